@@ -6,42 +6,23 @@ def writeRegisterTypes( f, listAgents ):
     f.write('void MpiFactory::registerTypes()\n')
     f.write('{\n')  
     for i in range(0, len(listAgents)):
-        f.write('\t_types.insert( std::make_pair( "'+listAgents[i]+'", create'+listAgents[i]+'Type()));\n')
+        f.write('\tregisterType("'+listAgents[i]+'", create'+listAgents[i]+'Type(), create'+listAgents[i]+'Package, create'+listAgents[i]+'Agent);\n')
     f.write('}\n')
     f.write('\n')
 
-def writeCreateDefaultPackage( f, listAgents ):
-    f.write('void * MpiFactory::createDefaultPackage( const std::string & type )\n')
+# creators registered in MpiFactory, so packages and agents are created by type id instead of comparing type names
+def writeCreateDefaultPackage( f, nameAgent ):
+    f.write('void * create'+nameAgent+'Package()\n')
     f.write('{\n')
-    for i in range(0, len(listAgents)):
-        f.write('\tif(type.compare("'+listAgents[i]+'")==0)\n')
-        f.write('\t{\n')
-        f.write('\t\treturn new '+listAgents[i]+'Package;\n')
-        f.write('\t}\n')
-    f.write('\n')
-    f.write('\tstd::stringstream oss;\n')
-    f.write('\toss << "MpiFactory::createDefaultPackage - unknown agent type: " << type;\n')
-    f.write('\tthrow Engine::Exception(oss.str());\n')
-    f.write('\treturn 0;\n')
+    f.write('\treturn new '+nameAgent+'Package;\n')
     f.write('}\n')
     f.write('\n')
     return None
 
-def writeCreateAndFillAgents( f, listAgents, namespaces ):
-    f.write('Agent * MpiFactory::createAndFillAgent( const std::string & type, void * package )\n')
+def writeCreateAndFillAgent( f, nameAgent, namespace ):
+    f.write('Agent * create'+nameAgent+'Agent( void * package )\n')
     f.write('{\n')
-    for i in range(0, len(listAgents)):
-        f.write('\tif(type.compare("'+listAgents[i]+'")==0)\n')
-        f.write('\t{\n')
-        f.write('\t\treturn new '+namespaces[i]+"::"+listAgents[i]+'(package);\n')
-        f.write('\t}\n')
-    f.write('\n')
-    f.write('\tstd::stringstream oss;\n')
-    f.write('\toss << "MpiFactory::createDefaultPackage - unknown agent type: " << type;\n')
-    f.write('\tthrow Engine::Exception(oss.str());\n')
-    f.write('\treturn 0;\n')
-
-
+    f.write('\treturn new '+namespace+"::"+nameAgent+'(package);\n')
     f.write('}\n')
     f.write('\n')
     return None
@@ -151,10 +132,10 @@ def createFactoryMethods( listAgents, factoryFile, namespaces, listAttributesMap
     
     for i in range(0, len(listAgents)):
         writeCreateType( f, listAgents[i], listAttributesMaps[i])
+        writeCreateDefaultPackage( f, listAgents[i] )
+        writeCreateAndFillAgent( f, listAgents[i], namespaces[i] )
 
     writeRegisterTypes( f, listAgents )
-    writeCreateDefaultPackage( f, listAgents )
-    writeCreateAndFillAgents( f, listAgents, namespaces )
 
     # close header & namespace
     f.write('} // namespace Engine\n')  
@@ -273,6 +254,23 @@ def writeVectorAttributesPassing( f, agentName, vectorAttributesMap ):
     f.write('}\n')
     f.write('\n')
 
+    # vector attributes appended to the buffer of the agent, used by SpacePartition to send agents in batches
+    f.write('void '+agentName+'::packVectorAttributes( Engine::MpiBuffer & buffer )\n')
+    f.write('{\n')
+    for nameAttribute in vectorAttributesMap.keys():
+        mpiType = getMpiTypeConversion(vectorAttributesMap[nameAttribute])
+        f.write('\tbuffer.pack('+nameAttribute+', '+mpiType+');\n')
+    f.write('}\n')
+    f.write('\n')
+
+    f.write('void '+agentName+'::unpackVectorAttributes( Engine::MpiBuffer & buffer )\n')
+    f.write('{\n')
+    for nameAttribute in vectorAttributesMap.keys():
+        mpiType = getMpiTypeConversion(vectorAttributesMap[nameAttribute])
+        f.write('\tbuffer.unpack('+nameAttribute+', '+mpiType+');\n')
+    f.write('}\n')
+    f.write('\n')
+
 def createMpiCode( agentName, source, header, namespace, parent, attributesMap, vectorAttributesMap ):
     print '\t\tcreating mpi file: mpiCode/'+agentName+'_mpi.cxx for agent: ' + agentName + ' in namespace: ' + namespace + ' with parent: ' + parent + ' from source: ' + source + ' and header: ' + header
     f = open('mpiCode/'+agentName+'_mpi.cxx', 'w')
@@ -283,6 +281,7 @@ def createMpiCode( agentName, source, header, namespace, parent, attributesMap,
     f.write('#include <cstring>\n')
     f.write('#include <mpi.h>\n')
     f.write('#include <typedefs.hxx>\n')
+    f.write('#include <MpiBuffer.hxx>\n')
     f.write('\n')
     if namespace!="":
         f.write('namespace '+namespace+'\n')
@@ -362,14 +361,21 @@ def getAttributesFromClass( className, attributesMap, vectorAttributesMap):
 
 def checkHeader(agentName, headerName):
     print '\tchecking if header: ' + headerName + ' for agent: ' + agentName + ' defines needed methods...'
-    # if this is not defined, we will add the four needed methods
+    # if this is not defined, we will add the needed methods
     fillPackageName = 'fillPackage'
+    packName = 'packVectorAttributes'
+    hasFillPackage = False
+    hasPack = False
     f = open(headerName, 'r')
     for line in f:
         if line.find(fillPackageName) != -1:
-            print '\theader: ' + headerName + ' correct'
-            return
+            hasFillPackage = True
+        if line.find(packName) != -1:
+            hasPack = True
     f.close()
+    if hasFillPackage and hasPack:
+        print '\theader: ' + headerName + ' correct'
+        return
     print '\theader: ' + headerName + ' does not contain parallel methods, adding...'
 
     headerNameTmp = headerName + '_tmp'
@@ -379,7 +385,13 @@ def checkHeader(agentName, headerName):
     insideClass = 0
     lastLine = ''
     for line in f:
-        if insideClass == 0:
+        if hasFillPackage:
+            # header generated by a previous version, only batched vector attributes are missing
+            fTmp.write(line)
+            if line.find('void receiveVectorAttributes(int);') != -1:
+                fTmp.write('\tvoid packVectorAttributes(Engine::MpiBuffer &);\n')
+                fTmp.write('\tvoid unpackVectorAttributes(Engine::MpiBuffer &);\n')
+        elif insideClass == 0:
             if line.find('class')!=-1 and line.find(agentName) != -1:
                 print 'accessing agent declaration: ' + agentName
                 insideClass = 1
@@ -396,6 +408,8 @@ def checkHeader(agentName, headerName):
             fTmp.write('\tvoid * fillPackage();\n')
             fTmp.write('\tvoid sendVectorAttributes(int);\n')
             fTmp.write('\tvoid receiveVectorAttributes(int);\n')
+            fTmp.write('\tvoid packVectorAttributes(Engine::MpiBuffer &);\n')
+            fTmp.write('\tvoid unpackVectorAttributes(Engine::MpiBuffer &);\n')
             fTmp.write('\t////////////////////////////////////////////////\n')
             fTmp.write('\t//////// End of generated code /////////////////\n')
             fTmp.write('\t////////////////////////////////////////////////\n')
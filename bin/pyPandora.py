@@ -22,6 +22,8 @@ class RectangleInt(libpyPandora.RectangleIntStub):
     def fromCoordinates(self, left, top, right, bottom):
         return RectangleInt(SizeInt(1+right-left, 1+bottom-top), Point2DInt(left, top))
 
+RasterValueType = libpyPandora.RasterValueType
+
 class StaticRaster(libpyPandora.StaticRasterStub):
     def __init__(self):
         libpyPandora.StaticRasterStub.__init__(self)
@@ -81,6 +81,8 @@ public:
 	void * fillPackage();
 	void sendVectorAttributes(int);
 	void receiveVectorAttributes(int);
+	void packVectorAttributes(Engine::MpiBuffer &);
+	void unpackVectorAttributes(Engine::MpiBuffer &);
 	////////////////////////////////////////////////
 	//////// End of generated code /////////////////
 	////////////////////////////////////////////////
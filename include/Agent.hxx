@@ -31,6 +31,7 @@
 namespace Engine
 {
 class Action;
+class MpiBuffer;
 
 //! Base class for all agents 
 /*!
@@ -49,6 +50,13 @@ private:
 	AttributesList _floatAttributes;
 	AttributesList _stringAttributes;
 
+	//! type of the agent, extracted from _id and cached
+	std::string _type;
+	//! integer id of _type inside GeneralState::agentTypes()
+	int _typeId;
+	//! sets _type and _typeId from the current _id
+	void updateType();
+
 protected:
 	/** Agent identifier **/
 	std::string _id;
@@ -112,7 +120,10 @@ public:
 	
 	// this function returns true if the type of the agent is the one passed by reference
 	bool isType( const std::string & type ) const;
-	virtual std::string getType() const;
+	//! faster version of isType using the id given by GeneralState::agentTypes()
+	bool isType( const int & typeId ) const { return _typeId==typeId; }
+	virtual const std::string & getType() const;
+	const int & getTypeId() const { return _typeId; }
 	
 	// defined in children, it must use serializeAttribute to save valuable data
 	virtual void serialize(){};
@@ -126,6 +137,10 @@ public:
 	virtual void * fillPackage() = 0;
 	virtual void sendVectorAttributes( int target ) = 0;
 	virtual void receiveVectorAttributes(int origin) = 0;
+	//! appends vector attributes to buffer, so they travel in the same message than the package of the agent
+	virtual void packVectorAttributes( MpiBuffer & buffer ){}
+	//! reads the vector attributes appended by packVectorAttributes
+	virtual void unpackVectorAttributes( MpiBuffer & buffer ){}
 
 	AttributesList::iterator beginStringAttributes(){ return _stringAttributes.begin(); }
 	AttributesList::iterator endStringAttributes(){ return _stringAttributes.end(); }
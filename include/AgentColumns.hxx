@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+
+#ifndef __AgentColumns_hxx__
+#define __AgentColumns_hxx__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace Engine
+{
+
+/** Attributes of the agents of one type, stored column by column
+  * Attribute names are resolved into integer column handles. Agents serialize their attributes in the same order,
+  * so once the first agent has been added every lookup is a single comparison with the name of the expected column
+  */
+class AgentColumns
+{
+	enum ColumnKind
+	{
+		eInt = 0,
+		eFloat = 1,
+		eString = 2
+	};
+
+	std::string _type;
+	std::vector<std::string> _intNames;
+	std::vector<std::string> _floatNames;
+	std::vector<std::string> _stringNames;
+	std::vector< std::vector<int> > _intColumns;
+	std::vector< std::vector<float> > _floatColumns;
+	std::vector< std::vector<std::string> > _stringColumns;
+	//! handle of every column, stored as index*3+kind
+	std::unordered_map<std::string, int> _handles;
+	//! columns filled by the first agent, in the order they were added
+	std::vector<int> _sequence;
+	size_t _position;
+	size_t _numAgents;
+
+	int addColumn( const std::string & name, ColumnKind kind, size_t numColumns );
+	//! column of kind 'kind' named 'name', expected at _position of _sequence
+	int resolve( const std::string & name, ColumnKind kind );
+public:
+	AgentColumns( const std::string & type = "" );
+	virtual ~AgentColumns();
+
+	const std::string & getType() const { return _type; }
+
+	//! registers a column and returns its handle; registering an existing column returns its handle
+	int addIntColumn( const std::string & name );
+	int addFloatColumn( const std::string & name );
+	int addStringColumn( const std::string & name );
+	//! returns the handle of the column, or -1 if it does not exist
+	int getIntHandle( const std::string & name ) const;
+	int getFloatHandle( const std::string & name ) const;
+	int getStringHandle( const std::string & name ) const;
+
+	//! starts the row of a new agent
+	void beginAgent();
+	void addInt( const std::string & name, int value ) { _intColumns[resolve(name, eInt)].push_back(value); }
+	void addFloat( const std::string & name, float value ) { _floatColumns[resolve(name, eFloat)].push_back(value); }
+	void addString( const std::string & name, const std::string & value ) { _stringColumns[resolve(name, eString)].push_back(value); }
+	size_t getNumAgents() const { return _numAgents; }
+
+	size_t getNumIntColumns() const { return _intColumns.size(); }
+	size_t getNumFloatColumns() const { return _floatColumns.size(); }
+	size_t getNumStringColumns() const { return _stringColumns.size(); }
+	const std::string & getIntName( int handle ) const { return _intNames[handle]; }
+	const std::string & getFloatName( int handle ) const { return _floatNames[handle]; }
+	const std::string & getStringName( int handle ) const { return _stringNames[handle]; }
+	std::vector<int> & getIntColumn( int handle ) { return _intColumns[handle]; }
+	std::vector<float> & getFloatColumn( int handle ) { return _floatColumns[handle]; }
+	std::vector<std::string> & getStringColumn( int handle ) { return _stringColumns[handle]; }
+	const std::vector<int> & getIntColumn( int handle ) const { return _intColumns[handle]; }
+	const std::vector<float> & getFloatColumn( int handle ) const { return _floatColumns[handle]; }
+	const std::vector<std::string> & getStringColumn( int handle ) const { return _stringColumns[handle]; }
+
+	//! moves the values into 'columns', registering the columns of this type in it if needed. The previous values of 'columns' are cleared and kept here, so their capacity is reused
+	void moveValues( AgentColumns & columns );
+	//! removes the values, keeping the columns and their capacity
+	void clear();
+};
+
+} // namespace Engine
+
+#endif // __AgentColumns_hxx__
@@ -24,54 +24,50 @@
 #define __AgentRecord_hxx__
 
 #include <map>
-#include <vector>
 #include <string>
 
 namespace Engine
 {
 
+class AgentTable;
+
+/** View of the recorded history of one agent, whose values are stored by the AgentTable of its type
+  */
 class AgentRecord
 {
-	typedef std::vector<int> IntValues;
-	typedef std::vector<float> FloatValues;
-	typedef std::vector<std::string> StrValues;
-
 public:
-	typedef std::map<std::string, IntValues > IntAttributesMap;
-	typedef std::map<std::string, FloatValues > FloatAttributesMap;
-	typedef std::map<std::string, StrValues > StrAttributesMap;
+	//! column of every attribute, by name
+	typedef std::map<std::string, int> IntAttributesMap;
+	typedef std::map<std::string, int> FloatAttributesMap;
+	typedef std::map<std::string, int> StrAttributesMap;
 
 private:
-	std::string _id;
-	// total number of steps in simulation (not agent life)
-	int _numSteps;
-	IntAttributesMap _intAttributes;
-	FloatAttributesMap _floatAttributes;
-	StrAttributesMap _strAttributes;
+	const AgentTable * _table;
+	const std::string * _id;
+	int _index;
 public:
-	AgentRecord( const std::string & id, int numSteps );
+	AgentRecord( const AgentTable & table, const std::string & id, int index );
 	virtual ~AgentRecord();
-	
-	void addInt( int numStep, const std::string & id, int value );
-	void addFloat( int numStep, const std::string & id, float value );
-	void addStr( int numStep, const std::string & id, const std::string & value );
 
 	int getInt( int numStep, const std::string & key ) const;
 	float getFloat( int numStep, const std::string & key ) const;
 	const std::string & getStr( int numStep, const std::string & key ) const;
 	std::string getCompleteState( int numStep ) const;
 
-	IntAttributesMap::const_iterator beginInt() const { return _intAttributes.begin(); }
-	IntAttributesMap::const_iterator endInt() const { return _intAttributes.end(); }
+	IntAttributesMap::const_iterator beginInt() const;
+	IntAttributesMap::const_iterator endInt() const;
 
-	FloatAttributesMap::const_iterator beginFloat() const { return _floatAttributes.begin(); }
-	FloatAttributesMap::const_iterator endFloat() const { return _floatAttributes.end(); }
+	FloatAttributesMap::const_iterator beginFloat() const;
+	FloatAttributesMap::const_iterator endFloat() const;
 
-	StrAttributesMap::const_iterator beginStr() const { return _strAttributes.begin(); }
-	StrAttributesMap::const_iterator endStr() const { return _strAttributes.end(); }
+	StrAttributesMap::const_iterator beginStr() const;
+	StrAttributesMap::const_iterator endStr() const;
 
-	const std::string & getId() const { return _id; }
-	int getNumSteps() const { return _numSteps; }
+	const std::string & getId() const { return *_id; }
+	int getNumSteps() const;
+	//! position of the agent in the columns of its table
+	int getIndex() const { return _index; }
+	const AgentTable & getTable() const { return *_table; }
 
     bool isInt( const std::string & key ) const;
     bool isFloat( const std::string & key ) const;
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+
+#ifndef __AgentTable_hxx__
+#define __AgentTable_hxx__
+
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <AgentRecord.hxx>
+#include <Point2D.hxx>
+
+namespace Engine
+{
+
+/** Aggregate of the values of a numerical attribute, as computed by AgentTable::aggregate
+  */
+struct AttributeStats
+{
+	size_t _count;
+	double _sum;
+	double _min;
+	double _max;
+
+	AttributeStats();
+	double getMean() const { return _sum/_count; }
+	void add( const double & value )
+	{
+		_count++;
+		_sum += value;
+		_min = value<_min ? value : _min;
+		_max = value>_max ? value : _max;
+	}
+	//! adds the values aggregated by 'stats'
+	void merge( const AttributeStats & stats );
+};
+
+/** Recorded history of the agents of one type, stored column by column
+  * Every attribute is a dense array of [step][agent index] values, and agent ids are translated into indices once.
+  * The values of an agent that does not exist in a step are 0, or an empty string
+  */
+class AgentTable
+{
+public:
+	//! records of the agents, by id
+	typedef std::map<std::string, AgentRecord *> RecordsMap;
+	//! column of every attribute, by name
+	typedef std::map<std::string, int> ColumnsMap;
+
+private:
+	std::string _type;
+	//! total number of steps in simulation (not agent life)
+	int _numSteps;
+	RecordsMap _records;
+	//! views of the agents, by index. A deque keeps their addresses while agents are added
+	std::deque<AgentRecord> _views;
+
+	ColumnsMap _intColumns;
+	ColumnsMap _floatColumns;
+	ColumnsMap _strColumns;
+	//! values of each column, as [column][step][agent index]
+	std::vector< std::vector< std::vector<int> > > _intValues;
+	std::vector< std::vector< std::vector<float> > > _floatValues;
+	//! string attributes store codes of _strings, where code 0 is the empty string
+	std::vector< std::vector< std::vector<int> > > _strValues;
+	std::vector<std::string> _strings;
+	std::unordered_map<std::string, int> _stringCodes;
+	int _existsColumn;
+	//! position key and index of the agents existing in each step, sorted by key. Built the first time a step is queried
+	mutable std::vector< std::vector< std::pair<long long, int> > > _positions;
+
+	AgentTable( const AgentTable & );
+	AgentTable & operator=( const AgentTable & );
+
+	//! returns the column 'name' of 'columns', adding it to 'values' if it does not exist
+	template<typename Type> int addColumn( const std::string & name, ColumnsMap & columns, std::vector< std::vector< std::vector<Type> > > & values );
+	static int getColumn( const std::string & name, const ColumnsMap & columns );
+	//! throws if [firstStep, lastStep] is not a range of stored steps
+	void checkSteps( const std::string & method, int firstStep, int lastStep ) const;
+	template<typename Type> void aggregateStep( const std::vector<int> & exists, const std::vector<Type> & values, AttributeStats & stats ) const;
+	template<typename Type> void histogramStep( const std::vector<int> & exists, const std::vector<Type> & values, double minValue, double interval, std::vector<size_t> & bins ) const;
+	static long long getPositionKey( int x, int y ) { return ((long long)y<<32) | (unsigned int)x; }
+public:
+	AgentTable();
+	virtual ~AgentTable();
+
+	//! removes every agent and attribute
+	void init( const std::string & type, int numSteps );
+	const std::string & getType() const { return _type; }
+	int getNumSteps() const { return _numSteps; }
+
+	//! returns the index of the agent 'id', adding it if it does not exist
+	int addAgent( const std::string & id );
+	//! returns the index of the agent 'id', or -1 if it does not exist
+	int getAgentIndex( const std::string & id ) const;
+	size_t getNumAgents() const { return _views.size(); }
+	const AgentRecord & getRecord( int index ) const { return _views[index]; }
+	RecordsMap::const_iterator beginRecords() const { return _records.begin(); }
+	RecordsMap::const_iterator endRecords() const { return _records.end(); }
+
+	//! registers a column and returns it; registering an existing column returns it
+	int addIntColumn( const std::string & name );
+	int addFloatColumn( const std::string & name );
+	int addStrColumn( const std::string & name );
+	//! returns the column of the attribute, or -1 if it does not exist
+	int getIntColumn( const std::string & name ) const { return getColumn(name, _intColumns); }
+	int getFloatColumn( const std::string & name ) const { return getColumn(name, _floatColumns); }
+	int getStrColumn( const std::string & name ) const { return getColumn(name, _strColumns); }
+	//! int column storing 1 for the agents that exist in each step
+	int getExistsColumn() const { return _existsColumn; }
+
+	const ColumnsMap & getIntColumns() const { return _intColumns; }
+	const ColumnsMap & getFloatColumns() const { return _floatColumns; }
+	const ColumnsMap & getStrColumns() const { return _strColumns; }
+
+	//! values of a column at 'step', sized to the number of agents so they can be filled by index
+	std::vector<int> & getIntStep( int column, int step );
+	std::vector<float> & getFloatStep( int column, int step );
+	std::vector<int> & getStrStep( int column, int step );
+	//! values of a column at 'step'. Agents added after the step was filled are not included
+	const std::vector<int> & getIntStep( int column, int step ) const { return _intValues[column].at(step); }
+	const std::vector<float> & getFloatStep( int column, int step ) const { return _floatValues[column].at(step); }
+	const std::vector<int> & getStrStep( int column, int step ) const { return _strValues[column].at(step); }
+
+	int getInt( int column, int step, int index ) const
+	{
+		const std::vector<int> & values = getIntStep(column, step);
+		return size_t(index)<values.size() ? values[index] : 0;
+	}
+	float getFloat( int column, int step, int index ) const
+	{
+		const std::vector<float> & values = getFloatStep(column, step);
+		return size_t(index)<values.size() ? values[index] : 0.0f;
+	}
+	const std::string & getStr( int column, int step, int index ) const
+	{
+		const std::vector<int> & values = getStrStep(column, step);
+		return _strings[size_t(index)<values.size() ? values[index] : 0];
+	}
+
+	//! returns the code of 'value' in the string columns, adding it if needed
+	int encodeString( const std::string & value );
+	const std::string & getString( int code ) const { return _strings[code]; }
+
+	//! adds to 'stats' the int or float attribute of the agents existing in each step of [firstStep, lastStep]
+	void aggregate( const std::string & attribute, int firstStep, int lastStep, AttributeStats & stats ) const;
+	//! counts the values of the agents existing in each step of [firstStep, lastStep] in bins of width 'interval' starting at minValue
+	//! bins are added as needed, and lower values are ignored
+	void histogram( const std::string & attribute, int firstStep, int lastStep, double minValue, double interval, std::vector<size_t> & bins ) const;
+	//! adds to 'indices' the agents located at 'position' in 'step'
+	void getAgentsAt( int step, const Point2D<int> & position, std::vector<int> & indices ) const;
+};
+
+} // namespace Engine
+
+#endif // __AgentTable_hxx__
+
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __AgentTypes_hxx__
+#define __AgentTypes_hxx__
+
+#include <string>
+#include <deque>
+#include <unordered_map>
+
+namespace Engine
+{
+
+//! registry assigning a small integer id to each agent type, so type checks compare integers instead of strings
+//! agents may be created or change their type inside parallel actions, so every method shares the critical section agentTypes
+class AgentTypes
+{
+	//! a deque keeps the names returned by getName valid while new types are registered
+	std::deque<std::string> _names;
+	std::unordered_map<std::string, int> _ids;
+public:
+	AgentTypes();
+	virtual ~AgentTypes();
+
+	//! returns the id of type, registering it if it is new
+	int registerType( const std::string & type );
+	//! returns the id of an already registered type, or -1 if no agent has ever been created with this type
+	int getId( const std::string & type ) const;
+	const std::string & getName( const int & id ) const;
+	size_t getNumTypes() const;
+};
+
+} // namespace Engine
+
+#endif // __AgentTypes_hxx__
+
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __Compression_hxx__
+#define __Compression_hxx__
+
+#include <hdf5.h>
+#include <vector>
+#include <Rectangle.hxx>
+#include <typedefs.hxx>
+
+namespace Engine
+{
+
+struct RasterSnapshot;
+
+//! previous serialized step of a dynamic raster, reference of the delta encoded steps that follow it
+struct DeltaReference
+{
+	DeltaReference() : _step(-1), _numDeltas(0) {}
+	int _step;
+	//! delta encoded steps written since the last complete step
+	int _numDeltas;
+	Rectangle<int> _area;
+	std::vector<int> _values;
+};
+
+/** Compression contains the HDF5 filters and delta encoding used by the serializers
+  * LZ4 and Zstd are HDF5 plugins loaded at runtime; if they are not found the datasets are compressed with deflate
+  */
+class Compression
+{
+public:
+	//! HDF5 ids of the LZ4 and Zstd plugins, as registered by the HDF Group
+	static const H5Z_filter_t _lz4Filter = 32004;
+	static const H5Z_filter_t _zstdFilter = 32015;
+	//! a complete step is written after this number of delta encoded steps, bounding the steps read to load one of them
+	static const int _maxDeltas = 16;
+	//! chunks of raster datasets have at most this number of cells in each dimension
+	static const hsize_t _rasterChunkSize = 256;
+	//! agent datasets chunks hold at most this number of agents
+	static const hsize_t _agentChunkSize = 20000;
+
+	//! codec that will be used for 'codec', which is eCodecDeflate if the plugin is not available
+	static CompressionCodec getAvailableCodec( const CompressionCodec & codec );
+	//! adds the filters of 'codec' to dataset creation list 'propertyListId', which must be chunked
+	static void setFilters( const hid_t & propertyListId, const CompressionCodec & codec, const int & level, const bool & shuffle );
+	//! HDF5 type of delta encoded datasets of rasters with 'valueType', wide enough to store any difference between two values
+	static hid_t getDeltaFileType( const RasterValueType & valueType );
+	//! stores in 'deltas' the difference between 'snapshot' and 'reference' if they cover the same area and the last complete step is recent enough; updates 'reference' with 'snapshot'
+	static bool encodeDelta( DeltaReference & reference, const RasterSnapshot & snapshot, std::vector<int> & deltas );
+	//! adds 'deltas' to 'values', undoing encodeDelta
+	static void decodeDelta( std::vector<int> & values, const std::vector<int> & deltas );
+};
+
+} // namespace Engine
+
+#endif // __Compression_hxx__
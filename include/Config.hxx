@@ -26,6 +26,7 @@
 #include <cstdlib>
 #include <string>
 #include <Size.hxx>
+#include <typedefs.hxx>
 
 class TiXmlDocument;
 class TiXmlElement;
@@ -51,6 +52,15 @@ protected:
 	int _serializeResolution;
 	// xml config file (if it exists)
 	std::string _configFile;
+	// seed of random streams (0 means a random seed)
+	unsigned _randomSeed;
+	// compression of raster and agent datasets
+	CompressionCodec _compression;
+	int _compressionLevel;
+	// shuffle the bytes of the values before compressing them
+	bool _shuffle;
+	// store each step of dynamic rasters as the difference with the previous serialized step
+	bool _deltaEncoding;
 
 
     TiXmlElement * findElement( const std::string & elementPath );
@@ -75,6 +85,13 @@ public:
 	const int & getNumSteps() const;
 	const int & getSerializeResolution() const;
 	const std::string & getResultsFile() const{return _resultsFile; }
+	const unsigned & getRandomSeed() const{return _randomSeed; }
+	void setRandomSeed( const unsigned & randomSeed ){_randomSeed = randomSeed; }
+	const CompressionCodec & getCompression() const{return _compression; }
+	const int & getCompressionLevel() const{return _compressionLevel; }
+	bool getShuffle() const{return _shuffle; }
+	bool getDeltaEncoding() const{return _deltaEncoding; }
+	void setCompression( const CompressionCodec & codec, const int & level = 4, bool shuffle = true, bool deltaEncoding = false ){_compression = codec; _compressionLevel = level; _shuffle = shuffle; _deltaEncoding = deltaEncoding; }
 	virtual void loadParams(){};    
   
 	std::string getParamStrFromElem(TiXmlElement* elem, const std::string & attrName);
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __DomainDecomposition_hxx__
+#define __DomainDecomposition_hxx__
+
+#include <Rectangle.hxx>
+#include <Size.hxx>
+#include <Point2D.hxx>
+#include <vector>
+
+namespace Engine
+{
+
+/** DomainDecomposition splits the space of a simulation into a grid of rectangular partitions, one for each computer node
+  * Any number of partitions is accepted: the grid is the factorization closest to square partitions
+  * Columns and rows can have different sizes, so partitions in the same column share width and partitions in the same row share height
+  * Boundaries are always even, as each partition is divided in 4 sections
+  */
+class DomainDecomposition
+{
+	Size<int> _size;
+	//! number of columns and rows of the grid
+	Size<int> _numPartitions;
+	//! minimum width and height of a partition
+	int _minimumSize;
+	//! first cell of each column, followed by the width of the space
+	std::vector<int> _columns;
+	//! first cell of each row, followed by the height of the space
+	std::vector<int> _rows;
+
+	//! uniform split of size into parts, with even boundaries
+	static std::vector<int> splitUniform( const int & size, const int & parts );
+public:
+	DomainDecomposition();
+	virtual ~DomainDecomposition();
+
+	//! chooses the grid of numPartitions for a space of size, with boundaries as uniform as possible
+	void init( const Size<int> & size, const int & numPartitions, const int & minimumSize );
+	//! moves boundaries so every column has a similar sum of columnCosts and every row a similar sum of rowCosts. Returns true if any boundary changed
+	bool balance( const std::vector<double> & columnCosts, const std::vector<double> & rowCosts );
+	//! splits costs into parts of similar total cost, with even sizes of at least minimumSize. Returns the origin of each part followed by costs.size()
+	static std::vector<int> split( const std::vector<double> & costs, const int & parts, const int & minimumSize );
+
+	const Size<int> & getNumPartitions() const;
+	//! column and row of partition id
+	Point2D<int> getPartitionPosition( const int & id ) const;
+	//! id of the partition owning position, in global coordinates
+	int getPartitionId( const Point2D<int> & position ) const;
+	//! area owned by partition id
+	Rectangle<int> getArea( const int & id ) const;
+	//! area owned by partition id extended with overlap, except at the borders of the space
+	Rectangle<int> getBoundaries( const int & id, const int & overlap ) const;
+};
+
+} // namespace Engine
+
+#endif // __DomainDecomposition_hxx__
+
@@ -26,6 +26,8 @@
 #include <Point2D.hxx>
 #include <Size.hxx>
 #include <StaticRaster.hxx>
+#include <RasterKernels.hxx>
+#include <algorithm>
 
 namespace Engine
 {
@@ -33,7 +35,9 @@ namespace Engine
 //! DynamicRaster adds mechanisms to modify the values of the raster map. It is serialized each time step.
 class DynamicRaster : public StaticRaster
 {
-	std::vector< std::vector<int> >	_maxValues;
+protected:
+	//! maximum value of each cell, with the same layout than _values
+	Values _maxValues;
 	int	_currentMaxValue;
 	int	_currentMinValue;
 public:
@@ -46,29 +50,121 @@ public:
 
 	// parameters: starting pos and size in matrix to grow
 	//! Increases each cell value by 1 if it is under the maximum allowed.
-	void updateRasterIncrement();
+	virtual void updateRasterIncrement();
 	// parameters: starting pos and size in matrix to grow
 	//! Assigns to each cell in raster the max value allowed for it.
-	void updateRasterToMaxValues();
+	virtual void updateRasterToMaxValues();
 	
-	//! Reads the maximum allowed value in the cell located by parameter "position". Returns -1 if "position" is out of the area of the raster.
+	//! Reads the maximum allowed value in the cell located by parameter "position". Bounds are only checked if PANDORADEBUG is defined
 	virtual int getMaxValue( const Point2D<int>& position ) const;
 	
-	//! Assigns the value "value" to the cell located by parameter "position". Does nothing if "position" is out of the area of the raster.
+	//! Assigns the value "value" to the cell located by parameter "position". Throws an Exception if value is bigger than the maximum of the cell; bounds are only checked if PANDORADEBUG is defined
 	virtual void setValue( const Point2D<int>& position, int value );
-	//! Changes the maximum value allowed in the cell located by parameter "position" to the new amount "value". Does nothing if "position" is out of the area of the raster.
-	void setMaxValue( const Point2D<int>& position, int value );
+	//! Changes the maximum value allowed in the cell located by parameter "position" to the new amount "value". Bounds are only checked if PANDORADEBUG is defined
+	virtual void setMaxValue( const Point2D<int>& position, int value );
+	//! copies 'width' maximum values of row y, starting at column x
+	virtual void copyMaxRow( const int & y, const int & x, const int & width, int * values ) const;
+	//! replaces 'width' cells of row y starting at column x. Used for cells received from other computer nodes, so maximum values are not checked
+	virtual void setRow( const int & y, const int & x, const int & width, const int * values );
+	virtual void setMaxRow( const int & y, const int & x, const int & width, const int * values );
+
+	//! non-virtual versions of getMaxValue and setValue, to be used in loops that already know the size of the raster. Maximum values are not checked
+	//! like the rest of dense accessors they throw an Exception if cells are not stored as int (i.e. tiled and narrow rasters)
+	const int & getMaxValueUnchecked( const Point2D<int>& position ) const
+	{
+		// tiled and narrow rasters leave the dense buffers empty
+		if(_maxValues.empty())
+		{
+			throwNotDense("DynamicRaster::getMaxValueUnchecked");
+		}
+#ifdef PANDORADEBUG
+		checkBounds(position, "DynamicRaster::getMaxValueUnchecked");
+#endif
+		return _maxValues[getIndex(position)];
+	}
+	void setValueUnchecked( const Point2D<int>& position, int value )
+	{
+		// tiled and narrow rasters leave the dense buffers empty
+		if(_values.empty())
+		{
+			throwNotDense("DynamicRaster::setValueUnchecked");
+		}
+#ifdef PANDORADEBUG
+		checkBounds(position, "DynamicRaster::setValueUnchecked");
+#endif
+		_values[getIndex(position)] = value;
+	}
+	//! writable version of StaticRaster::getRow; values are not checked against their maximums
+	int * getRow( const int & y )
+	{
+		// tiled and narrow rasters leave the dense buffers empty
+		if(_values.empty())
+		{
+			throwNotDense("DynamicRaster::getRow");
+		}
+#ifdef PANDORADEBUG
+		checkBounds(Point2D<int>(0, y), "DynamicRaster::getRow");
+#endif
+		return &_values[size_t(y)*_size._width];
+	}
+	using StaticRaster::getRow;
+	//! returns the maximum values of row y
+	const int * getMaxValuesRow( const int & y ) const
+	{
+		// tiled and narrow rasters leave the dense buffers empty
+		if(_maxValues.empty())
+		{
+			throwNotDense("DynamicRaster::getMaxValuesRow");
+		}
+#ifdef PANDORADEBUG
+		checkBounds(Point2D<int>(0, y), "DynamicRaster::getMaxValuesRow");
+#endif
+		return &_maxValues[size_t(y)*_size._width];
+	}
 	
 	//! Initializes the components of vector '_values' to defaultValue, and to maxValue the ones from vector _maxValue.
-	void setInitValues( int minValue, int maxValue, int defaultValue );
+	virtual void setInitValues( int minValue, int maxValue, int defaultValue );
 	//! Sets new value for attribute maxValue.
 	void setMaxValue( const int & maxValue);
 	//! Sets new value for attribute minValue.
 	void setMinValue( const int & minValue);
 	void resize( const Size<int> & size );
+	void setLoadedValues( const std::vector<int> & values );
 	
 	void updateCurrentMinMaxValues();
 
+	//! replaces the value of each cell with min(functor(value, maxValue), maxValue)
+	/** Rows are shared among OpenMP threads for big rasters, so functor must be callable concurrently. If it can be inlined the compiler will vectorize the loop, so stepRaster overrides get the same performance than built-in updates
+	  * Tiled and narrow rasters, without dense buffers, are transformed serially through getValue, getMaxValue and setValue, so narrow types still check the range of results */
+	template<class Functor> void transform( Functor functor )
+	{
+		int numRows = _size._height;
+		int width = _size._width;
+		if(_values.size()<size_t(numRows)*width)
+		{
+			for(int y=0; y<numRows; y++)
+			{
+				for(int x=0; x<width; x++)
+				{
+					Point2D<int> position(x, y);
+					int maxValue = getMaxValue(position);
+					setValue(position, std::min(functor(getValue(position), maxValue), maxValue));
+				}
+			}
+			return;
+		}
+		#pragma omp parallel for schedule(static) if(_values.size()>=RasterKernels::_parallelThreshold)
+		for(int y=0; y<numRows; y++)
+		{
+			int * row = &_values[size_t(y)*width];
+			const int * maxRow = &_maxValues[size_t(y)*width];
+			for(int x=0; x<width; x++)
+			{
+				row[x] = std::min(functor(row[x], maxRow[x]), maxRow[x]);
+			}
+		}
+	}
+
 	int  getCurrentMinValue() const { return _currentMinValue; }
 	int  getCurrentMaxValue() const { return _currentMaxValue; }
 
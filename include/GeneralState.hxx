@@ -6,6 +6,7 @@
 #include <Statistics.hxx>
 #include <RasterLoader.hxx>
 #include <ShpLoader.hxx>
+#include <AgentTypes.hxx>
 
 namespace Engine
 {
@@ -19,6 +20,8 @@ class GeneralState
 	Statistics _statistics;
 	RasterLoader _rasterLoader;
 	ShpLoader _shpLoader;
+	//! integer ids of agent types
+	AgentTypes _agentTypes;
 
 protected:
 	GeneralState();
@@ -46,6 +49,11 @@ public:
 	{
 		return instance()._shpLoader;
 	}
+
+	static AgentTypes & agentTypes()
+	{
+		return instance()._agentTypes;
+	}
 };
 
 } // namespace Engine
@@ -43,7 +43,8 @@ public:
 	virtual void		resize(  const Size<int> & size );
 
 	void 		setValue( const Point2D<int> & pos, int value );
-	const int& 	getValue( const Point2D<int> & pos ) const;
+	int 		getValue( const Point2D<int> & pos ) const;
+	void		copyRow( const int & y, const int & x, const int & width, int * values ) const;
 	int getMaxValue( const Point2D<int> & position ) const;
 
 	int			getCurrentMinValue() const { return _currentMinValue; }
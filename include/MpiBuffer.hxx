@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __MpiBuffer_hxx__
+#define __MpiBuffer_hxx__
+
+#include <mpi.h>
+#include <vector>
+
+namespace Engine
+{
+
+/** MpiBuffer packs heterogeneous data (agent packages, counts, vector attributes) into a single MPI_PACKED message
+  * The memory is kept between uses, so a buffer reused at each step does not need to allocate again once it has grown
+  */
+class MpiBuffer
+{
+	std::vector<char> _data;
+	//! number of bytes packed, or position of the next element to unpack
+	int _position;
+
+	//! grows _data until size bytes can be packed after _position
+	void reserve( const int & size );
+public:
+	MpiBuffer();
+	virtual ~MpiBuffer();
+
+	//! removes packed data, keeping the allocated memory
+	void clear();
+	//! number of bytes packed
+	const int & getSize() const;
+
+	void pack( const void * data, const int & count, MPI_Datatype type );
+	void unpack( void * data, const int & count, MPI_Datatype type );
+	void pack( const int & value );
+	void unpack( int & value );
+
+	//! packs the size of the vector followed by its elements
+	template <typename T> void pack( const std::vector<T> & values, MPI_Datatype type )
+	{
+		pack((int)values.size());
+		if(!values.empty())
+		{
+			pack(&values[0], values.size(), type);
+		}
+	}
+	//! resizes values and fills it with the elements packed by pack(const std::vector<T> &, MPI_Datatype)
+	template <typename T> void unpack( std::vector<T> & values, MPI_Datatype type )
+	{
+		int size = 0;
+		unpack(size);
+		values.resize(size);
+		if(size>0)
+		{
+			unpack(&values[0], size, type);
+		}
+	}
+
+	//! starts a non-blocking send of the packed data. The buffer must not be modified until request is completed
+	void send( const int & target, const int & tag, MPI_Request * request );
+	//! blocks until a message from origin with tag arrives and stores it, ready to be unpacked
+	void receive( const int & origin, const int & tag );
+	//! collective call sending to each task the data packed between offsets[task] and offsets[task+1]. received stores the data of every task, in order of task
+	void allToAll( const std::vector<int> & offsets, MpiBuffer & received );
+};
+
+} // namespace Engine
+
+#endif // __MpiBuffer_hxx__
+
@@ -26,6 +26,7 @@
 #include <string>
 #include <mpi.h>
 #include <map>
+#include <vector>
 
 namespace Engine
 {
@@ -37,6 +38,8 @@ class MpiFactory
 {
 public:
 	typedef std::map< std::string, MPI_Datatype *> TypesMap;
+	typedef void * (*PackageCreator)();
+	typedef Agent * (*AgentCreator)( void * package );
 
 private:
 	static MpiFactory * _instance;
@@ -44,6 +47,9 @@ private:
 	MpiFactory();
 	
 	TypesMap _types;
+	//! creators of packages and agents, indexed by the id of the type in GeneralState::agentTypes()
+	std::vector<PackageCreator> _packageCreators;
+	std::vector<AgentCreator> _agentCreators;
 
 public:
 	static MpiFactory * instance();
@@ -53,9 +59,13 @@ public:
 	void registerTypes();
 	//! method to delete from mpi stack all the created types
 	void cleanTypes();
+	//! adds the mpi type and creators of an agent type; called by registerTypes
+	void registerType( const std::string & type, MPI_Datatype * mpiType, PackageCreator packageCreator, AgentCreator agentCreator );
 
 	void * createDefaultPackage( const std::string & type );
+	void * createDefaultPackage( const int & typeId );
 	Agent * createAndFillAgent( const std::string & type, void * package );
+	Agent * createAndFillAgent( const int & typeId, void * package );
 
 	TypesMap::iterator beginTypes();
 	TypesMap::iterator endTypes();
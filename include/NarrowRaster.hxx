@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __NarrowRaster_hxx__
+#define __NarrowRaster_hxx__
+
+#include <DynamicRaster.hxx>
+#include <RasterKernels.hxx>
+#include <Exception.hxx>
+#include <typedefs.hxx>
+
+#include <vector>
+#include <limits>
+#include <sstream>
+#include <algorithm>
+
+namespace Engine
+{
+
+//! relation between the C++ types used by narrow rasters and RasterValueType
+template<typename Type> struct RasterValueTraits;
+
+template<> struct RasterValueTraits<short>
+{
+	static RasterValueType getType() { return eRasterShort; }
+};
+
+template<> struct RasterValueTraits<unsigned char>
+{
+	static RasterValueType getType() { return eRasterByte; }
+};
+
+//! throws an Exception if value can't be stored in a cell of type Type
+template<typename Type> void checkNarrowValue( const int & value, const std::string & method )
+{
+	if(value<int(std::numeric_limits<Type>::min()) || value>int(std::numeric_limits<Type>::max()))
+	{
+		std::stringstream oss;
+		oss << method << " - value: " << value << " out of range [" << int(std::numeric_limits<Type>::min()) << "," << int(std::numeric_limits<Type>::max()) << "] of raster type: " << RasterValueTraits<Type>::getType();
+		throw Exception(oss.str());
+	}
+}
+
+/** NarrowStaticRaster stores its cells with a type smaller than int (i.e. unsigned char for boolean or category layers)
+  * Values are still read and written as int. getRow and getValueUnchecked need an int raster and throw an Exception
+  */
+template<typename Type> class NarrowStaticRaster : public StaticRaster
+{
+public:
+	typedef std::vector<Type, boost::alignment::aligned_allocator<Type, 64> > NarrowValues;
+protected:
+	NarrowValues _narrowValues;
+
+	void getStats( int & minValue, int & maxValue, long long & sum ) const
+	{
+		minValue = std::numeric_limits<int>::max();
+		maxValue = std::numeric_limits<int>::min();
+		sum = 0;
+		for(size_t i=0; i<_narrowValues.size(); i++)
+		{
+			minValue = std::min(minValue, int(_narrowValues[i]));
+			maxValue = std::max(maxValue, int(_narrowValues[i]));
+			sum += _narrowValues[i];
+		}
+	}
+
+	void setLoadedValues( const std::vector<int> & values )
+	{
+		for(size_t i=0; i<_narrowValues.size(); i++)
+		{
+			checkNarrowValue<Type>(values[i], "NarrowStaticRaster::setLoadedValues");
+			_narrowValues[i] = Type(values[i]);
+		}
+	}
+public:
+	void resize( const Size<int> & size )
+	{
+		_size = size;
+		_values.clear();
+		_narrowValues.resize(size_t(size._width)*size._height);
+	}
+
+	int getValue( const Point2D<int>& position ) const
+	{
+#ifdef PANDORADEBUG
+		checkBounds(position, "NarrowStaticRaster::getValue");
+#endif
+		return _narrowValues[getIndex(position)];
+	}
+
+	void copyRow( const int & y, const int & x, const int & width, int * values ) const
+	{
+		const Type * row = &_narrowValues[getIndex(Point2D<int>(x, y))];
+		std::copy(row, row+width, values);
+	}
+
+	RasterValueType getValueType() const { return RasterValueTraits<Type>::getType(); }
+};
+
+/** NarrowDynamicRaster is the DynamicRaster version of NarrowStaticRaster. Values and max values are stored with Type
+  * getRow and the unchecked accessors need an int raster and throw an Exception; transform falls back to the virtual accessors
+  */
+template<typename Type> class NarrowDynamicRaster : public DynamicRaster
+{
+public:
+	typedef std::vector<Type, boost::alignment::aligned_allocator<Type, 64> > NarrowValues;
+protected:
+	NarrowValues _narrowValues;
+	NarrowValues _narrowMaxValues;
+
+	void getStats( int & minValue, int & maxValue, long long & sum ) const
+	{
+		minValue = std::numeric_limits<int>::max();
+		maxValue = std::numeric_limits<int>::min();
+		sum = 0;
+		for(size_t i=0; i<_narrowValues.size(); i++)
+		{
+			minValue = std::min(minValue, int(_narrowValues[i]));
+			maxValue = std::max(maxValue, int(_narrowValues[i]));
+			sum += _narrowValues[i];
+		}
+	}
+
+	void setLoadedValues( const std::vector<int> & values )
+	{
+		for(size_t i=0; i<_narrowValues.size(); i++)
+		{
+			checkNarrowValue<Type>(values[i], "NarrowDynamicRaster::setLoadedValues");
+			_narrowValues[i] = Type(values[i]);
+		}
+		_narrowMaxValues = _narrowValues;
+	}
+public:
+	void resize( const Size<int> & size )
+	{
+		_size = size;
+		_values.clear();
+		_maxValues.clear();
+		_narrowValues.resize(size_t(size._width)*size._height);
+		_narrowMaxValues.resize(_narrowValues.size());
+	}
+
+	int getValue( const Point2D<int>& position ) const
+	{
+#ifdef PANDORADEBUG
+		checkBounds(position, "NarrowDynamicRaster::getValue");
+#endif
+		return _narrowValues[getIndex(position)];
+	}
+
+	void copyRow( const int & y, const int & x, const int & width, int * values ) const
+	{
+		const Type * row = &_narrowValues[getIndex(Point2D<int>(x, y))];
+		std::copy(row, row+width, values);
+	}
+
+	int getMaxValue( const Point2D<int>& position ) const
+	{
+#ifdef PANDORADEBUG
+		checkBounds(position, "NarrowDynamicRaster::getMaxValue");
+#endif
+		return _narrowMaxValues[getIndex(position)];
+	}
+
+	void setValue( const Point2D<int>& position, int value )
+	{
+#ifdef PANDORADEBUG
+		checkBounds(position, "NarrowDynamicRaster::setValue");
+#endif
+		size_t index = getIndex(position);
+		if(value>_maxValue || value>int(_narrowMaxValues[index]))
+		{
+			std::stringstream oss;
+			oss << "NarrowDynamicRaster::setValue - value: " << value << " bigger than max value: " << std::min(_maxValue, int(_narrowMaxValues[index])) << " at position: " << position;
+			throw Exception(oss.str());
+		}
+		checkNarrowValue<Type>(value, "NarrowDynamicRaster::setValue");
+		_narrowValues[index] = Type(value);
+	}
+
+	void setMaxValue( const Point2D<int>& position, int value )
+	{
+		if(value>_maxValue)
+		{
+			std::stringstream oss;
+			oss << "NarrowDynamicRaster::setMaxValue - value: " << value << " bigger than max value: " << _maxValue << " at pos: " << position;
+			throw Exception(oss.str());
+		}
+		checkNarrowValue<Type>(value, "NarrowDynamicRaster::setMaxValue");
+#ifdef PANDORADEBUG
+		checkBounds(position, "NarrowDynamicRaster::setMaxValue");
+#endif
+		_narrowMaxValues[getIndex(position)] = Type(value);
+	}
+	using DynamicRaster::setMaxValue;
+
+	void copyMaxRow( const int & y, const int & x, const int & width, int * values ) const
+	{
+		const Type * row = &_narrowMaxValues[getIndex(Point2D<int>(x, y))];
+		std::copy(row, row+width, values);
+	}
+
+	void setRow( const int & y, const int & x, const int & width, const int * values )
+	{
+		Type * row = &_narrowValues[getIndex(Point2D<int>(x, y))];
+		for(int i=0; i<width; i++)
+		{
+			row[i] = Type(values[i]);
+		}
+	}
+
+	void setMaxRow( const int & y, const int & x, const int & width, const int * values )
+	{
+		Type * row = &_narrowMaxValues[getIndex(Point2D<int>(x, y))];
+		for(int i=0; i<width; i++)
+		{
+			row[i] = Type(values[i]);
+		}
+	}
+
+	void setInitValues( int minValue, int maxValue, int defaultValue )
+	{
+		if(defaultValue>maxValue)
+		{
+			std::stringstream oss;
+			oss << "NarrowDynamicRaster::setInitValues - default value: " << defaultValue << " bigger than max value: " << maxValue;
+			throw Exception(oss.str());
+		}
+		checkNarrowValue<Type>(maxValue, "NarrowDynamicRaster::setInitValues");
+		checkNarrowValue<Type>(defaultValue, "NarrowDynamicRaster::setInitValues");
+		_minValue = _currentMinValue = minValue;
+		_maxValue = _currentMaxValue = maxValue;
+		std::fill(_narrowMaxValues.begin(), _narrowMaxValues.end(), Type(maxValue));
+		std::fill(_narrowValues.begin(), _narrowValues.end(), Type(defaultValue));
+	}
+
+	void updateRasterIncrement()
+	{
+		int numValues = _narrowValues.size();
+		if(numValues==0)
+		{
+			return;
+		}
+		Type * values = &_narrowValues[0];
+		const Type * maxValues = &_narrowMaxValues[0];
+		// branchless, so the compiler can vectorize it with more cells per register than the int version
+		#pragma omp parallel for schedule(static) if(numValues>=int(RasterKernels::_parallelThreshold))
+		for(int i=0; i<numValues; i++)
+		{
+			values[i] = values[i]<maxValues[i] ? Type(values[i]+1) : values[i];
+		}
+	}
+
+	void updateRasterToMaxValues()
+	{
+		std::copy(_narrowMaxValues.begin(), _narrowMaxValues.end(), _narrowValues.begin());
+	}
+
+	RasterValueType getValueType() const { return RasterValueTraits<Type>::getType(); }
+};
+
+} // namespace Engine
+
+#endif // __NarrowRaster_hxx__
+
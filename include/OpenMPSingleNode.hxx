@@ -25,7 +25,10 @@
 #include <World.hxx>
 #include <typedefs.hxx>
 #include <SequentialSerializer.hxx>
+#include <SpatialIndex.hxx>
+#include <ParallelExecutor.hxx>
 #include <list>
+#include <unordered_map>
 #include <vector>
 #include <Scheduler.hxx>
 #include <boost/timer/timer.hpp>
@@ -45,11 +48,33 @@ class OpenMPSingleNode : public Scheduler
 
 	// list of agents that are removed during a time step, and need to be erased by the end of the time step
 	AgentsList _removedAgents;
+	//! agents bucketed by position, used to answer neighbour queries
+	SpatialIndex _spatialIndex;
+
+	//! position of each agent inside World::_agents, indexed by id
+	std::unordered_map<std::string, AgentsList::iterator> _agentsById;
+
+	//! maximum distance reached by an agent while executing actions; if it is 0 actions are executed sequentially
+	int _interactionRange;
+	ParallelExecutor _executor;
+
+	//! keeps the spatial index updated after the execution of each agent by ParallelExecutor
+	struct AgentExecuted
+	{
+		AgentExecuted( SpatialIndex & spatialIndex ) : _spatialIndex(spatialIndex) {}
+		void operator()( AgentPtr agent )
+		{
+			#pragma omp critical(agentsIndex)
+			_spatialIndex.updateAgent(agent.get());
+		}
+		SpatialIndex & _spatialIndex;
+	};
 
 	// returns the iterator inside World::_agents with _id = id; in case it is not found returns _agents.end()
 	AgentsList::iterator getAgentIterator( const std::string & id );
 public:
-	OpenMPSingleNode();
+	//! if interactionRange is positive actions are executed in parallel; agents must not modify the world further than interactionRange from their position, and wider neighbour queries are serialized
+	OpenMPSingleNode( const int & interactionRange = 0 );
 	virtual ~OpenMPSingleNode();
 
 	void finish();
@@ -61,6 +86,9 @@ public:
 	//! responsible for executing the agents and update world 
 	virtual void executeAgents();
 
+	void agentAdded( AgentPtr agent, bool executedAgent );
+	void agentMoved( Agent * agent );
+	void agentIdChanged( const std::string & oldId, Agent * agent );
 	void removeAgents();
 	void removeAgent(Agent * agent);
 	
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __OverlapExchange_hxx__
+#define __OverlapExchange_hxx__
+
+#include <mpi.h>
+#include <Rectangle.hxx>
+#include <vector>
+
+namespace Engine
+{
+class World;
+
+/** OverlapExchange sends and receives the cells of dynamic rasters shared with neighbouring computer nodes
+  * The zones of every dynamic raster going to the same neighbour are packed in a single buffer, with the value type of each raster
+  * Buffers are allocated once, and messages are sent with MPI persistent requests that are restarted at each exchange
+  * Receives can be posted in advance with startReceives, and sends are only completed before their buffers are packed again
+  */
+class OverlapExchange
+{
+	struct Message
+	{
+		int _neighbor;
+		//! zone of the rasters to pack or unpack, in local coordinates
+		Rectangle<int> _zone;
+		std::vector<char> _buffer;
+	};
+	World * _world;
+	std::vector<Message> _sends;
+	std::vector<Message> _receives;
+	//! indexes of the rasters to exchange
+	std::vector<size_t> _rasters;
+	//! persistent requests of _sends followed by the ones of _receives
+	std::vector<MPI_Request> _requests;
+	//! row of int values used to convert between rasters and buffers
+	std::vector<int> _row;
+	//! true if receives have been started and not yet completed by exchange
+	bool _receivesStarted;
+	//! true if sends started by the last exchange may not be completed
+	bool _sendsStarted;
+
+	void pack( Message & message, const bool & maxValues );
+	void unpack( const Message & message, const bool & maxValues );
+	//! completes pending sends, cancels receives posted in advance and frees the persistent requests
+	void freeRequests();
+public:
+	OverlapExchange();
+	virtual ~OverlapExchange();
+
+	//! zone of local rasters that will be sent to neighbor. Empty zones are ignored
+	void addSend( const int & neighbor, const Rectangle<int> & zone );
+	//! zone of local rasters that will be replaced with the data of neighbor. Empty zones are ignored
+	void addReceive( const int & neighbor, const Rectangle<int> & zone );
+	//! allocates the buffers for the dynamic rasters of world and creates the persistent requests. Must be called after every raster has been registered
+	void init( World & world, const int & tag );
+	//! posts the receives of the next exchange, so neighbours can deliver their data before it is called
+	void startReceives();
+	//! sends and receives every zone, and waits until local rasters are updated. If maxValues is true it exchanges max values instead of current values
+	void exchange( const bool & maxValues = false );
+	//! frees the persistent requests and removes every zone; must be called before MPI_Finalize
+	void clear();
+	//! persistent requests, so a ProgressThread can test them while a section is executed
+	std::vector<MPI_Request> & getRequests();
+};
+
+} // namespace Engine
+
+#endif // __OverlapExchange_hxx__
+
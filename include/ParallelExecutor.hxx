@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __ParallelExecutor_hxx__
+#define __ParallelExecutor_hxx__
+
+#include <typedefs.hxx>
+#include <Agent.hxx>
+#include <Rectangle.hxx>
+#include <Point2D.hxx>
+#include <Size.hxx>
+#include <GeneralState.hxx>
+#include <Statistics.hxx>
+#include <vector>
+
+namespace Engine
+{
+
+/** ParallelExecutor runs executeActions and updateState of a set of agents using every OpenMP thread
+  * Space is split in square regions with a side of at least twice the interaction range of agents, coloured in a 2x2 pattern
+  * Agents of two regions with the same colour can't reach the same cells, so the regions of a colour are executed concurrently as OpenMP tasks, picked by idle threads from the pool
+  * Agents inside a region keep the shuffled order they were given, and the order of colours is randomized every step
+  * Each region draws random numbers from its own engine, seeded from seed, rank, step and region index, so runs are reproducible whatever thread executes each task
+  * Any change to shared structures (creation, removal and movement of agents) must be done inside the critical section agentsIndex
+  * Neighbour queries around the executing agent with a radius up to the interaction range only read cells that no concurrent region can modify, so they don't lock
+  * Schedulers run wider queries and queries by position inside agentsIndex as well, as they could read cells modified by other regions of the same colour
+  */
+class ParallelExecutor
+{
+	Rectangle<int> _boundaries;
+	//! side of each region, in number of raster cells
+	int _regionSize;
+	Size<int> _numRegions;
+	//! agents to execute inside each region, row-major
+	std::vector<AgentsVector> _regions;
+	//! random engine bound while each region is executed
+	std::vector<Statistics::RandomEngine> _engines;
+
+	//! returns the index of the region containing position. Positions outside boundaries are assigned to the nearest region
+	int getRegionIndex( const Point2D<int> & position ) const;
+	//! fills regions with the non-empty regions of a colour, biggest first
+	void getRegions( const int & colour, std::vector<AgentsVector *> & regions );
+
+	template<class Functor> void executeRegion( const size_t & index, const int & step, Functor & functor )
+	{
+		Statistics & statistics = GeneralState::statistics();
+		statistics.seedTaskEngine(_engines[index], step, index);
+		Statistics::RandomEngine * previous = statistics.bindEngine(&_engines[index]);
+		AgentsVector & region = _regions[index];
+		for(size_t i=0; i<region.size(); i++)
+		{
+			region[i]->executeActions();
+			region[i]->updateState();
+			functor(region[i]);
+		}
+		statistics.bindEngine(previous);
+	}
+public:
+	ParallelExecutor();
+	virtual ~ParallelExecutor();
+
+	//! defines the area covered by regions. Their side is twice the smallest multiple of alignment not lower than range, so cells of a SpatialIndex with this cell size within range of a region are never within range of another region of the same colour
+	void resize( const Rectangle<int> & boundaries, const int & range, const int & alignment );
+
+	//! executes actions and updates state of agents; functor is called after each agent has been updated, from the thread that executed it. Step selects the random streams of the regions
+	template<class Functor> void execute( const AgentsVector & agents, Functor & functor, const int & step )
+	{
+		for(size_t i=0; i<_regions.size(); i++)
+		{
+			_regions[i].clear();
+		}
+		for(size_t i=0; i<agents.size(); i++)
+		{
+			_regions[getRegionIndex(agents[i]->getPosition())].push_back(agents[i]);
+		}
+
+		int colours[4] = {0, 1, 2, 3};
+		GeneralState::statistics().shuffle(colours, colours+4);
+		std::vector<AgentsVector *> regions;
+		Functor * sharedFunctor = &functor;
+		for(int i=0; i<4; i++)
+		{
+			getRegions(colours[i], regions);
+#ifndef PANDORAEDEBUG
+			#pragma omp parallel
+			#pragma omp single
+#endif
+			{
+				for(size_t j=0; j<regions.size(); j++)
+				{
+					size_t index = regions[j]-&_regions[0];
+#ifndef PANDORAEDEBUG
+					#pragma omp task firstprivate(index)
+#endif
+					executeRegion(index, step, *sharedFunctor);
+				}
+			}
+		}
+	}
+};
+
+} // namespace Engine
+
+#endif // __ParallelExecutor_hxx__
+
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __ProgressThread_hxx__
+#define __ProgressThread_hxx__
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <mpi.h>
+
+namespace Engine
+{
+
+/** ProgressThread drives the non-blocking messages of a computer node while the rest of threads execute agents
+  * Many MPI implementations only progress pending transfers inside MPI calls, and the main thread doesn't call MPI while executing a section
+  * While active it tests every watched request with MPI_Request_get_status, which advances the transfer without completing it, so the owner still completes its requests with MPI_Wait* (i.e. OverlapExchange unpacks receives in arrival order)
+  * It also probes MPI_COMM_WORLD, so messages without a posted receive (migrated agents) advance as well
+  * The time between polls doubles up to maxInterval while no watched request completes, so a thread waiting for slow neighbours barely uses its core
+  * Watched requests must only be started, completed or resized while the thread is paused; pause returns once the thread has left MPI
+  * It requires MPI to be initialized with MPI_THREAD_MULTIPLE
+  */
+class ProgressThread
+{
+	std::thread _thread;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	//! notified when the thread leaves MPI, so pause can return
+	std::condition_variable _idleCondition;
+	//! true while the thread polls MPI; otherwise it sleeps until resumed
+	bool _active;
+	bool _stop;
+	//! true while the thread is inside MPI calls
+	bool _polling;
+	//! microseconds between polls after a watched request completes
+	int _interval;
+	//! upper bound of the backoff between polls, in microseconds
+	int _maxInterval;
+	//! requests tested by the thread; the vectors are owned by the caller of watch
+	std::vector< std::vector<MPI_Request> * > _requests;
+	//! number of pending requests found by the last poll
+	int _numPending;
+
+	void run();
+	//! probes MPI and tests every watched request; returns true if any request completed since the last poll
+	bool poll();
+public:
+	ProgressThread( const int & interval = 50, const int & maxInterval = 1000 );
+	virtual ~ProgressThread();
+
+	//! creates the thread, initially paused
+	void start();
+	//! adds a vector of requests to test while active; it must outlive the thread
+	void watch( std::vector<MPI_Request> & requests );
+	//! starts polling MPI
+	void resume();
+	//! stops polling MPI until resume is called; returns once the thread is out of MPI, so watched requests can be waited
+	void pause();
+	//! finishes and joins the thread; must be called before MPI_Finalize
+	void stop();
+	bool isRunning() const;
+};
+
+} // namespace Engine
+
+#endif // __ProgressThread_hxx__
+
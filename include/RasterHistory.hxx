@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+
+#ifndef __RasterHistory_hxx__
+#define __RasterHistory_hxx__
+
+#include <hdf5.h>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+#include <DynamicRaster.hxx>
+#include <Size.hxx>
+
+namespace Engine
+{
+
+class RasterHistory;
+
+/** Bounded list of the raster steps kept in memory by the histories of a SimulationRecord
+  * When it is full the least recently used step is released; a capacity of 0 keeps every loaded step
+  */
+class RasterCache
+{
+public:
+	typedef std::pair<RasterHistory *, size_t> Entry;
+	typedef std::list<Entry> Entries;
+private:
+	//! most recently used first
+	Entries _entries;
+	size_t _capacity;
+	size_t _size;
+public:
+	RasterCache( const size_t & capacity = 64 );
+	virtual ~RasterCache();
+
+	//! registers a step loaded by 'history', releasing the least recently used ones if needed
+	Entries::iterator insert( RasterHistory * history, size_t index );
+	//! marks the step of 'entry' as the most recently used
+	void touch( const Entries::iterator & entry );
+	//! forgets the steps of 'history' without releasing them
+	void remove( RasterHistory * history );
+
+	void setCapacity( const size_t & capacity );
+	const size_t & getCapacity() const { return _capacity; }
+	const size_t & getSize() const { return _size; }
+};
+
+/** Steps of a dynamic raster stored in a results file, read the first time they are needed
+  * Returned references stay valid until the cache releases the step, which happens after 'capacity' other steps are loaded
+  */
+class RasterHistory
+{
+	struct Step
+	{
+		std::shared_ptr<DynamicRaster> _raster;
+		RasterCache::Entries::iterator _entry;
+	};
+
+	std::string _name;
+	//! results file, owned by the SimulationRecord
+	hid_t _fileId;
+	//! number of simulation steps between consecutive loaded steps
+	int _resolution;
+	//! size of the steps missing in the file
+	Size<int> _size;
+	RasterCache * _cache;
+	std::vector<Step> _steps;
+
+	//! values of the last step read, reused by the delta encoded steps that follow it
+	std::vector<int> _values;
+	int _valuesStep;
+	//! minimum and maximum values of the whole history, given to every loaded step
+	bool _minMaxLoaded;
+	int _minValue;
+	int _maxValue;
+
+	RasterHistory( const RasterHistory & );
+	RasterHistory & operator=( const RasterHistory & );
+
+	//! reads the minValue and maxValue attributes written by the serializers; returns false if 'objectId' doesn't have them
+	static bool readRange( const hid_t & objectId, int & minValue, int & maxValue );
+	//! reads the range of the history from the attributes of the raster, or of its steps; older files are scanned step by step
+	void loadMinMax();
+	DynamicRaster & load( size_t index );
+public:
+	RasterHistory();
+	virtual ~RasterHistory();
+
+	void init( const std::string & name, const hid_t & fileId, size_t numSteps, int resolution, const Size<int> & size, RasterCache * cache );
+	//! called by the cache when the step is released
+	void release( size_t index );
+
+	size_t size() const { return _steps.size(); }
+	//! histories are read on demand, so const access can still load a step
+	DynamicRaster & operator[]( size_t index ) { return load(index); }
+	const DynamicRaster & operator[]( size_t index ) const { return const_cast<RasterHistory *>(this)->load(index); }
+	DynamicRaster & at( size_t index );
+	const DynamicRaster & at( size_t index ) const;
+};
+
+} // namespace Engine
+
+#endif // __RasterHistory_hxx__
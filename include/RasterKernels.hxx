@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __RasterKernels_hxx__
+#define __RasterKernels_hxx__
+
+#include <cstddef>
+
+namespace Engine
+{
+
+/** RasterKernels contains the loops used by StaticRaster and DynamicRaster to update and reduce contiguous blocks of cells
+  * They use SSE2 or AVX2 instructions if the library is compiled with support for them, and a scalar branchless loop otherwise
+  * Rasters split their cells in blocks of _blockSize cells, and share them among OpenMP threads if they have at least _parallelThreshold cells
+  */
+class RasterKernels
+{
+public:
+	static const size_t _blockSize = 16384;
+	static const size_t _parallelThreshold = 65536;
+
+	//! increments by one each value lower than its maximum
+	static void increment( int * values, const int * maxValues, const size_t & size );
+	//! updates minValue, maxValue and sum with the cells of a block
+	static void accumulate( const int * values, const size_t & size, int & minValue, int & maxValue, long long & sum );
+};
+
+} // namespace Engine
+
+#endif // __RasterKernels_hxx__
+
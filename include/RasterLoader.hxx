@@ -24,6 +24,8 @@
 #define __RasterLoader_hxx__
 
 #include <string>
+#include <vector>
+#include <hdf5.h>
 #include <Rectangle.hxx>
 
 namespace Engine
@@ -47,6 +49,9 @@ public:
     void fillHDF5Raster( StaticRaster & raster, const std::string & fileName, const std::string & rasterName, int step, World * world = 0);
     // load an HDF5 from a serialized static raster
 	void fillHDF5Raster( StaticRaster & raster, const std::string & fileName, const std::string & rasterName, World * world = 0);
+	// read the values of a dynamic raster step from an open HDF5 file, adding the previous steps to delta encoded datasets
+	// 'values' holds the values of 'valuesStep' (-1 if none); they are reused if the step is delta encoded against it
+	void readHDF5Step( const hid_t & fileId, const std::string & rasterName, int step, std::vector<int> & values, int & valuesStep, Size<int> & size );
 	// load a raster file from a GRASS database conforming adjusting raster to data, or to World position if not null
 }; 
 
@@ -3,6 +3,7 @@
 #define __Scheduler_hxx__
 
 #include <Agent.hxx>
+#include <GeneralState.hxx>
 
 namespace Engine
 {
@@ -21,18 +22,23 @@ protected:
 	// this method returns a list with the list of agents in euclidean distance radius of position. if include center is false, position is not checked
 	template<class T> struct aggregator : public std::unary_function<T,void>
 	{
-		aggregator(double radius, Agent &center, const std::string & type ) :  _radius(radius), _center(center), _type(type)
+		aggregator(double radius, Agent &center, const std::string & type ) :  _radius(radius), _center(center), _typeId(-1)
 		{
-			_particularType = _type.compare("all");
+			_particularType = type.compare("all");
+			if(_particularType)
+			{
+				// -1 if no agent of this type has been created, so nothing will match
+				_typeId = GeneralState::agentTypes().getId(type);
+			}
 		}
 		virtual ~aggregator(){}
 		void operator()( T neighbor )
 		{
-			if(neighbor->getId()==_center.getId() || !neighbor->exists())
+			if(neighbor.get()==&_center || !neighbor->exists())
 			{
 				return;
 			}
-			if(_particularType && !neighbor->isType(_type))
+			if(_particularType && !neighbor->isType(_typeId))
 			{
 				return;
 			}
@@ -45,7 +51,7 @@ protected:
 		bool _particularType;
 		double _radius;
 		Agent & _center;
-		std::string _type;
+		int _typeId;
 	};
 
 	template<class T> struct aggregatorCount : public aggregator<T>
@@ -98,6 +104,10 @@ public:
 	// agent addition, removal and getters
 	//! do anything needed after adding agent to the list of World _agents
 	virtual void agentAdded( AgentPtr agent, bool executedAgent ){};
+	//! do anything needed after an agent has changed its position (i.e. update spatial indexes)
+	virtual void agentMoved( Agent * agent ){};
+	//! do anything needed after an agent has changed its id (i.e. re-key indexes by id)
+	virtual void agentIdChanged( const std::string & oldId, Agent * agent ){};
 	virtual void removeAgents() = 0;
 	virtual void removeAgent(Agent * agent) = 0;
 	//! this method will return an agent, both looking at owned and ghost agents
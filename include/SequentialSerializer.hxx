@@ -26,6 +26,11 @@
 #include <string>
 #include <map>
 #include <typedefs.hxx>
+#include <vector>
+#include <unordered_map>
+#include <AgentColumns.hxx>
+#include <SerializationThread.hxx>
+#include <Compression.hxx>
 
 namespace Engine
 {
@@ -41,12 +46,17 @@ class StaticRaster;
 class SequentialSerializer
 {
 	typedef std::map< std::string, StaticRaster *> StaticRastersRefMap;
-	typedef std::map< std::string, std::vector<int> * > IntMap;
-	typedef std::map< std::string, std::vector<float> * > FloatMap;
-	typedef std::map< std::string, std::vector<std::string> * > StringMap;
-	typedef std::map< std::string, IntMap * > IntAttributesMap;
-	typedef std::map< std::string, FloatMap * > FloatAttributesMap;
-	typedef std::map< std::string, StringMap * > StringAttributesMap;
+
+	//! datasets of the step being written for an agent type, kept open while the blocks of the step are written
+	struct AgentStepDatasets
+	{
+		int _step;
+		std::vector<hid_t> _intDatasets;
+		std::vector<hid_t> _floatDatasets;
+		std::vector<hid_t> _stringDatasets;
+		AgentStepDatasets() : _step(-1) {}
+	};
+	typedef std::map< std::string, AgentStepDatasets > AgentDatasetsMap;
 
 	const Scheduler & _scheduler;
     const Config * _config;
@@ -55,19 +65,61 @@ class SequentialSerializer
 	hid_t _agentsFileId;
 	StaticRastersRefMap _dynamicRasters;
 
-	StringAttributesMap _stringAttributes;
-	IntAttributesMap _intAttributes;
-	FloatAttributesMap _floatAttributes;
-	std::map<std::string, int> _agentIndexMap;
-
-	void executeAgentSerialization( const std::string & type, int step);
+	//! attributes of each agent type, indexed by type id
+	std::vector<AgentColumns> _columns;
+	//! columns of the type of the agent being serialized
+	AgentColumns * _currentColumns;
+	//! position in the step datasets of the next block of agents of each type
+	std::vector<int> _agentOffsets;
+	//! only used by the serialization thread
+	AgentDatasetsMap _agentDatasets;
+	//! code of every string attribute value written to the agents file, and the strings not written yet to its dictionary
+	std::unordered_map<std::string, int> _dictionary;
+	std::vector<char> _newStrings;
+	std::vector<int> _codes;
+	hid_t _dictionaryId;
+	hsize_t _dictionarySize;
+
+	//! executes HDF5 writes while the simulation continues
+	SerializationThread _writer;
+	SnapshotPool<RasterSnapshot> _rasterSnapshots;
+	std::map<std::string, SnapshotPool<AgentSnapshot> > _agentSnapshots;
+
+	//! codec of the datasets, once checked that it is available
+	CompressionCodec _codec;
+	//! previous step of each dynamic raster; only used by the serialization thread
+	std::map<std::string, DeltaReference> _deltaReferences;
+	std::vector<int> _deltas;
+	//! minimum and maximum values written in the steps of each dynamic raster, stored in its group by finish; only used by the serialization thread
+	std::map<std::string, std::pair<int, int> > _rasterRanges;
+	//! true for the agent type ids already registered
+	std::vector<bool> _registeredTypes;
+
+	//! HDF5 type of the datasets storing rasters of type 'valueType'
+	static hid_t getRasterFileType( const RasterValueType & valueType );
+	//! dataset creation property list shared by all raster datasets
+	hid_t createRasterProperties() const;
+	//! moves the attributes collected for type 'typeId' into a snapshot and queues its write
+	void executeAgentSerialization( int typeId, int step);
 	void serializeAgent( Agent * agent, const int & step, int index);
 	void finishAgentsSerialization( int step);
-	// register the type of agent into the data structures _agentIndexsMap, _stringAttributes and _intAttributes and create HDF5 structures
+	// register the columns of the type of agent into _columns
 	void registerType( Agent * agent);
-	int getDataSize( const std::string & type );
-	void resetCurrentIndexs();
-	void serializeRaster( const StaticRaster & raster, const std::string & datasetKey );
+	AgentColumns & getColumns( const std::string & type );
+	//! returns the datasets of the snapshot step, creating them if they do not exist yet
+	const AgentStepDatasets & openAgentStep( const AgentSnapshot & snapshot );
+	void closeAgentStep( AgentStepDatasets & datasets );
+	hid_t createAgentDataset( const hid_t & stepGroup, const std::string & name, const hid_t & fileType, const hid_t & fileSpace, const hid_t & propertyListId );
+	void writeAgents( AgentSnapshot & snapshot );
+	//! returns the dictionary code of 'value', adding it to _newStrings if it is new
+	int encodeString( const std::string & value );
+	//! appends 'size' values of 'data' at 'offset' of the dataset
+	void writeAgentColumn( const hid_t & datasetId, const hid_t & memoryType, hsize_t offset, hsize_t size, const void * data );
+	//! copies 'raster' and queues its write into step 'step' of raster 'name', or into its values if step is negative
+	void serializeRaster( const StaticRaster & raster, const std::string & name, int step );
+	void writeRaster( const RasterSnapshot & snapshot );
+	//! stores minValue and maxValue attributes in 'objectId', so readers don't need to scan the steps of a raster
+	void writeRange( const hid_t & objectId, const std::pair<int, int> & range );
 
 public:
 	SequentialSerializer( const Scheduler & scheduler );
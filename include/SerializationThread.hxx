@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __SerializationThread_hxx__
+#define __SerializationThread_hxx__
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+#include <list>
+#include <map>
+#include <vector>
+#include <string>
+#include <typedefs.hxx>
+#include <Rectangle.hxx>
+#include <AgentColumns.hxx>
+
+namespace Engine
+{
+
+//! raster values copied at a step boundary, waiting to be written
+struct RasterSnapshot
+{
+	std::string _datasetKey;
+	//! name and step of dynamic rasters
+	std::string _name;
+	int _step;
+	RasterValueType _valueType;
+	//! true if the dataset must be created before writing it
+	bool _create;
+	//! area of the dataset covered by _data, stored row by row
+	Rectangle<int> _area;
+	std::vector<int> _data;
+};
+
+//! attribute columns of the agents of one type, waiting to be written at '_offset' of step '_step'
+struct AgentSnapshot
+{
+	std::string _type;
+	int _step;
+	int _offset;
+	AgentColumns _columns;
+};
+
+/** Snapshots returned once written, so their vectors keep their capacity for the next steps
+  * get and release can be called from different threads
+  */
+template<typename T> class SnapshotPool
+{
+	std::mutex _mutex;
+	std::list< std::shared_ptr<T> > _snapshots;
+public:
+	std::shared_ptr<T> get()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(_snapshots.empty())
+		{
+			return std::make_shared<T>();
+		}
+		std::shared_ptr<T> snapshot = _snapshots.front();
+		_snapshots.pop_front();
+		return snapshot;
+	}
+	void release( const std::shared_ptr<T> & snapshot )
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_snapshots.push_back(snapshot);
+	}
+};
+
+/** SerializationThread executes the HDF5 writes of a serializer while the simulation goes on
+  * Tasks are executed in the order they are pushed, and push blocks while 'maxPendingTasks' are waiting, capping the memory used by snapshots
+  * If the thread is not running tasks are executed by the caller
+  * An exception thrown by a task is rethrown by the next call to push or flush
+  */
+class SerializationThread
+{
+public:
+	typedef std::function<void()> Task;
+private:
+	std::thread _thread;
+	std::mutex _mutex;
+	//! signals new tasks and stop to the thread
+	std::condition_variable _pushed;
+	//! signals the callers waiting for free slots or for an empty queue
+	std::condition_variable _done;
+	std::list<Task> _tasks;
+	//! true while the thread executes a task already removed from _tasks
+	bool _busy;
+	bool _stop;
+	size_t _maxPendingTasks;
+	std::exception_ptr _error;
+
+	void run();
+	void rethrow();
+public:
+	SerializationThread( const size_t & maxPendingTasks = 2 );
+	virtual ~SerializationThread();
+
+	void start();
+	void push( const Task & task );
+	//! waits until every pushed task is executed
+	void flush();
+	//! executes the pending tasks and joins the thread
+	void stop();
+	bool isRunning() const;
+};
+
+} // namespace Engine
+
+#endif // __SerializationThread_hxx__
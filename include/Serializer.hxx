@@ -27,9 +27,14 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <set>
+#include <memory>
 #include <mpi.h>
 #include <Rectangle.hxx>
 #include <typedefs.hxx>
+#include <AgentColumns.hxx>
+#include <SerializationThread.hxx>
+#include <Compression.hxx>
 
 namespace Engine
 {
@@ -46,12 +51,6 @@ class Serializer
 	typedef std::map< std::string, Raster> RastersMap;
 	typedef std::map< std::string, StaticRaster *> StaticRastersRefMap;
 
-	typedef std::map< std::string, std::vector<int> * > IntMap;
-	typedef std::map< std::string, std::vector<float> * > FloatMap;
-	typedef std::map< std::string, std::vector<std::string> * > StringMap;
-	typedef std::map< std::string, IntMap * > IntAttributesMap;
-	typedef std::map< std::string, FloatMap * > FloatAttributesMap;
-	typedef std::map< std::string, StringMap * > StringAttributesMap;
 
     const Config * _config;
 	const SpacePartition & _scheduler;
@@ -63,22 +62,64 @@ class Serializer
 	// this id is used to track the data set of the agent being serialized
 	hid_t _currentAgentDatasetId;
 
-	void serializeRaster( const StaticRaster & raster, const std::string & datasetKey );
+	//! copies the owned area of 'raster' and queues its write into step 'step' of raster 'name', or into its values if step is negative
+	void serializeRaster( const StaticRaster & raster, const std::string & name, int step );
+	void writeRaster( const RasterSnapshot & snapshot );
+	//! stores minValue and maxValue attributes in 'objectId', so readers don't need to scan the steps of a raster
+	void writeRange( const hid_t & objectId, const std::pair<int, int> & range );
 
-	// register the type of agent into the data structures _agentIndexsMap, _stringAttributes and _intAttributes and create HDF5 structures
+	// register the columns of the type of agent into _columns
 	void registerType( Agent * agent);
-	IntAttributesMap _intAttributes;
-	FloatAttributesMap _floatAttributes;
-	StringAttributesMap _stringAttributes;
-
-	std::map<std::string, int> _agentIndexMap;
+	//! attributes of each agent type, indexed by type id
+	std::vector<AgentColumns> _columns;
+	//! columns of the type of the agent being serialized
+	AgentColumns * _currentColumns;
+	AgentColumns & getColumns( const std::string & type );
+
+	//! attributes of an agent type serialized by any task
+	struct AgentSchema
+	{
+		std::set<std::string> _intAttributes;
+		std::set<std::string> _floatAttributes;
+		std::set<std::string> _stringAttributes;
+	};
+	typedef std::map<std::string, AgentSchema> AgentSchemas;
+	//! types known by every task; only used by the serialization thread
+	AgentSchemas _agentSchemas;
+	//! fixed width strings of the attribute being written; only used by the serialization thread
+	std::vector<char> _stringBuffer;
+
+	//! executes HDF5 writes while the simulation continues. Distributed runs need MPI_THREAD_MULTIPLE for it, requested by SpacePartition; if MPI doesn't provide it every write blocks World::step
+	SerializationThread _writer;
+	SnapshotPool<RasterSnapshot> _rasterSnapshots;
+	std::map<std::string, SnapshotPool<AgentSnapshot> > _agentSnapshots;
+
+	//! codec of the datasets, once checked that it is available
+	CompressionCodec _codec;
+	//! communicator of the serialization thread in distributed runs, MPI_COMM_NULL otherwise
+	MPI_Comm _communicator;
+	//! previous step of each dynamic raster; only used by the serialization thread
+	std::map<std::string, DeltaReference> _deltaReferences;
+	std::vector<int> _deltas;
+	//! minimum and maximum values written in the steps of each dynamic raster, stored in its group by finish; only used by the serialization thread
+	std::map<std::string, std::pair<int, int> > _rasterRanges;
+	//! true for the agent type ids already registered
+	std::vector<bool> _registeredTypes;
 	
-	void executeAgentSerialization( const std::string & type, int step);
-	void resetCurrentIndexs();
-
-	int getDataSize( const std::string & type );
+	//! HDF5 type of the datasets storing rasters of type 'valueType'
+	static hid_t getRasterFileType( const RasterValueType & valueType );
+	//! dataset creation property list shared by all raster datasets
+	hid_t createRasterProperties() const;
+	//! merges the types and attributes of the snapshots of every task into _agentSchemas
+	void updateAgentSchemas( const std::vector< std::shared_ptr<AgentSnapshot> > & snapshots );
+	//! writes the agents of every task into shared datasets, each task at the offset given by the counts of the previous tasks
+	void writeAgents( int step, const std::vector< std::shared_ptr<AgentSnapshot> > & snapshots );
+	//! checks that the column of 'attribute', serialized by another task, has been registered by this one
+	int getLocalHandle( int handle, const std::string & type, const std::string & attribute );
+	void writeAgentAttribute( const hid_t & stepGroup, const std::string & name, const hid_t & fileType, const hid_t & memoryType, const hid_t & creationListId, const hid_t & transferListId, const hid_t & fileSpace, const hid_t & memorySpace, const void * data );
 
 	void serializeAgent( Agent * agent, const int & step, int index);
+	//! moves the attributes collected for every type into snapshots and queues the write of the step
 	void finishAgentsSerialization( int step);
 
 public:
@@ -27,11 +27,14 @@
 #include <string>
 #include <list>
 #include <map>
+#include <set>
 #include <hdf5.h>
 
 #include <DynamicRaster.hxx>
 #include <StaticRaster.hxx>
 #include <AgentRecord.hxx>
+#include <AgentTable.hxx>
+#include <RasterHistory.hxx>
 #include <Point2D.hxx>
 #include <Size.hxx>
 
@@ -41,26 +44,26 @@ namespace Engine
 class SimulationRecord
 {
 public:
-	typedef std::map<std::string, AgentRecord * > AgentRecordsMap;
+	typedef AgentTable::RecordsMap AgentRecordsMap;
 	
     typedef std::map<std::string, int > IntAttributesMap;	
 	typedef std::map<std::string, float > FloatAttributesMap;	
 	typedef std::map<std::string, std::string > StrAttributesMap;	
 
-	typedef std::vector<DynamicRaster> RasterHistory;
+	typedef Engine::RasterHistory RasterHistory;
 	typedef std::map<std::string, RasterHistory> RasterMap;
 	typedef std::map<std::string, StaticRaster> StaticRasterMap;
-	typedef std::map<std::string, AgentRecordsMap > AgentTypesMap;
+	typedef std::map<std::string, AgentTable> AgentTypesMap;
 	typedef std::vector<AgentRecord *> AgentRecordsVector;
 private:
 
 	std::string _name;
+	//! declared before _resources, as histories unregister from it when destroyed
+	RasterCache _rasterCache;
 	RasterMap _resources;
 	StaticRasterMap _staticRasters;
 	AgentTypesMap _types;
 	int _numSteps;
-	// the step currently being loaded
-	int _loadingStep;
 
 	// resolution of loaded data
 	int _loadedResolution;
@@ -75,9 +78,36 @@ private:
 
 	Size<int> _size;
 
-	// we need this function in order to be called by H5Giterate. It must be static to match the C call signature
-	//static herr_t registerAgentStep( hid_t loc_id, const char *name, void *opdata );
-
+	// values of a step group of an agents file, read by one task and merged into the AgentTable of its type
+	struct AgentStepData
+	{
+		// index of the agents file and loaded step, or -1 if the file has no group for the step
+		int _file;
+		int _step;
+		// ids, as codes of the file dictionary or as strings
+		std::vector<int> _idCodes;
+		std::vector<std::string> _ids;
+		std::vector<std::string> _intNames;
+		std::vector<std::string> _floatNames;
+		std::vector<std::string> _strNames;
+		std::vector< std::vector<int> > _ints;
+		std::vector< std::vector<float> > _floats;
+		// codes of the file dictionary, replaced by codes of the table when merged; _strs keeps the strings of files without dictionary
+		std::vector< std::vector<int> > _strCodes;
+		std::vector< std::vector<std::string> > _strs;
+		std::vector< std::pair<int, int> > _intRanges;
+		std::vector< std::pair<float, float> > _floatRanges;
+
+		// filled when merged: index of every agent in the table, and columns of the step where values are stored
+		std::vector<int> _indices;
+		std::vector<int *> _intTargets;
+		std::vector<float *> _floatTargets;
+		std::vector<int *> _strTargets;
+		// message of the exception thrown while reading the step, empty if it was read
+		std::string _error;
+	};
+
+	// callbacks of H5Literate, storing the names of the links in the std::list<std::string> of opdata. They must be static to match the C call signature
 	static herr_t iterateAgentTypes( hid_t loc_id, const char * name, const H5L_info_t *linfo, void *opdata );
 	static herr_t iterateAgentDatasets( hid_t loc_id, const char * name, const H5L_info_t *linfo, void *opdata );
 
@@ -85,27 +115,52 @@ private:
 	bool _gui;
 	float _loadingPercentageDone;
 	std::string _loadingState;
-	static std::list< std::string > _agentTypes;
-	static std::list< std::string > _agentAttributes;
 
-	// loads the agents of simulation 
-	void loadAgentsFiles( const std::string & path, int numStepsToLoad, int numTasks  );
-	// registers the complete list of agent types into SimulationRecord
+	// results file read by the raster histories, -1 if closed
+	hid_t _fileId;
+	// files storing the agents, and types not loaded yet
+	std::vector<std::string> _agentsFiles;
+	mutable std::set<std::string> _pendingTypes;
+
+	// registers the agent types stored in the agents files of the simulation, without loading them
+	void indexAgentsFiles( const std::string & path, int numTasks );
+	// loads the agents of 'type' if they are not loaded yet
+	void loadAgentType( const std::string & type ) const;
+	void loadAgentType( const std::string & type, AgentTable & agents );
+	void loadPendingTypes() const;
+	// registers the agent types of an agents file into SimulationRecord, as pending types
 	void registerAgentTypes( const hid_t & rootGroup );
-	// looks for the list of agents present at a given time step (defined by stepGroyp) and type (defined in agents)
-	hssize_t registerAgentIds( const hid_t & stepGroup, std::vector<std::string> & indexAgents, AgentRecordsMap & agents );
-	// loads the attributes of the agents present at a given time step (defined by stepGroyp) and type (defined in agents)
-	void loadAttributes( const hid_t & stepGroup, hssize_t & numElements, const std::vector<std::string> & indexAgents, AgentRecordsMap & agents );
-	// updates min/max values checking value for the attribute key
-	void updateMinMaxAttributeValues( const std::string & key, int value );
-	void updateMinMaxAttributeValues( const std::string & key, float value );
+	// reads the codes of a dictionary encoded string dataset; returns false if the dataset stores the strings themselves
+	static bool readStringCodes( const hid_t & datasetId, hssize_t numElements, size_t dictionarySize, std::vector<int> & codes );
+	// reads the strings referenced by the codes of dictionary encoded datasets, empty if the file has no dictionary
+	static void readDictionary( const hid_t & agentsFileId, std::vector<std::string> & dictionary );
+	// reads the values of a string dataset, either dictionary encoded, fixed width or variable length
+	static void readStrings( const hid_t & datasetId, hssize_t numElements, const std::vector<std::string> & dictionary, std::vector<std::string> & values );
+	// reads the ids and attributes of /type/stepN into data. Every HDF5 call of the loading tasks is done here, inside a critical section
+	static void readAgentStep( const hid_t & agentsFileId, const std::string & type, int serializedStep, const std::vector<std::string> & dictionary, AgentStepData & data );
+	// computes the range of every numerical attribute of data
+	static void computeRanges( AgentStepData & data );
+	// registers the agents, columns and strings of data into agents, in step order
+	// codeAgents and codeStrings cache the indices and string codes of the file dictionary codes, -1 if not seen yet
+	void mergeAgentStep( AgentStepData & data, const std::vector<std::string> & dictionary, std::vector<int> & codeAgents, std::vector<int> & codeStrings, AgentTable & agents );
+	// copies the values of a merged step into the columns of its table
+	static void storeAgentStep( const AgentStepData & data );
+	// updates min/max values of the attribute key with the range [minValue, maxValue]
+	void updateMinMaxAttributeValues( const std::string & key, int minValue, int maxValue );
+	void updateMinMaxAttributeValues( const std::string & key, float minValue, float maxValue );
+	// returns the loaded table of 'type', or throws naming method if the type does not exist
+	const AgentTable & getAgentTable( const std::string & method, const std::string & type ) const;
 public:
 	SimulationRecord( int loadedResolution = 1, bool gui = true );
 	virtual ~SimulationRecord();
 
 	// the real method, called from registerAgentStep
 	//void registerAgent( hid_t loc_id, const char * name );
+	//! opens the results of a simulation; raster steps and agent types are read the first time they are accessed
 	bool loadHDF5( const std::string & fileName, const bool & loadRasters=true, const bool & loadAgents=true);
+	//! maximum number of dynamic raster steps kept in memory, 0 for no limit
+	void setRasterCacheSize( const size_t & rasterSteps );
+	size_t getRasterCacheSize() const;
 	
 	RasterHistory & getRasterHistory( const std::string & key );
 	const RasterHistory & getRasterHistory( const std::string & key ) const;
@@ -136,10 +191,18 @@ public:
 	StaticRasterMap::const_iterator beginStaticRasters() const;
 	StaticRasterMap::const_iterator endStaticRasters() const;
 
+	//! agents located at position in 'step', found through an index of the positions of the step built the first time it is queried
 	AgentRecordsVector getAgentsAtPosition( int step, const Point2D<int> & position ) const;
 	
 	double getMean( const std::string & type, const std::string & attribute, int step );
 	double getSum( const std::string & type, const std::string & attribute, int step );
+
+	//! aggregates the values of 'attribute' for the agents of 'type' existing in each loaded step of [firstStep, lastStep]
+	AttributeStats getStats( const std::string & type, const std::string & attribute, int firstStep, int lastStep ) const;
+	//! number of agents of 'type' existing in each loaded step of [firstStep, lastStep], added up
+	size_t getCount( const std::string & type, int firstStep, int lastStep ) const;
+	//! histogram of 'attribute' with bins of width 'interval' starting at minValue. See AgentTable::histogram
+	std::vector<size_t> getHistogram( const std::string & type, const std::string & attribute, int firstStep, int lastStep, double minValue, double interval ) const;
 	
 	int getMinInt( const std::string & attribute);
 	int getMaxInt( const std::string & attribute);
@@ -26,28 +26,26 @@
 #include <World.hxx>
 #include <typedefs.hxx>
 #include <Serializer.hxx>
+#include <SpatialIndex.hxx>
+#include <ParallelExecutor.hxx>
+#include <OverlapExchange.hxx>
+#include <MpiBuffer.hxx>
+#include <DomainDecomposition.hxx>
+#include <ProgressThread.hxx>
 #include <list>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <Scheduler.hxx>
 
 namespace Engine
 {
 class Agent;
 
-//! struct containing raster information sent between nodes
-struct MpiOverlap
-{
-	// TODO move from string to index
-	std::string _rasterName;
-	std::vector<int> _data;
-	Rectangle<int> _overlap;
-	MPI_Request _request;
-};
-
 /** SpacePartition is a execution scheduler
   * It distributes a Pandora execution in different nodes using spatial partition
-  * Each node contains the same amount of space and the agents inside
-  * It is efficient for models where a homogeneous density of agents is expected around the whole world
+  * The space is split in a grid of rectangles, one for each node, with columns and rows of different sizes
+  * If a rebalance period is defined the boundaries are moved periodically, so each column and row of the grid has a similar cost of execution
   */
 class SpacePartition : public Scheduler
 {
@@ -56,22 +54,31 @@ class SpacePartition : public Scheduler
 	Point2D<int> _localRasterSize;
 
 	//! map of already executed agents
-	std::map<std::string, std::weak_ptr<Agent> > _executedAgentsHash;	
+	std::unordered_map<std::string, std::weak_ptr<Agent> > _executedAgentsHash;	
 
 	//! position of World inside global limits 
 	Point2D<int> _worldPos;
 
-	std::list<MpiOverlap*> _sendRequests;
-	std::list<MpiOverlap*> _receiveRequests;
-	// this method checks whether all the requests in the pool created by MPI_Isend and MPI_Irecv are finished before continuing
-	void clearRequests( bool updateMaxValues );
+	//! overlap cells owned by neighbours, received at the beginning of each step
+	OverlapExchange _overlapExchange;
+	//! overlap cells modified by the execution of each section
+	OverlapExchange _sectionExchanges[4];
 	
+	//! one buffer per neighbour with the agents that leave the owned area, sent once per section
+	std::vector<MpiBuffer> _migrationBuffers;
+	std::vector<MPI_Request> _migrationRequests;
+	//! one buffer per neighbour with the ghost agents of the section, sent once per section
+	std::vector<MpiBuffer> _ghostBuffers;
+	std::vector<MPI_Request> _ghostRequests;
+	//! buffer storing the message received from a neighbour while it is unpacked
+	MpiBuffer _receiveBuffer;
+
+	//! packs the number of agents followed by the package and vector attributes of each one
+	void packAgents( MpiBuffer & buffer, const AgentsList & agents, MPI_Datatype * agentType );
+	//! creates an agent of type typeId with the next package and vector attributes of buffer
+	Agent * unpackAgent( MpiBuffer & buffer, const int & typeId, MPI_Datatype * agentType );
 	// method to send a list of agents to their respective future world
 	void sendAgents( AgentsList & agentsToSend );
-	// Method to send overlap zones in the section we have executed 
-	// if entire overlap is true, the node will send its owned zone in overlap as well as adjacents overlapped zones
-	void sendOverlapZones( const int & sectionIndex, const bool & entireOverlap = true );
-	void sendMaxOverlapZones();
 	// method to copy of agents to neighbours
 	void sendGhostAgents( const int & sectionIndex );
 
@@ -80,10 +87,6 @@ class SpacePartition : public Scheduler
 	void receiveGhostAgents( const int & sectionIndex );
 	// method to receive agents
 	void receiveAgents( const int & sectionIndex );
-	// method to receive overlap zones from neighbors that have executed adjacent sections 
-	// if entire overlap is true, the node will send its owned zone in overlap as well as adjacents overlapped zones
-	void receiveOverlapData( const int & sectionIndex, const bool & entireOverlap = true );
-	void receiveMaxOverlapData();
 	
 	//! id's of neighboring computer nodes
 	std::vector<int> _neighbors;
@@ -94,6 +97,40 @@ class SpacePartition : public Scheduler
 	
 	//! list of agents owned by other nodes in overlapping positions
 	AgentsList _overlapAgents;
+	//! owned and ghost agents bucketed by position, used to answer neighbour queries
+	SpatialIndex _spatialIndex;
+	//! position of owned agents inside World::_agents, indexed by id
+	std::unordered_map<std::string, AgentsList::iterator> _ownedAgentsById;
+	//! position of ghost agents inside _overlapAgents, indexed by id
+	std::unordered_map<std::string, AgentsList::iterator> _ghostAgentsById;
+
+	//! adds agent to the list of ghost agents
+	void addGhostAgent( AgentPtr agent );
+	//! erases a ghost agent, returning the next element of _overlapAgents
+	AgentsList::iterator eraseGhostAgent( AgentsList::iterator it );
+	//! erases an owned agent from World::_agents
+	void eraseOwnedAgent( AgentsList::iterator it );
+
+	//! if true the actions of agents inside a section are executed by several threads, using _overlap as interaction range
+	bool _parallelActions;
+	ParallelExecutor _executor;
+	//! in hybrid mode (_parallelActions) tests the requests of migration, ghost and overlap messages while sections are executed
+	ProgressThread _progressThread;
+	//! bookkeeping after the execution of an agent: updates indexes and adds it to agentsToSend if it left the owned area
+	void agentExecuted( AgentPtr agent, AgentsList & agentsToSend );
+
+	//! calls agentExecuted after the execution of each agent by ParallelExecutor
+	struct AgentExecuted
+	{
+		AgentExecuted( SpacePartition & scheduler, AgentsList & agentsToSend ) : _scheduler(scheduler), _agentsToSend(agentsToSend) {}
+		void operator()( AgentPtr agent )
+		{
+			#pragma omp critical(agentsIndex)
+			_scheduler.agentExecuted(agent, _agentsToSend);
+		}
+		SpacePartition & _scheduler;
+		AgentsList & _agentsToSend;
+	};
 	
 	//! this method returns true if neighbor is corner of _id
 	bool isCorner(const int & neighbor) const;
@@ -116,10 +153,31 @@ class SpacePartition : public Scheduler
 	void checkOverlapSize();
 	//! compute _boundaries based on Size, number of nodes and _overlap
 	void stablishBoundaries();
+	//! compute neighbors, owned area, _boundaries and sections from _decomposition
+	void updateBoundaries();
+
+	//! grid of partitions of the whole space
+	DomainDecomposition _decomposition;
+	//! number of steps between rebalances of _decomposition; 0 keeps uniform boundaries
+	int _rebalancePeriod;
+	//! time spent executing agents since the last rebalance
+	double _agentsTime;
+	//! time spent outside executeAgents (i.e. updating rasters and serializing) since the last rebalance
+	double _environmentTime;
+	//! wall time at the end of the last executeAgents, or negative before the first step
+	double _lastStepEnd;
+	//! collective call that moves boundaries to balance the cost of nodes, measured or given by the number of agents. Returns true if boundaries changed
+	bool rebalance( const bool & measured );
+	//! sends the cells of every raster to the nodes that contain them inside the new boundaries
+	void migrateRasters( const DomainDecomposition & previous );
+	//! sends owned agents outside the new owned area to their nodes and removes ghost agents
+	void migrateAgents();
+	//! waits until pending messages are sent and removes every overlap zone
+	void completeSends();
 	//! define original position of world, given overlap, size and id.
 	void stablishWorldPosition();
-	//! applies next simulation step on the Section of the space identified by parameter 'sectionIndex'.
-	void stepSection( const int & sectionIndex );
+	//! applies next simulation step on the Section of the space identified by parameter 'sectionIndex'. Agents leaving the owned area are added to agentsToSend; it doesn't call MPI, so it can run while the progress thread is active
+	void stepSection( const int & sectionIndex, AgentsList & agentsToSend );
 
 	//! returns the id of the section that contains the point 'position' 
 	int getIdFromPosition( const Point2D<int> & position );
@@ -137,6 +195,8 @@ class SpacePartition : public Scheduler
 	AgentsList::iterator getGhostAgent( const std::string & id );
 	//! this list has the agents that need to be removed at the end of step.
 	AgentsList _removedAgents;
+	//! ids of the agents inside _removedAgents
+	std::unordered_set<std::string> _removedAgentsIds;
 	//! return an agent, if it is in the list of owned
 	AgentsList::iterator getOwnedAgent( const std::string & id );
 	
@@ -147,13 +207,15 @@ class SpacePartition : public Scheduler
 	void initOverlappingData();
 
 	const Rectangle<int> & getOwnedArea() const;
+	//! returns the number of columns and rows of the grid of nodes
+	const Size<int> & getNumPartitions() const;
 	//! returns the attribute _overlap
 	const int & getOverlap() const;
 	//! transform from global coordinates to real coordinates (in terms of world position)
 	Point2D<int> getRealPosition( const Point2D<int> & globalPosition ) const;
 
 public:
-	SpacePartition(const int & overlap, bool finalize );
+	SpacePartition(const int & overlap, bool finalize, bool parallelActions = false, int rebalancePeriod = 0 );
 	virtual ~SpacePartition();
 
 	void finish();
@@ -169,6 +231,8 @@ public:
 	void executeAgents();
 
 	void agentAdded( AgentPtr agent, bool executedAgent );
+	void agentMoved( Agent * agent );
+	void agentIdChanged( const std::string & oldId, Agent * agent );
 	void removeAgents();
 	void removeAgent(Agent * agent);
 	
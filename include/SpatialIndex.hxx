@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __SpatialIndex_hxx__
+#define __SpatialIndex_hxx__
+
+#include <typedefs.hxx>
+#include <Rectangle.hxx>
+#include <Point2D.hxx>
+#include <Size.hxx>
+#include <vector>
+#include <unordered_map>
+
+namespace Engine
+{
+class Agent;
+
+/** SpatialIndex buckets agents in a uniform grid of square cells covering the boundaries of a Scheduler
+  * Neighbour queries only visit the cells that intersect the query radius, so its cost depends on the local density of agents instead of its total number
+  * Agents are stored in the cell of the position they had the last time the index was updated
+  */
+class SpatialIndex
+{
+	Rectangle<int> _boundaries;
+	//! side of each cell, in number of raster cells
+	int _cellSize;
+	Size<int> _numCells;
+	//! agents stored in each cell, row-major
+	std::vector<AgentsVector> _cells;
+	//! cell where each indexed agent is stored
+	std::unordered_map<Agent *, int> _agentCells;
+
+	//! returns the index of the cell containing position. Positions outside boundaries are assigned to the nearest cell
+	int getCellIndex( const Point2D<int> & position ) const;
+	//! removes agent from cell 'cellIndex' and returns the pointer that was stored
+	AgentPtr eraseFromCell( Agent * agent, const int & cellIndex );
+public:
+	SpatialIndex( const int & cellSize = 8 );
+	virtual ~SpatialIndex();
+
+	//! defines the area covered by the index, in global coordinates. Any indexed agent is removed
+	void resize( const Rectangle<int> & boundaries );
+	void clear();
+
+	//! stores agent in the cell of its current position. If it was already indexed its cell is updated
+	void addAgent( AgentPtr agent );
+	void removeAgent( Agent * agent );
+	//! moves agent to the cell of its current position. Agents not indexed are ignored
+	void updateAgent( Agent * agent );
+	//! checks the position of every indexed agent. Needed if agents have been moved without notifying the index
+	void updateAll();
+
+	//! returns the indexed agents located at position
+	AgentsVector getAgents( const Point2D<int> & position ) const;
+
+	size_t getNumberOfAgents() const { return _agentCells.size(); }
+	const int & getCellSize() const { return _cellSize; }
+
+	//! applies functor to each agent stored in the cells intersecting the square of side 2*radius centered at position. Exact distance must be checked by functor
+	template<class Functor> Functor forEachInRadius( const Point2D<int> & position, const double & radius, Functor functor ) const
+	{
+		if(_cells.empty())
+		{
+			return functor;
+		}
+		// same tolerance used by Scheduler::aggregator
+		double reach = radius+0.0001;
+		int left = clampCell((position._x-reach-_boundaries._origin._x)/_cellSize, _numCells._width);
+		int right = clampCell((position._x+reach-_boundaries._origin._x)/_cellSize, _numCells._width);
+		int top = clampCell((position._y-reach-_boundaries._origin._y)/_cellSize, _numCells._height);
+		int bottom = clampCell((position._y+reach-_boundaries._origin._y)/_cellSize, _numCells._height);
+
+		for(int y=top; y<=bottom; y++)
+		{
+			for(int x=left; x<=right; x++)
+			{
+				const AgentsVector & cell = _cells[y*_numCells._width+x];
+				for(size_t i=0; i<cell.size(); i++)
+				{
+					functor(cell[i]);
+				}
+			}
+		}
+		return functor;
+	}
+private:
+	static int clampCell( const double & value, const int & numCells )
+	{
+		if(value<0.0)
+		{
+			return 0;
+		}
+		if(value>=numCells)
+		{
+			return numCells-1;
+		}
+		return (int)value;
+	}
+};
+
+} // namespace Engine
+
+#endif // __SpatialIndex_hxx__
+
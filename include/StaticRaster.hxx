@@ -25,12 +25,16 @@
 
 #include <Point2D.hxx>
 #include <Size.hxx>
+#include <typedefs.hxx>
 #include <vector>
+#include <string>
+#include <boost/align/aligned_allocator.hpp>
 
 namespace Engine
 {
 class World;
 class RasterLoader;
+class SpacePartition;
 
 struct ColorEntry
 {
@@ -48,14 +52,32 @@ struct ColorEntry
 //! this class is used to load a static raster map. Values can't be modified, and it won't be serialized each time step (only one time)
 class StaticRaster
 {
+public:
+	//! contiguous storage of cells, aligned to cache lines so loops over rows can be vectorized
+	typedef std::vector<int, boost::alignment::aligned_allocator<int, 64> > Values;
 protected:
-	std::vector< std::vector<int> >_values;
+	Size<int> _size;
+	//! values stored in row-major order (cell x,y is at y*width+x), the same layout used by GDAL and HDF5 files
+	Values _values;
 
 	int _minValue;
 	int _maxValue;
 
 	bool _hasColorTable;
 	std::vector< ColorEntry > _colorTable;
+
+	//! position of cell 'position' inside _values
+	size_t getIndex( const Point2D<int> & position ) const { return size_t(position._y)*_size._width+position._x; }
+	//! throws an Exception if position is outside the raster
+	void checkBounds( const Point2D<int> & position, const std::string & method ) const;
+	//! throws an Exception; called by the accessors of dense buffers on rasters that store their cells elsewhere
+	void throwNotDense( const char * method ) const;
+	//! minimum, maximum and sum of all the cells, computed by RasterKernels
+	virtual void getStats( int & minValue, int & maxValue, long long & sum ) const;
+	//! replaces every cell with the row-major buffer 'values', of getSize() cells. Used by RasterLoader
+	virtual void setLoadedValues( const std::vector<int> & values );
+	//! number of blocks of RasterKernels::_blockSize cells needed to cover the raster
+	int getNumBlocks() const;
 public:
 	StaticRaster();
 	virtual ~StaticRaster();
@@ -66,8 +88,36 @@ public:
 
 	//! changes raster size. Parameter 'size' represents the new dimesions for the raster area.
 	virtual void resize( const Size<int> & size );
-	//! Reads the value in the cell located by parameter "position". Returns -1 if "position" is out of the area of the raster.
-	virtual const int & getValue( const Point2D<int>& position ) const;
+	//! Reads the value in the cell located by parameter "position". Bounds are only checked if PANDORADEBUG is defined
+	virtual int getValue( const Point2D<int>& position ) const;
+	//! copies 'width' values of row y, starting at column x. Unlike getRow it works with any kind of raster
+	virtual void copyRow( const int & y, const int & x, const int & width, int * values ) const;
+	//! non-virtual version of getValue, to be used in loops that already know the size of the raster. Throws an Exception if cells are not stored as int (i.e. tiled and narrow rasters)
+	const int & getValueUnchecked( const Point2D<int>& position ) const
+	{
+		// tiled and narrow rasters leave the dense buffers empty
+		if(_values.empty())
+		{
+			throwNotDense("StaticRaster::getValueUnchecked");
+		}
+#ifdef PANDORADEBUG
+		checkBounds(position, "StaticRaster::getValueUnchecked");
+#endif
+		return _values[getIndex(position)];
+	}
+	//! returns the first cell of row y; the row has getSize()._width contiguous values. Throws an Exception if cells are not stored as int
+	const int * getRow( const int & y ) const
+	{
+		// tiled and narrow rasters leave the dense buffers empty
+		if(_values.empty())
+		{
+			throwNotDense("StaticRaster::getRow");
+		}
+#ifdef PANDORADEBUG
+		checkBounds(Point2D<int>(0, y), "StaticRaster::getRow");
+#endif
+		return &_values[size_t(y)*_size._width];
+	}
 
 	//! Returns size of the raster codifying the horizontal and vertical dimensions in a Size object. 
 	virtual Size<int> getSize() const;
@@ -75,6 +125,8 @@ public:
 	virtual const int & getMaxValue() const;
 	//! Reads the '_minValue' attribute.
 	const int & getMinValue() const;
+	//! type used to store the cells, also used for MPI messages and serialization
+	virtual RasterValueType getValueType() const;
 
 	float getAvgValue() const;
 	void updateMinMaxValues();
@@ -86,6 +138,8 @@ public:
 	ColorEntry getColorEntry(int index ) const;
 	
 	friend class RasterLoader;
+	//! needs to reload values after moving boundaries
+	friend class SpacePartition;
 }; 
 
 } // namespace Engine
@@ -25,21 +25,43 @@
 
 #include <boost/random.hpp>
 #include <vector>
+#include <algorithm>
+#include <omp.h>
 
 namespace Engine
 {
 
+/** Statistics provides random numbers to the simulation
+  * Each OpenMP thread draws from its own engine, so it can be used inside parallel regions without locks
+  * Engines are seeded from /dev/urandom unless setSeed is called; in this case the same seed, rank and number of threads will give the same sequences
+  * Work scheduled as OpenMP tasks runs on whichever thread is idle, so it binds an engine of its own (see seedTaskEngine and bindEngine) to keep runs reproducible
+  */
 class Statistics
 {
+public:
 	typedef boost::mt19937 RandomEngine;
-	RandomEngine _randomGenerator;
+private:
 	static const int _distributionSize = 100000;
 
+	//! random engine of a thread, padded to avoid false sharing between threads
+	struct RandomStream
+	{
+		RandomEngine _engine;
+		//! engine of the task being executed by the thread, if any
+		RandomEngine * _bound;
+		char _padding[64];
+
+		RandomStream() : _bound(0) {}
+	};
+	mutable std::vector<RandomStream> _streams;
+	//! seed and rank given to seedStreams, used to derive task engines
+	uint64_t _seed;
+	int _rank;
+
+	//! engine used to generate distribution tables
+	RandomEngine _randomGenerator;
 	// general random indexs
 	boost::uniform_int<> _randomNumbers;
-	mutable boost::variate_generator< RandomEngine, boost::uniform_int<> > _nextRandomNumber;
-
-    boost::uniform_01<RandomEngine> _next01Number;
 
 	// TODO fix expo and normal distributions!
 	std::vector<float> _exponentialDistribution;
@@ -47,8 +69,31 @@ class Statistics
 
 	std::vector<float> _normalDistribution;
 	void generateNormalDistribution();
+
+	//! seeds generator and thread engines with independent substreams derived from seed and rank
+	void seedStreams( uint64_t seed, int rank );
+	//! returns the seed of the substream identified by rank and thread index
+	static uint32_t getStreamSeed( uint64_t seed, uint64_t rank, uint64_t thread );
+	//! engine of the calling thread
+	RandomEngine & getEngine() const
+	{
+		size_t thread = omp_get_thread_num();
+		if(thread>=_streams.size())
+		{
+			throwUnknownThread(thread);
+		}
+		RandomStream & stream = _streams[thread];
+		return stream._bound ? *stream._bound : stream._engine;
+	}
+	void throwUnknownThread( size_t thread ) const;
 public:
 	Statistics();
+	//! reseeds every thread engine, and regenerates distribution tables. Rank is used to get different streams in each MPI task
+	void setSeed( uint64_t seed, int rank = 0 );
+	//! seeds engine with the substream of task index in step; it only depends on seed, rank, step and index, not on the thread executing the task
+	void seedTaskEngine( RandomEngine & engine, uint64_t step, uint64_t index ) const;
+	//! draws of the calling thread come from engine (or its own engine if it is null) until the next call; returns the engine bound before, to be restored at the end of the task
+	RandomEngine * bindEngine( RandomEngine * engine ) const;
 	float getExponentialDistValue( float min, float max ) const;
 	float getNormalDistValueMinMax( float min, float max ) const;
 	float getNormalDistValue( float mean, float sd );
@@ -60,6 +105,17 @@ public:
 	//! Gets a random number from /dev/urandom to be used as a seed.
 	uint64_t getNewSeed();
 
+	//! random permutation of [begin, end) drawn from the engine of the calling thread
+	template<class RandomAccessIterator> void shuffle( RandomAccessIterator begin, RandomAccessIterator end ) const
+	{
+		RandomEngine & engine = getEngine();
+		for(int i=int(end-begin)-1; i>0; i--)
+		{
+			boost::uniform_int<> index(0, i);
+			std::swap(begin[i], begin[index(engine)]);
+		}
+	}
+
 };
 
 } // namespace Engine
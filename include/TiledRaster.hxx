@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#ifndef __TiledRaster_hxx__
+#define __TiledRaster_hxx__
+
+#include <DynamicRaster.hxx>
+#include <vector>
+
+namespace Engine
+{
+
+/** TiledRaster is a DynamicRaster for maps where most cells are at their maximum value most of the time (i.e. resources)
+  * Cells are grouped in square tiles of _tileSize side. A tile with the same value (or max value) in every cell stores it only once
+  * updateRasterIncrement does not touch cells: each tile remembers the last increment applied to it, and pending regrowth is added when a cell is read or modified
+  * Tiles have the same side than SpatialIndex cells, so agents executed in parallel by ParallelExecutor never modify the same tile
+  * getRow and the unchecked accessors need a dense DynamicRaster and throw an Exception; transform falls back to the virtual accessors
+  */
+class TiledRaster : public DynamicRaster
+{
+public:
+	static const int _tileSize = 8;
+private:
+	struct Tile
+	{
+		Tile() : _increments(0), _deficit(0), _value(0), _maxValue(0), _atMax(false), _modified(false) {}
+		//! number of raster increments already applied to the values of the tile
+		int _increments;
+		//! increments needed to get every cell to its max value, counted from _increments
+		int _deficit;
+		//! value of every cell if _values is empty
+		int _value;
+		std::vector<int> _values;
+		//! max value of every cell if _maxValues is empty
+		int _maxValue;
+		std::vector<int> _maxValues;
+		//! true if every cell is at its max value; _value and _values are not used
+		bool _atMax;
+		//! true if cells have been modified since the tile was compressed
+		bool _modified;
+	};
+	//! number of times updateRasterIncrement has been called
+	int _increments;
+	Size<int> _numTiles;
+	std::vector<Tile> _tiles;
+
+	//! returns the tile containing position, and the index of position inside the tile
+	Tile & getTile( const Point2D<int> & position, int & cell );
+	const Tile & getTile( const Point2D<int> & position, int & cell ) const;
+	//! current value of a cell, including pending regrowth
+	int getCellValue( const Tile & tile, const int & cell ) const;
+	int getCellMaxValue( const Tile & tile, const int & cell ) const { return tile._maxValues.empty() ? tile._maxValue : tile._maxValues[cell]; }
+	//! stores the current value of each cell of the tile, so they can be modified
+	void expandValues( Tile & tile ) const;
+	void expandMaxValues( Tile & tile ) const;
+	//! stores only once values and max values that are equal in every cell of the tile
+	void compress( Tile & tile ) const;
+
+protected:
+	void getStats( int & minValue, int & maxValue, long long & sum ) const;
+	void setLoadedValues( const std::vector<int> & values );
+public:
+	TiledRaster();
+	virtual ~TiledRaster();
+
+	void resize( const Size<int> & size );
+	int getValue( const Point2D<int>& position ) const;
+	void copyRow( const int & y, const int & x, const int & width, int * values ) const;
+	int getMaxValue( const Point2D<int>& position ) const;
+
+	void setValue( const Point2D<int>& position, int value );
+	void setMaxValue( const Point2D<int>& position, int value );
+	using DynamicRaster::setMaxValue;
+	void copyMaxRow( const int & y, const int & x, const int & width, int * values ) const;
+	void setRow( const int & y, const int & x, const int & width, const int * values );
+	void setMaxRow( const int & y, const int & x, const int & width, const int * values );
+	void setInitValues( int minValue, int maxValue, int defaultValue );
+
+	//! regrowth is applied lazily, so it only compresses tiles modified since last step
+	void updateRasterIncrement();
+	void updateRasterToMaxValues();
+
+	//! number of tiles storing one value per cell, either for values or max values
+	int getNumExpandedTiles() const;
+};
+
+} // namespace Engine
+
+#endif // __TiledRaster_hxx__
+
@@ -91,6 +91,10 @@ public:
 	
 	//! add an agent to the world, and remove it from overlap agents if exist
 	virtual void addAgent( Agent * agent, bool executedAgent = true );
+	//! notifies the scheduler that agent has changed its position
+	void agentMoved( Agent * agent );
+	//! notifies the scheduler that agent has changed its id
+	void agentIdChanged( const std::string & oldId, Agent * agent );
 
 	//! returns the number of neighbours of agent 'target' within the radius 'radius' using Euclidean Distance.
 	int countNeighbours( Agent * target, const double & radius, const std::string & type="all" );
@@ -119,10 +123,10 @@ public:
 	StaticRaster & getStaticRaster( const size_t & index );
 	StaticRaster & getStaticRaster( const std::string & key );
 
-	//! create a new static raster map with the stablished size and given key
-	void registerStaticRaster( const std::string & key, const bool & serialize, int index = -1);
-	//! create a new raster map with the stablished size and given key
-	void registerDynamicRaster( const std::string & key, const bool & serialize, int index = -1);
+	//! create a new static raster map with the stablished size and given key. Cells are stored with 'valueType'
+	void registerStaticRaster( const std::string & key, const bool & serialize, int index = -1, const RasterValueType & valueType = eRasterInt);
+	//! create a new raster map with the stablished size and given key. If tiled is true it will be a TiledRaster, useful for sparse updates over big maps. Tiled rasters can only store int cells
+	void registerDynamicRaster( const std::string & key, const bool & serialize, int index = -1, const bool & tiled = false, const RasterValueType & valueType = eRasterInt);
 	//! checks if position parameter 'newPosition' is free to occupy by an agent, 'newPosition' is inside of the world and the maximum of agent cell-occupancy is not exceeded.
 	bool checkPosition( const Point2D<int> & newPosition ) const;
 
@@ -192,10 +196,10 @@ public:
 		return false;
 	}
 
-	//! factory method for distributed Scheduler based on spatial distribution of a simulation
-	static Scheduler * useSpacePartition(int overlap = 1, bool finalize = true );
-	//! factory method for sequential Scheduler without any non-shared communication mechanism, apt for being executed in a single computer
-	static Scheduler * useOpenMPSingleNode();
+	//! factory method for distributed Scheduler based on spatial distribution of a simulation. If parallelActions is true actions of agents inside a section are executed by several threads, using overlap as interaction range, and a progress thread advances MPI messages (hybrid mode). A positive rebalancePeriod moves boundaries every rebalancePeriod steps. MPI is initialized with MPI_THREAD_MULTIPLE; if the implementation doesn't provide it there is no progress thread, and with several tasks each serialized step blocks the simulation until it is written
+	static Scheduler * useSpacePartition(int overlap = 1, bool finalize = true, bool parallelActions = false, int rebalancePeriod = 0 );
+	//! factory method for sequential Scheduler without any non-shared communication mechanism, apt for being executed in a single computer. A positive interactionRange enables the parallel execution of actions
+	static Scheduler * useOpenMPSingleNode( int interactionRange = 0 );
 };
 
 } // namespace Engine
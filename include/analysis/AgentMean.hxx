@@ -23,6 +23,10 @@ public:
 
 	void preProcess();
 	void postProcess();
+
+	bool isMergeable() const { return true; }
+	AgentAnalysis * clone() const { return new AgentMean(*this); }
+	void merge( const Analysis & partial );
 };
 
 } // namespace PostProcess
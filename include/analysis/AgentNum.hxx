@@ -18,6 +18,9 @@ public:
 	AgentNum();
 	virtual ~AgentNum();
 	void computeAgent( const Engine::AgentRecord & agentRecord );
+
+	bool isMergeable() const { return true; }
+	AgentAnalysis * clone() const { return new AgentNum(*this); }
 };
 
 } // namespace PostProcess
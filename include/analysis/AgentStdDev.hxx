@@ -24,6 +24,10 @@ public:
 
 	void preProcess();
 	void postProcess();
+
+	bool isMergeable() const { return true; }
+	AgentAnalysis * clone() const { return new AgentStdDev(*this); }
+	void merge( const Analysis & partial );
 };
 
 } // namespace PostProcess
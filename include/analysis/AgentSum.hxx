@@ -19,6 +19,9 @@ public:
 	AgentSum( const std::string & attributeName );
 	virtual ~AgentSum();
 	void computeAgent( const Engine::AgentRecord & agentRecord );
+
+	bool isMergeable() const { return true; }
+	AgentAnalysis * clone() const { return new AgentSum(*this); }
 };
 
 } // namespace PostProcess
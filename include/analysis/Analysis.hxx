@@ -31,6 +31,7 @@
 namespace Engine
 {
 	class AgentRecord;
+	class DynamicRaster;
 }
 
 namespace PostProcess 
@@ -54,6 +55,11 @@ public:
 	virtual void postProcess(){};
 	long double getResult( int timeStep ) const;
 	bool writeResults(){return _writeResults;}	
+
+	//! true if partial results computed by copies of the analysis over disjoint sets of records can be merged
+	virtual bool isMergeable() const { return false; }
+	//! accumulates the partial results of a copy; by default results of each time step are added
+	virtual void merge( const Analysis & partial );
 };
 
 class RasterAnalysis : public Analysis
@@ -64,6 +70,9 @@ public:
 	}
 	virtual ~RasterAnalysis(){}
 	virtual void computeRaster( const Engine::SimulationRecord::RasterHistory & rasterHistory ) = 0;
+	//! if true the analysis is fed one time step at a time through computeRasterStep, sharing each loaded raster with the rest of analyses
+	virtual bool isStepwise() const { return false; }
+	virtual void computeRasterStep( const Engine::DynamicRaster & , int ){}
 };
 
 class AgentAnalysis : public Analysis
@@ -74,6 +83,8 @@ public:
 	}
 	virtual ~AgentAnalysis(){}
 	virtual void computeAgent( const Engine::AgentRecord & ) = 0;
+	//! new copy with the same settings, used to compute partial results; required if isMergeable
+	virtual AgentAnalysis * clone() const { return 0; }
 };
 
 } // namespace PostProcess
@@ -24,6 +24,12 @@
 
 #include <analysis/Output.hxx>
 #include <memory>
+#include <vector>
+
+namespace Engine
+{
+	class AgentRecord;
+}
 
 namespace PostProcess
 {
@@ -45,6 +51,8 @@ protected:
 	std::string _inputDir;
 
 	void writeParams( std::stringstream & line, const std::string & fileName );
+	//! feeds each record once to every analysis; mergeable analyses are computed in parallel by per-thread copies
+	void computeAgents( const std::vector<const Engine::AgentRecord *> & records );
 public:
 	GlobalAgentStats( const std::string & separator=";");	
 	virtual ~GlobalAgentStats();
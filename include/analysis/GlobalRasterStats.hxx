@@ -25,6 +25,11 @@
 #include <analysis/Output.hxx>
 #include <memory>
 
+namespace Engine
+{
+	class RasterHistory;
+}
+
 namespace PostProcess
 {
 class RasterAnalysis;
@@ -45,6 +50,8 @@ protected:
 	std::string _inputDir;
 
 	void writeParams( std::stringstream & line, const std::string & fileName );
+	//! loads each step of the history once and feeds it to every stepwise analysis
+	void computeRaster( const Engine::RasterHistory & rasterHistory, int numTimeSteps );
 public:
 	GlobalRasterStats( const std::string & separator=";");	
 	virtual ~GlobalRasterStats();
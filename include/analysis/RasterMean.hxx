@@ -20,6 +20,9 @@ public:
 	virtual ~RasterMean();
 	void computeRaster( const Engine::SimulationRecord::RasterHistory & rasterHistory );
 
+	bool isStepwise() const { return true; }
+	void computeRasterStep( const Engine::DynamicRaster & raster, int timeStep );
+
 	void postProcess();
 };
 
@@ -19,6 +19,9 @@ public:
 	RasterSum();
 	virtual ~RasterSum();
 	void computeRaster( const Engine::SimulationRecord::RasterHistory & rasterHistory );
+
+	bool isStepwise() const { return true; }
+	void computeRasterStep( const Engine::DynamicRaster & raster, int timeStep );
 };
 
 } // namespace PostProcess
@@ -27,7 +27,26 @@ enum MpiMessageType
 	eVectorAttribute = 7, 	
 	eSizeVector = 8,
 	eNumModifiedAgents = 9,
-	eModifiedAgent = 10
+	eModifiedAgent = 10,
+	//! raster overlap modified by a section; each of the four sections uses its own tag, starting with this one
+	eRasterSectionData = 11
+};
+
+//! Type used to store the cells of a raster, in memory, MPI messages and HDF5 files
+enum RasterValueType
+{
+	eRasterInt = 0,
+	eRasterShort = 1,
+	eRasterByte = 2
+};
+
+//! Codec used to compress the datasets of the results files
+enum CompressionCodec
+{
+	eCodecNone = 0,
+	eCodecDeflate = 1,
+	eCodecLZ4 = 2,
+	eCodecZstd = 3
 };
 
 
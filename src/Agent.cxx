@@ -35,8 +35,9 @@
 namespace Engine
 {
 
-Agent::Agent( const std::string & id ) : _id(id), _exists(true), _position(-1,-1), _world(0)
+Agent::Agent( const std::string & id ) : _typeId(-1), _id(id), _exists(true), _position(-1,-1), _world(0)
 {
+	updateType();
 	_stringAttributes.push_back("id");
 	_intAttributes.push_back("x");
 	_intAttributes.push_back("y");
@@ -75,6 +76,10 @@ World & Agent::getWorldRef()
 void Agent::setPosition( const Point2D<int> & position )
 {
 	_position = position;
+	if(_world)
+	{
+		_world->agentMoved(this);
+	}
 }
 
 const Point2D<int> & Agent::getPosition() const
@@ -131,17 +136,23 @@ void Agent::remove()
 	
 bool Agent::isType( const std::string & type ) const
 {
-	if(type.compare(getType())==0)
+	if(type.compare(_type)==0)
 	{
 		return true;
 	}
 	return false;
 }
 
-std::string Agent::getType() const
+const std::string & Agent::getType() const
+{
+	return _type;
+}
+
+void Agent::updateType()
 {
 	unsigned int typePos = _id.find_first_of("_");
-	return _id.substr(0,typePos);
+	_type = _id.substr(0,typePos);
+	_typeId = GeneralState::agentTypes().registerType(_type);
 }
 
 void Agent::executeActions()
@@ -160,14 +171,20 @@ void Agent::executeActions()
 	
 void Agent::setRandomPosition()
 {
-	_position = _world->getRandomPosition();
+	setPosition(_world->getRandomPosition());
 }
 
 void Agent::changeType( const std::string & type )
 {
     std::string oldType = getType();
+    std::string oldId = _id;
     size_t startPos = _id.find(oldType);
     _id.replace(startPos, oldType.length(), type);
+    updateType();
+    if(_world)
+    {
+        _world->agentIdChanged(oldId, this);
+    }
 }
 
 } // namespace Engine
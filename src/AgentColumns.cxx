@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+
+#include <AgentColumns.hxx>
+#include <Exception.hxx>
+#include <sstream>
+
+namespace Engine
+{
+
+AgentColumns::AgentColumns( const std::string & type ) : _type(type), _position(0), _numAgents(0)
+{
+}
+
+AgentColumns::~AgentColumns()
+{
+}
+
+int AgentColumns::addColumn( const std::string & name, ColumnKind kind, size_t numColumns )
+{
+	std::unordered_map<std::string, int>::const_iterator it = _handles.find(name);
+	if(it!=_handles.end())
+	{
+		if(it->second%3!=kind)
+		{
+			std::stringstream oss;
+			oss << "AgentColumns::addColumn - attribute: " << name << " of agent type: " << _type << " registered with different types";
+			throw Exception(oss.str());
+		}
+		return it->second/3;
+	}
+	_handles.insert(std::make_pair(name, numColumns*3+kind));
+	return numColumns;
+}
+
+int AgentColumns::addIntColumn( const std::string & name )
+{
+	int handle = addColumn(name, eInt, _intColumns.size());
+	if(handle==(int)_intColumns.size())
+	{
+		_intNames.push_back(name);
+		_intColumns.push_back(std::vector<int>());
+	}
+	return handle;
+}
+
+int AgentColumns::addFloatColumn( const std::string & name )
+{
+	int handle = addColumn(name, eFloat, _floatColumns.size());
+	if(handle==(int)_floatColumns.size())
+	{
+		_floatNames.push_back(name);
+		_floatColumns.push_back(std::vector<float>());
+	}
+	return handle;
+}
+
+int AgentColumns::addStringColumn( const std::string & name )
+{
+	int handle = addColumn(name, eString, _stringColumns.size());
+	if(handle==(int)_stringColumns.size())
+	{
+		_stringNames.push_back(name);
+		_stringColumns.push_back(std::vector<std::string>());
+	}
+	return handle;
+}
+
+int AgentColumns::getIntHandle( const std::string & name ) const
+{
+	std::unordered_map<std::string, int>::const_iterator it = _handles.find(name);
+	return (it==_handles.end() || it->second%3!=eInt) ? -1 : it->second/3;
+}
+
+int AgentColumns::getFloatHandle( const std::string & name ) const
+{
+	std::unordered_map<std::string, int>::const_iterator it = _handles.find(name);
+	return (it==_handles.end() || it->second%3!=eFloat) ? -1 : it->second/3;
+}
+
+int AgentColumns::getStringHandle( const std::string & name ) const
+{
+	std::unordered_map<std::string, int>::const_iterator it = _handles.find(name);
+	return (it==_handles.end() || it->second%3!=eString) ? -1 : it->second/3;
+}
+
+void AgentColumns::beginAgent()
+{
+	_position = 0;
+	_numAgents++;
+}
+
+int AgentColumns::resolve( const std::string & name, ColumnKind kind )
+{
+	if(_position<_sequence.size())
+	{
+		int expected = _sequence[_position];
+		if(expected%3==kind)
+		{
+			const std::vector<std::string> & names = kind==eInt ? _intNames : (kind==eFloat ? _floatNames : _stringNames);
+			if(names[expected/3]==name)
+			{
+				_position++;
+				return expected/3;
+			}
+		}
+	}
+
+	std::unordered_map<std::string, int>::const_iterator it = _handles.find(name);
+	if(it==_handles.end() || it->second%3!=kind)
+	{
+		std::stringstream oss;
+		oss << "AgentColumns::resolve - looking for unknown attribute: " << name << " in agent type: " << _type;
+		throw Exception(oss.str());
+	}
+	// the first agent defines the order expected for the next ones
+	if(_position==_sequence.size() && _numAgents<=1)
+	{
+		_sequence.push_back(it->second);
+	}
+	_position++;
+	return it->second/3;
+}
+
+void AgentColumns::moveValues( AgentColumns & columns )
+{
+	if(columns._handles.size()!=_handles.size() || columns._type!=_type)
+	{
+		columns._type = _type;
+		columns._intNames = _intNames;
+		columns._floatNames = _floatNames;
+		columns._stringNames = _stringNames;
+		columns._handles = _handles;
+		columns._intColumns.resize(_intColumns.size());
+		columns._floatColumns.resize(_floatColumns.size());
+		columns._stringColumns.resize(_stringColumns.size());
+		columns.clear();
+	}
+	_intColumns.swap(columns._intColumns);
+	_floatColumns.swap(columns._floatColumns);
+	_stringColumns.swap(columns._stringColumns);
+	columns._numAgents = _numAgents;
+	clear();
+}
+
+void AgentColumns::clear()
+{
+	for(size_t i=0; i<_intColumns.size(); i++)
+	{
+		_intColumns[i].clear();
+	}
+	for(size_t i=0; i<_floatColumns.size(); i++)
+	{
+		_floatColumns[i].clear();
+	}
+	for(size_t i=0; i<_stringColumns.size(); i++)
+	{
+		_stringColumns[i].clear();
+	}
+	_numAgents = 0;
+	_position = 0;
+}
+
+} // namespace Engine
@@ -21,6 +21,7 @@
  */
 
 #include <AgentRecord.hxx>
+#include <AgentTable.hxx>
 #include <Exception.hxx>
 
 #include <sstream>
@@ -28,7 +29,7 @@
 namespace Engine
 {
 
-AgentRecord::AgentRecord( const std::string & id, int numSteps ) : _id(id), _numSteps(numSteps)
+AgentRecord::AgentRecord( const AgentTable & table, const std::string & id, int index ) : _table(&table), _id(&id), _index(index)
 {
 }
 
@@ -36,155 +37,124 @@ AgentRecord::~AgentRecord()
 {
 }
 
-void AgentRecord::addInt( int numStep, const std::string & key, int value )
-{
-	IntAttributesMap::iterator it = _intAttributes.find(key);
-	// the key still doesn't exist
-	if(it==_intAttributes.end())
-	{
-		IntValues values;
-		values.resize(_numSteps);
-		_intAttributes.insert( make_pair( key, values ));
-		it = _intAttributes.find(key);
-	}
-	IntValues& vector = it->second;
-	vector[numStep] = value;
-}
-
-void AgentRecord::addFloat( int numStep, const std::string & key, float value )
-{
-	FloatAttributesMap::iterator it = _floatAttributes.find(key);
-	// the key still doesn't exist
-	if(it==_floatAttributes.end())
-	{
-		FloatValues values;
-		values.resize(_numSteps);
-		_floatAttributes.insert( make_pair( key, values ));
-		it = _floatAttributes.find(key);
-	}
-	FloatValues& vector = it->second;
-	vector[numStep] = value;
-}
-
-void AgentRecord::addStr( int numStep, const std::string & key, const std::string & value )
-{
-	StrAttributesMap::iterator it = _strAttributes.find(key);
-	// the key still doesn't exist
-	if(it==_strAttributes.end())
-	{
-		StrValues values;
-		values.resize(_numSteps);
-		_strAttributes.insert( make_pair( key, values ));
-		it = _strAttributes.find(key);
-	}
-	StrValues& vector = it->second;
-	vector[numStep] = value;
-}
-
 int AgentRecord::getInt( int numStep, const std::string & key ) const
 {
-	IntAttributesMap::const_iterator it = _intAttributes.find(key);
-	// the key already exists
-	if(it==_intAttributes.end())
+	int column = _table->getIntColumn(key);
+	if(column==-1)
 	{
 		std::stringstream oss;
 		oss << "AgentRecord::getInt - searching for unknown key: " << key << " in agent record";
 		throw Engine::Exception(oss.str());
 	}
-	const IntValues & vector = it->second;
-	return vector.at(numStep);
+	return _table->getInt(column, numStep, _index);
 }
 
 float AgentRecord::getFloat( int numStep, const std::string & key ) const
 {
-	FloatAttributesMap::const_iterator it = _floatAttributes.find(key);
-	// the key already exists
-	if(it==_floatAttributes.end())
+	int column = _table->getFloatColumn(key);
+	if(column==-1)
 	{
 		std::stringstream oss;
 		oss << "AgentRecord::getFloat - searching for unknown key: " << key << " in agent record";
 		throw Engine::Exception(oss.str());
 	}
-	const FloatValues & vector = it->second;
-	return vector.at(numStep);
+	return _table->getFloat(column, numStep, _index);
 }
 
 const std::string & AgentRecord::getStr( int numStep, const std::string & key ) const
 {
-	StrAttributesMap::const_iterator it = _strAttributes.find(key);
-	// the key already exists
-	if(it==_strAttributes.end())
+	int column = _table->getStrColumn(key);
+	if(column==-1)
 	{
 		std::stringstream oss;
 		oss << "AgentRecord::getStr - searching for unknown key: " << key << " in agent record";
 		throw Engine::Exception(oss.str());
 	}
-	const StrValues & vector = it->second;
-	return vector.at(numStep);
+	return _table->getStr(column, numStep, _index);
 }
 
 std::string AgentRecord::getCompleteState( int numStep ) const
 {
 	std::stringstream completeState;
-	completeState << "id: " << _id << " pos: " << getInt(numStep, "x") << "/" << getInt(numStep, "y") << std::endl;
-	for(IntAttributesMap::const_iterator it=_intAttributes.begin(); it!=_intAttributes.end(); it++)
+	completeState << "id: " << getId() << " pos: " << getInt(numStep, "x") << "/" << getInt(numStep, "y") << std::endl;
+	for(IntAttributesMap::const_iterator it=beginInt(); it!=endInt(); it++)
 	{
 		const std::string & key = it->first;
 		if(key.compare("exists")==0 || key.compare("x")==0 || key.compare("y")==0)
 		{
 			continue;
 		}
-		completeState << "\t" << it->first << ": " << it->second[numStep] << std::endl;
+		completeState << "\t" << it->first << ": " << _table->getInt(it->second, numStep, _index) << std::endl;
 	}
-    for(FloatAttributesMap::const_iterator it=_floatAttributes.begin(); it!=_floatAttributes.end(); it++)
+    for(FloatAttributesMap::const_iterator it=beginFloat(); it!=endFloat(); it++)
 	{
 		const std::string & key = it->first;
 		if(key.compare("exists")==0 || key.compare("x")==0 || key.compare("y")==0)
 		{
 			continue;
 		}
-		completeState << "\t" << it->first << ": " << it->second[numStep] << std::endl;
+		completeState << "\t" << it->first << ": " << _table->getFloat(it->second, numStep, _index) << std::endl;
 	}
-    for(StrAttributesMap::const_iterator it=_strAttributes.begin(); it!=_strAttributes.end(); it++)
+    for(StrAttributesMap::const_iterator it=beginStr(); it!=endStr(); it++)
 	{
 		const std::string & key = it->first;
 		if(key.compare("exists")==0 || key.compare("x")==0 || key.compare("y")==0)
 		{
 			continue;
 		}
-		completeState << "\t" << it->first << ": " << it->second[numStep] << std::endl;
+		completeState << "\t" << it->first << ": " << _table->getStr(it->second, numStep, _index) << std::endl;
 	}
 	return completeState.str();
 }
 
+AgentRecord::IntAttributesMap::const_iterator AgentRecord::beginInt() const
+{
+	return _table->getIntColumns().begin();
+}
+
+AgentRecord::IntAttributesMap::const_iterator AgentRecord::endInt() const
+{
+	return _table->getIntColumns().end();
+}
+
+AgentRecord::FloatAttributesMap::const_iterator AgentRecord::beginFloat() const
+{
+	return _table->getFloatColumns().begin();
+}
+
+AgentRecord::FloatAttributesMap::const_iterator AgentRecord::endFloat() const
+{
+	return _table->getFloatColumns().end();
+}
+
+AgentRecord::StrAttributesMap::const_iterator AgentRecord::beginStr() const
+{
+	return _table->getStrColumns().begin();
+}
+
+AgentRecord::StrAttributesMap::const_iterator AgentRecord::endStr() const
+{
+	return _table->getStrColumns().end();
+}
+
+int AgentRecord::getNumSteps() const
+{
+	return _table->getNumSteps();
+}
+
 bool AgentRecord::isInt( const std::string & key ) const
 {
-    IntAttributesMap::const_iterator it = _intAttributes.find(key);
-	if(it==_intAttributes.end())
-    {
-        return false;
-    }
-    return true;
+	return _table->getIntColumn(key)!=-1;
 }
 
 bool AgentRecord::isFloat( const std::string & key ) const
 { 
-    FloatAttributesMap::const_iterator it = _floatAttributes.find(key);
-	if(it==_floatAttributes.end())
-    {
-        return false;
-    }
-    return true;
+	return _table->getFloatColumn(key)!=-1;
 }
 
 bool AgentRecord::isStr( const std::string & key ) const
 {   
-    StrAttributesMap::const_iterator it = _strAttributes.find(key);
-	if(it==_strAttributes.end())
-    {
-        return false;
-    }
-    return true;
+	return _table->getStrColumn(key)!=-1;
 }
 
 } // namespace Engine
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+
+#include <AgentTable.hxx>
+#include <Exception.hxx>
+
+#include <sstream>
+#include <limits>
+#include <algorithm>
+
+namespace Engine
+{
+
+AttributeStats::AttributeStats() : _count(0), _sum(0.0), _min(std::numeric_limits<double>::max()), _max(-std::numeric_limits<double>::max())
+{
+}
+
+void AttributeStats::merge( const AttributeStats & stats )
+{
+	_count += stats._count;
+	_sum += stats._sum;
+	_min = std::min(_min, stats._min);
+	_max = std::max(_max, stats._max);
+}
+
+AgentTable::AgentTable() : _numSteps(0), _existsColumn(-1)
+{
+	init("", 0);
+}
+
+AgentTable::~AgentTable()
+{
+}
+
+void AgentTable::init( const std::string & type, int numSteps )
+{
+	_type = type;
+	_numSteps = numSteps;
+	_records.clear();
+	_views.clear();
+	_intColumns.clear();
+	_floatColumns.clear();
+	_strColumns.clear();
+	_intValues.clear();
+	_floatValues.clear();
+	_strValues.clear();
+	_strings.clear();
+	_stringCodes.clear();
+	_positions.clear();
+	_positions.resize(numSteps);
+	encodeString("");
+	_existsColumn = addIntColumn("exists");
+}
+
+template<typename Type> int AgentTable::addColumn( const std::string & name, ColumnsMap & columns, std::vector< std::vector< std::vector<Type> > > & values )
+{
+	ColumnsMap::iterator it = columns.find(name);
+	if(it!=columns.end())
+	{
+		return it->second;
+	}
+	int column = values.size();
+	columns.insert(make_pair(name, column));
+	values.push_back(std::vector< std::vector<Type> >(_numSteps));
+	return column;
+}
+
+int AgentTable::addIntColumn( const std::string & name )
+{
+	return addColumn(name, _intColumns, _intValues);
+}
+
+int AgentTable::addFloatColumn( const std::string & name )
+{
+	return addColumn(name, _floatColumns, _floatValues);
+}
+
+int AgentTable::addStrColumn( const std::string & name )
+{
+	return addColumn(name, _strColumns, _strValues);
+}
+
+int AgentTable::getColumn( const std::string & name, const ColumnsMap & columns )
+{
+	ColumnsMap::const_iterator it = columns.find(name);
+	if(it==columns.end())
+	{
+		return -1;
+	}
+	return it->second;
+}
+
+int AgentTable::addAgent( const std::string & id )
+{
+	RecordsMap::iterator it = _records.find(id);
+	if(it!=_records.end())
+	{
+		return it->second->getIndex();
+	}
+	it = _records.insert(make_pair(id, (AgentRecord *)0)).first;
+	_views.push_back(AgentRecord(*this, it->first, _views.size()));
+	it->second = &_views.back();
+	return it->second->getIndex();
+}
+
+int AgentTable::getAgentIndex( const std::string & id ) const
+{
+	RecordsMap::const_iterator it = _records.find(id);
+	if(it==_records.end())
+	{
+		return -1;
+	}
+	return it->second->getIndex();
+}
+
+std::vector<int> & AgentTable::getIntStep( int column, int step )
+{
+	std::vector<int> & values = _intValues[column].at(step);
+	values.resize(_views.size(), 0);
+	return values;
+}
+
+std::vector<float> & AgentTable::getFloatStep( int column, int step )
+{
+	std::vector<float> & values = _floatValues[column].at(step);
+	values.resize(_views.size(), 0.0f);
+	return values;
+}
+
+std::vector<int> & AgentTable::getStrStep( int column, int step )
+{
+	std::vector<int> & values = _strValues[column].at(step);
+	values.resize(_views.size(), 0);
+	return values;
+}
+
+int AgentTable::encodeString( const std::string & value )
+{
+	std::unordered_map<std::string, int>::iterator it = _stringCodes.find(value);
+	if(it!=_stringCodes.end())
+	{
+		return it->second;
+	}
+	int code = _strings.size();
+	_strings.push_back(value);
+	_stringCodes.insert(make_pair(value, code));
+	return code;
+}
+
+void AgentTable::checkSteps( const std::string & method, int firstStep, int lastStep ) const
+{
+	if(firstStep<0 || lastStep>=_numSteps || firstStep>lastStep)
+	{
+		std::stringstream oss;
+		oss << "AgentTable::" << method << " - steps: [" << firstStep << ", " << lastStep << "] out of bounds for type: " << _type << " with: " << _numSteps << " steps";
+		throw Exception(oss.str());
+	}
+}
+
+template<typename Type> void AgentTable::aggregateStep( const std::vector<int> & exists, const std::vector<Type> & values, AttributeStats & stats ) const
+{
+	size_t numValues = std::min(exists.size(), values.size());
+	for(size_t i=0; i<numValues; i++)
+	{
+		if(exists[i])
+		{
+			stats.add(values[i]);
+		}
+	}
+	// agents without values in the step, registered by other files
+	for(size_t i=numValues; i<exists.size(); i++)
+	{
+		if(exists[i])
+		{
+			stats.add(0.0);
+		}
+	}
+}
+
+void AgentTable::aggregate( const std::string & attribute, int firstStep, int lastStep, AttributeStats & stats ) const
+{
+	checkSteps("aggregate", firstStep, lastStep);
+	int intColumn = getIntColumn(attribute);
+	int floatColumn = getFloatColumn(attribute);
+	if(intColumn==-1 && floatColumn==-1)
+	{
+		std::stringstream oss;
+		oss << "AgentTable::aggregate - unknown numerical attribute: " << attribute << " in type: " << _type;
+		throw Exception(oss.str());
+	}
+	for(int step=firstStep; step<=lastStep; step++)
+	{
+		const std::vector<int> & exists = getIntStep(_existsColumn, step);
+		if(intColumn!=-1)
+		{
+			aggregateStep(exists, getIntStep(intColumn, step), stats);
+		}
+		else
+		{
+			aggregateStep(exists, getFloatStep(floatColumn, step), stats);
+		}
+	}
+}
+
+template<typename Type> void AgentTable::histogramStep( const std::vector<int> & exists, const std::vector<Type> & values, double minValue, double interval, std::vector<size_t> & bins ) const
+{
+	for(size_t i=0; i<exists.size(); i++)
+	{
+		double value = i<values.size() ? values[i] : 0.0;
+		if(!exists[i] || value<minValue)
+		{
+			continue;
+		}
+		size_t bin = (value-minValue)/interval;
+		if(bin>=bins.size())
+		{
+			bins.resize(bin+1, 0);
+		}
+		bins[bin]++;
+	}
+}
+
+void AgentTable::histogram( const std::string & attribute, int firstStep, int lastStep, double minValue, double interval, std::vector<size_t> & bins ) const
+{
+	checkSteps("histogram", firstStep, lastStep);
+	int intColumn = getIntColumn(attribute);
+	int floatColumn = getFloatColumn(attribute);
+	if((intColumn==-1 && floatColumn==-1) || interval<=0.0)
+	{
+		std::stringstream oss;
+		oss << "AgentTable::histogram - attribute: " << attribute << " of type: " << _type << " with interval: " << interval << " is not a numerical attribute with a positive interval";
+		throw Exception(oss.str());
+	}
+	for(int step=firstStep; step<=lastStep; step++)
+	{
+		const std::vector<int> & exists = getIntStep(_existsColumn, step);
+		if(intColumn!=-1)
+		{
+			histogramStep(exists, getIntStep(intColumn, step), minValue, interval, bins);
+		}
+		else
+		{
+			histogramStep(exists, getFloatStep(floatColumn, step), minValue, interval, bins);
+		}
+	}
+}
+
+void AgentTable::getAgentsAt( int step, const Point2D<int> & position, std::vector<int> & indices ) const
+{
+	checkSteps("getAgentsAt", step, step);
+	int xColumn = getIntColumn("x");
+	int yColumn = getIntColumn("y");
+	if(xColumn==-1 || yColumn==-1)
+	{
+		return;
+	}
+	std::vector< std::pair<long long, int> > & positions = _positions[step];
+	if(positions.empty())
+	{
+		const std::vector<int> & exists = getIntStep(_existsColumn, step);
+		for(size_t i=0; i<exists.size(); i++)
+		{
+			if(exists[i])
+			{
+				positions.push_back(std::make_pair(getPositionKey(getInt(xColumn, step, i), getInt(yColumn, step, i)), int(i)));
+			}
+		}
+		std::sort(positions.begin(), positions.end());
+	}
+	long long key = getPositionKey(position._x, position._y);
+	std::vector< std::pair<long long, int> >::const_iterator it = std::lower_bound(positions.begin(), positions.end(), std::make_pair(key, -1));
+	for(; it!=positions.end() && it->first==key; it++)
+	{
+		indices.push_back(it->second);
+	}
+}
+
+} // namespace Engine
+
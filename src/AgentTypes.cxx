@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <AgentTypes.hxx>
+#include <Exception.hxx>
+
+#include <sstream>
+
+namespace Engine
+{
+
+AgentTypes::AgentTypes()
+{
+}
+
+AgentTypes::~AgentTypes()
+{
+}
+
+int AgentTypes::registerType( const std::string & type )
+{
+	int id = -1;
+	// agents are usually created by serial code, but registration must be safe if this is not the case
+	#pragma omp critical(agentTypes)
+	{
+		std::unordered_map<std::string, int>::const_iterator it = _ids.find(type);
+		if(it!=_ids.end())
+		{
+			id = it->second;
+		}
+		else
+		{
+			id = _names.size();
+			_names.push_back(type);
+			_ids.insert(std::make_pair(type, id));
+		}
+	}
+	return id;
+}
+
+int AgentTypes::getId( const std::string & type ) const
+{
+	int id = -1;
+	// registerType may rehash _ids from another thread
+	#pragma omp critical(agentTypes)
+	{
+		std::unordered_map<std::string, int>::const_iterator it = _ids.find(type);
+		if(it!=_ids.end())
+		{
+			id = it->second;
+		}
+	}
+	return id;
+}
+
+const std::string & AgentTypes::getName( const int & id ) const
+{
+	size_t numTypes = getNumTypes();
+	if(id<0 || id>=(int)numTypes)
+	{
+		std::stringstream oss;
+		oss << "AgentTypes::getName - unknown type id: " << id << " with num registered types: " << numTypes;
+		throw Exception(oss.str());
+	}
+	const std::string * name = 0;
+	#pragma omp critical(agentTypes)
+	{
+		name = &_names[id];
+	}
+	return *name;
+}
+
+size_t AgentTypes::getNumTypes() const
+{
+	size_t numTypes = 0;
+	#pragma omp critical(agentTypes)
+	{
+		numTypes = _names.size();
+	}
+	return numTypes;
+}
+
+} // namespace Engine
+
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <Compression.hxx>
+#include <SerializationThread.hxx>
+
+namespace Engine
+{
+
+const hsize_t Compression::_rasterChunkSize;
+const hsize_t Compression::_agentChunkSize;
+
+CompressionCodec Compression::getAvailableCodec( const CompressionCodec & codec )
+{
+	if(codec==eCodecLZ4 && H5Zfilter_avail(_lz4Filter)<=0)
+	{
+		return eCodecDeflate;
+	}
+	if(codec==eCodecZstd && H5Zfilter_avail(_zstdFilter)<=0)
+	{
+		return eCodecDeflate;
+	}
+	return codec;
+}
+
+void Compression::setFilters( const hid_t & propertyListId, const CompressionCodec & codec, const int & level, const bool & shuffle )
+{
+	if(codec==eCodecNone)
+	{
+		return;
+	}
+	if(shuffle)
+	{
+		H5Pset_shuffle(propertyListId);
+	}
+	if(codec==eCodecLZ4)
+	{
+		// 0 uses the default block size of the plugin
+		unsigned int blockSize = 0;
+		H5Pset_filter(propertyListId, _lz4Filter, H5Z_FLAG_MANDATORY, 1, &blockSize);
+		return;
+	}
+	if(codec==eCodecZstd)
+	{
+		unsigned int zstdLevel = level;
+		H5Pset_filter(propertyListId, _zstdFilter, H5Z_FLAG_MANDATORY, 1, &zstdLevel);
+		return;
+	}
+	H5Pset_deflate(propertyListId, level);
+}
+
+hid_t Compression::getDeltaFileType( const RasterValueType & valueType )
+{
+	if(valueType==eRasterByte)
+	{
+		return H5T_NATIVE_SHORT;
+	}
+	return H5T_NATIVE_INT;
+}
+
+bool Compression::encodeDelta( DeltaReference & reference, const RasterSnapshot & snapshot, std::vector<int> & deltas )
+{
+	bool encoded = reference._step>=0 && reference._numDeltas<_maxDeltas && reference._area==snapshot._area && reference._values.size()==snapshot._data.size();
+	if(encoded)
+	{
+		deltas.resize(snapshot._data.size());
+		// unsigned arithmetic wraps around instead of overflowing
+		for(size_t i=0; i<deltas.size(); i++)
+		{
+			deltas[i] = int(unsigned(snapshot._data[i])-unsigned(reference._values[i]));
+		}
+		reference._numDeltas++;
+	}
+	else
+	{
+		reference._numDeltas = 0;
+	}
+	reference._step = snapshot._step;
+	reference._area = snapshot._area;
+	reference._values = snapshot._data;
+	return encoded;
+}
+
+void Compression::decodeDelta( std::vector<int> & values, const std::vector<int> & deltas )
+{
+	for(size_t i=0; i<values.size(); i++)
+	{
+		values[i] = int(unsigned(values[i])+unsigned(deltas[i]));
+	}
+}
+
+} // namespace Engine
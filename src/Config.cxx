@@ -33,11 +33,11 @@
 namespace Engine
 {
 
-Config::Config( const std::string & configFile ) : _doc(0), _root(0), _configFile(configFile)
+Config::Config( const std::string & configFile ) : _doc(0), _root(0), _configFile(configFile), _randomSeed(0), _compression(eCodecNone), _compressionLevel(4), _shuffle(true), _deltaEncoding(false)
 {
 }
 
-Config::Config( const Size<int> & size, const int & numSteps, const std::string & resultsFile, const int & serializeResolution ) : _doc(0), _root(0), _resultsFile(resultsFile), _size(size), _numSteps(numSteps), _serializeResolution(serializeResolution), _configFile("")
+Config::Config( const Size<int> & size, const int & numSteps, const std::string & resultsFile, const int & serializeResolution ) : _doc(0), _root(0), _resultsFile(resultsFile), _size(size), _numSteps(numSteps), _serializeResolution(serializeResolution), _configFile(""), _randomSeed(0), _compression(eCodecNone), _compressionLevel(4), _shuffle(true), _deltaEncoding(false)
 {
 }
 
@@ -91,6 +91,52 @@ void Config::loadBaseParams()
 
     _size._width = getParamInt("size", "width");
     _size._height = getParamInt("size", "height");
+
+	// optional, fixed seed for reproducible runs
+	TiXmlElement * element = _root->FirstChildElement("randomSeed");
+	if(element)
+	{
+		_randomSeed = getParamUnsignedFromElem(element, "value");
+	}
+
+	// optional, <compression codec="none|deflate|lz4|zstd" level="4" shuffle="true" delta="false"/>
+	element = _root->FirstChildElement("compression");
+	if(element)
+	{
+		std::string codec = getParamStrFromElem(element, "codec");
+		if(codec.compare("none")==0)
+		{
+			_compression = eCodecNone;
+		}
+		else if(codec.compare("deflate")==0)
+		{
+			_compression = eCodecDeflate;
+		}
+		else if(codec.compare("lz4")==0)
+		{
+			_compression = eCodecLZ4;
+		}
+		else if(codec.compare("zstd")==0)
+		{
+			_compression = eCodecZstd;
+		}
+		else
+		{
+			throw Engine::Exception("[CONFIG]: ERROR - unknown compression codec: " + codec);
+		}
+		if(element->Attribute("level"))
+		{
+			_compressionLevel = getParamIntFromElem(element, "level");
+		}
+		if(element->Attribute("shuffle"))
+		{
+			_shuffle = getParamBoolFromElem(element, "shuffle");
+		}
+		if(element->Attribute("delta"))
+		{
+			_deltaEncoding = getParamBoolFromElem(element, "delta");
+		}
+	}
 }
 
 void Config::loadFile()
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <DomainDecomposition.hxx>
+#include <Exception.hxx>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+namespace Engine
+{
+
+DomainDecomposition::DomainDecomposition() : _size(0,0), _numPartitions(1,1), _minimumSize(2)
+{
+}
+
+DomainDecomposition::~DomainDecomposition()
+{
+}
+
+void DomainDecomposition::init( const Size<int> & size, const int & numPartitions, const int & minimumSize )
+{
+	if(size._width%2!=0 || size._height%2!=0)
+	{
+		std::stringstream oss;
+		oss << "DomainDecomposition::init - size: " << size << " must be divisible by 2";
+		throw Exception(oss.str());
+	}
+	// sections need at least 1 cell, so partitions need 2
+	int minimum = std::max(2, minimumSize);
+
+	// the factorization of numPartitions with partitions closest to squares
+	int bestColumns = 0;
+	double bestRatio = 0.0f;
+	for(int columns=1; columns<=numPartitions; columns++)
+	{
+		if(numPartitions%columns!=0)
+		{
+			continue;
+		}
+		int rows = numPartitions/columns;
+		if(columns*minimum>size._width || rows*minimum>size._height)
+		{
+			continue;
+		}
+		double ratio = std::fabs(std::log((double(size._width)/columns)/(double(size._height)/rows)));
+		if(bestColumns==0 || ratio<bestRatio)
+		{
+			bestColumns = columns;
+			bestRatio = ratio;
+		}
+	}
+	if(bestColumns==0)
+	{
+		std::stringstream oss;
+		oss << "DomainDecomposition::init - size: " << size << " can't be split in: " << numPartitions << " partitions with minimum size: " << minimum;
+		throw Exception(oss.str());
+	}
+	_size = size;
+	_minimumSize = minimum;
+	_numPartitions = Size<int>(bestColumns, numPartitions/bestColumns);
+	_columns = splitUniform(_size._width, _numPartitions._width);
+	_rows = splitUniform(_size._height, _numPartitions._height);
+}
+
+std::vector<int> DomainDecomposition::splitUniform( const int & size, const int & parts )
+{
+	std::vector<int> origins(parts+1);
+	// boundaries are computed in pairs of cells to keep them even
+	for(int i=0; i<=parts; i++)
+	{
+		origins[i] = 2*((size/2)*i/parts);
+	}
+	return origins;
+}
+
+std::vector<int> DomainDecomposition::split( const std::vector<double> & costs, const int & parts, const int & minimumSize )
+{
+	int size = costs.size();
+	// boundaries are computed in pairs of cells to keep them even
+	int numPairs = size/2;
+	int minimumPairs = std::max(1, (minimumSize+1)/2);
+	std::vector<double> accumulated(numPairs+1, 0.0f);
+	for(int i=0; i<numPairs; i++)
+	{
+		accumulated[i+1] = accumulated[i]+std::max(0.0, costs[2*i])+std::max(0.0, costs[2*i+1]);
+	}
+	double total = accumulated[numPairs];
+	if(total<=0.0f)
+	{
+		return splitUniform(size, parts);
+	}
+
+	std::vector<int> origins(parts+1);
+	origins[0] = 0;
+	origins[parts] = size;
+	int previous = 0;
+	for(int i=1; i<parts; i++)
+	{
+		double target = total*i/parts;
+		// first pair boundary where accumulated cost reaches target
+		int boundary = std::lower_bound(accumulated.begin(), accumulated.end(), target)-accumulated.begin();
+		// the previous pair boundary is chosen if it is closer to target
+		if(boundary>0 && target-accumulated[boundary-1]<accumulated[boundary]-target)
+		{
+			boundary--;
+		}
+		boundary = std::max(boundary, previous+minimumPairs);
+		boundary = std::min(boundary, numPairs-(parts-i)*minimumPairs);
+		origins[i] = 2*boundary;
+		previous = boundary;
+	}
+	return origins;
+}
+
+bool DomainDecomposition::balance( const std::vector<double> & columnCosts, const std::vector<double> & rowCosts )
+{
+	std::vector<int> columns = split(columnCosts, _numPartitions._width, _minimumSize);
+	std::vector<int> rows = split(rowCosts, _numPartitions._height, _minimumSize);
+	if(columns==_columns && rows==_rows)
+	{
+		return false;
+	}
+	_columns = columns;
+	_rows = rows;
+	return true;
+}
+
+const Size<int> & DomainDecomposition::getNumPartitions() const
+{
+	return _numPartitions;
+}
+
+Point2D<int> DomainDecomposition::getPartitionPosition( const int & id ) const
+{
+	return Point2D<int>(id%_numPartitions._width, id/_numPartitions._width);
+}
+
+int DomainDecomposition::getPartitionId( const Point2D<int> & position ) const
+{
+	// the partition is the last one whose origin is not after position
+	int column = std::upper_bound(_columns.begin(), _columns.end()-1, position._x)-_columns.begin()-1;
+	int row = std::upper_bound(_rows.begin(), _rows.end()-1, position._y)-_rows.begin()-1;
+	column = std::min(std::max(column, 0), _numPartitions._width-1);
+	row = std::min(std::max(row, 0), _numPartitions._height-1);
+	return row*_numPartitions._width+column;
+}
+
+Rectangle<int> DomainDecomposition::getArea( const int & id ) const
+{
+	Point2D<int> position = getPartitionPosition(id);
+	Point2D<int> origin(_columns[position._x], _rows[position._y]);
+	Size<int> size(_columns[position._x+1]-origin._x, _rows[position._y+1]-origin._y);
+	return Rectangle<int>(size, origin);
+}
+
+Rectangle<int> DomainDecomposition::getBoundaries( const int & id, const int & overlap ) const
+{
+	Rectangle<int> boundaries = getArea(id);
+	// west boundary
+	if(boundaries._origin._x!=0)
+	{
+		boundaries._origin._x -= overlap;
+		boundaries._size._width += overlap;
+	}
+	// east boundary
+	if(boundaries._origin._x+boundaries._size._width!=_size._width)
+	{
+		boundaries._size._width += overlap;
+	}
+	// north boundary
+	if(boundaries._origin._y!=0)
+	{
+		boundaries._origin._y -= overlap;
+		boundaries._size._height += overlap;
+	}
+	// south boundary
+	if(boundaries._origin._y+boundaries._size._height!=_size._height)
+	{
+		boundaries._size._height += overlap;
+	}
+	return boundaries;
+}
+
+} // namespace Engine
+
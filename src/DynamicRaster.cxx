@@ -26,6 +26,7 @@
 
 #include <sstream>
 #include <limits>
+#include <algorithm>
 
 namespace Engine
 {
@@ -52,50 +53,45 @@ bool DynamicRaster::operator!=(const DynamicRaster& other) const {
 void DynamicRaster::resize( const Size<int> & size )
 {
 	StaticRaster::resize(size);
-	_maxValues.resize(size._width);
-	for(int i=0; i<size._width; i++)
-	{
-		_maxValues[i].resize(size._height);
-	}
+	_maxValues.resize(_values.size());
+}
+
+void DynamicRaster::setLoadedValues( const std::vector<int> & values )
+{
+	StaticRaster::setLoadedValues(values);
+	_maxValues = _values;
 }
 
 void DynamicRaster::updateRasterIncrement()
 {
-	for(size_t i=0; i<_values.size(); i++)
+	int numBlocks = getNumBlocks();
+	#pragma omp parallel for schedule(static) if(_values.size()>=RasterKernels::_parallelThreshold)
+	for(int i=0; i<numBlocks; i++)
 	{
-		for(size_t j=0; j<_values[i].size(); j++)
-		{
-			if(_values.at(i).at(j) < _maxValues[i][j])
-			{
-				_values.at(i).at(j)++;
-			}
-		}
+		size_t begin = i*RasterKernels::_blockSize;
+		size_t size = std::min(RasterKernels::_blockSize, _values.size()-begin);
+		RasterKernels::increment(&_values[begin], &_maxValues[begin], size);
 	}
 }
 
 void DynamicRaster::updateRasterToMaxValues()
 {
-	// std::copy is deep oriented.
-	std::copy(_maxValues.begin(), _maxValues.end(), _values.begin());
+	int numBlocks = getNumBlocks();
+	#pragma omp parallel for schedule(static) if(_values.size()>=RasterKernels::_parallelThreshold)
+	for(int i=0; i<numBlocks; i++)
+	{
+		size_t begin = i*RasterKernels::_blockSize;
+		size_t end = std::min(begin+RasterKernels::_blockSize, _values.size());
+		std::copy(_maxValues.begin()+begin, _maxValues.begin()+end, _values.begin()+begin);
+	}
 }
 
 int DynamicRaster::getMaxValue( const Point2D<int>& position ) const
 {
-	if(position._x<0 || position._x>=_maxValues.size())
-	{
-		std::stringstream oss;
-		oss << "DynamicRaster::getMaxValue - " << position << " x out of bounds: " << _maxValues.size();
-		throw Exception(oss.str());
-		return -1;
-	}
-	if(position._y<0 || position._y>=_maxValues[position._x].size())
-	{
-		std::stringstream oss;
-		oss << "DynamicRaster::getMaxValue - " << position << " y out of bounds: " << _maxValues.size() << "/" << _maxValues[position._x].size();
-		throw Exception(oss.str());
-		return -1;
-	}	
-	return _maxValues[position._x][position._y];
+#ifdef PANDORADEBUG
+	checkBounds(position, "DynamicRaster::getMaxValue");
+#endif
+	return _maxValues[getIndex(position)];
 }
 
 void DynamicRaster::setValue( const Point2D<int>& position, int value )
@@ -108,28 +104,17 @@ void DynamicRaster::setValue( const Point2D<int>& position, int value )
 
 		return;
 	}
-	if(position._x<0 || position._x>=_values.size())
+#ifdef PANDORADEBUG
+	checkBounds(position, "DynamicRaster::setValue");
+#endif
+	size_t index = getIndex(position);
+	if(value>_maxValues[index])
 	{
 		std::stringstream oss;
-		oss << "DynamicRaster::setValue - " << position << " x out of bounds: " << _values.size();
+		oss << "DynamicRaster::setValue - value: " << value << " bigger than max value: " << _maxValues[index] << " at position: " << position;
 		throw Exception(oss.str());
-
-		return;
 	}
-	if(position._y<0 || position._y>=_values[position._x].size())
-	{
-		std::stringstream oss;
-		oss << "DynamicRaster::setValue - " << position << " y out of bounds: " << _values.size() << "/" << _values[position._x].size();
-		throw Exception(oss.str());
-		return;
-	}
-	if(value>_maxValues[position._x][position._y])
-	{
-		std::stringstream oss;
-		oss << "DynamicRaster::setValue - value: " << value << " bigger than max value: " << _maxValues[position._x][position._y] << " at position: " << position;
-		throw Exception(oss.str());
-	}
-	_values[position._x][position._y] = value;
+	_values[index] = value;
 }
 
 void DynamicRaster::setMaxValue( const Point2D<int>& position, int value )
@@ -142,23 +127,26 @@ void DynamicRaster::setMaxValue( const Point2D<int>& position, int value )
 
 		return;
 	}
+#ifdef PANDORADEBUG
+	checkBounds(position, "DynamicRaster::setMaxValue");
+#endif
+	_maxValues[getIndex(position)] = value;
+}
 
-	if(position._x<0 || position._x>=_maxValues.size())
-	{
-		std::stringstream oss;
-		oss << "DynamicRaster::setMaxValue- " << position << " x out of bounds: " << _maxValues.size();
-		throw Exception(oss.str());
+void DynamicRaster::copyMaxRow( const int & y, const int & x, const int & width, int * values ) const
+{
+	const int * row = &_maxValues[getIndex(Point2D<int>(x, y))];
+	std::copy(row, row+width, values);
+}
 
-		return;
-	}
-	if(position._y<0 || position._y>=_maxValues[position._x].size())
-	{
-		std::stringstream oss;
-		oss << "DynamicRaster::setMaxValue- " << position << " y out of bounds: " << _maxValues.size() << "/" << _maxValues[position._x].size();
-		throw Exception(oss.str());
-		return;
-	}	
-	_maxValues[position._x][position._y] = value;
+void DynamicRaster::setRow( const int & y, const int & x, const int & width, const int * values )
+{
+	std::copy(values, values+width, &_values[getIndex(Point2D<int>(x, y))]);
+}
+
+void DynamicRaster::setMaxRow( const int & y, const int & x, const int & width, const int * values )
+{
+	std::copy(values, values+width, &_maxValues[getIndex(Point2D<int>(x, y))]);
 }
 
 void DynamicRaster::setMaxValue( const int & maxValue )
@@ -173,28 +161,22 @@ void DynamicRaster::setMinValue( const int & minValue )
 
 void DynamicRaster::updateCurrentMinMaxValues()
 {
-	_currentMinValue = std::numeric_limits<int>::max();
-	_currentMaxValue = std::numeric_limits<int>::min();
-	for (size_t i = 0; i < _values.size(); i++  )
-		for (size_t j = 0; j < _values[i].size(); j++ )
-		{
-			_currentMaxValue = ( _values[i][j] > _currentMaxValue ? _values[i][j] : _currentMaxValue );
-			_currentMinValue = ( _values[i][j] < _currentMinValue ? _values[i][j] : _currentMinValue );
-		}
+	long long sum;
+	getStats(_currentMinValue, _currentMaxValue, sum);
 }
 
 void DynamicRaster::setInitValues( int minValue, int maxValue, int defaultValue )
 {
 	_minValue = _currentMinValue = minValue;
 	_maxValue = _currentMaxValue = maxValue;
-	for(size_t i=0; i<_values.size(); i++)
+	if(defaultValue>_maxValue)
 	{
-		for(size_t j=0; j<_values[i].size(); j++)
-		{
-			setMaxValue(Point2D<int>(i,j), _maxValue);
-			setValue(Point2D<int>(i,j), defaultValue);			
-		}
+		std::stringstream oss;
+		oss << "DynamicRaster::setInitValues - default value: " << defaultValue << " bigger than max value: " << _maxValue;
+		throw Exception(oss.str());
 	}
+	std::fill(_maxValues.begin(), _maxValues.end(), _maxValue);
+	std::fill(_values.begin(), _values.end(), defaultValue);
 }
 
 } // namespace Engine
@@ -54,7 +54,7 @@ void IncrementalRaster::setValue( const Point2D<int> & pos, int value )
 	_changes[pos] = value;
 }
 
-const int & IncrementalRaster::getValue( const Point2D<int> & pos ) const
+int IncrementalRaster::getValue( const Point2D<int> & pos ) const
 {
 	ChangeTable::const_iterator it = _changes.find( pos );
 	if ( it == _changes.end() )
@@ -62,6 +62,12 @@ const int & IncrementalRaster::getValue( const Point2D<int> & pos ) const
 	return it->second;
 }
 
+void IncrementalRaster::copyRow( const int & y, const int & x, const int & width, int * values ) const
+{
+	for ( int i = 0; i < width; i++ )
+		values[i] = getValue( Point2D<int>( x+i, y ) );
+}
+
 /*
 void	IncrementalRaster::updateCurrentMinMaxValues()
 {
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <MpiBuffer.hxx>
+#include <Exception.hxx>
+#include <sstream>
+#include <algorithm>
+
+namespace Engine
+{
+
+MpiBuffer::MpiBuffer() : _position(0)
+{
+}
+
+MpiBuffer::~MpiBuffer()
+{
+}
+
+void MpiBuffer::clear()
+{
+	_position = 0;
+}
+
+const int & MpiBuffer::getSize() const
+{
+	return _position;
+}
+
+void MpiBuffer::reserve( const int & size )
+{
+	if(_position+size<=(int)_data.size())
+	{
+		return;
+	}
+	// amortized growth, as agents are packed one by one
+	_data.resize(std::max(2*_data.size(), (size_t)(_position+size)));
+}
+
+void MpiBuffer::pack( const void * data, const int & count, MPI_Datatype type )
+{
+	int size = 0;
+	MPI_Pack_size(count, type, MPI_COMM_WORLD, &size);
+	reserve(size);
+	int error = MPI_Pack((void*)data, count, type, &_data[0], _data.size(), &_position, MPI_COMM_WORLD);
+	if(error!=MPI_SUCCESS)
+	{
+		std::stringstream oss;
+		oss << "MpiBuffer::pack - error in MPI_Pack: " << error;
+		throw Exception(oss.str());
+	}
+}
+
+void MpiBuffer::unpack( void * data, const int & count, MPI_Datatype type )
+{
+	int error = MPI_Unpack(&_data[0], _data.size(), &_position, data, count, type, MPI_COMM_WORLD);
+	if(error!=MPI_SUCCESS)
+	{
+		std::stringstream oss;
+		oss << "MpiBuffer::unpack - error in MPI_Unpack: " << error;
+		throw Exception(oss.str());
+	}
+}
+
+void MpiBuffer::pack( const int & value )
+{
+	pack(&value, 1, MPI_INT);
+}
+
+void MpiBuffer::unpack( int & value )
+{
+	unpack(&value, 1, MPI_INT);
+}
+
+void MpiBuffer::send( const int & target, const int & tag, MPI_Request * request )
+{
+	// MPI needs a valid address even for empty messages
+	reserve(1);
+	int error = MPI_Isend(&_data[0], _position, MPI_PACKED, target, tag, MPI_COMM_WORLD, request);
+	if(error!=MPI_SUCCESS)
+	{
+		std::stringstream oss;
+		oss << "MpiBuffer::send - error in MPI_Isend to: " << target << " with tag: " << tag << " error: " << error;
+		throw Exception(oss.str());
+	}
+}
+
+void MpiBuffer::receive( const int & origin, const int & tag )
+{
+	MPI_Status status;
+	MPI_Probe(origin, tag, MPI_COMM_WORLD, &status);
+	int size = 0;
+	MPI_Get_count(&status, MPI_PACKED, &size);
+	_position = 0;
+	if((int)_data.size()<std::max(size, 1))
+	{
+		_data.resize(std::max(size, 1));
+	}
+	int error = MPI_Recv(&_data[0], size, MPI_PACKED, origin, tag, MPI_COMM_WORLD, &status);
+	if(error!=MPI_SUCCESS)
+	{
+		std::stringstream oss;
+		oss << "MpiBuffer::receive - error in MPI_Recv from: " << origin << " with tag: " << tag << " error: " << error;
+		throw Exception(oss.str());
+	}
+}
+
+void MpiBuffer::allToAll( const std::vector<int> & offsets, MpiBuffer & received )
+{
+	int numTasks = offsets.size()-1;
+	std::vector<int> sendCounts(numTasks);
+	for(int i=0; i<numTasks; i++)
+	{
+		sendCounts[i] = offsets[i+1]-offsets[i];
+	}
+	std::vector<int> receiveCounts(numTasks);
+	MPI_Alltoall(&sendCounts[0], 1, MPI_INT, &receiveCounts[0], 1, MPI_INT, MPI_COMM_WORLD);
+
+	std::vector<int> receiveOffsets(numTasks+1, 0);
+	for(int i=0; i<numTasks; i++)
+	{
+		receiveOffsets[i+1] = receiveOffsets[i]+receiveCounts[i];
+	}
+	reserve(1);
+	received._position = 0;
+	if((int)received._data.size()<std::max(receiveOffsets[numTasks], 1))
+	{
+		received._data.resize(std::max(receiveOffsets[numTasks], 1));
+	}
+	int error = MPI_Alltoallv(&_data[0], &sendCounts[0], (int*)&offsets[0], MPI_PACKED, &received._data[0], &receiveCounts[0], &receiveOffsets[0], MPI_PACKED, MPI_COMM_WORLD);
+	if(error!=MPI_SUCCESS)
+	{
+		std::stringstream oss;
+		oss << "MpiBuffer::allToAll - error in MPI_Alltoallv: " << error;
+		throw Exception(oss.str());
+	}
+}
+
+} // namespace Engine
+
@@ -21,6 +21,9 @@
  */
 
 #include <MpiFactory.hxx>
+#include <GeneralState.hxx>
+#include <Exception.hxx>
+#include <sstream>
 
 namespace Engine
 {
@@ -53,6 +56,51 @@ void MpiFactory::cleanTypes()
 	}
 }
 
+void MpiFactory::registerType( const std::string & type, MPI_Datatype * mpiType, PackageCreator packageCreator, AgentCreator agentCreator )
+{
+	_types.insert(std::make_pair(type, mpiType));
+	int typeId = GeneralState::agentTypes().registerType(type);
+	if(typeId>=(int)_packageCreators.size())
+	{
+		_packageCreators.resize(typeId+1, 0);
+		_agentCreators.resize(typeId+1, 0);
+	}
+	_packageCreators[typeId] = packageCreator;
+	_agentCreators[typeId] = agentCreator;
+}
+
+void * MpiFactory::createDefaultPackage( const std::string & type )
+{
+	return createDefaultPackage(GeneralState::agentTypes().getId(type));
+}
+
+void * MpiFactory::createDefaultPackage( const int & typeId )
+{
+	if(typeId<0 || typeId>=(int)_packageCreators.size() || !_packageCreators[typeId])
+	{
+		std::stringstream oss;
+		oss << "MpiFactory::createDefaultPackage - unknown agent type id: " << typeId;
+		throw Exception(oss.str());
+	}
+	return _packageCreators[typeId]();
+}
+
+Agent * MpiFactory::createAndFillAgent( const std::string & type, void * package )
+{
+	return createAndFillAgent(GeneralState::agentTypes().getId(type), package);
+}
+
+Agent * MpiFactory::createAndFillAgent( const int & typeId, void * package )
+{
+	if(typeId<0 || typeId>=(int)_agentCreators.size() || !_agentCreators[typeId])
+	{
+		std::stringstream oss;
+		oss << "MpiFactory::createAndFillAgent - unknown agent type id: " << typeId;
+		throw Exception(oss.str());
+	}
+	return _agentCreators[typeId](package);
+}
+
 MpiFactory::TypesMap::iterator MpiFactory::beginTypes()
 {
 	return _types.begin();
@@ -24,12 +24,13 @@
 #include <Logger.hxx>
 #include <Config.hxx>
 #include <Exception.hxx>
+#include <Statistics.hxx>
 #include <boost/chrono.hpp>
 
 namespace Engine
 {
 
-OpenMPSingleNode::OpenMPSingleNode() : _serializer(*this)
+OpenMPSingleNode::OpenMPSingleNode( const int & interactionRange ) : _serializer(*this), _interactionRange(interactionRange)
 {
 }
 
@@ -42,11 +43,18 @@ void OpenMPSingleNode::init( int argc, char *argv[] )
 	_timer.start();
 	_boundaries._origin = Point2D<int>(0,0);
 	_boundaries._size = _world->getConfig().getSize();
+	_spatialIndex.resize(_boundaries);
+	if(_interactionRange>0)
+	{
+		_executor.resize(_boundaries, _interactionRange, _spatialIndex.getCellSize());
+	}
 	std::cout << "simulation: " << _id << " of: " << _numTasks << " initialized" << std::endl;
 }
 
 void OpenMPSingleNode::initData()
 {
+	// agents could have been placed without notifying the scheduler
+	_spatialIndex.updateAll();
 	// serializer init
 	_serializer.init(*_world);
 	std::stringstream logName;
@@ -67,11 +75,11 @@ void OpenMPSingleNode::executeAgents()
 	{
 		agentsToExecute.push_back(*it);
 	}
-	std::random_shuffle(agentsToExecute.begin(), agentsToExecute.end());
+	GeneralState::statistics().shuffle(agentsToExecute.begin(), agentsToExecute.end());
 
 #ifndef PANDORAEDEBUG
 	// shared memory distibution for read-only planning actions, disabled for extreme debug
-	#pragma omp parallel for
+	#pragma omp parallel for schedule(static)
 #endif
 	for(size_t i=0; i<agentsToExecute.size(); i++)
 	{
@@ -80,11 +88,20 @@ void OpenMPSingleNode::executeAgents()
 		agent->selectActions();
 	}	
 	
-	for(size_t i=0; i<agentsToExecute.size(); i++)
+	if(_interactionRange>0)
 	{
-		Agent * agent = agentsToExecute[i].get();
-		agent->executeActions();
-		agent->updateState();
+		AgentExecuted agentExecuted(_spatialIndex);
+		_executor.execute(agentsToExecute, agentExecuted, _world->getCurrentStep());
+	}
+	else
+	{
+		for(size_t i=0; i<agentsToExecute.size(); i++)
+		{
+			Agent * agent = agentsToExecute[i].get();
+			agent->executeActions();
+			agent->updateState();
+			_spatialIndex.updateAgent(agent);
+		}
 	}
 	log_DEBUG(logName.str(), getWallTime() << " executed step: " << _world->getCurrentStep() << " executed agents: " << agentsToExecute.size() << " total agents: " << std::distance(_world->beginAgents(), _world->endAgents()));
 }
@@ -123,17 +140,40 @@ void OpenMPSingleNode::removeAgent( Agent * agent )
 	throw Exception(oss.str());
 }
 
+void OpenMPSingleNode::agentAdded( AgentPtr agent, bool executedAgent )
+{
+	// World::addAgent pushes new agents at the end of the list
+	AgentsList::iterator it = _world->endAgents();
+	it--;
+	_agentsById[agent->getId()] = it;
+	_spatialIndex.addAgent(agent);
+}
+
+void OpenMPSingleNode::agentMoved( Agent * agent )
+{
+	_spatialIndex.updateAgent(agent);
+}
+
+void OpenMPSingleNode::agentIdChanged( const std::string & oldId, Agent * agent )
+{
+	std::unordered_map<std::string, AgentsList::iterator>::iterator it = _agentsById.find(oldId);
+	if(it==_agentsById.end())
+	{
+		return;
+	}
+	AgentsList::iterator itAgent = it->second;
+	_agentsById.erase(it);
+	_agentsById[agent->getId()] = itAgent;
+}
+
 AgentsList::iterator OpenMPSingleNode::getAgentIterator( const std::string & id )
 {
-	for(AgentsList::iterator it=_world->beginAgents(); it!=_world->endAgents(); it++)
+	std::unordered_map<std::string, AgentsList::iterator>::iterator it = _agentsById.find(id);
+	if(it==_agentsById.end())
 	{
-		Agent * agent = it->get();
-		if(agent->getId()==id)
-		{
-			return it;
-		}
+		return _world->endAgents();
 	}
-	return _world->endAgents();
+	return it->second;
 }
 
 void OpenMPSingleNode::removeAgents()
@@ -150,6 +190,8 @@ void OpenMPSingleNode::removeAgents()
 			throw Exception(oss.str());
 			return;
 		}
+		_spatialIndex.removeAgent(agent);
+		_agentsById.erase(agent->getId());
 		_world->eraseAgent(itAg);
 		it = _removedAgents.erase(it);
 	}
@@ -158,15 +200,28 @@ void OpenMPSingleNode::removeAgents()
 
 AgentsVector OpenMPSingleNode::getAgent( const Point2D<int> & position, const std::string & type )
 {
+	AgentsVector candidates;
+	// position could be in a region executed concurrently
+	if(_interactionRange>0)
+	{
+		#pragma omp critical(agentsIndex)
+		candidates = _spatialIndex.getAgents(position);
+	}
+	else
+	{
+		candidates = _spatialIndex.getAgents(position);
+	}
+	if(type.compare("all")==0)
+	{
+		return candidates;
+	}
+	int typeId = GeneralState::agentTypes().getId(type);
 	AgentsVector result;
-	for(AgentsList::iterator it=_world->beginAgents(); it!=_world->endAgents(); it++)
+	for(size_t i=0; i<candidates.size(); i++)
 	{
-		if((*it)->getPosition().isEqual(position))
+		if(candidates[i]->isType(typeId))
 		{
-			if(type.compare("all")==0 || (*it)->isType(type))
-			{
-				result.push_back(*it);
-			}
+			result.push_back(candidates[i]);
 		}
 	}
 	return result;
@@ -211,13 +266,30 @@ void OpenMPSingleNode::serializeRasters( const int & step )
 
 int OpenMPSingleNode::countNeighbours( Agent * target, const double & radius, const std::string & type )
 {
-	return for_each(_world->beginAgents(), _world->endAgents(), aggregatorCount<std::shared_ptr<Agent> >(radius,*target, type))._count;
+	// queries beyond the interaction range could read cells modified by regions executed concurrently
+	if(_interactionRange>0 && radius>_interactionRange)
+	{
+		int count = 0;
+		#pragma omp critical(agentsIndex)
+		count = _spatialIndex.forEachInRadius(target->getPosition(), radius, aggregatorCount<std::shared_ptr<Agent> >(radius,*target, type))._count;
+		return count;
+	}
+	return _spatialIndex.forEachInRadius(target->getPosition(), radius, aggregatorCount<std::shared_ptr<Agent> >(radius,*target, type))._count;
 }
 
 AgentsVector OpenMPSingleNode::getNeighbours( Agent * target, const double & radius, const std::string & type )
 {
-	AgentsVector agentsVector = for_each(_world->beginAgents(), _world->endAgents(), aggregatorGet<std::shared_ptr<Agent> >(radius,*target, type))._neighbors;
-	std::random_shuffle(agentsVector.begin(), agentsVector.end());
+	AgentsVector agentsVector;
+	if(_interactionRange>0 && radius>_interactionRange)
+	{
+		#pragma omp critical(agentsIndex)
+		agentsVector = _spatialIndex.forEachInRadius(target->getPosition(), radius, aggregatorGet<std::shared_ptr<Agent> >(radius,*target, type))._neighbors;
+	}
+	else
+	{
+		agentsVector = _spatialIndex.forEachInRadius(target->getPosition(), radius, aggregatorGet<std::shared_ptr<Agent> >(radius,*target, type))._neighbors;
+	}
+	GeneralState::statistics().shuffle(agentsVector.begin(), agentsVector.end());
 	return agentsVector;
 }
 	
@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <OverlapExchange.hxx>
+#include <World.hxx>
+#include <DynamicRaster.hxx>
+#include <cstring>
+#include <algorithm>
+
+namespace Engine
+{
+
+static size_t getValueSize( const RasterValueType & valueType )
+{
+	if(valueType==eRasterShort)
+	{
+		return sizeof(short);
+	}
+	if(valueType==eRasterByte)
+	{
+		return sizeof(unsigned char);
+	}
+	return sizeof(int);
+}
+
+template<typename Type> static void packValues( const int * values, const int & width, char * buffer )
+{
+	Type * typedBuffer = (Type*)buffer;
+	for(int i=0; i<width; i++)
+	{
+		typedBuffer[i] = Type(values[i]);
+	}
+}
+
+template<typename Type> static void unpackValues( const char * buffer, const int & width, int * values )
+{
+	const Type * typedBuffer = (const Type*)buffer;
+	for(int i=0; i<width; i++)
+	{
+		values[i] = typedBuffer[i];
+	}
+}
+
+OverlapExchange::OverlapExchange() : _world(0), _receivesStarted(false), _sendsStarted(false)
+{
+}
+
+OverlapExchange::~OverlapExchange()
+{
+	clear();
+}
+
+void OverlapExchange::addSend( const int & neighbor, const Rectangle<int> & zone )
+{
+	if(zone._size._width<=0 || zone._size._height<=0)
+	{
+		return;
+	}
+	Message message;
+	message._neighbor = neighbor;
+	message._zone = zone;
+	_sends.push_back(message);
+}
+
+void OverlapExchange::addReceive( const int & neighbor, const Rectangle<int> & zone )
+{
+	if(zone._size._width<=0 || zone._size._height<=0)
+	{
+		return;
+	}
+	Message message;
+	message._neighbor = neighbor;
+	message._zone = zone;
+	_receives.push_back(message);
+}
+
+void OverlapExchange::init( World & world, const int & tag )
+{
+	freeRequests();
+	_world = &world;
+	_rasters.clear();
+	size_t cellSize = 0;
+	for(size_t d=0; d<world.getNumberOfRasters(); d++)
+	{
+		if(!world.rasterExists(d) || !world.isRasterDynamic(d))
+		{
+			continue;
+		}
+		_rasters.push_back(d);
+		cellSize += getValueSize(world.getDynamicRaster(d).getValueType());
+	}
+
+	int maxWidth = 0;
+	_requests.resize(_sends.size()+_receives.size());
+	for(size_t i=0; i<_sends.size(); i++)
+	{
+		Message & send = _sends[i];
+		send._buffer.resize(cellSize*send._zone._size._width*send._zone._size._height);
+		maxWidth = std::max(maxWidth, send._zone._size._width);
+		MPI_Send_init(send._buffer.empty() ? 0 : &send._buffer[0], send._buffer.size(), MPI_BYTE, send._neighbor, tag, MPI_COMM_WORLD, &_requests[i]);
+	}
+	for(size_t i=0; i<_receives.size(); i++)
+	{
+		Message & receive = _receives[i];
+		receive._buffer.resize(cellSize*receive._zone._size._width*receive._zone._size._height);
+		maxWidth = std::max(maxWidth, receive._zone._size._width);
+		MPI_Recv_init(receive._buffer.empty() ? 0 : &receive._buffer[0], receive._buffer.size(), MPI_BYTE, receive._neighbor, tag, MPI_COMM_WORLD, &_requests[_sends.size()+i]);
+	}
+	_row.resize(maxWidth);
+}
+
+void OverlapExchange::pack( Message & message, const bool & maxValues )
+{
+	const Rectangle<int> & zone = message._zone;
+	char * buffer = message._buffer.empty() ? 0 : &message._buffer[0];
+	for(size_t d=0; d<_rasters.size(); d++)
+	{
+		const DynamicRaster & raster = _world->getDynamicRaster(_rasters[d]);
+		RasterValueType valueType = raster.getValueType();
+		size_t rowSize = getValueSize(valueType)*zone._size._width;
+		for(int y=zone._origin._y; y<zone._origin._y+zone._size._height; y++)
+		{
+			if(maxValues)
+			{
+				raster.copyMaxRow(y, zone._origin._x, zone._size._width, &_row[0]);
+			}
+			else
+			{
+				raster.copyRow(y, zone._origin._x, zone._size._width, &_row[0]);
+			}
+			if(valueType==eRasterShort)
+			{
+				packValues<short>(&_row[0], zone._size._width, buffer);
+			}
+			else if(valueType==eRasterByte)
+			{
+				packValues<unsigned char>(&_row[0], zone._size._width, buffer);
+			}
+			else
+			{
+				memcpy(buffer, &_row[0], rowSize);
+			}
+			buffer += rowSize;
+		}
+	}
+}
+
+void OverlapExchange::unpack( const Message & message, const bool & maxValues )
+{
+	const Rectangle<int> & zone = message._zone;
+	const char * buffer = message._buffer.empty() ? 0 : &message._buffer[0];
+	for(size_t d=0; d<_rasters.size(); d++)
+	{
+		DynamicRaster & raster = _world->getDynamicRaster(_rasters[d]);
+		RasterValueType valueType = raster.getValueType();
+		size_t rowSize = getValueSize(valueType)*zone._size._width;
+		for(int y=zone._origin._y; y<zone._origin._y+zone._size._height; y++)
+		{
+			if(valueType==eRasterShort)
+			{
+				unpackValues<short>(buffer, zone._size._width, &_row[0]);
+			}
+			else if(valueType==eRasterByte)
+			{
+				unpackValues<unsigned char>(buffer, zone._size._width, &_row[0]);
+			}
+			else
+			{
+				memcpy(&_row[0], buffer, rowSize);
+			}
+			if(maxValues)
+			{
+				raster.setMaxRow(y, zone._origin._x, zone._size._width, &_row[0]);
+			}
+			else
+			{
+				raster.setRow(y, zone._origin._x, zone._size._width, &_row[0]);
+			}
+			buffer += rowSize;
+		}
+	}
+}
+
+void OverlapExchange::startReceives()
+{
+	if(_receivesStarted || _receives.empty() || _rasters.empty())
+	{
+		return;
+	}
+	MPI_Startall(_receives.size(), &_requests[_sends.size()]);
+	_receivesStarted = true;
+}
+
+void OverlapExchange::exchange( const bool & maxValues )
+{
+	if(_requests.empty() || _rasters.empty())
+	{
+		return;
+	}
+	// receives are started first, so data from neighbours doesn't need to be buffered by MPI
+	startReceives();
+	// send buffers of the previous exchange are reused
+	if(_sendsStarted)
+	{
+		MPI_Waitall(_sends.size(), &_requests[0], MPI_STATUSES_IGNORE);
+		_sendsStarted = false;
+	}
+	for(size_t i=0; i<_sends.size(); i++)
+	{
+		pack(_sends[i], maxValues);
+		MPI_Start(&_requests[i]);
+		_sendsStarted = true;
+	}
+	// zones are unpacked in the order they arrive
+	for(size_t i=0; i<_receives.size(); i++)
+	{
+		int index = 0;
+		MPI_Waitany(_receives.size(), &_requests[_sends.size()], &index, MPI_STATUS_IGNORE);
+		unpack(_receives[index], maxValues);
+	}
+	_receivesStarted = false;
+}
+
+void OverlapExchange::freeRequests()
+{
+	int finalized = 0;
+	MPI_Finalized(&finalized);
+	if(!finalized)
+	{
+		if(_sendsStarted)
+		{
+			MPI_Waitall(_sends.size(), &_requests[0], MPI_STATUSES_IGNORE);
+		}
+		// receives posted in advance but never used
+		if(_receivesStarted)
+		{
+			for(size_t i=_sends.size(); i<_requests.size(); i++)
+			{
+				MPI_Cancel(&_requests[i]);
+				MPI_Wait(&_requests[i], MPI_STATUS_IGNORE);
+			}
+		}
+		for(size_t i=0; i<_requests.size(); i++)
+		{
+			if(_requests[i]!=MPI_REQUEST_NULL)
+			{
+				MPI_Request_free(&_requests[i]);
+			}
+		}
+	}
+	_requests.clear();
+	_receivesStarted = false;
+	_sendsStarted = false;
+}
+
+void OverlapExchange::clear()
+{
+	freeRequests();
+	_sends.clear();
+	_receives.clear();
+}
+
+std::vector<MPI_Request> & OverlapExchange::getRequests()
+{
+	return _requests;
+}
+
+} // namespace Engine
+
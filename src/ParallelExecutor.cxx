@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <ParallelExecutor.hxx>
+#include <Exception.hxx>
+
+#include <algorithm>
+#include <sstream>
+
+namespace Engine
+{
+
+//! sorts regions by number of agents, so the longest tasks are started first
+struct BiggerRegion
+{
+	bool operator()( const AgentsVector * a, const AgentsVector * b ) const
+	{
+		return a->size()>b->size();
+	}
+};
+
+ParallelExecutor::ParallelExecutor() : _regionSize(1), _numRegions(0,0)
+{
+}
+
+ParallelExecutor::~ParallelExecutor()
+{
+}
+
+void ParallelExecutor::resize( const Rectangle<int> & boundaries, const int & range, const int & alignment )
+{
+	if(range<1 || alignment<1)
+	{
+		std::stringstream oss;
+		oss << "ParallelExecutor::resize - range: " << range << " and alignment: " << alignment << " must be positive";
+		throw Exception(oss.str());
+	}
+	_boundaries = boundaries;
+	// each half is rounded up, so reads within range of one region and writes of the next one with the same colour never meet in a cell of the index
+	_regionSize = 2*alignment*((range+alignment-1)/alignment);
+	_numRegions._width = std::max(1, (_boundaries._size._width+_regionSize-1)/_regionSize);
+	_numRegions._height = std::max(1, (_boundaries._size._height+_regionSize-1)/_regionSize);
+	_regions.clear();
+	_regions.resize(_numRegions._width*_numRegions._height);
+	_engines.resize(_regions.size());
+}
+
+int ParallelExecutor::getRegionIndex( const Point2D<int> & position ) const
+{
+	int x = std::min(std::max(0, position._x-_boundaries._origin._x), _boundaries._size._width-1)/_regionSize;
+	int y = std::min(std::max(0, position._y-_boundaries._origin._y), _boundaries._size._height-1)/_regionSize;
+	return y*_numRegions._width+x;
+}
+
+void ParallelExecutor::getRegions( const int & colour, std::vector<AgentsVector *> & regions )
+{
+	regions.clear();
+	for(int y=colour/2; y<_numRegions._height; y+=2)
+	{
+		for(int x=colour%2; x<_numRegions._width; x+=2)
+		{
+			AgentsVector & region = _regions[y*_numRegions._width+x];
+			if(!region.empty())
+			{
+				regions.push_back(&region);
+			}
+		}
+	}
+	std::stable_sort(regions.begin(), regions.end(), BiggerRegion());
+}
+
+} // namespace Engine
+
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <ProgressThread.hxx>
+#include <mpi.h>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+
+namespace Engine
+{
+
+ProgressThread::ProgressThread( const int & interval, const int & maxInterval ) : _active(false), _stop(false), _polling(false), _interval(interval), _maxInterval(std::max(interval, maxInterval)), _numPending(0)
+{
+}
+
+ProgressThread::~ProgressThread()
+{
+	stop();
+}
+
+void ProgressThread::start()
+{
+	if(isRunning())
+	{
+		return;
+	}
+	_active = false;
+	_stop = false;
+	_thread = std::thread(&ProgressThread::run, this);
+}
+
+void ProgressThread::watch( std::vector<MPI_Request> & requests )
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_requests.push_back(&requests);
+}
+
+void ProgressThread::run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	int interval = _interval;
+	while(!_stop)
+	{
+		if(!_active)
+		{
+			interval = _interval;
+			_condition.wait(lock);
+			continue;
+		}
+		_polling = true;
+		lock.unlock();
+		bool completed = poll();
+		lock.lock();
+		_polling = false;
+		_idleCondition.notify_all();
+
+		interval = completed ? _interval : std::min(2*interval, _maxInterval);
+		// pause and stop wake the thread before the interval expires
+		_condition.wait_for(lock, std::chrono::microseconds(interval));
+	}
+}
+
+bool ProgressThread::poll()
+{
+	// probing is enough to enter the progress engine, and it never receives a message
+	int flag = 0;
+	MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+
+	// get_status neither frees nor deactivates requests, so their owner still completes them
+	int numPending = 0;
+	for(size_t i=0; i<_requests.size(); i++)
+	{
+		std::vector<MPI_Request> & requests = *_requests[i];
+		for(size_t j=0; j<requests.size(); j++)
+		{
+			if(requests[j]==MPI_REQUEST_NULL)
+			{
+				continue;
+			}
+			MPI_Request_get_status(requests[j], &flag, MPI_STATUS_IGNORE);
+			if(!flag)
+			{
+				numPending++;
+			}
+		}
+	}
+	bool completed = numPending<_numPending;
+	_numPending = numPending;
+	return completed;
+}
+
+void ProgressThread::resume()
+{
+	if(!isRunning())
+	{
+		return;
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	_active = true;
+	// the first poll after resuming keeps the shortest interval
+	_numPending = std::numeric_limits<int>::max();
+	_condition.notify_one();
+}
+
+void ProgressThread::pause()
+{
+	if(!isRunning())
+	{
+		return;
+	}
+	std::unique_lock<std::mutex> lock(_mutex);
+	_active = false;
+	_condition.notify_one();
+	while(_polling)
+	{
+		_idleCondition.wait(lock);
+	}
+}
+
+void ProgressThread::stop()
+{
+	if(!isRunning())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+		_condition.notify_one();
+	}
+	_thread.join();
+}
+
+bool ProgressThread::isRunning() const
+{
+	return _thread.joinable();
+}
+
+} // namespace Engine
+
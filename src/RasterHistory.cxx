@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+
+#include <RasterHistory.hxx>
+#include <RasterLoader.hxx>
+#include <GeneralState.hxx>
+#include <Exception.hxx>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+namespace Engine
+{
+
+RasterCache::RasterCache( const size_t & capacity ) : _capacity(capacity), _size(0)
+{
+}
+
+RasterCache::~RasterCache()
+{
+}
+
+RasterCache::Entries::iterator RasterCache::insert( RasterHistory * history, size_t index )
+{
+	_entries.push_front(Entry(history, index));
+	_size++;
+	// the new step is never released
+	while(_capacity>0 && _size>_capacity)
+	{
+		Entry last = _entries.back();
+		_entries.pop_back();
+		_size--;
+		last.first->release(last.second);
+	}
+	return _entries.begin();
+}
+
+void RasterCache::touch( const Entries::iterator & entry )
+{
+	_entries.splice(_entries.begin(), _entries, entry);
+}
+
+void RasterCache::remove( RasterHistory * history )
+{
+	for(Entries::iterator it=_entries.begin(); it!=_entries.end(); )
+	{
+		if(it->first==history)
+		{
+			it = _entries.erase(it);
+			_size--;
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+void RasterCache::setCapacity( const size_t & capacity )
+{
+	_capacity = capacity;
+	while(_capacity>0 && _size>_capacity)
+	{
+		Entry last = _entries.back();
+		_entries.pop_back();
+		_size--;
+		last.first->release(last.second);
+	}
+}
+
+RasterHistory::RasterHistory() : _fileId(-1), _resolution(1), _cache(0), _valuesStep(-1), _minMaxLoaded(false), _minValue(0), _maxValue(0)
+{
+}
+
+RasterHistory::~RasterHistory()
+{
+	if(_cache)
+	{
+		_cache->remove(this);
+	}
+}
+
+void RasterHistory::init( const std::string & name, const hid_t & fileId, size_t numSteps, int resolution, const Size<int> & size, RasterCache * cache )
+{
+	if(_cache)
+	{
+		_cache->remove(this);
+	}
+	_name = name;
+	_fileId = fileId;
+	_resolution = resolution;
+	_size = size;
+	_cache = cache;
+	_steps.clear();
+	_steps.resize(numSteps);
+	_values.clear();
+	_valuesStep = -1;
+	_minMaxLoaded = false;
+}
+
+void RasterHistory::release( size_t index )
+{
+	_steps[index]._raster.reset();
+}
+
+bool RasterHistory::readRange( const hid_t & objectId, int & minValue, int & maxValue )
+{
+	if(H5Aexists(objectId, "minValue")<=0 || H5Aexists(objectId, "maxValue")<=0)
+	{
+		return false;
+	}
+	hid_t attributeId = H5Aopen_name(objectId, "minValue");
+	H5Aread(attributeId, H5T_NATIVE_INT, &minValue);
+	H5Aclose(attributeId);
+	attributeId = H5Aopen_name(objectId, "maxValue");
+	H5Aread(attributeId, H5T_NATIVE_INT, &maxValue);
+	H5Aclose(attributeId);
+	return true;
+}
+
+void RasterHistory::loadMinMax()
+{
+	_minMaxLoaded = true;
+	// range of the whole history, stored when the serializer finished
+	std::ostringstream groupName;
+	groupName << "/" << _name;
+	hid_t groupId = H5Gopen(_fileId, groupName.str().c_str(), H5P_DEFAULT);
+	bool stored = groupId>=0 && readRange(groupId, _minValue, _maxValue);
+	if(groupId>=0)
+	{
+		H5Gclose(groupId);
+	}
+	if(stored)
+	{
+		return;
+	}
+
+	_minValue = std::numeric_limits<int>::max();
+	_maxValue = std::numeric_limits<int>::min();
+	// a truncated run only has the range of each step; files written before ranges were stored are read entirely
+	bool scan = false;
+	for(size_t i=0; i<_steps.size(); i++)
+	{
+		std::ostringstream oss;
+		oss << "/" << _name << "/step" << i*_resolution;
+		if(H5Lexists(_fileId, oss.str().c_str(), H5P_DEFAULT)<=0)
+		{
+			continue;
+		}
+		int minValue = 0;
+		int maxValue = 0;
+		if(!scan)
+		{
+			hid_t datasetId = H5Dopen(_fileId, oss.str().c_str(), H5P_DEFAULT);
+			scan = !readRange(datasetId, minValue, maxValue);
+			H5Dclose(datasetId);
+		}
+		if(scan)
+		{
+			Size<int> dims;
+			GeneralState::rasterLoader().readHDF5Step(_fileId, _name, i*_resolution, _values, _valuesStep, dims);
+			if(_values.empty())
+			{
+				continue;
+			}
+			std::pair<std::vector<int>::const_iterator, std::vector<int>::const_iterator> minMax = std::minmax_element(_values.begin(), _values.end());
+			minValue = *minMax.first;
+			maxValue = *minMax.second;
+		}
+		_minValue = std::min(_minValue, minValue);
+		_maxValue = std::max(_maxValue, maxValue);
+	}
+}
+
+DynamicRaster & RasterHistory::load( size_t index )
+{
+	Step & step = _steps[index];
+	if(step._raster)
+	{
+		_cache->touch(step._entry);
+		return *step._raster;
+	}
+	if(!_minMaxLoaded)
+	{
+		loadMinMax();
+	}
+
+	std::shared_ptr<DynamicRaster> raster = std::make_shared<DynamicRaster>();
+	std::ostringstream oss;
+	oss << "/" << _name << "/step" << index*_resolution;
+	// step datasets are created while serializing, so a truncated run has no dataset for the remaining steps
+	if(H5Lexists(_fileId, oss.str().c_str(), H5P_DEFAULT)<=0)
+	{
+		raster->resize(_size);
+	}
+	else
+	{
+		Size<int> dims;
+		GeneralState::rasterLoader().readHDF5Step(_fileId, _name, index*_resolution, _values, _valuesStep, dims);
+		raster->resize(dims);
+		// loaded values are their own maximums
+		for(int j=0; j<dims._height; j++)
+		{
+			const int * row = &_values[size_t(j)*dims._width];
+			raster->setMaxRow(j, 0, dims._width, row);
+			raster->setRow(j, 0, dims._width, row);
+		}
+	}
+	raster->setMaxValue(_maxValue);
+	raster->setMinValue(_minValue);
+
+	step._raster = raster;
+	step._entry = _cache->insert(this, index);
+	return *raster;
+}
+
+DynamicRaster & RasterHistory::at( size_t index )
+{
+	if(index>=_steps.size())
+	{
+		std::stringstream oss;
+		oss << "RasterHistory::at - asking for step: " << index << " of raster: " << _name << " with " << _steps.size() << " steps";
+		throw Exception(oss.str());
+	}
+	return load(index);
+}
+
+const DynamicRaster & RasterHistory::at( size_t index ) const
+{
+	return const_cast<RasterHistory *>(this)->at(index);
+}
+
+} // namespace Engine
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <RasterKernels.hxx>
+
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace Engine
+{
+
+const size_t RasterKernels::_blockSize;
+const size_t RasterKernels::_parallelThreshold;
+
+void RasterKernels::increment( int * values, const int * maxValues, const size_t & size )
+{
+	size_t i = 0;
+#if defined(__AVX2__)
+	for(; i+8<=size; i+=8)
+	{
+		__m256i value = _mm256_loadu_si256((const __m256i *)(values+i));
+		__m256i maxValue = _mm256_loadu_si256((const __m256i *)(maxValues+i));
+		// the comparison is -1 for values lower than max, so subtracting it increments them
+		__m256i lower = _mm256_cmpgt_epi32(maxValue, value);
+		_mm256_storeu_si256((__m256i *)(values+i), _mm256_sub_epi32(value, lower));
+	}
+#elif defined(__SSE2__)
+	for(; i+4<=size; i+=4)
+	{
+		__m128i value = _mm_loadu_si128((const __m128i *)(values+i));
+		__m128i maxValue = _mm_loadu_si128((const __m128i *)(maxValues+i));
+		// the comparison is -1 for values lower than max, so subtracting it increments them
+		__m128i lower = _mm_cmplt_epi32(value, maxValue);
+		_mm_storeu_si128((__m128i *)(values+i), _mm_sub_epi32(value, lower));
+	}
+#endif
+	for(; i<size; i++)
+	{
+		values[i] += values[i]<maxValues[i];
+	}
+}
+
+void RasterKernels::accumulate( const int * values, const size_t & size, int & minValue, int & maxValue, long long & sum )
+{
+	size_t i = 0;
+#if defined(__AVX2__)
+	if(size>=8)
+	{
+		__m256i minValues = _mm256_set1_epi32(minValue);
+		__m256i maxValues = _mm256_set1_epi32(maxValue);
+		__m256i sums = _mm256_setzero_si256();
+		for(; i+8<=size; i+=8)
+		{
+			__m256i value = _mm256_loadu_si256((const __m256i *)(values+i));
+			minValues = _mm256_min_epi32(minValues, value);
+			maxValues = _mm256_max_epi32(maxValues, value);
+			// sums are done with 64 bits to avoid overflows
+			sums = _mm256_add_epi64(sums, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(value)));
+			sums = _mm256_add_epi64(sums, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(value, 1)));
+		}
+		int mins[8], maxs[8];
+		long long partialSums[4];
+		_mm256_storeu_si256((__m256i *)mins, minValues);
+		_mm256_storeu_si256((__m256i *)maxs, maxValues);
+		_mm256_storeu_si256((__m256i *)partialSums, sums);
+		minValue = *std::min_element(mins, mins+8);
+		maxValue = *std::max_element(maxs, maxs+8);
+		sum += partialSums[0]+partialSums[1]+partialSums[2]+partialSums[3];
+	}
+#elif defined(__SSE2__)
+	if(size>=4)
+	{
+		__m128i minValues = _mm_set1_epi32(minValue);
+		__m128i maxValues = _mm_set1_epi32(maxValue);
+		__m128i sums = _mm_setzero_si128();
+		__m128i zero = _mm_setzero_si128();
+		for(; i+4<=size; i+=4)
+		{
+			__m128i value = _mm_loadu_si128((const __m128i *)(values+i));
+			// SSE2 lacks min/max for 32 bit integers, so they are selected with masks
+			__m128i lower = _mm_cmplt_epi32(value, minValues);
+			minValues = _mm_or_si128(_mm_and_si128(lower, value), _mm_andnot_si128(lower, minValues));
+			__m128i greater = _mm_cmpgt_epi32(value, maxValues);
+			maxValues = _mm_or_si128(_mm_and_si128(greater, value), _mm_andnot_si128(greater, maxValues));
+			// sign extension to 64 bits to avoid overflows
+			__m128i sign = _mm_cmpgt_epi32(zero, value);
+			sums = _mm_add_epi64(sums, _mm_unpacklo_epi32(value, sign));
+			sums = _mm_add_epi64(sums, _mm_unpackhi_epi32(value, sign));
+		}
+		int mins[4], maxs[4];
+		long long partialSums[2];
+		_mm_storeu_si128((__m128i *)mins, minValues);
+		_mm_storeu_si128((__m128i *)maxs, maxValues);
+		_mm_storeu_si128((__m128i *)partialSums, sums);
+		minValue = *std::min_element(mins, mins+4);
+		maxValue = *std::max_element(maxs, maxs+4);
+		sum += partialSums[0]+partialSums[1];
+	}
+#endif
+	for(; i<size; i++)
+	{
+		minValue = std::min(minValue, values[i]);
+		maxValue = std::max(maxValue, values[i]);
+		sum += values[i];
+	}
+}
+
+} // namespace Engine
+
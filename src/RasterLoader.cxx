@@ -28,8 +28,10 @@
 
 #include <GeneralState.hxx>
 #include <Logger.hxx>
+#include <Compression.hxx>
 
 #include <vector>
+#include <algorithm>
 #include <gdal_priv.h>
 
 #include <hdf5.h>
@@ -85,28 +87,21 @@ void RasterLoader::fillGDALRaster( StaticRaster & raster, const std::string & fi
 
 	log_DEBUG(logName.str(), "raster IO done");
 
-	Point2D<int> index;
-
-	for(index._x=boundaries._origin._x; index._x<boundaries._origin._x+boundaries._size._width; index._x++)
+	// scanlines and raster share the same row-major layout
+	std::vector<int> values(boundaries._size._width*boundaries._size._height);
+	for(size_t i=0; i<values.size(); i++)
 	{
-		for(index._y=boundaries._origin._y; index._y<boundaries._origin._y+boundaries._size._height; index._y++)
-		{
-			Point2D<int> index2(index - boundaries._origin);
-			log_EDEBUG(logName.str(), "index: " << index << " and index2: " << index2 << " accessing to: " << boundaries._size._width*index2._y+index2._x);
-			raster._values[index2._x][index2._y] = (int)(pafScanline[boundaries._size._width*index2._y+index2._x]);
-			log_EDEBUG(logName.str(), "value in index2: " << index2 << " is: " << (int)(pafScanline[boundaries._size._width*index2._y+index2._x]));
-		}
+		values[i] = (int)(pafScanline[i]);
 	}
-
 	CPLFree(pafScanline);
+	// dynamic rasters will also use them as max values
+	raster.setLoadedValues(values);
+
 	log_DEBUG(logName.str(), "done, update minmax values");	
 	raster.updateMinMaxValues();
-
-	// if dynamic, copy to maxValues
 	DynamicRaster * dynamicRaster = dynamic_cast<DynamicRaster*>(&raster);
 	if(dynamicRaster)
 	{
-		std::copy(dynamicRaster->_values.begin(), dynamicRaster->_values.end(), dynamicRaster->_maxValues.begin());
 		dynamicRaster->updateCurrentMinMaxValues();
 	}
 
@@ -144,6 +139,14 @@ void RasterLoader::fillHDF5RasterDirectPath( StaticRaster & raster, const std::s
 
 
 	hid_t fileId = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+	// step datasets only exist for the steps that were serialized
+	if(H5Lexists(fileId, pathToData.c_str(), H5P_DEFAULT)<=0)
+	{
+		H5Fclose(fileId);
+		std::stringstream oss;
+		oss << "RasterLoader::fillHDF5RasterDirectPath - file: " << fileName << " does not contain dataset: " << pathToData;
+		throw Engine::Exception(oss.str());
+	}
 	hid_t dset_id = H5Dopen(fileId, pathToData.c_str(), H5P_DEFAULT);
 	hid_t dataspaceId = H5Dget_space(dset_id);
 	hsize_t dims[2];
@@ -157,47 +160,33 @@ void RasterLoader::fillHDF5RasterDirectPath( StaticRaster & raster, const std::s
 		throw Engine::Exception(oss.str());
 	}
 	
-	int * dset_data = 0;
 	if(world)
 	{
-		dset_data = (int*)malloc(sizeof(int)*world->getBoundaries()._size._width*world->getBoundaries()._size._height);
 		raster.resize(world->getBoundaries()._size);
 	}
 	else
 	{
-		dset_data = (int*)malloc(sizeof(int)*dims[0]*dims[1]);
 		raster.resize(Size<int>(dims[0], dims[1]));
 	}
 
-	H5Dread(dset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, dset_data);
-	H5Dclose(dset_id);
-
-	if(world)
+	// datasets are stored with the row-major layout of the raster
+	std::vector<int> data(dims[0]*dims[1]);
+	if(H5Aexists(dset_id, "deltaStep")>0)
 	{
-		const Rectangle<int> & boundaries = world->getBoundaries();
-		Point2D<int> index;
-		for(index._x=boundaries._origin._x; index._x<boundaries._origin._x+boundaries._size._width; index._x++)
-		{
-			for(index._y=boundaries._origin._y; index._y<boundaries._origin._y+boundaries._size._height; index._y++)
-			{
-				Point2D<int> index2(index - boundaries._origin);
-				int index = boundaries._size._width*index2._y+index2._x;
-				raster._values[index2._x][index2._y] = (int)dset_data[index];
-			}
-		}
+		H5Dclose(dset_id);
+		int lastIndex = pathToData.find_last_of("/");
+		int step = atoi(pathToData.substr(lastIndex+5).c_str());
+		int valuesStep = -1;
+		Size<int> size;
+		readHDF5Step(fileId, pathToData.substr(0, lastIndex), step, data, valuesStep, size);
 	}
 	else
 	{
-		for(size_t i=0; i<dims[0]; i++)
-		{
-			for(size_t j=0; j<dims[1]; j++)
-			{
-				size_t index = i+j*dims[0];
-				raster._values[i][j] = dset_data[index];	
-			}
-		}
+		H5Dread(dset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &data[0]);
+		H5Dclose(dset_id);
 	}
-	free(dset_data);
+	data.resize(size_t(raster.getSize()._width)*raster.getSize()._height);
+	raster.setLoadedValues(data);
 
     int lastIndex = pathToData.find_last_of("/"); 
     std::string rasterName = pathToData.substr(0, lastIndex); 
@@ -243,11 +232,9 @@ void RasterLoader::fillHDF5RasterDirectPath( StaticRaster & raster, const std::s
 	H5Fclose(fileId);
 	raster.updateMinMaxValues();
 	
-	// if dynamic, copy to maxValues
 	DynamicRaster * dynamicRaster = dynamic_cast<DynamicRaster*>(&raster);
 	if(dynamicRaster)
 	{
-		std::copy(dynamicRaster->_values.begin(), dynamicRaster->_values.end(), dynamicRaster->_maxValues.begin());
 		dynamicRaster->updateCurrentMinMaxValues();
 	}
 	log_DEBUG(logName.str(), "file: " << fileName << " path to data: " << pathToData << " loaded");
@@ -260,6 +247,53 @@ void RasterLoader::fillHDF5Raster( StaticRaster & raster, const std::string & fi
     fillHDF5RasterDirectPath(raster, fileName, oss.str(), world);
 }
 
+void RasterLoader::readHDF5Step( const hid_t & fileId, const std::string & rasterName, int step, std::vector<int> & values, int & valuesStep, Size<int> & size )
+{
+	std::ostringstream oss;
+	oss << "/" << rasterName << "/step" << step;
+	hid_t datasetId = H5Dopen(fileId, oss.str().c_str(), H5P_DEFAULT);
+	if(datasetId<0)
+	{
+		std::stringstream ossErr;
+		ossErr << "RasterLoader::readHDF5Step - dataset: " << oss.str() << " does not exist";
+		throw Engine::Exception(ossErr.str());
+	}
+	hid_t dataspaceId = H5Dget_space(datasetId);
+	hsize_t dims[2];
+	H5Sget_simple_extent_dims(dataspaceId, dims, NULL);
+	H5Sclose(dataspaceId);
+	size._width = dims[0];
+	size._height = dims[1];
+
+	int deltaStep = -1;
+	if(H5Aexists(datasetId, "deltaStep")>0)
+	{
+		hid_t attributeId = H5Aopen_name(datasetId, "deltaStep");
+		H5Aread(attributeId, H5T_NATIVE_INT, &deltaStep);
+		H5Aclose(attributeId);
+	}
+
+	if(deltaStep<0)
+	{
+		values.resize(dims[0]*dims[1]);
+		H5Dread(datasetId, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &values[0]);
+		H5Dclose(datasetId);
+		valuesStep = step;
+		return;
+	}
+
+	// the chain of delta encoded steps ends at a complete step, at most Compression::_maxDeltas steps before
+	if(valuesStep!=deltaStep)
+	{
+		readHDF5Step(fileId, rasterName, deltaStep, values, valuesStep, size);
+	}
+	std::vector<int> deltas(dims[0]*dims[1]);
+	H5Dread(datasetId, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &deltas[0]);
+	H5Dclose(datasetId);
+	Compression::decodeDelta(values, deltas);
+	valuesStep = step;
+}
+
 void RasterLoader::fillHDF5Raster( StaticRaster & raster, const std::string & fileName, const std::string & rasterName, World * world )
 {	
     std::ostringstream oss;
@@ -1,6 +1,8 @@
 
 #include <SequentialSerializer.hxx>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <limits>
 #include <World.hxx>
 #include <Exception.hxx>
 #include <Agent.hxx>
@@ -8,11 +10,13 @@
 #include <Logger.hxx>
 #include <StaticRaster.hxx>
 #include <Config.hxx>
+#include <Compression.hxx>
+#include <GeneralState.hxx>
 
 namespace Engine
 {
 
-SequentialSerializer::SequentialSerializer( const Scheduler & scheduler ) : _scheduler(scheduler)
+SequentialSerializer::SequentialSerializer( const Scheduler & scheduler ) : _scheduler(scheduler), _currentColumns(0), _dictionaryId(-1), _dictionarySize(0), _codec(eCodecNone)
 {
 }
 
@@ -20,6 +24,35 @@ SequentialSerializer::~SequentialSerializer()
 {
 }
 
+hid_t SequentialSerializer::getRasterFileType( const RasterValueType & valueType )
+{
+	if(valueType==eRasterShort)
+	{
+		return H5T_NATIVE_SHORT;
+	}
+	if(valueType==eRasterByte)
+	{
+		return H5T_NATIVE_UCHAR;
+	}
+	return H5T_NATIVE_INT;
+}
+
+hid_t SequentialSerializer::createRasterProperties() const
+{
+	hid_t propertyListId = H5Pcreate(H5P_DATASET_CREATE);
+	// uncompressed rasters are stored contiguously
+	if(_codec==eCodecNone)
+	{
+		return propertyListId;
+	}
+	hsize_t chunkDimensions[2];
+	chunkDimensions[0] = std::max(hsize_t(1), std::min(hsize_t(_config->getSize()._width), Compression::_rasterChunkSize));
+	chunkDimensions[1] = std::max(hsize_t(1), std::min(hsize_t(_config->getSize()._height), Compression::_rasterChunkSize));
+	H5Pset_chunk(propertyListId, 2, chunkDimensions);
+	Compression::setFilters(propertyListId, _codec, _config->getCompressionLevel(), _config->getShuffle());
+	return propertyListId;
+}
+
 void SequentialSerializer::init( World & world )
 {
     _config = &world.getConfig();
@@ -74,6 +107,12 @@ void SequentialSerializer::init( World & world )
 
 	log_INFO(logName.str(), _scheduler.getWallTime() << " id: " << _scheduler.getId() << " size: " << _config->getSize() << " num tasks: " << _scheduler.getNumTasks() << " serializer resolution:" << _config->getSerializeResolution() << " and steps: " << _config->getNumSteps());
 
+	_codec = Compression::getAvailableCodec(_config->getCompression());
+	if(_codec!=_config->getCompression())
+	{
+		log_INFO(logName.str(), "compression plugin not available, using deflate");
+	}
+
 	// we store the name of the rasters
 	hid_t rasterNameFileSpace = H5Screate_simple(1, &simpleDimension, NULL);
 	hid_t rasterNameDatasetId = H5Dcreate(_fileId, "rasters", H5T_NATIVE_INT, rasterNameFileSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
@@ -182,15 +221,28 @@ void SequentialSerializer::init( World & world )
 	}
 	H5Gclose(colorTableGroupId);
 
-	// creating a file with the agents of each computer node
+	// creating a file with the agents of the simulation
 	std::ostringstream oss;
 	if(!path.empty())
 	{
 		oss << path << "/";
 	}
-	oss << "agents-" << _scheduler.getId() << ".abm";
+	oss << "agents.abm";
 
 	_agentsFileId = H5Fcreate(oss.str().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+
+	// string attributes are stored as codes of a dictionary holding every different string, each one followed by '\0'
+	hsize_t dictionarySize = 0;
+	hsize_t maxDictionarySize = H5S_UNLIMITED;
+	hid_t dictionarySpace = H5Screate_simple(1, &dictionarySize, &maxDictionarySize);
+	hsize_t dictionaryChunk = 65536;
+	hid_t dictionaryListId = H5Pcreate(H5P_DATASET_CREATE);
+	H5Pset_chunk(dictionaryListId, 1, &dictionaryChunk);
+	Compression::setFilters(dictionaryListId, _codec, _config->getCompressionLevel(), _config->getShuffle());
+	_dictionaryId = H5Dcreate(_agentsFileId, "dictionary", H5T_NATIVE_CHAR, dictionarySpace, H5P_DEFAULT, dictionaryListId, H5P_DEFAULT);
+	H5Pclose(dictionaryListId);
+	H5Sclose(dictionarySpace);
+	_dictionarySize = 0;
 	
 	//the real size of the matrix is sqrt(num simulator)*matrixsize	
 	hsize_t dimensions[2];
@@ -207,13 +259,15 @@ void SequentialSerializer::init( World & world )
 		// TODO 0 o H5P_DEFAULT??
 		hid_t rasterGroupId = H5Gcreate(_fileId, world.getRasterName(i).c_str(), 0, H5P_DEFAULT, H5P_DEFAULT);
 		hid_t fileSpace = H5Screate_simple(2, dimensions, NULL); 
-		hid_t datasetId = H5Dcreate(rasterGroupId, "values", H5T_NATIVE_INT, fileSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+		hid_t propertyListId = createRasterProperties();
+		hid_t datasetId = H5Dcreate(rasterGroupId, "values", getRasterFileType(world.getStaticRaster(i).getValueType()), fileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);
+		H5Pclose(propertyListId);
 		H5Dclose(datasetId);
 		H5Sclose(fileSpace);
 		H5Gclose(rasterGroupId);
 	}
 
-	// dynamic rasters
+	// dynamic rasters, step datasets are created by serializeRasters
 	for(size_t i=0; i<world.getNumberOfRasters(); i++)
 	{
 		if(!world.rasterExists(i) || !world.rasterToSerialize(i) || !world.isRasterDynamic(i))
@@ -221,19 +275,6 @@ void SequentialSerializer::init( World & world )
 			continue;
 		}	
 		hid_t rasterGroupId = H5Gcreate(_fileId, world.getRasterName(i).c_str(), 0, H5P_DEFAULT, H5P_DEFAULT);
-		for(int i=0; i<=_config->getNumSteps(); i++)
-		{  
-			if(i%_config->getSerializeResolution()!=0)
-			{
-				continue;
-			}
-			std::ostringstream oss;
-			oss << "step" << i;
-			hid_t stepFileSpace = H5Screate_simple(2, dimensions, NULL); 
-			hid_t stepDatasetId = H5Dcreate(rasterGroupId, oss.str().c_str(), H5T_NATIVE_INT, stepFileSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-			H5Dclose(stepDatasetId);
-			H5Sclose(stepFileSpace);
-		}	
 		H5Gclose(rasterGroupId);
 	}
 
@@ -255,6 +296,7 @@ void SequentialSerializer::init( World & world )
 		}
 	}
 	serializeStaticRasters(staticRasters);
+	_writer.start();
 }
 
 void SequentialSerializer::serializeAgents( const int & step, const AgentsList::const_iterator & beginAgents, const AgentsList::const_iterator & endAgents )
@@ -275,369 +317,453 @@ void SequentialSerializer::serializeAgents( const int & step, const AgentsList::
 
 void SequentialSerializer::serializeAgent( Agent * agent, const int & step, int index )
 {
-	std::string type = agent->getType();
-	// new type, must be in _stringAttributes because at least id attribute must exist
-	if(_stringAttributes.find(type)==_stringAttributes.end())
+	// new type
+	int typeId = agent->getTypeId();
+	if(typeId>=(int)_registeredTypes.size() || !_registeredTypes[typeId])
 	{
 		agent->registerAttributes();
 		registerType(agent);
 	}
 
-	addStringAttribute(type, "id", agent->getId());
-	addIntAttribute(type, "x", agent->getPosition()._x);
-	addIntAttribute(type, "y", agent->getPosition()._y);
+	_currentColumns = &_columns[typeId];
+	_currentColumns->beginAgent();
+	_currentColumns->addString("id", agent->getId());
+	_currentColumns->addInt("x", agent->getPosition()._x);
+	_currentColumns->addInt("y", agent->getPosition()._y);
 	agent->serialize();
 
-	if(getDataSize(type)>=20000)
+	if(_currentColumns->getNumAgents()>=20000)
 	{
-		executeAgentSerialization(type, step);
+		executeAgentSerialization(typeId, step);
 	}
 }
 
 void SequentialSerializer::finish()
 {
+	// writes every pending snapshot before closing the files
+	_writer.stop();
+	// range of the whole history of each raster, read by RasterHistory instead of every step
+	for(std::map<std::string, std::pair<int, int> >::const_iterator it=_rasterRanges.begin(); it!=_rasterRanges.end(); it++)
+	{
+		hid_t rasterGroupId = H5Gopen(_fileId, it->first.c_str(), H5P_DEFAULT);
+		writeRange(rasterGroupId, it->second);
+		H5Gclose(rasterGroupId);
+	}
+	_rasterRanges.clear();
+	for(AgentDatasetsMap::iterator it=_agentDatasets.begin(); it!=_agentDatasets.end(); it++)
+	{
+		closeAgentStep(it->second);
+	}
+	_agentDatasets.clear();
+	H5Dclose(_dictionaryId);
 	H5Fclose(_fileId);
 	H5Fclose(_agentsFileId);
 }
 
 void SequentialSerializer::finishAgentsSerialization( int step)
 {
-	for(std::map<std::string, int>::iterator it=_agentIndexMap.begin(); it!=_agentIndexMap.end(); it++)
+	for(size_t i=0; i<_columns.size(); i++)
 	{
-		executeAgentSerialization(it->first, step);
+		// type not registered yet
+		if(_columns[i].getType().empty())
+		{
+			continue;
+		}
+		executeAgentSerialization(i, step);
+		_agentOffsets[i] = 0;
 	}
-	resetCurrentIndexs();
 }
 
-void SequentialSerializer::executeAgentSerialization( const std::string & type, int step)	
+void SequentialSerializer::executeAgentSerialization( int typeId, int step)	
 {
-	std::map<std::string, int>::iterator itI = _agentIndexMap.find(type);
+	AgentColumns & columns = _columns[typeId];
+	SnapshotPool<AgentSnapshot> * pool = &_agentSnapshots[columns.getType()];
+	std::shared_ptr<AgentSnapshot> snapshot = pool->get();
+	snapshot->_type = columns.getType();
+	snapshot->_step = step;
+	snapshot->_offset = _agentOffsets[typeId];
+	_agentOffsets[typeId] += columns.getNumAgents();
+
+	// the snapshot keeps the capacity of the columns written by the previous one
+	columns.moveValues(snapshot->_columns);
+	_writer.push([this, snapshot, pool]()
+	{
+		writeAgents(*snapshot);
+		pool->release(snapshot);
+	});
+}
 
-	int currentIndex = itI->second;	
+void SequentialSerializer::writeAgentColumn( const hid_t & datasetId, const hid_t & memoryType, hsize_t offset, hsize_t size, const void * data )
+{
+	// nothing to serialize
+	if(size==0)
+	{
+		return;
+	}
+	hsize_t newSize = offset+size;
+	H5Dset_extent(datasetId, &newSize);
+	hid_t fileSpace = H5Dget_space(datasetId);
+	H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, &offset, NULL, &size, NULL);
+	hid_t memorySpace = H5Screate_simple(1, &size, 0);
+	H5Dwrite(datasetId, memoryType, memorySpace, fileSpace, H5P_DEFAULT, data);
+	H5Sclose(memorySpace);
+	H5Sclose(fileSpace);
+}
 
-	hsize_t	offset[1];
-    offset[0] = currentIndex;
- 	
-	hsize_t	stride[1];
-	stride[0] = 1;
-	
-	hsize_t count[1];
-	count[0] = 1;
+int SequentialSerializer::encodeString( const std::string & value )
+{
+	std::pair<std::unordered_map<std::string, int>::iterator, bool> code = _dictionary.insert(std::make_pair(value, (int)_dictionary.size()));
+	if(code.second)
+	{
+		_newStrings.insert(_newStrings.end(), value.begin(), value.end());
+		_newStrings.push_back('\0');
+	}
+	return code.first->second;
+}
 
-	IntAttributesMap::iterator it = _intAttributes.find(type);
-	IntMap * attributes = it->second;	
-	for(IntMap::iterator itM=attributes->begin(); itM!=attributes->end(); itM++)
+void SequentialSerializer::writeAgents( AgentSnapshot & snapshot )
+{
+	const AgentStepDatasets & datasets = openAgentStep(snapshot);
+	AgentColumns & columns = snapshot._columns;
+
+	// every column is written, even if a previous one was empty
+	for(size_t i=0; i<columns.getNumIntColumns(); i++)
 	{
-		std::vector<int> * data = itM->second;
-		// nothing to serialize
-		if(data->size()==0)
-		{
-			return;
-		}
-		hsize_t	block[1];
-		block[0] = data->size();
-		
-		hsize_t simpleDimension = data->size();
-		// TODO es repeteix per cada atribut
-		hsize_t newSize[1];
-		newSize[0] = currentIndex+data->size();
-
-		std::ostringstream oss;
-		oss << type << "/step" << step << "/" << itM->first;
-		hid_t datasetId = H5Dopen(_agentsFileId, oss.str().c_str(), H5P_DEFAULT);
-		H5Dset_extent( datasetId, newSize);
-		hid_t fileSpace = H5Dget_space(datasetId);
-		H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, stride, count, block);
-  		hid_t memorySpace = H5Screate_simple(1, &simpleDimension, 0);
-		H5Dwrite(datasetId, H5T_NATIVE_INT, memorySpace, fileSpace, H5P_DEFAULT, &(data->at(0)));
-		data->clear();
-
-		H5Sclose(memorySpace);
-		H5Sclose(fileSpace);
-		H5Dclose(datasetId);
+		const std::vector<int> & data = columns.getIntColumn(i);
+		writeAgentColumn(datasets._intDatasets[i], H5T_NATIVE_INT, snapshot._offset, data.size(), data.empty() ? 0 : &data[0]);
 	}
-    
-    FloatAttributesMap::iterator itF = _floatAttributes.find(type);
-	FloatMap * attributesF = itF->second;	
-	for(FloatMap::iterator itM=attributesF->begin(); itM!=attributesF->end(); itM++)
+	for(size_t i=0; i<columns.getNumFloatColumns(); i++)
 	{
-		std::vector<float> * data = itM->second;
-		// nothing to serialize
-		if(data->size()==0)
-		{
-			return;
-		}
-		hsize_t	block[1];
-		block[0] = data->size();
-		
-		hsize_t simpleDimension = data->size();
-		// TODO es repeteix per cada atribut
-		hsize_t newSize[1];
-		newSize[0] = currentIndex+data->size();
-
-		std::ostringstream oss;
-		oss << type << "/step" << step << "/" << itM->first;
-		hid_t datasetId = H5Dopen(_agentsFileId, oss.str().c_str(), H5P_DEFAULT);
-		H5Dset_extent( datasetId, newSize);
-		hid_t fileSpace = H5Dget_space(datasetId);
-		H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, stride, count, block);
-  		hid_t memorySpace = H5Screate_simple(1, &simpleDimension, 0);
-		H5Dwrite(datasetId, H5T_NATIVE_FLOAT, memorySpace, fileSpace, H5P_DEFAULT, &(data->at(0)));
-		data->clear();
-
-		H5Sclose(memorySpace);
-		H5Sclose(fileSpace);
-		H5Dclose(datasetId);
+		const std::vector<float> & data = columns.getFloatColumn(i);
+		writeAgentColumn(datasets._floatDatasets[i], H5T_NATIVE_FLOAT, snapshot._offset, data.size(), data.empty() ? 0 : &data[0]);
 	}
-	
-	StringAttributesMap::iterator itS = _stringAttributes.find(type);
-	StringMap * attributesS = itS->second;	
-	for(StringMap::iterator itM=attributesS->begin(); itM!=attributesS->end(); itM++)
+	for(size_t i=0; i<columns.getNumStringColumns(); i++)
 	{
-		std::vector<std::string> * data = itM->second;
-		hsize_t	block[1];
-		block[0] = data->size();
-		
-		hsize_t simpleDimension = data->size();
-		// TODO es repeteix per cada atribut
-		hsize_t newSize[1];
-		newSize[0] = currentIndex+data->size();
-		itI->second = currentIndex+data->size();
-
-		std::ostringstream oss;
-		oss << type << "/step" << step << "/" << itM->first;
-
-		hid_t datasetId = H5Dopen(_agentsFileId, oss.str().c_str(), H5P_DEFAULT);
-		H5Dset_extent( datasetId, newSize);
-		hid_t fileSpace = H5Dget_space(datasetId);
-		H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, stride, count, block);
-		hid_t idType = H5Tcopy(H5T_C_S1);
-		H5Tset_size (idType, H5T_VARIABLE);
-  		hid_t memorySpace = H5Screate_simple(1, &simpleDimension, 0);
-		H5Dwrite(datasetId, idType, memorySpace, fileSpace, H5P_DEFAULT, &(data->at(0)));
-		data->clear();
-
-		H5Sclose(memorySpace);
-		H5Sclose(fileSpace);
-		H5Dclose(datasetId);
+		const std::vector<std::string> & data = columns.getStringColumn(i);
+		_codes.resize(data.size());
+		for(size_t j=0; j<data.size(); j++)
+		{
+			_codes[j] = encodeString(data[j]);
+		}
+		writeAgentColumn(datasets._stringDatasets[i], H5T_NATIVE_INT, snapshot._offset, data.size(), data.empty() ? 0 : &_codes[0]);
 	}
+	// strings that appeared for the first time in this block
+	writeAgentColumn(_dictionaryId, H5T_NATIVE_CHAR, _dictionarySize, _newStrings.size(), _newStrings.empty() ? 0 : &_newStrings[0]);
+	_dictionarySize += _newStrings.size();
+	_newStrings.clear();
+	columns.clear();
 }
 
 void SequentialSerializer::addStringAttribute( const std::string & type, const std::string & key, const std::string & value )
 {
-	StringAttributesMap::iterator it = _stringAttributes.find(type);
-	StringMap * stringMap = it->second;
-	StringMap::iterator itS = stringMap->find(key);
-	std::vector<std::string> * stringVector = itS->second;
-	stringVector->push_back(value);
+	getColumns(type).addString(key, value);
 }
 	
 void SequentialSerializer::addIntAttribute( const std::string & type, const std::string & key, int value )
 {
-	IntAttributesMap::iterator it = _intAttributes.find(type);
-	if(it==_intAttributes.end())
-	{
-		std::stringstream oss;
-		oss << "SequentialSerializer::addIntAttribute - looking for unknown agent type: " << type;
-		throw Exception(oss.str());
-	}
-	IntMap * intMap = it->second;
-	IntMap::iterator itI = intMap->find(key);
-	if(itI==intMap->end())
-	{
-		std::stringstream oss;
-		oss << "SequentialSerializer::addIntAttribute - looking for unknown attribute: " << key << " in agent type: " << type;
-		throw Exception(oss.str());
-	}
-	std::vector<int> * intVector = itI->second;
-	intVector->push_back(value);
+	getColumns(type).addInt(key, value);
 }
 
 void SequentialSerializer::addFloatAttribute( const std::string & type, const std::string & key, float value )
 {
-	FloatAttributesMap::iterator it = _floatAttributes.find(type);
-	if(it==_floatAttributes.end())
+	getColumns(type).addFloat(key, value);
+}
+
+AgentColumns & SequentialSerializer::getColumns( const std::string & type )
+{
+	// attributes are usually added while serializing an agent of this type
+	if(_currentColumns && _currentColumns->getType()==type)
 	{
-		std::stringstream oss;
-		oss << "SequentialSerializer::addFloatAttribute - looking for unknown agent type: " << type;
-		throw Exception(oss.str());
+		return *_currentColumns;
 	}
-	FloatMap * floatMap = it->second;
-	FloatMap::iterator itI = floatMap->find(key);
-	if(itI==floatMap->end())
+	int typeId = GeneralState::agentTypes().getId(type);
+	if(typeId==-1 || typeId>=(int)_columns.size() || _columns[typeId].getType().empty())
 	{
 		std::stringstream oss;
-		oss << "SequentialSerializer::addFloatAttribute - looking for unknown attribute: " << key << " in agent type: " << type;
+		oss << "SequentialSerializer::getColumns - looking for unknown agent type: " << type;
 		throw Exception(oss.str());
 	}
-	std::vector<float> * floatVector = itI->second;
-	floatVector->push_back(value);
+	return _columns[typeId];
 }
 
 void SequentialSerializer::registerType( Agent * agent )
 {
-	std::string type = agent->getType();
+	const std::string & type = agent->getType();
+	if(agent->getTypeId()>=(int)_registeredTypes.size())
+	{
+		_registeredTypes.resize(agent->getTypeId()+1, false);
+	}
+	_registeredTypes[agent->getTypeId()] = true;
 
 	std::stringstream logName;
 	logName << "SequentialSerializer_" << _scheduler.getId();
 
 	log_DEBUG(logName.str(), "registering new type: " << type);
 
+	// HDF5 groups are created by openAgentStep the first time a step of this type is written
+	if(agent->getTypeId()>=(int)_columns.size())
+	{
+		_columns.resize(agent->getTypeId()+1);
+		_agentOffsets.resize(agent->getTypeId()+1, 0);
+	}
+	AgentColumns & columns = _columns[agent->getTypeId()];
+	columns = AgentColumns(type);
+
+	for(Agent::AttributesList::iterator it=agent->beginIntAttributes(); it!=agent->endIntAttributes(); it++)
+	{	
+		log_DEBUG(logName.str(), "\tnew int attribute: " << *it);
+		columns.addIntColumn(*it);
+	}      
+	for(Agent::AttributesList::iterator it=agent->beginFloatAttributes(); it!=agent->endFloatAttributes(); it++)
+	{	
+		log_DEBUG(logName.str(), "\tnew float attribute: " << *it);
+		columns.addFloatColumn(*it);
+	}
+	for(Agent::AttributesList::iterator it=agent->beginStringAttributes(); it!=agent->endStringAttributes(); it++)
+	{		
+		log_DEBUG(logName.str(), "\tnew string attribute: " << *it);
+		columns.addStringColumn(*it);
+	}
+}
+
+void SequentialSerializer::closeAgentStep( AgentStepDatasets & datasets )
+{
+	for(size_t i=0; i<datasets._intDatasets.size(); i++)
+	{
+		H5Dclose(datasets._intDatasets[i]);
+	}
+	for(size_t i=0; i<datasets._floatDatasets.size(); i++)
+	{
+		H5Dclose(datasets._floatDatasets[i]);
+	}
+	for(size_t i=0; i<datasets._stringDatasets.size(); i++)
+	{
+		H5Dclose(datasets._stringDatasets[i]);
+	}
+	datasets._intDatasets.clear();
+	datasets._floatDatasets.clear();
+	datasets._stringDatasets.clear();
+}
+
+hid_t SequentialSerializer::createAgentDataset( const hid_t & stepGroup, const std::string & name, const hid_t & fileType, const hid_t & fileSpace, const hid_t & propertyListId )
+{
+	hid_t datasetId = H5Dcreate(stepGroup, name.c_str(), fileType, fileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);
+	if(datasetId<0)
+	{
+		std::stringstream oss;
+		oss << "SequentialSerializer::createAgentDataset - dataset not created for attribute: " << name;
+		throw Exception(oss.str());
+	}
+	return datasetId;
+}
+
+const SequentialSerializer::AgentStepDatasets & SequentialSerializer::openAgentStep( const AgentSnapshot & snapshot )
+{
+	AgentDatasetsMap::iterator itStep = _agentDatasets.find(snapshot._type);
+	if(itStep==_agentDatasets.end())
+	{
+		hid_t agentTypeGroup = H5Gcreate(_agentsFileId, snapshot._type.c_str(),  0, H5P_DEFAULT, H5P_DEFAULT);
+		H5Gclose(agentTypeGroup);
+		itStep = _agentDatasets.insert( make_pair(snapshot._type, AgentStepDatasets())).first;
+	}
+	AgentStepDatasets & datasets = itStep->second;
+	if(datasets._step==snapshot._step)
+	{
+		return datasets;
+	}
+	closeAgentStep(datasets);
+	datasets._step = snapshot._step;
+
 	hsize_t simpleDimension = 0;
 	hsize_t maxDims[1];
 	maxDims[0] = H5S_UNLIMITED;
 	hid_t agentFileSpace = H5Screate_simple(1, &simpleDimension, maxDims);
-	hid_t agentTypeGroup = H5Gcreate(_agentsFileId, agent->getType().c_str(),  0, H5P_DEFAULT, H5P_DEFAULT);
 
+	// the first block written to the step fits in one chunk, as it usually holds every agent of the type
+	const AgentColumns & columns = snapshot._columns;
+	hsize_t chunks = std::max(hsize_t(1), std::min(hsize_t(columns.getNumAgents()), Compression::_agentChunkSize));
 	hid_t propertyListId = H5Pcreate(H5P_DATASET_CREATE);
-	hsize_t chunks = 1;
 	H5Pset_chunk(propertyListId, 1, &chunks);
+	Compression::setFilters(propertyListId, _codec, _config->getCompressionLevel(), _config->getShuffle());
 
-	IntMap * newTypeIntMap = new IntMap;
-    FloatMap * newTypeFloatMap = new FloatMap;
-	StringMap * newTypeStringMap = new StringMap;
-
-	// create a dataset for each timestep
-	for(int i=0; i<=_config->getNumSteps(); i++)
+	std::ostringstream oss;
+	oss << snapshot._type << "/step" << snapshot._step;
+	hid_t stepGroup = H5Gcreate(_agentsFileId, oss.str().c_str(),  0, H5P_DEFAULT, H5P_DEFAULT);
+	if(stepGroup<0)
 	{
-		if(i%_config->getSerializeResolution()!=0)
-		{
-			continue;
-		}
-
-		std::ostringstream oss;
-		oss<<"step"<<i;
-		hid_t stepGroup = H5Gcreate(agentTypeGroup, oss.str().c_str(),  0, H5P_DEFAULT, H5P_DEFAULT);
-		for(Agent::AttributesList::iterator it=agent->beginIntAttributes(); it!=agent->endIntAttributes(); it++)
-		{	
-			log_DEBUG(logName.str(), "\tnew int attribute: " << *it);
-			newTypeIntMap->insert( make_pair(*it, new std::vector<int>() ));
-			hid_t idDataset= H5Dcreate(stepGroup, (*it).c_str(), H5T_NATIVE_INT, agentFileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);
-            if(idDataset<0)
-            {
-                std::stringstream ossErr;
-        		ossErr << "SequentialSerializer::registerType - dataset not created for agent: " << agent << " step group: " << oss.str() << " and int attribute: " << *it;
-        		throw Exception(ossErr.str());
-            }   
-			H5Dclose(idDataset);
-		}      
-        
-        for(Agent::AttributesList::iterator it=agent->beginFloatAttributes(); it!=agent->endFloatAttributes(); it++)
-		{	
-			log_DEBUG(logName.str(), "\tnew float attribute: " << *it);
-			newTypeFloatMap->insert( make_pair(*it, new std::vector<float>() ));
-			hid_t idDataset= H5Dcreate(stepGroup, (*it).c_str(), H5T_NATIVE_FLOAT, agentFileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);    
-            if(idDataset<0)
-            {
-                std::stringstream ossErr;
-        		ossErr<< "SequentialSerializer::registerType - dataset not created for agent: " << agent << " step group: " << oss.str() << " and float attribute: " << *it;
-        		throw Exception(ossErr.str());
-            }
-			H5Dclose(idDataset);
-		}
+		std::stringstream ossErr;
+		ossErr << "SequentialSerializer::openAgentStep - step group: " << oss.str() << " not created";
+		throw Exception(ossErr.str());
+	}
 
-		
-		hid_t idType = H5Tcopy(H5T_C_S1);
-		H5Tset_size (idType, H5T_VARIABLE);
-		for(Agent::AttributesList::iterator it=agent->beginStringAttributes(); it!=agent->endStringAttributes(); it++)
-		{		
-			log_DEBUG(logName.str(), "\tnew string attribute: " << *it);
-			newTypeStringMap->insert( make_pair(*it, new std::vector<std::string>() ));
-			hid_t idDataset= H5Dcreate(stepGroup, (*it).c_str(), idType, agentFileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);  
-            if(idDataset<0)
-            {
-                std::stringstream ossErr;
-        		ossErr<< "SequentialSerializer::registerType - dataset not created for agent: " << agent << " step group: " << oss.str() << " and string attribute: " << *it;
-        		throw Exception(ossErr.str());
-            }
-			H5Dclose(idDataset);
-		}
-		H5Gclose(stepGroup);
+	for(size_t i=0; i<columns.getNumIntColumns(); i++)
+	{	
+		datasets._intDatasets.push_back(createAgentDataset(stepGroup, columns.getIntName(i), H5T_NATIVE_INT, agentFileSpace, propertyListId));
+	}
+	for(size_t i=0; i<columns.getNumFloatColumns(); i++)
+	{	
+		datasets._floatDatasets.push_back(createAgentDataset(stepGroup, columns.getFloatName(i), H5T_NATIVE_FLOAT, agentFileSpace, propertyListId));
 	}
-	H5Gclose(agentTypeGroup);
+	// the dictionary attribute tells readers that the integers are codes of strings
+	hid_t attributeSpace = H5Screate(H5S_SCALAR);
+	int encoding = 1;
+	for(size_t i=0; i<columns.getNumStringColumns(); i++)
+	{		
+		hid_t datasetId = createAgentDataset(stepGroup, columns.getStringName(i), H5T_NATIVE_INT, agentFileSpace, propertyListId);
+		hid_t attributeId = H5Acreate(datasetId, "dictionary", H5T_NATIVE_INT, attributeSpace, H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(attributeId, H5T_NATIVE_INT, &encoding);
+		H5Aclose(attributeId);
+		datasets._stringDatasets.push_back(datasetId);
+	}
+	H5Sclose(attributeSpace);
+	H5Gclose(stepGroup);
+	H5Pclose(propertyListId);
 	H5Sclose(agentFileSpace);
-
-	_agentIndexMap.insert( make_pair(type, 0) );
-	_intAttributes.insert( make_pair(type, newTypeIntMap));
-	_floatAttributes.insert( make_pair(type, newTypeFloatMap));
-	_stringAttributes.insert( make_pair(type, newTypeStringMap));
+	return datasets;
 }
 
-int SequentialSerializer::getDataSize( const std::string & type )
+void SequentialSerializer::serializeStaticRasters( const StaticRastersRefMap & staticRasters)
 {
-	StringAttributesMap::iterator it = _stringAttributes.find(type);
-	StringMap * stringMap = it->second;
-	StringMap::iterator itS = stringMap->find("id");
-	return itS->second->size();
+	for(StaticRastersRefMap::const_iterator it=staticRasters.begin(); it!=staticRasters.end(); it++)
+	{
+		serializeRaster(*it->second, it->first, -1);
+	}
 }
 
-void SequentialSerializer::resetCurrentIndexs()
+void SequentialSerializer::serializeRaster( const StaticRaster & raster, const std::string & name, int step )
 {
-	for(std::map<std::string, int>::iterator it=_agentIndexMap.begin(); it!=_agentIndexMap.end(); it++)
+	std::ostringstream datasetKey;
+	datasetKey << "/" << name << "/";
+	if(step<0)
 	{
-		it->second = 0;
+		datasetKey << "values";
+	}
+	else
+	{
+		datasetKey << "step" << step;
 	}
-}
 
-void SequentialSerializer::serializeStaticRasters( const StaticRastersRefMap & staticRasters)
-{
-	for(StaticRastersRefMap::const_iterator it=staticRasters.begin(); it!=staticRasters.end(); it++)
+	std::stringstream logName;
+	logName << "SequentialSerializer_" << _scheduler.getId();
+	log_EDEBUG(logName.str(), "serializing raster: " << datasetKey.str());
+
+	std::shared_ptr<RasterSnapshot> snapshot = _rasterSnapshots.get();
+	snapshot->_datasetKey = datasetKey.str();
+	snapshot->_name = name;
+	snapshot->_step = step;
+	snapshot->_valueType = raster.getValueType();
+	snapshot->_create = step>=0;
+	snapshot->_area = _scheduler.getBoundaries();
+
+	size_t width = snapshot->_area._size._width;
+	size_t height = snapshot->_area._size._height;
+	snapshot->_data.resize(width*height);
+	for(size_t j=0; j<height; j++)
 	{
-		std::ostringstream oss;
-		oss << "/" << it->first << "/values";
-		serializeRaster(*it->second, oss.str());
+		raster.copyRow(j, 0, width, &snapshot->_data[j*width]);
 	}
+	_writer.push([this, snapshot]()
+	{
+		writeRaster(*snapshot);
+		_rasterSnapshots.release(snapshot);
+	});
 }
 
-void SequentialSerializer::serializeRaster( const StaticRaster & raster, const std::string & datasetKey )
+void SequentialSerializer::writeRaster( const RasterSnapshot & snapshot )
 {
-	std::stringstream logName;
-	logName << "SequentialSerializer_" << _scheduler.getId();
-	log_EDEBUG(logName.str(), "serializing raster: " << datasetKey);
+	hsize_t	block[2];
+	block[0] = snapshot._area._size._width;
+	block[1] = snapshot._area._size._height;
 
-	hid_t dataSetId = H5Dopen(_fileId, datasetKey.c_str(), H5P_DEFAULT);
-	hid_t fileSpace = H5Dget_space(dataSetId);
+	const std::vector<int> * values = &snapshot._data;
+	if(snapshot._create)
+	{
+		hid_t fileType = getRasterFileType(snapshot._valueType);
+		int referenceStep = -1;
+		if(_config->getDeltaEncoding())
+		{
+			DeltaReference & reference = _deltaReferences[snapshot._name];
+			referenceStep = reference._step;
+			if(Compression::encodeDelta(reference, snapshot, _deltas))
+			{
+				values = &_deltas;
+				fileType = Compression::getDeltaFileType(snapshot._valueType);
+			}
+			else
+			{
+				referenceStep = -1;
+			}
+		}
 
-	hsize_t	block[2];
-	block[0] = _scheduler.getBoundaries()._size._width;
-	block[1] = _scheduler.getBoundaries()._size._height;
-	
-	int * data = (int *) malloc(sizeof(int)*block[0]*block[1]);
-	for(size_t i=0; i<block[0]; i++)
-	{
-		for(size_t j=0; j<block[1]; j++)
-		{	
-			size_t index = j*block[0]+i;
-			log_EDEBUG(logName.str(), "index: " << i << "/" << j << " - " << index);
-			/*
-			log_EDEBUG(logName.str(), "getting value: " << Point2D<int> (i+overlapDist._x,j+overlapDist._y));
-			data[index] = raster.getValue(Point2D<int> (i+overlapDist._x,j+overlapDist._y));
-			*/
-			data[index] = raster.getValue(Point2D<int>(i,j));
-			log_EDEBUG(logName.str(), "value: " << data[index]);
+		std::pair<int, int> range(std::numeric_limits<int>::max(), std::numeric_limits<int>::min());
+		if(!snapshot._data.empty())
+		{
+			std::pair<std::vector<int>::const_iterator, std::vector<int>::const_iterator> minMax = std::minmax_element(snapshot._data.begin(), snapshot._data.end());
+			range = std::make_pair(*minMax.first, *minMax.second);
+		}
+
+		hid_t creationListId = createRasterProperties();
+		hid_t stepFileSpace = H5Screate_simple(2, block, NULL); 
+		hid_t stepDatasetId = H5Dcreate(_fileId, snapshot._datasetKey.c_str(), fileType, stepFileSpace, H5P_DEFAULT, creationListId, H5P_DEFAULT);
+		if(referenceStep>=0)
+		{
+			// readers add the values of 'deltaStep' to the stored differences
+			hsize_t simpleDimension = 1;
+			hid_t attributeFileSpace = H5Screate_simple(1, &simpleDimension, NULL);
+			hid_t attributeId = H5Acreate(stepDatasetId, "deltaStep", H5T_NATIVE_INT, attributeFileSpace, H5P_DEFAULT, H5P_DEFAULT);
+			H5Awrite(attributeId, H5T_NATIVE_INT, &referenceStep);
+			H5Aclose(attributeId);
+			H5Sclose(attributeFileSpace);
+		}
+		writeRange(stepDatasetId, range);
+		std::map<std::string, std::pair<int, int> >::iterator itRange = _rasterRanges.find(snapshot._name);
+		if(itRange==_rasterRanges.end())
+		{
+			_rasterRanges.insert(std::make_pair(snapshot._name, range));
 		}
+		else
+		{
+			itRange->second.first = std::min(itRange->second.first, range.first);
+			itRange->second.second = std::max(itRange->second.second, range.second);
+		}
+		H5Dclose(stepDatasetId);
+		H5Sclose(stepFileSpace);
+		H5Pclose(creationListId);
 	}
+
+	hid_t dataSetId = H5Dopen(_fileId, snapshot._datasetKey.c_str(), H5P_DEFAULT);
+	hid_t fileSpace = H5Dget_space(dataSetId);
+	
     // Create property list for collective dataset write.
 	hid_t propertyListId = H5Pcreate(H5P_DATASET_XFER);
 	H5Pset_dxpl_mpio(propertyListId, H5FD_MPIO_INDEPENDENT);
     hid_t memorySpace = H5Screate_simple(2, block, NULL);
-	H5Dwrite(dataSetId, H5T_NATIVE_INT, memorySpace, fileSpace, propertyListId, data);
+	H5Dwrite(dataSetId, H5T_NATIVE_INT, memorySpace, fileSpace, propertyListId, &values->at(0));
 
-	free(data);
 	H5Pclose(propertyListId);
     H5Sclose(memorySpace);	
 	H5Sclose(fileSpace);
 	H5Dclose(dataSetId);
-	log_EDEBUG(logName.str(), "serializing raster: " << datasetKey << " done");
+}
+
+void SequentialSerializer::writeRange( const hid_t & objectId, const std::pair<int, int> & range )
+{
+	hsize_t simpleDimension = 1;
+	hid_t attributeFileSpace = H5Screate_simple(1, &simpleDimension, NULL);
+	hid_t attributeId = H5Acreate(objectId, "minValue", H5T_NATIVE_INT, attributeFileSpace, H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attributeId, H5T_NATIVE_INT, &range.first);
+	H5Aclose(attributeId);
+	attributeId = H5Acreate(objectId, "maxValue", H5T_NATIVE_INT, attributeFileSpace, H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attributeId, H5T_NATIVE_INT, &range.second);
+	H5Aclose(attributeId);
+	H5Sclose(attributeFileSpace);
 }
 
 void SequentialSerializer::serializeRasters(int step)
 {
 	for(StaticRastersRefMap::const_iterator it=_dynamicRasters.begin(); it!=_dynamicRasters.end(); it++)
 	{
-		std::ostringstream oss;
-		oss << "/" << it->first << "/step" << step;
-		serializeRaster(*it->second, oss.str());
+		serializeRaster(*it->second, it->first, step);
 	}
 }
 
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <SerializationThread.hxx>
+
+namespace Engine
+{
+
+SerializationThread::SerializationThread( const size_t & maxPendingTasks ) : _busy(false), _stop(false), _maxPendingTasks(maxPendingTasks>0 ? maxPendingTasks : 1)
+{
+}
+
+SerializationThread::~SerializationThread()
+{
+	try
+	{
+		stop();
+	}
+	catch(...)
+	{
+	}
+}
+
+void SerializationThread::start()
+{
+	if(isRunning())
+	{
+		return;
+	}
+	_stop = false;
+	_thread = std::thread(&SerializationThread::run, this);
+}
+
+void SerializationThread::run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(true)
+	{
+		if(_tasks.empty())
+		{
+			if(_stop)
+			{
+				return;
+			}
+			_pushed.wait(lock);
+			continue;
+		}
+		Task task = _tasks.front();
+		_tasks.pop_front();
+		_busy = true;
+		lock.unlock();
+		try
+		{
+			task();
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> errorLock(_mutex);
+			if(!_error)
+			{
+				_error = std::current_exception();
+			}
+		}
+		lock.lock();
+		_busy = false;
+		_done.notify_all();
+	}
+}
+
+void SerializationThread::rethrow()
+{
+	if(!_error)
+	{
+		return;
+	}
+	std::exception_ptr error = _error;
+	_error = std::exception_ptr();
+	std::rethrow_exception(error);
+}
+
+void SerializationThread::push( const Task & task )
+{
+	if(!isRunning())
+	{
+		task();
+		return;
+	}
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(_tasks.size()>=_maxPendingTasks && !_error)
+	{
+		_done.wait(lock);
+	}
+	rethrow();
+	_tasks.push_back(task);
+	_pushed.notify_one();
+}
+
+void SerializationThread::flush()
+{
+	if(!isRunning())
+	{
+		return;
+	}
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(!_tasks.empty() || _busy)
+	{
+		_done.wait(lock);
+	}
+	rethrow();
+}
+
+void SerializationThread::stop()
+{
+	if(!isRunning())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+		_pushed.notify_one();
+	}
+	_thread.join();
+	std::lock_guard<std::mutex> lock(_mutex);
+	rethrow();
+}
+
+bool SerializationThread::isRunning() const
+{
+	return _thread.joinable();
+}
+
+} // namespace Engine
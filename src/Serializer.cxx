@@ -28,15 +28,19 @@
 #include <Agent.hxx>
 #include <Exception.hxx>
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <limits>
+#include <iostream>
 #include <Logger.hxx>
 #include <GeneralState.hxx>
+#include <Compression.hxx>
 
 #include <SpacePartition.hxx>
 
 namespace Engine
 {
 
-Serializer::Serializer( const SpacePartition & scheduler) : _scheduler(scheduler), _agentsFileId(-1), _fileId(-1), _currentAgentDatasetId(-1)
+Serializer::Serializer( const SpacePartition & scheduler) : _scheduler(scheduler), _agentsFileId(-1), _fileId(-1), _currentAgentDatasetId(-1), _currentColumns(0), _codec(eCodecNone), _communicator(MPI_COMM_NULL)
 {
 }
 
@@ -44,6 +48,34 @@ Serializer::~Serializer()
 {
 }
 
+hid_t Serializer::getRasterFileType( const RasterValueType & valueType )
+{
+	if(valueType==eRasterShort)
+	{
+		return H5T_NATIVE_SHORT;
+	}
+	if(valueType==eRasterByte)
+	{
+		return H5T_NATIVE_UCHAR;
+	}
+	return H5T_NATIVE_INT;
+}
+
+hid_t Serializer::createRasterProperties() const
+{
+	// chunks must be equal in every computer node, so they are based on the average size of the partitions instead of the owned area
+	hsize_t chunkDimensions[2];
+	chunkDimensions[0] = _config->getSize()._width/_scheduler.getNumPartitions()._width;
+	chunkDimensions[0] = std::max(hsize_t(1), std::min(chunkDimensions[0], Compression::_rasterChunkSize));
+	chunkDimensions[1] = _config->getSize()._height/_scheduler.getNumPartitions()._height;
+	chunkDimensions[1] = std::max(hsize_t(1), std::min(chunkDimensions[1], Compression::_rasterChunkSize));
+	
+	hid_t propertyListId = H5Pcreate(H5P_DATASET_CREATE);
+	H5Pset_chunk(propertyListId, 2, chunkDimensions);
+	Compression::setFilters(propertyListId, _codec, _config->getCompressionLevel(), _config->getShuffle());
+	return propertyListId;
+}
+
 void Serializer::init(World & world )
 {
     _config = &world.getConfig();
@@ -110,6 +142,17 @@ void Serializer::init(World & world )
 
 	log_INFO(logName.str(), _scheduler.getWallTime() << " id: " << _scheduler.getId() << " size: " << _config->getSize() << " num tasks: " << _scheduler.getNumTasks() << " serializer resolution:" << _config->getSerializeResolution() << " and steps: " << _config->getNumSteps());
 
+	_codec = Compression::getAvailableCodec(_config->getCompression());
+	if(_codec!=_config->getCompression())
+	{
+		log_INFO(logName.str(), "compression plugin not available, using deflate");
+	}
+	// the serialization thread agrees on agent types, offsets and delta encoding without interfering with the collectives of the scheduler
+	if(_scheduler.getNumTasks()>1)
+	{
+		MPI_Comm_dup(MPI_COMM_WORLD, &_communicator);
+	}
+
 	// we store the name of the rasters
 	hid_t rasterNameFileSpace = H5Screate_simple(1, &simpleDimension, NULL);
 	hid_t rasterNameDatasetId = H5Dcreate(_fileId, "rasters", H5T_NATIVE_INT, rasterNameFileSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
@@ -218,30 +261,27 @@ void Serializer::init(World & world )
 	}
 	H5Gclose(colorTableGroupId);
 
-	// creating a file with the agents of each computer node
+	// creating a file with the agents of every computer node; each task writes a slice of every dataset
 	std::ostringstream oss;
 	if(!path.empty())
 	{
 		oss << path << "/";
 	}
-	oss << "agents-" << _scheduler.getId() << ".abm";
+	oss << "agents.abm";
 
-	_agentsFileId = H5Fcreate(oss.str().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+	propertyListId = H5Pcreate(H5P_FILE_ACCESS);
+	if(_scheduler.getNumTasks()>1)		
+	{
+		H5Pset_fapl_mpio(propertyListId, MPI_COMM_WORLD, MPI_INFO_NULL);
+	}
+	_agentsFileId = H5Fcreate(oss.str().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, propertyListId);
+	H5Pclose(propertyListId);
 	
-	//the real size of the matrix is sqrt(num simulator)*matrixsize	
 	hsize_t dimensions[2];
 	dimensions[0] = hsize_t(_config->getSize()._width);
 	dimensions[1] = hsize_t(_config->getSize()._height);
 
-	// we need to specify the size where each computer node will be writing
-	hsize_t chunkDimensions[2];
-	chunkDimensions[0] = _scheduler.getOwnedArea()._size._width/2;
-	chunkDimensions[0] += 2*_scheduler.getOverlap();
-	chunkDimensions[1] = _scheduler.getOwnedArea()._size._height/2;
-	chunkDimensions[1] += 2*_scheduler.getOverlap();
-	
-	propertyListId = H5Pcreate(H5P_DATASET_CREATE);
-	H5Pset_chunk(propertyListId, 2, chunkDimensions);
+	propertyListId = createRasterProperties();
 
 	// static rasters	
 	for(size_t i=0; i<world.getNumberOfRasters(); i++)
@@ -253,37 +293,23 @@ void Serializer::init(World & world )
 		// TODO 0 o H5P_DEFAULT??
 		hid_t rasterGroupId = H5Gcreate(_fileId, world.getRasterName(i).c_str(), 0, H5P_DEFAULT, H5P_DEFAULT);
 		hid_t fileSpace = H5Screate_simple(2, dimensions, NULL); 
-		hid_t datasetId = H5Dcreate(rasterGroupId, "values", H5T_NATIVE_INT, fileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);
+		hid_t datasetId = H5Dcreate(rasterGroupId, "values", getRasterFileType(world.getStaticRaster(i).getValueType()), fileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);
 		H5Dclose(datasetId);
 		H5Sclose(fileSpace);
 		H5Gclose(rasterGroupId);
 	}
+	H5Pclose(propertyListId);
 
-	// dynamic rasters
+	// dynamic rasters, step datasets are created by serializeRasters
 	for(size_t i=0; i<world.getNumberOfRasters(); i++)
 	{
 		if(!world.rasterExists(i) || !world.rasterToSerialize(i) || !world.isRasterDynamic(i))
 		{
 			continue;
 		}	
-		// TODO 0 o H5P_DEFAULT??
 		hid_t rasterGroupId = H5Gcreate(_fileId, world.getRasterName(i).c_str(), 0, H5P_DEFAULT, H5P_DEFAULT);
-		for(int i=0; i<=_config->getNumSteps(); i++)
-		{  
-			if(i%_config->getSerializeResolution()!=0)
-			{
-				continue;
-			}
-			std::ostringstream oss;
-			oss << "step" << i;
-			hid_t stepFileSpace = H5Screate_simple(2, dimensions, NULL); 
-			hid_t stepDatasetId = H5Dcreate(rasterGroupId, oss.str().c_str(), H5T_NATIVE_INT, stepFileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);
-			H5Dclose(stepDatasetId);
-			H5Sclose(stepFileSpace);
-		}	
 		H5Gclose(rasterGroupId);
 	}
-	H5Pclose(propertyListId);
 
 	StaticRastersRefMap staticRasters;
 	for(size_t i=0; i<world.getNumberOfRasters(); i++)
@@ -303,291 +329,384 @@ void Serializer::init(World & world )
 		}
 	}
 	serializeStaticRasters(staticRasters);
+
+	// HDF5 calls MPI from the serialization thread in distributed runs
+	int threadLevel = MPI_THREAD_SINGLE;
+	MPI_Query_thread(&threadLevel);
+	if(_scheduler.getNumTasks()==1 || threadLevel==MPI_THREAD_MULTIPLE)
+	{
+		_writer.start();
+	}
+	else
+	{
+		log_INFO(logName.str(), "MPI_THREAD_MULTIPLE not provided, serialization will block the simulation");
+		// SpacePartition asks for MPI_THREAD_MULTIPLE, so this only happens if MPI can't provide it (or it was initialized by the user); reported once
+		if(_scheduler.getId()==0)
+		{
+			std::cout << "serializer: MPI thread level: " << threadLevel << " doesn't support MPI_THREAD_MULTIPLE, steps are written by the main thread" << std::endl;
+		}
+	}
 }
 
 void Serializer::finish()
 {
+	// writes every pending snapshot before closing the files
+	_writer.stop();
+	// range of the whole history of each raster, read by RasterHistory instead of every step
+	for(std::map<std::string, std::pair<int, int> >::const_iterator it=_rasterRanges.begin(); it!=_rasterRanges.end(); it++)
+	{
+		hid_t rasterGroupId = H5Gopen(_fileId, it->first.c_str(), H5P_DEFAULT);
+		writeRange(rasterGroupId, it->second);
+		H5Gclose(rasterGroupId);
+	}
+	_rasterRanges.clear();
 	H5Fclose(_fileId);
 	H5Fclose(_agentsFileId);
+	if(_communicator!=MPI_COMM_NULL)
+	{
+		MPI_Comm_free(&_communicator);
+	}
 }
 
 void Serializer::registerType( Agent * agent )
 {
-	std::string type = agent->getType();
+	const std::string & type = agent->getType();
+	if(agent->getTypeId()>=(int)_registeredTypes.size())
+	{
+		_registeredTypes.resize(agent->getTypeId()+1, false);
+	}
+	_registeredTypes[agent->getTypeId()] = true;
 
 	std::stringstream logName;
 	logName << "Serializer_" << _scheduler.getId();
 
 	log_DEBUG(logName.str(), "registering new type: " << type);
 
-	hsize_t simpleDimension = 0;
-	hsize_t maxDims[1];
-	maxDims[0] = H5S_UNLIMITED;
-	hid_t agentFileSpace = H5Screate_simple(1, &simpleDimension, maxDims);
-	hid_t agentTypeGroup = H5Gcreate(_agentsFileId, agent->getType().c_str(),  0, H5P_DEFAULT, H5P_DEFAULT);
-
-	hid_t propertyListId = H5Pcreate(H5P_DATASET_CREATE);
-	hsize_t chunks = 1;
-	H5Pset_chunk(propertyListId, 1, &chunks);
+	// HDF5 groups are created by the serialization thread once every task knows the type
+	if(agent->getTypeId()>=(int)_columns.size())
+	{
+		_columns.resize(agent->getTypeId()+1);
+	}
+	AgentColumns & columns = _columns[agent->getTypeId()];
+	columns = AgentColumns(type);
 
-	IntMap * newTypeIntMap = new IntMap;
-	FloatMap * newTypeFloatMap = new FloatMap;
-	StringMap * newTypeStringMap = new StringMap;
+	for(Agent::AttributesList::iterator it=agent->beginIntAttributes(); it!=agent->endIntAttributes(); it++)
+	{	
+		log_DEBUG(logName.str(), "\tnew int attribute: " << *it);
+		columns.addIntColumn(*it);
+	}
+	for(Agent::AttributesList::iterator it=agent->beginFloatAttributes(); it!=agent->endFloatAttributes(); it++)
+	{	
+		log_DEBUG(logName.str(), "\tnew float attribute: " << *it);
+		columns.addFloatColumn(*it);
+	}
+	for(Agent::AttributesList::iterator it=agent->beginStringAttributes(); it!=agent->endStringAttributes(); it++)
+	{		
+		log_DEBUG(logName.str(), "\tnew string attribute: " << *it);
+		columns.addStringColumn(*it);
+	}
+}
 
-	// create a dataset for each timestep
-	for(int i=0; i<=_config->getNumSteps(); i++)
+void Serializer::finishAgentsSerialization( int step)
+{
+	// a single task writes the step, as the datasets of every type are created and written collectively
+	std::shared_ptr< std::vector< std::shared_ptr<AgentSnapshot> > > snapshots(new std::vector< std::shared_ptr<AgentSnapshot> >());
+	std::vector< SnapshotPool<AgentSnapshot> * > pools;
+	for(size_t i=0; i<_columns.size(); i++)
 	{
-		if(i%_config->getSerializeResolution()!=0)
+		const std::string & type = _columns[i].getType();
+		// type not registered by this task
+		if(type.empty())
 		{
 			continue;
 		}
+		SnapshotPool<AgentSnapshot> * pool = &_agentSnapshots[type];
+		std::shared_ptr<AgentSnapshot> snapshot = pool->get();
+		snapshot->_type = type;
+		snapshot->_step = step;
+		snapshot->_offset = 0;
+		_columns[i].moveValues(snapshot->_columns);
+		snapshots->push_back(snapshot);
+		pools.push_back(pool);
+	}
+	_writer.push([this, step, snapshots, pools]()
+	{
+		writeAgents(step, *snapshots);
+		for(size_t i=0; i<snapshots->size(); i++)
+		{
+			pools[i]->release(snapshots->at(i));
+		}
+	});
+}
 
-		std::ostringstream oss;
-		oss<<"step"<<i;
-		hid_t stepGroup = H5Gcreate(agentTypeGroup, oss.str().c_str(),  0, H5P_DEFAULT, H5P_DEFAULT);
-		for(Agent::AttributesList::iterator it=agent->beginIntAttributes(); it!=agent->endIntAttributes(); it++)
-		{	
-			log_DEBUG(logName.str(), "\tstep: " << i << " new int attribute: " << *it);
-			newTypeIntMap->insert( make_pair(*it, new std::vector<int>() ));
-			hid_t idDataset= H5Dcreate(stepGroup, (*it).c_str(), H5T_NATIVE_INT, agentFileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);  
-            if(idDataset<0)
-            {
-                std::stringstream ossErr;
-        		ossErr << "SequentialSerializer::registerType - dataset not created for agent: " << agent << " step group: " << oss.str() << " and int attribute: " << *it;
-        		throw Exception(ossErr.str());
-            }   
-			H5Dclose(idDataset);
-		}
-
-        for(Agent::AttributesList::iterator it=agent->beginFloatAttributes(); it!=agent->endFloatAttributes(); it++)
-		{	
-			log_DEBUG(logName.str(), "\tstep: " << i << " new float attribute: " << *it);
-			newTypeFloatMap->insert( make_pair(*it, new std::vector<float>() ));
-			hid_t idDataset= H5Dcreate(stepGroup, (*it).c_str(), H5T_NATIVE_FLOAT, agentFileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);     
-            if(idDataset<0)
-            {
-                std::stringstream ossErr;
-        		ossErr<< "SequentialSerializer::registerType - dataset not created for agent: " << agent << " step group: " << oss.str() << " and float attribute: " << *it;
-        		throw Exception(ossErr.str());
-            }
-
-			H5Dclose(idDataset);
+void Serializer::updateAgentSchemas( const std::vector< std::shared_ptr<AgentSnapshot> > & snapshots )
+{
+	// one line for each type and attribute: T<type>, I<int attribute>, F<float attribute>, S<string attribute>
+	std::ostringstream local;
+	for(size_t i=0; i<snapshots.size(); i++)
+	{
+		const AgentColumns & columns = snapshots[i]->_columns;
+		local << "T" << columns.getType() << "\n";
+		for(size_t j=0; j<columns.getNumIntColumns(); j++)
+		{
+			local << "I" << columns.getIntName(j) << "\n";
 		}
-		
-		hid_t idType = H5Tcopy(H5T_C_S1);
-		H5Tset_size (idType, H5T_VARIABLE);
-		for(Agent::AttributesList::iterator it=agent->beginStringAttributes(); it!=agent->endStringAttributes(); it++)
-		{		
-			log_DEBUG(logName.str(), "\tstep: " << i << " new string attribute: " << *it);
-			newTypeStringMap->insert( make_pair(*it, new std::vector<std::string>() ));
-			hid_t idDataset= H5Dcreate(stepGroup, (*it).c_str(), idType, agentFileSpace, H5P_DEFAULT, propertyListId, H5P_DEFAULT);   
-            if(idDataset<0)
-            {
-                std::stringstream ossErr;
-        		ossErr<< "SequentialSerializer::registerType - dataset not created for agent: " << agent << " step group: " << oss.str() << " and string attribute: " << *it;
-        		throw Exception(ossErr.str());
-            }
-			H5Dclose(idDataset);
+		for(size_t j=0; j<columns.getNumFloatColumns(); j++)
+		{
+			local << "F" << columns.getFloatName(j) << "\n";
+		}
+		for(size_t j=0; j<columns.getNumStringColumns(); j++)
+		{
+			local << "S" << columns.getStringName(j) << "\n";
 		}
-		H5Gclose(stepGroup);
 	}
-	H5Gclose(agentTypeGroup);
-	H5Sclose(agentFileSpace);
-
-	_agentIndexMap.insert( make_pair(type, 0) );
-	_intAttributes.insert( make_pair(type, newTypeIntMap));
-	_floatAttributes.insert( make_pair(type, newTypeFloatMap));
-	_stringAttributes.insert( make_pair(type, newTypeStringMap));
-}
+	std::string schemas = local.str();
 
-void Serializer::resetCurrentIndexs()
-{
-	for(std::map<std::string, int>::iterator it=_agentIndexMap.begin(); it!=_agentIndexMap.end(); it++)
+	if(_communicator!=MPI_COMM_NULL)
 	{
-		it->second = 0;
+		int numTasks = _scheduler.getNumTasks();
+		int localSize = schemas.size();
+		std::vector<int> sizes(numTasks);
+		MPI_Allgather(&localSize, 1, MPI_INT, &sizes[0], 1, MPI_INT, _communicator);
+		std::vector<int> displacements(numTasks, 0);
+		for(int i=1; i<numTasks; i++)
+		{
+			displacements[i] = displacements[i-1]+sizes[i-1];
+		}
+		std::vector<char> gathered(std::max(1, displacements[numTasks-1]+sizes[numTasks-1]));
+		MPI_Allgatherv(const_cast<char*>(schemas.data()), localSize, MPI_CHAR, &gathered[0], &sizes[0], &displacements[0], MPI_CHAR, _communicator);
+		schemas.assign(gathered.begin(), gathered.begin()+displacements[numTasks-1]+sizes[numTasks-1]);
 	}
-}
 
-void Serializer::finishAgentsSerialization( int step)
-{
-	for(StringAttributesMap::iterator it=_stringAttributes.begin(); it!=_stringAttributes.end(); it++)
+	std::istringstream lines(schemas);
+	std::string line;
+	AgentSchema * schema = 0;
+	while(std::getline(lines, line))
 	{
-		executeAgentSerialization(it->first, step);
+		std::string name = line.substr(1);
+		switch(line[0])
+		{
+			case 'T':
+				schema = &_agentSchemas[name];
+				break;
+			case 'I':
+				schema->_intAttributes.insert(name);
+				break;
+			case 'F':
+				schema->_floatAttributes.insert(name);
+				break;
+			default:
+				schema->_stringAttributes.insert(name);
+				break;
+		}
 	}
-	resetCurrentIndexs();
 }
-	
-void Serializer::executeAgentSerialization( const std::string & type, int step)	
-{
-	std::map<std::string, int>::iterator itI = _agentIndexMap.find(type);
 
-	int currentIndex = itI->second;	
+void Serializer::writeAgents( int step, const std::vector< std::shared_ptr<AgentSnapshot> > & snapshots )
+{
+	updateAgentSchemas(snapshots);
 
-	hsize_t	offset[1];
-    offset[0] = currentIndex;
- 	
-	hsize_t	stride[1];
-	stride[0] = 1;
-	
-	hsize_t count[1];
-	count[0] = 1;
+	std::map<std::string, AgentSnapshot *> localSnapshots;
+	for(size_t i=0; i<snapshots.size(); i++)
+	{
+		localSnapshots.insert(std::make_pair(snapshots[i]->_type, snapshots[i].get()));
+	}
 
-	IntAttributesMap::iterator it = _intAttributes.find(type);
-	IntMap * attributes = it->second;	
-	for(IntMap::iterator itM=attributes->begin(); itM!=attributes->end(); itM++)
+	// number of local agents of each type, and the length of their longest string attribute
+	std::vector<long long> counts;
+	std::vector<int> stringSizes;
+	for(AgentSchemas::const_iterator it=_agentSchemas.begin(); it!=_agentSchemas.end(); it++)
 	{
-		std::vector<int> * data = itM->second;
-		// nothing to serialize
-		if(data->size()==0)
+		std::map<std::string, AgentSnapshot *>::const_iterator itS = localSnapshots.find(it->first);
+		const AgentSnapshot * snapshot = itS==localSnapshots.end() ? 0 : itS->second;
+		counts.push_back(snapshot ? snapshot->_columns.getNumAgents() : 0);
+		for(std::set<std::string>::const_iterator itA=it->second._stringAttributes.begin(); itA!=it->second._stringAttributes.end(); itA++)
 		{
-			return;
+			size_t maxSize = 0;
+			int handle = snapshot ? snapshot->_columns.getStringHandle(*itA) : -1;
+			if(handle!=-1)
+			{
+				const std::vector<std::string> & values = snapshot->_columns.getStringColumn(handle);
+				for(size_t i=0; i<values.size(); i++)
+				{
+					maxSize = std::max(maxSize, values[i].size());
+				}
+			}
+			stringSizes.push_back(maxSize+1);
 		}
-		hsize_t	block[1];
-		block[0] = data->size();
-		
-		hsize_t simpleDimension = data->size();
-		// TODO es repeteix per cada atribut
-		hsize_t newSize[1];
-		newSize[0] = currentIndex+data->size();
-
-		std::ostringstream oss;
-		oss << type << "/step" << step << "/" << itM->first;
-		hid_t datasetId = H5Dopen(_agentsFileId, oss.str().c_str(), H5P_DEFAULT);
-		H5Dset_extent( datasetId, newSize);
-		hid_t fileSpace = H5Dget_space(datasetId);
-		H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, stride, count, block);
-  		hid_t memorySpace = H5Screate_simple(1, &simpleDimension, 0);
-		H5Dwrite(datasetId, H5T_NATIVE_INT, memorySpace, fileSpace, H5P_DEFAULT, &(data->at(0)));
-		data->clear();
-
-		H5Sclose(memorySpace);
-		H5Sclose(fileSpace);
-		H5Dclose(datasetId);
 	}
-    
-    FloatAttributesMap::iterator itF = _floatAttributes.find(type);
-	FloatMap * attributesF = itF->second;	
-	for(FloatMap::iterator itM=attributesF->begin(); itM!=attributesF->end(); itM++)
+
+	// the slice of each task starts after the agents of the tasks with lower ids
+	std::vector<long long> offsets(counts.size(), 0);
+	std::vector<long long> totals(counts);
+	if(_communicator!=MPI_COMM_NULL && !counts.empty())
 	{
-		std::vector<float> * data = itM->second;
-		// nothing to serialize
-		if(data->size()==0)
+		MPI_Exscan(&counts[0], &offsets[0], counts.size(), MPI_LONG_LONG, MPI_SUM, _communicator);
+		if(_scheduler.getId()==0)
 		{
-			return;
+			std::fill(offsets.begin(), offsets.end(), 0);
 		}
-		hsize_t	block[1];
-		block[0] = data->size();
-		
-		hsize_t simpleDimension = data->size();
-		// TODO es repeteix per cada atribut
-		hsize_t newSize[1];
-		newSize[0] = currentIndex+data->size();
+		MPI_Allreduce(&counts[0], &totals[0], counts.size(), MPI_LONG_LONG, MPI_SUM, _communicator);
+		if(!stringSizes.empty())
+		{
+			std::vector<int> localSizes(stringSizes);
+			MPI_Allreduce(&localSizes[0], &stringSizes[0], stringSizes.size(), MPI_INT, MPI_MAX, _communicator);
+		}
+	}
 
-		std::ostringstream oss;
-		oss << type << "/step" << step << "/" << itM->first;
-		hid_t datasetId = H5Dopen(_agentsFileId, oss.str().c_str(), H5P_DEFAULT);
-		H5Dset_extent( datasetId, newSize);
-		hid_t fileSpace = H5Dget_space(datasetId);
-		H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, stride, count, block);
-  		hid_t memorySpace = H5Screate_simple(1, &simpleDimension, 0);
-		H5Dwrite(datasetId, H5T_NATIVE_FLOAT, memorySpace, fileSpace, H5P_DEFAULT, &(data->at(0)));
-		data->clear();
+	hid_t transferListId = H5Pcreate(H5P_DATASET_XFER);
+	H5Pset_dxpl_mpio(transferListId, H5FD_MPIO_COLLECTIVE);
+	// tasks without agents of a type still join the collective write, and HDF5 needs a valid buffer for them
+	int empty = 0;
 
-		H5Sclose(memorySpace);
-		H5Sclose(fileSpace);
-		H5Dclose(datasetId);
-	}
-	
-	StringAttributesMap::iterator itS = _stringAttributes.find(type);
-	StringMap * attributesS = itS->second;	
-	for(StringMap::iterator itM=attributesS->begin(); itM!=attributesS->end(); itM++)
+	size_t typeIndex = 0;
+	size_t stringIndex = 0;
+	for(AgentSchemas::const_iterator it=_agentSchemas.begin(); it!=_agentSchemas.end(); it++, typeIndex++)
 	{
-		std::vector<std::string> * data = itM->second;
-		hsize_t	block[1];
-		block[0] = data->size();
-		
-		hsize_t simpleDimension = data->size();
-		// TODO es repeteix per cada atribut
-		hsize_t newSize[1];
-		newSize[0] = currentIndex+data->size();
-		itI->second = currentIndex+data->size();
+		const AgentSchema & schema = it->second;
+		std::map<std::string, AgentSnapshot *>::const_iterator itS = localSnapshots.find(it->first);
+		AgentSnapshot * snapshot = itS==localSnapshots.end() ? 0 : itS->second;
 
+		if(H5Lexists(_agentsFileId, it->first.c_str(), H5P_DEFAULT)<=0)
+		{
+			hid_t agentTypeGroup = H5Gcreate(_agentsFileId, it->first.c_str(),  0, H5P_DEFAULT, H5P_DEFAULT);
+			H5Gclose(agentTypeGroup);
+		}
 		std::ostringstream oss;
-		oss << type << "/step" << step << "/" << itM->first;
-
-		hid_t datasetId = H5Dopen(_agentsFileId, oss.str().c_str(), H5P_DEFAULT);
-		H5Dset_extent( datasetId, newSize);
-		hid_t fileSpace = H5Dget_space(datasetId);
-		H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, stride, count, block);
-		hid_t idType = H5Tcopy(H5T_C_S1);
-		H5Tset_size (idType, H5T_VARIABLE);
-  		hid_t memorySpace = H5Screate_simple(1, &simpleDimension, 0);
-		H5Dwrite(datasetId, idType, memorySpace, fileSpace, H5P_DEFAULT, &(data->at(0)));
-		data->clear();
+		oss << it->first << "/step" << step;
+		hid_t stepGroup = H5Gcreate(_agentsFileId, oss.str().c_str(),  0, H5P_DEFAULT, H5P_DEFAULT);
+		if(stepGroup<0)
+		{
+			std::stringstream ossErr;
+			ossErr << "Serializer::writeAgents - step group: " << oss.str() << " not created";
+			throw Exception(ossErr.str());
+		}
+
+		hsize_t total = totals[typeIndex];
+		hid_t fileSpace = H5Screate_simple(1, &total, NULL);
+		hsize_t count = counts[typeIndex];
+		hid_t memorySpace = H5Screate_simple(1, &count, NULL);
+		hsize_t offset = offsets[typeIndex];
+		if(count==0)
+		{
+			H5Sselect_none(fileSpace);
+			H5Sselect_none(memorySpace);
+		}
+		else
+		{
+			H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, &offset, NULL, &count, NULL);
+		}
 
+		hsize_t chunks = std::max(hsize_t(1), std::min(total, Compression::_agentChunkSize));
+		hid_t creationListId = H5Pcreate(H5P_DATASET_CREATE);
+		if(_codec!=eCodecNone)
+		{
+			H5Pset_chunk(creationListId, 1, &chunks);
+			Compression::setFilters(creationListId, _codec, _config->getCompressionLevel(), _config->getShuffle());
+		}
+
+		for(std::set<std::string>::const_iterator itA=schema._intAttributes.begin(); itA!=schema._intAttributes.end(); itA++)
+		{
+			const void * data = &empty;
+			if(count>0)
+			{
+				data = &snapshot->_columns.getIntColumn(getLocalHandle(snapshot->_columns.getIntHandle(*itA), it->first, *itA)).at(0);
+			}
+			writeAgentAttribute(stepGroup, *itA, H5T_NATIVE_INT, H5T_NATIVE_INT, creationListId, transferListId, fileSpace, memorySpace, data);
+		}
+		for(std::set<std::string>::const_iterator itA=schema._floatAttributes.begin(); itA!=schema._floatAttributes.end(); itA++)
+		{
+			const void * data = &empty;
+			if(count>0)
+			{
+				data = &snapshot->_columns.getFloatColumn(getLocalHandle(snapshot->_columns.getFloatHandle(*itA), it->first, *itA)).at(0);
+			}
+			writeAgentAttribute(stepGroup, *itA, H5T_NATIVE_FLOAT, H5T_NATIVE_FLOAT, creationListId, transferListId, fileSpace, memorySpace, data);
+		}
+		// parallel HDF5 can't write variable length data, so strings are as wide as the longest value of any task
+		for(std::set<std::string>::const_iterator itA=schema._stringAttributes.begin(); itA!=schema._stringAttributes.end(); itA++, stringIndex++)
+		{
+			size_t width = stringSizes[stringIndex];
+			_stringBuffer.assign(std::max(size_t(1), size_t(count*width)), '\0');
+			if(count>0)
+			{
+				const std::vector<std::string> & data = snapshot->_columns.getStringColumn(getLocalHandle(snapshot->_columns.getStringHandle(*itA), it->first, *itA));
+				for(size_t i=0; i<count; i++)
+				{
+					data.at(i).copy(&_stringBuffer[i*width], width-1);
+				}
+			}
+			hid_t stringType = H5Tcopy(H5T_C_S1);
+			H5Tset_size(stringType, width);
+			writeAgentAttribute(stepGroup, *itA, stringType, stringType, creationListId, transferListId, fileSpace, memorySpace, &_stringBuffer[0]);
+			H5Tclose(stringType);
+		}
+		if(snapshot)
+		{
+			snapshot->_columns.clear();
+		}
+		H5Pclose(creationListId);
 		H5Sclose(memorySpace);
 		H5Sclose(fileSpace);
-		H5Dclose(datasetId);
+		H5Gclose(stepGroup);
 	}
+	H5Pclose(transferListId);
 }
 
-void Serializer::addStringAttribute( const std::string & type, const std::string & key, const std::string & value )
+int Serializer::getLocalHandle( int handle, const std::string & type, const std::string & attribute )
 {
-	StringAttributesMap::iterator it = _stringAttributes.find(type);
-	StringMap * stringMap = it->second;
-	StringMap::iterator itS = stringMap->find(key);
-	std::vector<std::string> * stringVector = itS->second;
-	stringVector->push_back(value);
-}
-	
-void Serializer::addFloatAttribute( const std::string & type, const std::string & key, float value )
-{
-    FloatAttributesMap::iterator it = _floatAttributes.find(type);
-	if(it==_floatAttributes.end())
+	if(handle==-1)
 	{
 		std::stringstream oss;
-		oss << "Serializer::addFloatAttribute - looking for unknown agent type: " << type;
+		oss << "Serializer::getLocalHandle - attribute: " << attribute << " of agent type: " << type << " not registered by task: " << _scheduler.getId();
 		throw Exception(oss.str());
 	}
-	FloatMap * floatMap = it->second;
-	FloatMap::iterator itI = floatMap->find(key);
-	if(itI==floatMap->end())
+	return handle;
+}
+
+void Serializer::writeAgentAttribute( const hid_t & stepGroup, const std::string & name, const hid_t & fileType, const hid_t & memoryType, const hid_t & creationListId, const hid_t & transferListId, const hid_t & fileSpace, const hid_t & memorySpace, const void * data )
+{
+	hid_t datasetId = H5Dcreate(stepGroup, name.c_str(), fileType, fileSpace, H5P_DEFAULT, creationListId, H5P_DEFAULT);
+	if(datasetId<0)
 	{
 		std::stringstream oss;
-		oss << "Serializer::addFloatAttribute - looking for unknown attribute: " << key << " in agent type: " << type;
+		oss << "Serializer::writeAgentAttribute - dataset not created for attribute: " << name;
 		throw Exception(oss.str());
 	}
-	std::vector<float> * floatVector = itI->second;
-	floatVector->push_back(value);
+	H5Dwrite(datasetId, memoryType, memorySpace, fileSpace, transferListId, data);
+	H5Dclose(datasetId);
 }
-	
-void Serializer::addIntAttribute( const std::string & type, const std::string & key, int value )
+
+AgentColumns & Serializer::getColumns( const std::string & type )
 {
-	IntAttributesMap::iterator it = _intAttributes.find(type);
-	if(it==_intAttributes.end())
+	// attributes are usually added while serializing an agent of this type
+	if(_currentColumns && _currentColumns->getType()==type)
 	{
-		std::stringstream oss;
-		oss << "Serializer::addIntAttribute - looking for unknown agent type: " << type;
-		throw Exception(oss.str());
+		return *_currentColumns;
 	}
-	IntMap * intMap = it->second;
-	IntMap::iterator itI = intMap->find(key);
-	if(itI==intMap->end())
+	int typeId = GeneralState::agentTypes().getId(type);
+	if(typeId==-1 || typeId>=(int)_columns.size() || _columns[typeId].getType().empty())
 	{
 		std::stringstream oss;
-		oss << "Serializer::addIntAttribute - looking for unknown attribute: " << key << " in agent type: " << type;
+		oss << "Serializer::getColumns - looking for unknown agent type: " << type;
 		throw Exception(oss.str());
 	}
-	std::vector<int> * intVector = itI->second;
-	intVector->push_back(value);
+	return _columns[typeId];
 }
 
-int Serializer::getDataSize( const std::string & type )
+void Serializer::addStringAttribute( const std::string & type, const std::string & key, const std::string & value )
 {
-	StringAttributesMap::iterator it = _stringAttributes.find(type);
-	StringMap * stringMap = it->second;
-	StringMap::iterator itS = stringMap->find("id");
-	return itS->second->size();
+	getColumns(type).addString(key, value);
+}
+	
+void Serializer::addFloatAttribute( const std::string & type, const std::string & key, float value )
+{
+	getColumns(type).addFloat(key, value);
+}
+	
+void Serializer::addIntAttribute( const std::string & type, const std::string & key, int value )
+{
+	getColumns(type).addInt(key, value);
 }
 
 void Serializer::serializeAgents( const int & step, const AgentsList::const_iterator beginAgents, const AgentsList::const_iterator endAgents )
@@ -608,23 +727,20 @@ void Serializer::serializeAgents( const int & step, const AgentsList::const_iter
 
 void Serializer::serializeAgent( Agent * agent, const int & step, int index )
 {
-	std::string type = agent->getType();
-	// new type, must be in _stringAttributes because at least id attribute must exist
-	if(_stringAttributes.find(type)==_stringAttributes.end())
+	// new type
+	int typeId = agent->getTypeId();
+	if(typeId>=(int)_registeredTypes.size() || !_registeredTypes[typeId])
 	{
 		agent->registerAttributes();
 		registerType(agent);
 	}
 
-	addStringAttribute(type, "id", agent->getId());
-	addIntAttribute(type, "x", agent->getPosition()._x);
-	addIntAttribute(type, "y", agent->getPosition()._y);
+	_currentColumns = &_columns[typeId];
+	_currentColumns->beginAgent();
+	_currentColumns->addString("id", agent->getId());
+	_currentColumns->addInt("x", agent->getPosition()._x);
+	_currentColumns->addInt("y", agent->getPosition()._y);
 	agent->serialize();
-
-	if(getDataSize(type)>=20000)
-	{
-		executeAgentSerialization(type, step);
-	}
 }
 
 void Serializer::serializeAttribute( const std::string & name, const int & value )
@@ -645,23 +761,135 @@ void Serializer::serializeAttribute( const std::string & name, const int & value
 	H5Sclose(fileSpace);
 }
 
-void Serializer::serializeRaster( const StaticRaster & raster, const std::string & datasetKey )
+void Serializer::serializeRaster( const StaticRaster & raster, const std::string & name, int step )
 {
+	std::ostringstream datasetKey;
+	datasetKey << "/" << name << "/";
+	if(step<0)
+	{
+		datasetKey << "values";
+	}
+	else
+	{
+		datasetKey << "step" << step;
+	}
+
 	std::stringstream logName;
 	logName << "MPI_Serializer_world_" << _scheduler.getId();
-	log_EDEBUG(logName.str(), "serializing raster: " << datasetKey);
-
+	log_EDEBUG(logName.str(), "serializing raster: " << datasetKey.str());
+
+	std::shared_ptr<RasterSnapshot> snapshot = _rasterSnapshots.get();
+	snapshot->_datasetKey = datasetKey.str();
+	snapshot->_name = name;
+	snapshot->_step = step;
+	snapshot->_valueType = raster.getValueType();
+	snapshot->_create = step>=0;
 	// if it is not a border, it will copy from overlap
+	snapshot->_area = _scheduler.getOwnedArea();
+
+	size_t width = snapshot->_area._size._width;
+	size_t height = snapshot->_area._size._height;
+	snapshot->_data.resize(width*height);
+	Point2D<int> overlapDist = _scheduler.getOwnedArea()._origin-_scheduler.getBoundaries()._origin;
+	log_EDEBUG(logName.str(), "overlap dist: " << overlapDist << "owned area: " << _scheduler.getOwnedArea() << " and boundaries: " << _scheduler.getBoundaries());
+	// copy the owned part of each row, skipping overlap
+	for(size_t j=0; j<height; j++)
+	{
+		raster.copyRow(j+overlapDist._y, overlapDist._x, width, &snapshot->_data[j*width]);
+	}
+	_writer.push([this, snapshot]()
+	{
+		writeRaster(*snapshot);
+		_rasterSnapshots.release(snapshot);
+	});
+}
+
+void Serializer::writeRaster( const RasterSnapshot & snapshot )
+{
+	const std::vector<int> * values = &snapshot._data;
+	if(snapshot._create)
+	{
+		hid_t fileType = getRasterFileType(snapshot._valueType);
+		int referenceStep = -1;
+		if(_config->getDeltaEncoding())
+		{
+			DeltaReference & reference = _deltaReferences[snapshot._name];
+			referenceStep = reference._step;
+			int encoded = Compression::encodeDelta(reference, snapshot, _deltas);
+			// the whole dataset is delta encoded only if every task covers the same area than in the previous step
+			if(_communicator!=MPI_COMM_NULL)
+			{
+				int localEncoded = encoded;
+				MPI_Allreduce(&localEncoded, &encoded, 1, MPI_INT, MPI_LAND, _communicator);
+			}
+			if(encoded)
+			{
+				values = &_deltas;
+				fileType = Compression::getDeltaFileType(snapshot._valueType);
+			}
+			else
+			{
+				reference._numDeltas = 0;
+				referenceStep = -1;
+			}
+		}
+
+		hsize_t dimensions[2];
+		dimensions[0] = hsize_t(_config->getSize()._width);
+		dimensions[1] = hsize_t(_config->getSize()._height);
+
+		std::pair<int, int> range(std::numeric_limits<int>::max(), std::numeric_limits<int>::min());
+		if(!snapshot._data.empty())
+		{
+			std::pair<std::vector<int>::const_iterator, std::vector<int>::const_iterator> minMax = std::minmax_element(snapshot._data.begin(), snapshot._data.end());
+			range = std::make_pair(*minMax.first, *minMax.second);
+		}
+		// attributes are written collectively, so every task stores the range of the whole step
+		if(_communicator!=MPI_COMM_NULL)
+		{
+			std::pair<int, int> localRange = range;
+			MPI_Allreduce(&localRange.first, &range.first, 1, MPI_INT, MPI_MIN, _communicator);
+			MPI_Allreduce(&localRange.second, &range.second, 1, MPI_INT, MPI_MAX, _communicator);
+		}
+
+		hid_t creationListId = createRasterProperties();
+		hid_t stepFileSpace = H5Screate_simple(2, dimensions, NULL); 
+		hid_t stepDatasetId = H5Dcreate(_fileId, snapshot._datasetKey.c_str(), fileType, stepFileSpace, H5P_DEFAULT, creationListId, H5P_DEFAULT);
+		if(referenceStep>=0)
+		{
+			// readers add the values of 'deltaStep' to the stored differences
+			hsize_t simpleDimension = 1;
+			hid_t attributeFileSpace = H5Screate_simple(1, &simpleDimension, NULL);
+			hid_t attributeId = H5Acreate(stepDatasetId, "deltaStep", H5T_NATIVE_INT, attributeFileSpace, H5P_DEFAULT, H5P_DEFAULT);
+			H5Awrite(attributeId, H5T_NATIVE_INT, &referenceStep);
+			H5Aclose(attributeId);
+			H5Sclose(attributeFileSpace);
+		}
+		writeRange(stepDatasetId, range);
+		std::map<std::string, std::pair<int, int> >::iterator itRange = _rasterRanges.find(snapshot._name);
+		if(itRange==_rasterRanges.end())
+		{
+			_rasterRanges.insert(std::make_pair(snapshot._name, range));
+		}
+		else
+		{
+			itRange->second.first = std::min(itRange->second.first, range.first);
+			itRange->second.second = std::max(itRange->second.second, range.second);
+		}
+		H5Dclose(stepDatasetId);
+		H5Sclose(stepFileSpace);
+		H5Pclose(creationListId);
+	}
+
 	hsize_t	offset[2];
-    offset[0] = _scheduler.getOwnedArea()._origin._x;	
-    offset[1] = _scheduler.getOwnedArea()._origin._y;
+    offset[0] = snapshot._area._origin._x;	
+    offset[1] = snapshot._area._origin._y;
  
 	hsize_t	block[2];
-	block[0] = _scheduler.getOwnedArea()._size._width;
-	block[1] = _scheduler.getOwnedArea()._size._height;
+	block[0] = snapshot._area._size._width;
+	block[1] = snapshot._area._size._height;
 
-
-	hid_t dataSetId = H5Dopen(_fileId, datasetKey.c_str(), H5P_DEFAULT);
+	hid_t dataSetId = H5Dopen(_fileId, snapshot._datasetKey.c_str(), H5P_DEFAULT);
 	hid_t fileSpace = H5Dget_space(dataSetId);
 	
 	hsize_t	stride[2];
@@ -674,41 +902,37 @@ void Serializer::serializeRaster( const StaticRaster & raster, const std::string
 	
 	H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, stride, count, block);
  
-	int * data = (int *) malloc(sizeof(int)*block[0]*block[1]);
-	Point2D<int> overlapDist = _scheduler.getOwnedArea()._origin-_scheduler.getBoundaries()._origin;
-	log_EDEBUG(logName.str(), "overlap dist: " << overlapDist << "owned area: " << _scheduler.getOwnedArea() << " and boundaries: " << _scheduler.getBoundaries());
-	for(size_t i=0; i<block[0]; i++)
-	{
-		for(size_t j=0; j<block[1]; j++)
-		{	
-			size_t index = j*block[0]+i;
-			log_EDEBUG(logName.str(), "index: " << i << "/" << j << " - " << index);
-			log_EDEBUG(logName.str(), "getting value: " << Point2D<int> (i+overlapDist._x,j+overlapDist._y));
-			data[index] = raster.getValue(Point2D<int> (i+overlapDist._x,j+overlapDist._y));
-			log_EDEBUG(logName.str(), "value: " << data[index]);
-		}
-	}
-    // Create property list for collective dataset write.
+    // every task writes its owned area of the dataset in a single collective call
 	hid_t propertyListId = H5Pcreate(H5P_DATASET_XFER);
-	H5Pset_dxpl_mpio(propertyListId, H5FD_MPIO_INDEPENDENT);
+	H5Pset_dxpl_mpio(propertyListId, H5FD_MPIO_COLLECTIVE);
     hid_t memorySpace = H5Screate_simple(2, block, NULL);
-	H5Dwrite(dataSetId, H5T_NATIVE_INT, memorySpace, fileSpace, propertyListId, data);
+	H5Dwrite(dataSetId, H5T_NATIVE_INT, memorySpace, fileSpace, propertyListId, &values->at(0));
 
-	free(data);
 	H5Pclose(propertyListId);
     H5Sclose(memorySpace);	
 	H5Sclose(fileSpace);
 	H5Dclose(dataSetId);
-	log_EDEBUG(logName.str(), "serializing raster: " << datasetKey << " done");
+}
+
+void Serializer::writeRange( const hid_t & objectId, const std::pair<int, int> & range )
+{
+	hsize_t simpleDimension = 1;
+	hid_t attributeFileSpace = H5Screate_simple(1, &simpleDimension, NULL);
+	hid_t attributeId = H5Acreate(objectId, "minValue", H5T_NATIVE_INT, attributeFileSpace, H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attributeId, H5T_NATIVE_INT, &range.first);
+	H5Aclose(attributeId);
+	attributeId = H5Acreate(objectId, "maxValue", H5T_NATIVE_INT, attributeFileSpace, H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attributeId, H5T_NATIVE_INT, &range.second);
+	H5Aclose(attributeId);
+	H5Sclose(attributeFileSpace);
 }
 
 void Serializer::serializeRasters(int step)
 {
+	// dataset creation is collective; every task walks _dynamicRasters in the same order and the writer keeps it
 	for(StaticRastersRefMap::const_iterator it=_dynamicRasters.begin(); it!=_dynamicRasters.end(); it++)
 	{
-		std::ostringstream oss;
-		oss << "/" << it->first << "/step" << step;
-		serializeRaster(*it->second, oss.str());
+		serializeRaster(*it->second, it->first, step);
 	}
 }
 
@@ -716,9 +940,7 @@ void Serializer::serializeStaticRasters( const StaticRastersRefMap & staticRaste
 {
 	for(StaticRastersRefMap::const_iterator it=staticRasters.begin(); it!=staticRasters.end(); it++)
 	{
-		std::ostringstream oss;
-		oss << "/" << it->first << "/values";
-		serializeRaster(*it->second, oss.str());
+		serializeRaster(*it->second, it->first, -1);
 	}
 }
 
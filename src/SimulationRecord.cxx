@@ -31,32 +31,50 @@
 #include <vector>
 #include <cstdlib>
 #include <limits>
+#include <fstream>
+#include <algorithm>
+#include <omp.h>
 
 namespace Engine 
 {
 
-std::list<std::string> SimulationRecord::_agentTypes;
-std::list<std::string> SimulationRecord::_agentAttributes;
-
-SimulationRecord::SimulationRecord( int loadedResolution, bool gui) : _name("unknown"), _numSteps(0), _loadingStep(0), _loadedResolution(loadedResolution), _serializedResolution(1), _gui(gui), _loadingPercentageDone(0.0f), _loadingState("no load")
+SimulationRecord::SimulationRecord( int loadedResolution, bool gui) : _name("unknown"), _numSteps(0), _loadedResolution(loadedResolution), _serializedResolution(1), _gui(gui), _loadingPercentageDone(0.0f), _loadingState("no load"), _fileId(-1)
 {	
 }
 
 SimulationRecord::~SimulationRecord()
 {
+	_resources.clear();
+	if(_fileId>=0)
+	{
+		H5Fclose(_fileId);
+	}
+}
+
+void SimulationRecord::setRasterCacheSize( const size_t & rasterSteps )
+{
+	_rasterCache.setCapacity(rasterSteps);
+}
+
+size_t SimulationRecord::getRasterCacheSize() const
+{
+	return _rasterCache.getCapacity();
 }
 
 bool SimulationRecord::loadHDF5( const std::string & fileName, const bool & loadRasters, const bool & loadAgents )
 {
 	_loadingPercentageDone = 0.0f;
-	// TODO it deletes agent records?
-	for(AgentTypesMap::iterator it = _types.begin(); it!=_types.end(); it++)
-	{
-		it->second.clear();
-	}
 	_types.clear();
+	_pendingTypes.clear();
+	_agentsFiles.clear();
 
+	// histories read from the previous file
 	_resources.clear();
+	if(_fileId>=0)
+	{
+		H5Fclose(_fileId);
+		_fileId = -1;
+	}
 
 	_loadingState = "loading file: "+fileName+"...";
 	if(!_gui)
@@ -137,104 +155,28 @@ bool SimulationRecord::loadHDF5( const std::string & fileName, const bool & load
 			GeneralState::rasterLoader().fillHDF5Raster(it->second, fileName, it->first );
 		}
 
-		// dynamic rasters
+		// dynamic rasters are read the first time a step is needed, so the file stays open
 		hid_t rasterNamesDatasetId = H5Dopen(fileId, "rasters", H5P_DEFAULT);
 		int numRasters = H5Aget_num_attrs(rasterNamesDatasetId);
+		for(int i=0; i<numRasters; i++)
+		{
+			char nameAttribute[256];
+			attributeId= H5Aopen_idx(rasterNamesDatasetId, i);
+			H5Aget_name(attributeId, 256, nameAttribute);
+			_resources[nameAttribute].init(nameAttribute, fileId, numStepsToLoad, getFinalResolution(), _size, &_rasterCache);
+			H5Aclose(attributeId);
+		}
+		H5Dclose(rasterNamesDatasetId);
 		if(numRasters!=0)
 		{
-			for(int i=0; i<numRasters; i++)
-			{
-				char nameAttribute[256];
-				attributeId= H5Aopen_idx(rasterNamesDatasetId, i);
-				H5Aget_name(attributeId, 256, nameAttribute);
-				_resources.insert( make_pair( std::string(nameAttribute), RasterHistory()));
-				getRasterHistory(nameAttribute).resize(numStepsToLoad);
-				H5Aclose(attributeId);
-			}
-			H5Dclose(rasterNamesDatasetId);
-
-			_loadingPercentageDone = 20.0f; // from 20 to 50
-			float increase = 30.0f/(numRasters*numStepsToLoad);
-			for(RasterMap::iterator it=_resources.begin(); it!=_resources.end(); it++)
-			{
-				_loadingState = "loading dynamic raster: "+it->first;
-				if(!_gui)
-				{
-					std::cout << _loadingPercentageDone << "% - " << _loadingState << std::endl;
-				}
-				int maxValue = std::numeric_limits<int>::min();
-				int minValue = std::numeric_limits<int>::max();
-				for(int i=0; i<=_numSteps; i=i+getFinalResolution())
-				{
-					std::stringstream line;
-					line << "loading raster " << it->first << " - step: " << i << " : " << i/getFinalResolution() << "/" << _numSteps/getFinalResolution();
-					_loadingState = line.str();
-					if(!_gui)
-					{
-						std::cout << _loadingPercentageDone << "% - " << _loadingState << std::endl;
-					}
-
-					std::ostringstream oss;
-					oss << "/" << it->first << "/step" << i;
-					hid_t dset_id = H5Dopen(fileId, oss.str().c_str(), H5P_DEFAULT);
-					hid_t dataspaceId = H5Dget_space(dset_id);
-					hsize_t dims[2];
-					H5Sget_simple_extent_dims(dataspaceId, dims, NULL);
-					H5Sclose(dataspaceId);
-
-					int * dset_data = (int*)malloc(sizeof(int)*dims[0]*dims[1]);
-					
-					// squared	
-					DynamicRaster & raster = it->second[i/getFinalResolution()];
-					raster.resize(Size<int>(dims[0], dims[1]));
-					// TODO max value!
-					raster.setInitValues(std::numeric_limits<int>::min(),std::numeric_limits<int>::max(), 0);
-
-					H5Dread(dset_id, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, dset_data);
-					H5Dclose(dset_id);
-
-					for(size_t i=0; i<dims[0]; i++)
-					{
-						for(size_t j=0; j<dims[1]; j++)
-						{
-							size_t index = i+j*dims[0];
-							int value = dset_data[index];
-							if(value>raster.StaticRaster::getMaxValue())
-							{
-								raster.setMaxValue(value);
-							}
-							if(value>maxValue)
-							{
-								maxValue = value;
-							}
-							if(value<raster.getMinValue())
-							{
-								raster.setMinValue(value);
-							}
-							if(value<minValue)
-							{
-								minValue = value;
-							}
-							raster.setMaxValue(Point2D<int>(i,j), value);
-							raster.setValue(Point2D<int>(i,j), value); 
-						}
-					}
-					free(dset_data);
-					_loadingPercentageDone += increase;
-				}
-				// setting max value for the entire simulation
-				for(int i=0; i<=_numSteps; i=i+getFinalResolution())
-				{
-					DynamicRaster & raster = it->second.at(i/getFinalResolution());
-					raster.setMaxValue(maxValue);
-					raster.setMinValue(minValue);
-				
-				}
-			}
+			_fileId = fileId;
 		}
 	}
 
-	H5Fclose(fileId);
+	if(_fileId!=fileId)
+	{
+		H5Fclose(fileId);
+	}
 
 	_loadingPercentageDone = 50.0f;
 	_loadingState = "loading agents";
@@ -247,7 +189,7 @@ bool SimulationRecord::loadHDF5( const std::string & fileName, const bool & load
 	{
 		unsigned int filePos = fileName.find_last_of("/");
 		std::string path = fileName.substr(0,filePos+1);
-		loadAgentsFiles(path, numStepsToLoad, numTasks);
+		indexAgentsFiles(path, numTasks);
 	}
 	_loadingState = "no loading";
 	_loadingPercentageDone = 100.0f;
@@ -256,111 +198,154 @@ bool SimulationRecord::loadHDF5( const std::string & fileName, const bool & load
 
 void SimulationRecord::registerAgentTypes( const hid_t & rootGroup )
 {
-	H5Literate(rootGroup, H5_INDEX_NAME, H5_ITER_INC, 0, iterateAgentTypes, 0);
-	for(std::list<std::string>::iterator it=_agentTypes.begin(); it!=_agentTypes.end(); it++)
+	std::list<std::string> agentTypes;
+	H5Literate(rootGroup, H5_INDEX_NAME, H5_ITER_INC, 0, iterateAgentTypes, &agentTypes);
+	for(std::list<std::string>::iterator it=agentTypes.begin(); it!=agentTypes.end(); it++)
 	{
-		_types.insert( make_pair( *it, AgentRecordsMap()));
+		// types stored in more than one file keep the agents already registered
+		if(_types.find(*it)==_types.end())
+		{
+			_types[*it].init(*it, 1+_numSteps/getFinalResolution());
+		}
+		_pendingTypes.insert(*it);
 	}
 }
 
-hssize_t SimulationRecord::registerAgentIds( const hid_t & stepGroup, std::vector<std::string> & indexAgents, AgentRecordsMap & agents )
+bool SimulationRecord::readStringCodes( const hid_t & datasetId, hssize_t numElements, size_t dictionarySize, std::vector<int> & codes )
 {
-	hid_t datasetId = H5Dopen(stepGroup, "id", H5P_DEFAULT);						
-	hid_t stringType = H5Tcopy (H5T_C_S1);
-	H5Tset_size(stringType, H5T_VARIABLE);
-	
-	// get the number of elements
-	hid_t stringSpace = H5Dget_space(datasetId);
-	hssize_t numElements = H5Sget_simple_extent_npoints(stringSpace);
-
+	if(H5Aexists(datasetId, "dictionary")<=0)
+	{
+		return false;
+	}
+	codes.resize(numElements);
 	if(numElements==0)
 	{
-		H5Sclose(stringSpace);
-		H5Tclose(stringType);
-		H5Dclose(datasetId);
-		return numElements;
+		return true;
 	}
+	H5Dread(datasetId, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &codes[0]);
+	for(hssize_t i=0; i<numElements; i++)
+	{
+		if(codes[i]<0 || codes[i]>=(int)dictionarySize)
+		{
+			std::stringstream oss;
+			oss << "SimulationRecord::readStringCodes - code: " << codes[i] << " out of a dictionary of " << dictionarySize << " strings";
+			throw Exception(oss.str());
+		}
+	}
+	return true;
+}
 
-	char ** stringIds = (char **) malloc (numElements * sizeof (char *));	
-	H5Dread(datasetId, stringType, H5S_ALL, H5S_ALL, H5P_DEFAULT, stringIds);						
-				
-	for(int iAgent=0; iAgent<numElements; iAgent++)
+void SimulationRecord::readDictionary( const hid_t & agentsFileId, std::vector<std::string> & dictionary )
+{
+	dictionary.clear();
+	if(H5Lexists(agentsFileId, "dictionary", H5P_DEFAULT)<=0)
+	{
+		return;
+	}
+	hid_t datasetId = H5Dopen(agentsFileId, "dictionary", H5P_DEFAULT);
+	hid_t space = H5Dget_space(datasetId);
+	hssize_t numChars = H5Sget_simple_extent_npoints(space);
+	H5Sclose(space);
+	if(numChars>0)
 	{
-		std::string agentName(stringIds[iAgent]);	
-		indexAgents.push_back(agentName);
-		AgentRecordsMap::iterator it = agents.find(agentName);
-		// new agent
-		if(it==agents.end())
+		// strings stored one after the other, each one followed by '\0'
+		std::vector<char> buffer(numChars);
+		H5Dread(datasetId, H5T_NATIVE_CHAR, H5S_ALL, H5S_ALL, H5P_DEFAULT, &buffer[0]);
+		const char * begin = &buffer[0];
+		const char * last = begin+numChars;
+		while(begin!=last)
 		{
-			agents.insert( make_pair( agentName, new AgentRecord(agentName, 1+_numSteps/getFinalResolution())));
-			it = agents.find(agentName);
+			const char * end = std::find(begin, last, '\0');
+			dictionary.push_back(std::string(begin, end));
+			begin = end==last ? end : end+1;
 		}
-		AgentRecord * agentRecord = it->second;
-		// the agent exists in _loadingStep
-		agentRecord->addInt( _loadingStep/getFinalResolution(), "exists", true);
 	}
-	// clean memory
-	H5Dvlen_reclaim (stringType, stringSpace, H5P_DEFAULT, stringIds);
-	free (stringIds);
-	H5Sclose(stringSpace);
-	H5Tclose(stringType);
 	H5Dclose(datasetId);
-	return numElements;
 }
 
-void SimulationRecord::updateMinMaxAttributeValues( const std::string & key, int value )
-{	
-	IntAttributesMap::iterator itMin = _minIntValues.find(key);
-	// check if it is minimum value
-	if(itMin==_minIntValues.end())
+void SimulationRecord::readStrings( const hid_t & datasetId, hssize_t numElements, const std::vector<std::string> & dictionary, std::vector<std::string> & values )
+{
+	values.resize(numElements);
+	std::vector<int> codes;
+	if(readStringCodes(datasetId, numElements, dictionary.size(), codes))
 	{
-		_minIntValues.insert( make_pair(key, value));
+		for(hssize_t i=0; i<numElements; i++)
+		{
+			values[i] = dictionary[codes[i]];
+		}
+		return;
 	}
-	else if(value<itMin->second)
+	if(numElements==0)
 	{
-		itMin->second = value;
+		return;
 	}
-	
-	// check maximum value
-	IntAttributesMap::iterator itMax = _maxIntValues.find(key);
-	if(itMax==_maxIntValues.end())
+	hid_t fileType = H5Dget_type(datasetId);
+	// distributed runs store fixed width strings, as parallel HDF5 can't write variable length data
+	if(!H5Tis_variable_str(fileType))
 	{
-		_maxIntValues.insert( make_pair(key, value));
+		size_t width = H5Tget_size(fileType);
+		hid_t stringType = H5Tcopy(H5T_C_S1);
+		H5Tset_size(stringType, width);
+		std::vector<char> buffer(numElements*width);
+		H5Dread(datasetId, stringType, H5S_ALL, H5S_ALL, H5P_DEFAULT, &buffer[0]);
+		for(hssize_t i=0; i<numElements; i++)
+		{
+			const char * value = &buffer[i*width];
+			values[i].assign(value, std::find(value, value+width, '\0'));
+		}
+		H5Tclose(stringType);
+		H5Tclose(fileType);
+		return;
 	}
-	else if(value>itMax->second)
+	H5Tclose(fileType);
+
+	hid_t stringType = H5Tcopy (H5T_C_S1);
+	H5Tset_size(stringType, H5T_VARIABLE);
+	hid_t stringSpace = H5Dget_space(datasetId);
+	char ** strings = (char **) malloc (numElements * sizeof (char *));	
+	H5Dread(datasetId, stringType, H5S_ALL, H5S_ALL, H5P_DEFAULT, strings);
+	for(hssize_t i=0; i<numElements; i++)
 	{
-		itMax->second = value;
+		values[i] = strings[i];
 	}
+	// clean memory
+	H5Dvlen_reclaim (stringType, stringSpace, H5P_DEFAULT, strings);
+	free (strings);
+	H5Sclose(stringSpace);
+	H5Tclose(stringType);
 }
 
-void SimulationRecord::updateMinMaxAttributeValues( const std::string & key, float value )
-{	
-	FloatAttributesMap::iterator itMin = _minFloatValues.find(key);
-	// check if it is minimum value
-	if(itMin==_minFloatValues.end())
-	{
-		_minFloatValues.insert( make_pair(key, value));
-	}
-	else if(value<itMin->second)
+void SimulationRecord::readAgentStep( const hid_t & agentsFileId, const std::string & type, int serializedStep, const std::vector<std::string> & dictionary, AgentStepData & data )
+{
+	std::ostringstream oss;
+	oss << "/" << type << "/step" << serializedStep;
+	// no group if the type was registered after this step or the run stopped before it
+	if(H5Lexists(agentsFileId, oss.str().c_str(), H5P_DEFAULT)<=0)
 	{
-		itMin->second = value;
+		return;
 	}
-	
-	// check maximum value
-	FloatAttributesMap::iterator itMax = _maxFloatValues.find(key);
-	if(itMax==_maxFloatValues.end())
+	hid_t stepGroup = H5Gopen(agentsFileId, oss.str().c_str(), H5P_DEFAULT);
+	// register the attributes
+	std::list<std::string> attributes;
+	H5Literate(stepGroup, H5_INDEX_NAME, H5_ITER_INC, 0, iterateAgentDatasets, &attributes);
+
+	hid_t datasetId = H5Dopen(stepGroup, "id", H5P_DEFAULT);						
+	hid_t stringSpace = H5Dget_space(datasetId);
+	hssize_t numElements = H5Sget_simple_extent_npoints(stringSpace);
+	H5Sclose(stringSpace);
+	// dictionary encoded ids are joined with the table by their code, looking up each name only the first time it appears
+	if(!readStringCodes(datasetId, numElements, dictionary.size(), data._idCodes))
 	{
-		_maxFloatValues.insert( make_pair(key, value));
+		readStrings(datasetId, numElements, dictionary, data._ids);
 	}
-	else if(value>itMax->second)
+	H5Dclose(datasetId);
+	if(numElements==0)
 	{
-		itMax->second = value;
+		H5Gclose(stepGroup);
+		return;
 	}
-}
 
-void SimulationRecord::loadAttributes( const hid_t & stepGroup, hssize_t & numElements, const std::vector<std::string> & indexAgents, AgentRecordsMap & agents )
-{
-	for(std::list<std::string>::iterator itA=_agentAttributes.begin(); itA!=_agentAttributes.end(); itA++)
+	for(std::list<std::string>::iterator itA=attributes.begin(); itA!=attributes.end(); itA++)
 	{
 		// id already parsed
 		if((*itA).compare("id")==0)
@@ -370,129 +355,374 @@ void SimulationRecord::loadAttributes( const hid_t & stepGroup, hssize_t & numEl
 		hid_t attributeDatasetId = H5Dopen(stepGroup, (*itA).c_str(), H5P_DEFAULT);
 		hid_t typeAttribute = H5Dget_type(attributeDatasetId);
 		H5T_class_t typeClass = H5Tget_class(typeAttribute);
-		if(typeClass== H5T_INTEGER)
+		// dictionary encoded strings are stored as integer codes
+		if(typeClass== H5T_STRING || H5Aexists(attributeDatasetId, "dictionary")>0)
 		{
-			std::vector<int> data;
-			data.resize(numElements);
-			H5Dread(attributeDatasetId, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(data.at(0)));
-			for(int iAgent=0; iAgent<numElements; iAgent++)
+			data._strNames.push_back(*itA);
+			data._strCodes.push_back(std::vector<int>());
+			data._strs.push_back(std::vector<std::string>());
+			if(!readStringCodes(attributeDatasetId, numElements, dictionary.size(), data._strCodes.back()))
 			{
-				std::string agentName = indexAgents.at(iAgent);
-				AgentRecordsMap::iterator it = agents.find(agentName);
-				AgentRecord * agentRecord = it->second;
-				agentRecord->addInt( _loadingStep/getFinalResolution(), *itA, data.at(iAgent));
-				updateMinMaxAttributeValues(*itA, data.at(iAgent));
+				readStrings(attributeDatasetId, numElements, dictionary, data._strs.back());
 			}
 		}
-		else if(typeClass== H5T_STRING)
+		else if(typeClass== H5T_INTEGER)
 		{
-            hid_t stringType = H5Tcopy (H5T_C_S1);
-        	H5Tset_size(stringType, H5T_VARIABLE);
-            
-            char ** stringIds = (char **) malloc (numElements * sizeof (char *));	
-            H5Dread(attributeDatasetId, stringType, H5S_ALL, H5S_ALL, H5P_DEFAULT, stringIds);
-            for(int iAgent=0; iAgent<numElements; iAgent++)
-			{	
-                std::string agentName = indexAgents.at(iAgent);
-				AgentRecordsMap::iterator it = agents.find(agentName);
-				AgentRecord * agentRecord = it->second;
-				agentRecord->addStr( _loadingStep/getFinalResolution(), *itA, std::string(stringIds[iAgent]));
-            }
+			data._intNames.push_back(*itA);
+			data._ints.push_back(std::vector<int>(numElements));
+			H5Dread(attributeDatasetId, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(data._ints.back().at(0)));
 		}
         else if(typeClass== H5T_FLOAT)
 		{	
-            std::vector<float> data;
-			data.resize(numElements);
-			H5Dread(attributeDatasetId, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(data.at(0)));
-			for(int iAgent=0; iAgent<numElements; iAgent++)
-			{
-				std::string agentName = indexAgents.at(iAgent);
-				AgentRecordsMap::iterator it = agents.find(agentName);
-				AgentRecord * agentRecord = it->second;
-				agentRecord->addFloat( _loadingStep/getFinalResolution(), *itA, data.at(iAgent));
-				updateMinMaxAttributeValues(*itA, data.at(iAgent));
-			}
+			data._floatNames.push_back(*itA);
+			data._floats.push_back(std::vector<float>(numElements));
+			H5Dread(attributeDatasetId, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &(data._floats.back().at(0)));
 		}
 		else
 		{
+			H5Tclose(typeAttribute);
+			H5Dclose(attributeDatasetId);
+			H5Gclose(stepGroup);
 			std::stringstream oss;
-			oss << "SimulationRecord::loadHDF5 - loading attribute: " << *itA << " of unknown type";
+			oss << "SimulationRecord::readAgentStep - loading attribute: " << *itA << " of unknown type";
 			throw Exception(oss.str());
 		}
 		H5Tclose(typeAttribute);
 		H5Dclose(attributeDatasetId);
 	}
+	H5Gclose(stepGroup);
+}
+
+void SimulationRecord::computeRanges( AgentStepData & data )
+{
+	data._intRanges.resize(data._ints.size());
+	for(size_t i=0; i<data._ints.size(); i++)
+	{
+		std::pair<std::vector<int>::const_iterator, std::vector<int>::const_iterator> minMax = std::minmax_element(data._ints[i].begin(), data._ints[i].end());
+		data._intRanges[i] = std::make_pair(*minMax.first, *minMax.second);
+	}
+	data._floatRanges.resize(data._floats.size());
+	for(size_t i=0; i<data._floats.size(); i++)
+	{
+		std::pair<std::vector<float>::const_iterator, std::vector<float>::const_iterator> minMax = std::minmax_element(data._floats[i].begin(), data._floats[i].end());
+		data._floatRanges[i] = std::make_pair(*minMax.first, *minMax.second);
+	}
 }
 
-void SimulationRecord::loadAgentsFiles( const std::string & path, int numStepsToLoad, int numTasks  )
+void SimulationRecord::mergeAgentStep( AgentStepData & data, const std::vector<std::string> & dictionary, std::vector<int> & codeAgents, std::vector<int> & codeStrings, AgentTable & agents )
 {
-	// we need to store in numsteps the working step, in order to access it from H5Giterate
-	if(numStepsToLoad==0 || numTasks==0)
+	size_t numAgents = data._idCodes.size()+data._ids.size();
+	data._indices.resize(numAgents);
+	if(!data._idCodes.empty())
+	{
+		codeAgents.resize(dictionary.size(), -1);
+		for(size_t i=0; i<numAgents; i++)
+		{
+			int & index = codeAgents[data._idCodes[i]];
+			if(index==-1)
+			{
+				index = agents.addAgent(dictionary[data._idCodes[i]]);
+			}
+			data._indices[i] = index;
+		}
+	}
+	else
+	{
+		for(size_t i=0; i<numAgents; i++)
+		{
+			data._indices[i] = agents.addAgent(data._ids[i]);
+		}
+	}
+	if(numAgents==0)
 	{
 		return;
 	}
-	for(int i=0; i<numTasks; i++)
+
+	// the agents exist in this step
+	std::vector<int> & exists = agents.getIntStep(agents.getExistsColumn(), data._step);
+	for(size_t i=0; i<numAgents; i++)
 	{
-		std::ostringstream agentsFileName;
-		agentsFileName << path << "agents-" << i<< ".abm";
+		exists[data._indices[i]] = 1;
+	}
 
-		// open a file for each original computer node
-		hid_t agentsFileId = H5Fopen(agentsFileName.str().c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);				
+	// the columns of the step are sized to the agents registered so far. Agents of later steps do not resize them, so storeAgentStep can fill them while other steps are merged
+	data._intTargets.resize(data._ints.size());
+	for(size_t i=0; i<data._ints.size(); i++)
+	{
+		data._intTargets[i] = &agents.getIntStep(agents.addIntColumn(data._intNames[i]), data._step)[0];
+		updateMinMaxAttributeValues(data._intNames[i], data._intRanges[i].first, data._intRanges[i].second);
+	}
+	data._floatTargets.resize(data._floats.size());
+	for(size_t i=0; i<data._floats.size(); i++)
+	{
+		data._floatTargets[i] = &agents.getFloatStep(agents.addFloatColumn(data._floatNames[i]), data._step)[0];
+		updateMinMaxAttributeValues(data._floatNames[i], data._floatRanges[i].first, data._floatRanges[i].second);
+	}
+	data._strTargets.resize(data._strCodes.size());
+	for(size_t i=0; i<data._strCodes.size(); i++)
+	{
+		std::vector<int> & codes = data._strCodes[i];
+		const std::vector<std::string> & strings = data._strs[i];
+		if(!strings.empty())
+		{
+			codes.resize(numAgents);
+			for(size_t iAgent=0; iAgent<numAgents; iAgent++)
+			{
+				codes[iAgent] = agents.encodeString(strings[iAgent]);
+			}
+		}
+		else
+		{
+			codeStrings.resize(dictionary.size(), -1);
+			for(size_t iAgent=0; iAgent<numAgents; iAgent++)
+			{
+				int & code = codeStrings[codes[iAgent]];
+				if(code==-1)
+				{
+					code = agents.encodeString(dictionary[codes[iAgent]]);
+				}
+				codes[iAgent] = code;
+			}
+		}
+		data._strTargets[i] = &agents.getStrStep(agents.addStrColumn(data._strNames[i]), data._step)[0];
+	}
+}
+
+void SimulationRecord::storeAgentStep( const AgentStepData & data )
+{
+	const std::vector<int> & indices = data._indices;
+	for(size_t i=0; i<data._ints.size(); i++)
+	{
+		int * values = data._intTargets[i];
+		const std::vector<int> & source = data._ints[i];
+		for(size_t iAgent=0; iAgent<indices.size(); iAgent++)
+		{
+			values[indices[iAgent]] = source[iAgent];
+		}
+	}
+	for(size_t i=0; i<data._floats.size(); i++)
+	{
+		float * values = data._floatTargets[i];
+		const std::vector<float> & source = data._floats[i];
+		for(size_t iAgent=0; iAgent<indices.size(); iAgent++)
+		{
+			values[indices[iAgent]] = source[iAgent];
+		}
+	}
+	for(size_t i=0; i<data._strCodes.size(); i++)
+	{
+		int * values = data._strTargets[i];
+		const std::vector<int> & source = data._strCodes[i];
+		for(size_t iAgent=0; iAgent<indices.size(); iAgent++)
+		{
+			values[indices[iAgent]] = source[iAgent];
+		}
+	}
+}
+
+void SimulationRecord::updateMinMaxAttributeValues( const std::string & key, int minValue, int maxValue )
+{	
+	IntAttributesMap::iterator itMin = _minIntValues.find(key);
+	// check if it is minimum value
+	if(itMin==_minIntValues.end())
+	{
+		_minIntValues.insert( make_pair(key, minValue));
+	}
+	else if(minValue<itMin->second)
+	{
+		itMin->second = minValue;
+	}
+	
+	// check maximum value
+	IntAttributesMap::iterator itMax = _maxIntValues.find(key);
+	if(itMax==_maxIntValues.end())
+	{
+		_maxIntValues.insert( make_pair(key, maxValue));
+	}
+	else if(maxValue>itMax->second)
+	{
+		itMax->second = maxValue;
+	}
+}
+
+void SimulationRecord::updateMinMaxAttributeValues( const std::string & key, float minValue, float maxValue )
+{	
+	FloatAttributesMap::iterator itMin = _minFloatValues.find(key);
+	// check if it is minimum value
+	if(itMin==_minFloatValues.end())
+	{
+		_minFloatValues.insert( make_pair(key, minValue));
+	}
+	else if(minValue<itMin->second)
+	{
+		itMin->second = minValue;
+	}
+	
+	// check maximum value
+	FloatAttributesMap::iterator itMax = _maxFloatValues.find(key);
+	if(itMax==_maxFloatValues.end())
+	{
+		_maxFloatValues.insert( make_pair(key, maxValue));
+	}
+	else if(maxValue>itMax->second)
+	{
+		itMax->second = maxValue;
+	}
+}
+
+void SimulationRecord::indexAgentsFiles( const std::string & path, int numTasks )
+{
+	// runs store every agent in a single file, while old ones have a file for each task
+	std::string sharedFile = path+"agents.abm";
+	if(std::ifstream(sharedFile.c_str()).good())
+	{
+		_agentsFiles.push_back(sharedFile);
+	}
+	else
+	{
+		for(int i=0; i<numTasks; i++)
+		{
+			std::ostringstream agentsFileName;
+			agentsFileName << path << "agents-" << i<< ".abm";
+			_agentsFiles.push_back(agentsFileName.str());
+		}
+	}
+
+	// agents are loaded by loadAgentType the first time their type is needed
+	for(size_t i=0; i<_agentsFiles.size(); i++)
+	{
+		hid_t agentsFileId = H5Fopen(_agentsFiles[i].c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);				
 		hid_t rootGroup = H5Gopen(agentsFileId, "/", H5P_DEFAULT);
-		
-		// get type names
 		registerAgentTypes(rootGroup);
-		float increase = 50.0f/(numTasks*_types.size()*numStepsToLoad);
+		H5Gclose(rootGroup);
+		H5Fclose(agentsFileId);
+	}
+}
+
+void SimulationRecord::loadPendingTypes() const
+{
+	while(!_pendingTypes.empty())
+	{
+		loadAgentType(*_pendingTypes.begin());
+	}
+}
 
-		// for each type check the agents in each loaded time step
-		// we use _agentTypes because _types contains the whole list of agent types of the entire simulation
-		// _agentTypes only has the agents of this particular computer node file
-		for(std::list< std::string >::iterator typeAgent=_agentTypes.begin(); typeAgent!=_agentTypes.end(); typeAgent++)
+void SimulationRecord::loadAgentType( const std::string & type ) const
+{
+	std::set<std::string>::iterator itPending = _pendingTypes.find(type);
+	if(itPending==_pendingTypes.end())
+	{
+		return;
+	}
+	_pendingTypes.erase(itPending);
+	// loading fills the records and the attribute ranges, which are part of the logical state of a const record
+	SimulationRecord * record = const_cast<SimulationRecord *>(this);
+	record->loadAgentType(type, record->_types.find(type)->second);
+}
+
+void SimulationRecord::loadAgentType( const std::string & type, AgentTable & agents )
+{
+	int numFiles = _agentsFiles.size();
+	int numSteps = 1+_numSteps/getFinalResolution();
+	// steps are read in batches by OpenMP threads; the size bounds the memory of the steps read but not stored yet
+	int batchSize = 4*omp_get_max_threads();
+	std::vector<AgentStepData> batch;
+	std::vector<std::string> dictionary;
+	std::string error;
+	for(int i=0; i<numFiles && error.empty(); i++)
+	{
+		// open a file for each original computer node
+		hid_t agentsFileId = H5Fopen(_agentsFiles[i].c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);				
+		// types registered by other computer nodes
+		if(H5Lexists(agentsFileId, type.c_str(), H5P_DEFAULT)<=0)
 		{
-			AgentTypesMap::iterator typeIt = _types.find(*typeAgent);
-			for(_loadingStep=0; _loadingStep<=_numSteps; _loadingStep=_loadingStep+getFinalResolution())
+			H5Fclose(agentsFileId);
+			continue;
+		}
+		readDictionary(agentsFileId, dictionary);
+
+		// indices of the agents of this type and codes of the strings, by their code in the file dictionary
+		std::vector<int> codeAgents;
+		std::vector<int> codeStrings;
+		// a batch never holds the same step twice, as the columns of a step are resized when it is merged
+		for(int first=0; first<numSteps && error.empty(); first+=batchSize)
+		{
+			int numBatchSteps = std::min(batchSize, numSteps-first);
+			batch.assign(numBatchSteps, AgentStepData());
+			#pragma omp parallel for schedule(dynamic) ordered
+			for(int j=0; j<numBatchSteps; j++)
 			{
-				std::stringstream line;
-				line << "loading agents of type: " << *typeAgent << " in task: "<< i+1 << "/" << numTasks << " - step: " << _loadingStep/getFinalResolution() << "/" << _numSteps/getFinalResolution();
-				_loadingState = line.str();
-				if(!_gui)
+				AgentStepData & data = batch[j];
+				data._file = i;
+				data._step = first+j;
+				// the HDF5 library is not reentrant, so only the work done with the values read runs in parallel
+				#pragma omp critical(hdf5)
+				{
+					try
+					{
+						readAgentStep(agentsFileId, type, data._step*getFinalResolution(), dictionary, data);
+					}
+					catch(std::exception & exception)
+					{
+						data._error = exception.what();
+					}
+				}
+				computeRanges(data);
+
+				// tables are filled in step order, so agent indices do not depend on the number of threads
+				#pragma omp ordered
 				{
-					std::cout << _loadingPercentageDone << "% - " << _loadingState << std::endl;
+					if(data._error.empty() && error.empty())
+					{
+						mergeAgentStep(data, dictionary, codeAgents, codeStrings, agents);
+					}
+					else if(error.empty())
+					{
+						error = data._error;
+					}
+					std::stringstream line;
+					line << "loading agents of type: " << type << " in file: "<< i+1 << "/" << numFiles << " - step: " << data._step << "/" << numSteps-1;
+					_loadingState = line.str();
+					_loadingPercentageDone = 100.0f*(i*numSteps+data._step+1)/(numFiles*numSteps);
+					if(!_gui)
+					{
+						std::cout << _loadingState << std::endl;
+					}
 				}
-				
-				std::ostringstream oss;
-				oss << "/" << typeIt->first << "/step" << _loadingStep;
-
-				hid_t stepGroup = H5Gopen(agentsFileId, oss.str().c_str(), H5P_DEFAULT);
-				// register the attributes
-				H5Literate(stepGroup, H5_INDEX_NAME, H5_ITER_INC, 0, iterateAgentDatasets, 0);
-				
-				std::vector<std::string> indexAgents;
-				hssize_t numElement = registerAgentIds(stepGroup, indexAgents, typeIt->second );
-				if(numElement!=0)
+				if(!data._indices.empty())
 				{
-					loadAttributes(stepGroup, numElement, indexAgents, typeIt->second);
+					storeAgentStep(data);
 				}
-				_loadingPercentageDone += increase;
-				H5Gclose(stepGroup);
-				SimulationRecord::_agentAttributes.clear();
 			}
 		}
-		H5Gclose(rootGroup);
 		H5Fclose(agentsFileId);
-		SimulationRecord::_agentTypes.clear();
+	}
+	_loadingState = "no loading";
+	if(!error.empty())
+	{
+		throw Exception(error);
 	}
 }
 
 herr_t SimulationRecord::iterateAgentDatasets( hid_t loc_id, const char * name, const H5L_info_t *linfo, void *opdata )
 {
-	SimulationRecord::_agentAttributes.push_back(name);	
+	std::list<std::string> * attributes = (std::list<std::string> *)opdata;
+	attributes->push_back(name);
 	return 0;
 }
 
 herr_t SimulationRecord::iterateAgentTypes( hid_t loc_id, const char * name, const H5L_info_t *linfo, void *opdata )
 {
-	SimulationRecord::_agentTypes.push_back(name);	
+	// agent types are groups, while the dictionary of strings is a dataset
+	hid_t objectId = H5Oopen(loc_id, name, H5P_DEFAULT);
+	H5I_type_t objectType = H5Iget_type(objectId);
+	H5Oclose(objectId);
+	if(objectType!=H5I_GROUP)
+	{
+		return 0;
+	}
+	std::list<std::string> * agentTypes = (std::list<std::string> *)opdata;
+	agentTypes->push_back(name);	
 	return 0;
 }
 	
@@ -623,7 +853,8 @@ SimulationRecord::AgentRecordsMap::const_iterator SimulationRecord::beginAgents(
 		oss << "SimulationRecord::beginAgents - asking for type " << type;
 		throw Exception(oss.str());
 	}	
-	return it->second.begin();
+	loadAgentType(type);
+	return it->second.beginRecords();
 }
 
 SimulationRecord::AgentRecordsMap::const_iterator SimulationRecord::endAgents( const std::string & type ) const
@@ -635,17 +866,20 @@ SimulationRecord::AgentRecordsMap::const_iterator SimulationRecord::endAgents( c
 		oss << "SimulationRecord::endAgents- asking for type " << type;
 		throw Exception(oss.str());
 	}	
-	return it->second.end();
+	loadAgentType(type);
+	return it->second.endRecords();
 }
 
 SimulationRecord::AgentRecordsMap::const_iterator SimulationRecord::beginAgents( AgentTypesMap::const_iterator & it ) const
 {
-	return it->second.begin();
+	loadAgentType(it->first);
+	return it->second.beginRecords();
 }
 
 SimulationRecord::AgentRecordsMap::const_iterator SimulationRecord::endAgents( AgentTypesMap::const_iterator & it ) const
 {
-	return it->second.end();
+	loadAgentType(it->first);
+	return it->second.endRecords();
 }
 
 SimulationRecord::RasterMap::const_iterator SimulationRecord::beginRasters() const
@@ -671,94 +905,67 @@ SimulationRecord::StaticRasterMap::const_iterator SimulationRecord::endStaticRas
 SimulationRecord::AgentRecordsVector SimulationRecord::getAgentsAtPosition( int step, const Point2D<int> & position ) const	
 {
 	AgentRecordsVector results;
+	std::vector<int> indices;
 	for(AgentTypesMap::const_iterator itType=_types.begin(); itType!=_types.end(); itType++)
 	{
-		for(AgentRecordsMap::const_iterator it=beginAgents(itType); it!=endAgents(itType); it++)
+		loadAgentType(itType->first);
+		const AgentTable & agents = itType->second;
+		indices.clear();
+		agents.getAgentsAt(step, position, indices);
+		for(size_t i=0; i<indices.size(); i++)
 		{
-			AgentRecord * agentRecord = it->second;	
-			int x = agentRecord->getInt(step, "x");
-			int y = agentRecord->getInt(step, "y");
-			if(x==position._x && y==position._y)
-			{
-				results.push_back(agentRecord);
-			}
+			results.push_back(const_cast<AgentRecord *>(&agents.getRecord(indices[i])));
 		}
 	}
 	return results;
 }
 
-double SimulationRecord::getMean( const std::string & type, const std::string & attribute, int step )
+const AgentTable & SimulationRecord::getAgentTable( const std::string & method, const std::string & type ) const
 {
-	double value = 0;
-	int sample = 0;
-	AgentTypesMap::iterator itType = _types.find(type);
+	AgentTypesMap::const_iterator itType = _types.find(type);
 	if(itType==_types.end())
 	{
 		std::stringstream oss;
-		oss << "SimulationRecord::getMean - asking for attribute: " << attribute<< " in type " << type;
+		oss << "SimulationRecord::" << method << " - asking for unknown type: " << type;
 		throw Exception(oss.str());
 	}
-	AgentRecordsMap agents = itType->second;
-	for(AgentRecordsMap::iterator it=agents.begin(); it!=agents.end(); it++)
-	{
-		AgentRecord * agentRecord = it->second;	
-		bool exists = agentRecord->getInt(step, "exists");
-		if(!exists)
-		{
-            continue;
-        }
-        float agentValue = 0.0f;
-        if(agentRecord->isInt(attribute))
-        {
-			agentValue = agentRecord->getInt(step, attribute);
-        }
-        else if(agentRecord->isFloat(attribute))
-        {
-			agentValue = agentRecord->getFloat(step, attribute);
-        }
-        value += agentValue;
-	    sample++;
-	}
-	value = value/sample;
-	return value;
+	loadAgentType(type);
+	return itType->second;
+}
+
+double SimulationRecord::getMean( const std::string & type, const std::string & attribute, int step )
+{
+	return getStats(type, attribute, step, step).getMean();
 }
 
 double SimulationRecord::getSum( const std::string & type, const std::string & attribute, int step )
 {
-	double value = 0;
-	
-	AgentTypesMap::iterator itType = _types.find(type);
-	if(itType==_types.end())
-	{
-		std::stringstream oss;
-		oss << "SimulationRecord::getSum - asking for attribute: " << attribute << " in type " << type;
-		throw Exception(oss.str());
-	}
-	AgentRecordsMap agents = itType->second;
-	for(AgentRecordsMap::iterator it=agents.begin(); it!=agents.end(); it++)
-	{
-		AgentRecord * agentRecord = it->second;	
-		bool exists = agentRecord->getInt(step, "exists");
-		if(!exists)
-		{
-            continue;
-        }
-        float agentValue = 0.0f;
-        if(agentRecord->isInt(attribute))
-        {
-			agentValue = agentRecord->getInt(step, attribute);
-        }
-        else if(agentRecord->isFloat(attribute))
-        {
-			agentValue = agentRecord->getFloat(step, attribute);
-        }
-        value += agentValue;
-	}
-	return value;
+	return getStats(type, attribute, step, step)._sum;
+}
+
+AttributeStats SimulationRecord::getStats( const std::string & type, const std::string & attribute, int firstStep, int lastStep ) const
+{
+	AttributeStats stats;
+	getAgentTable("getStats", type).aggregate(attribute, firstStep, lastStep, stats);
+	return stats;
+}
+
+size_t SimulationRecord::getCount( const std::string & type, int firstStep, int lastStep ) const
+{
+	return getStats(type, "exists", firstStep, lastStep)._count;
+}
+
+std::vector<size_t> SimulationRecord::getHistogram( const std::string & type, const std::string & attribute, int firstStep, int lastStep, double minValue, double interval ) const
+{
+	std::vector<size_t> bins;
+	getAgentTable("getHistogram", type).histogram(attribute, firstStep, lastStep, minValue, interval, bins);
+	return bins;
 }
 
 int SimulationRecord::getMinInt( const std::string & attribute)
 {
+	// ranges include every agent type
+	loadPendingTypes();
 	IntAttributesMap::iterator it = _minIntValues.find(attribute);
 	if(it==_minIntValues.end())
 	{
@@ -771,6 +978,8 @@ int SimulationRecord::getMinInt( const std::string & attribute)
 
 float SimulationRecord::getMinFloat( const std::string & attribute)
 {
+	// ranges include every agent type
+	loadPendingTypes();
 	FloatAttributesMap::iterator it = _minFloatValues.find(attribute);
 	if(it==_minFloatValues.end())
 	{
@@ -782,7 +991,9 @@ float SimulationRecord::getMinFloat( const std::string & attribute)
 }
 
 int SimulationRecord::getMaxInt( const std::string & attribute)
-{	
+{		// ranges include every agent type
+	loadPendingTypes();
+
 	IntAttributesMap::iterator it = _maxIntValues.find(attribute);
 	if(it==_maxIntValues.end())
 	{
@@ -795,7 +1006,9 @@ int SimulationRecord::getMaxInt( const std::string & attribute)
 }
 
 float SimulationRecord::getMaxFloat( const std::string & attribute)
-{	
+{		// ranges include every agent type
+	loadPendingTypes();
+
 	FloatAttributesMap::iterator it = _maxFloatValues.find(attribute);
 	if(it==_maxFloatValues.end())
 	{
@@ -24,12 +24,15 @@
 #include <MpiFactory.hxx>
 #include <Logger.hxx>
 #include <Exception.hxx>
+#include <Statistics.hxx>
 #include <Config.hxx>
+#include <DynamicRaster.hxx>
+#include <algorithm>
 
 namespace Engine
 {
 
-SpacePartition::SpacePartition( const int & overlap, bool finalize ) : _serializer(*this), _worldPos(-1,-1), _overlap(overlap), _finalize(finalize), _initialTime(0.0f)
+SpacePartition::SpacePartition( const int & overlap, bool finalize, bool parallelActions, int rebalancePeriod ) : _serializer(*this), _worldPos(-1,-1), _parallelActions(parallelActions && overlap>0), _overlap(overlap), _rebalancePeriod(rebalancePeriod), _agentsTime(0.0f), _environmentTime(0.0f), _lastStepEnd(-1.0f), _finalize(finalize), _initialTime(0.0f)
 {
 }
 
@@ -39,27 +42,70 @@ SpacePartition::~SpacePartition()
 
 void SpacePartition::init( int argc, char *argv[] )
 {
+	// the serialization thread (and the progress thread in hybrid mode) call MPI concurrently with the main thread; if MPI doesn't provide this level both fall back to the main thread
+	int requiredThreadLevel = MPI_THREAD_MULTIPLE;
+	int threadLevel = MPI_THREAD_SINGLE;
 	int alreadyInitialized;
 	MPI_Initialized(&alreadyInitialized);
 	if(!alreadyInitialized)
 	{
-		MPI_Init(&argc, &argv);
+		MPI_Init_thread(&argc, &argv, requiredThreadLevel, &threadLevel);
+	}
+	else
+	{
+		MPI_Query_thread(&threadLevel);
 	}
 	_initialTime = getWallTime();
 
 	MPI_Comm_size(MPI_COMM_WORLD, &_numTasks);
 	MPI_Comm_rank(MPI_COMM_WORLD,&_id);	
 	std::cout << "simulation: " << _id << " of: " << _numTasks << " initialized" << std::endl;
+
+	std::stringstream logName;
+	logName << "simulation_" << _id;
+	if(_parallelActions)
+	{
+		if(threadLevel>=MPI_THREAD_MULTIPLE)
+		{
+			// every request that may be pending while a section is executed
+			_progressThread.watch(_migrationRequests);
+			_progressThread.watch(_ghostRequests);
+			_progressThread.watch(_overlapExchange.getRequests());
+			for(int i=0; i<4; i++)
+			{
+				_progressThread.watch(_sectionExchanges[i].getRequests());
+			}
+			_progressThread.start();
+		}
+		else
+		{
+			log_INFO(logName.str(), getWallTime() << " MPI thread level: " << threadLevel << " doesn't support MPI_THREAD_MULTIPLE, running without progress thread");
+		}
+	}
 	stablishBoundaries();
+	_spatialIndex.resize(_boundaries);
+	if(_parallelActions)
+	{
+		_executor.resize(_boundaries, _overlap, _spatialIndex.getCellSize());
+	}
 }
 
 void SpacePartition::initData()
 {
-	// serializer init
-	_serializer.init(*_world);
-
 	// mpi type registering
 	MpiFactory::instance()->registerTypes();
+
+	// agents could have been placed without notifying the scheduler
+	_spatialIndex.updateAll();
+
+	// initial boundaries are balanced by the number of agents of each task
+	if(_rebalancePeriod>0)
+	{
+		rebalance(false);
+	}
+
+	// serializer init
+	_serializer.init(*_world);
 	initOverlappingData();
 
 	std::stringstream logName;
@@ -80,54 +126,36 @@ void SpacePartition::checkOverlapSize()
 }
 
 void SpacePartition::stablishBoundaries()
+{
+	// partitions must contain 4 sections of at least twice the overlap
+	_decomposition.init(_world->getConfig().getSize(), _numTasks, 4*_overlap);
+	updateBoundaries();
+}
+
+void SpacePartition::updateBoundaries()
 {
 	// position of world related to the complete set of computer nodes
-	int worldsPerRow = sqrt(_numTasks);
 	_worldPos = getPositionFromId(_id);
+	const Size<int> & numPartitions = _decomposition.getNumPartitions();
 
+	_neighbors.clear();
 	for(int x=_worldPos._x-1; x<=_worldPos._x+1; x++)
 	{
 		for(int y=_worldPos._y-1; y<=_worldPos._y+1; y++)
 		{
-			if(x>-1 && x<worldsPerRow && y>-1 && y<worldsPerRow)
+			if(x>-1 && x<numPartitions._width && y>-1 && y<numPartitions._height)
 			{
 				if(x!=_worldPos._x || y!=_worldPos._y)
 				{
-					_neighbors.push_back(y*worldsPerRow+x);
+					_neighbors.push_back(y*numPartitions._width+x);
 				}
 			}
 		}
 	}
-	// owned area inside global coordinates, depending on worldPos
-	_ownedArea._size._width = _world->getConfig().getSize()._width/sqrt(_numTasks);
-	_ownedArea._size._height = _world->getConfig().getSize()._height/sqrt(_numTasks);
-	_ownedArea._origin._x = _worldPos._x*_ownedArea._size._width;
-	_ownedArea._origin._y = _worldPos._y*_ownedArea._size._height;
+	// owned area inside global coordinates, and boundaries including overlap
+	_ownedArea = _decomposition.getArea(_id);
+	_boundaries = _decomposition.getBoundaries(_id, _overlap);
 
-	// defining overlap boundaries
-	_boundaries = _ownedArea;
-	// west boundary
-	if(_ownedArea._origin._x!=0)
-	{
-		_boundaries._origin._x -= _overlap;
-		_boundaries._size._width += _overlap;
-	}
-	// east boundary
-	if(_ownedArea._origin._x!=_world->getConfig().getSize()._width-_ownedArea._size._width)
-	{
-		_boundaries._size._width += _overlap;
-	}
-	// north boundary
-	if(_ownedArea._origin._y!=0)
-	{
-		_boundaries._origin._y -= _overlap;
-		_boundaries._size._height += _overlap;
-	}
-	// south boundary
-	if(_ownedArea._origin._y!=_world->getConfig().getSize()._height-_ownedArea._size._height)
-	{
-		_boundaries._size._height += _overlap;
-	}
 	// creating sections
 	_sections.resize(4);
 	_sections[0] = Rectangle<int>(_ownedArea._size/2, _ownedArea._origin);
@@ -145,11 +173,11 @@ void SpacePartition::stablishBoundaries()
 
 	std::stringstream logName;
 	logName << "simulation_" << _id;
-	log_INFO(logName.str(), getWallTime() << " pos: " << _worldPos << ", global size: " << _world->getConfig().getSize() << ", boundaries: " << _boundaries << " and owned area: " << _ownedArea);
+	log_INFO(logName.str(), getWallTime() << " pos: " << _worldPos << " of grid: " << numPartitions << ", global size: " << _world->getConfig().getSize() << ", boundaries: " << _boundaries << " and owned area: " << _ownedArea);
 	log_INFO(logName.str(), getWallTime() << " sections 0: " << _sections[0] << " - 1: " << _sections[1] << " - 2:" << _sections[2] << " - 3: " << _sections[3]);
 }
 
-void SpacePartition::stepSection( const int & sectionIndex )
+void SpacePartition::stepSection( const int & sectionIndex, AgentsList & agentsToSend )
 {
 	std::stringstream logName;
 	logName << "simulation_" << _id;
@@ -168,13 +196,11 @@ void SpacePartition::stepSection( const int & sectionIndex )
 		}
 		it++;
 	}
-	std::random_shuffle(agentsToExecute.begin(), agentsToExecute.end());
-	int numExecutedAgents = 0;
-	AgentsList agentsToSend;
+	GeneralState::statistics().shuffle(agentsToExecute.begin(), agentsToExecute.end());
 
 #ifndef PANDORAEDEBUG
 	// shared memory distibution for read-only planning actions, disabled for extreme debug
-	#pragma omp parallel for
+	#pragma omp parallel for schedule(static)
 #endif
 	for(size_t i=0; i<agentsToExecute.size(); i++)
 	{
@@ -183,193 +209,121 @@ void SpacePartition::stepSection( const int & sectionIndex )
 	}
 
 	// execute actions
-	for(size_t i=0; i<agentsToExecute.size(); i++)
+	if(_parallelActions)
 	{
-        AgentPtr agent = agentsToExecute.at(i);
-		log_DEBUG(logName.str(), getWallTime() << " agent: " << agent << " being executed at index: " << sectionIndex << " of task: "<< _id << " in step: " << _world->getCurrentStep() );
-		agentsToExecute.at(i)->executeActions();
-		agentsToExecute.at(i)->updateState();
-		log_DEBUG(logName.str(), getWallTime() << " agent: " << agent << " has been executed at index: " << sectionIndex << " of task: "<< _id << " in step: " << _world->getCurrentStep() );
-
-		if(!_ownedArea.contains(agent->getPosition()) && !willBeRemoved(agent->getId()))
-		{
-			log_DEBUG(logName.str(), getWallTime() << " migrating agent: " << agent << " being executed at index: " << sectionIndex << " of task: "<< _id );
-			agentsToSend.push_back(agent);
-
-			// the agent is no longer property of this world
-			AgentsList::iterator itErase  = getOwnedAgent(agent->getId());
-			// it will be deleted
-			_world->eraseAgent(itErase);
-			_overlapAgents.push_back(agent);
-			log_DEBUG(logName.str(), getWallTime() <<  "putting agent: " << agent << " to overlap");
-		}
-		else
+		AgentExecuted executed(*this, agentsToSend);
+		_executor.execute(agentsToExecute, executed, _world->getCurrentStep());
+	}
+	else
+	{
+		for(size_t i=0; i<agentsToExecute.size(); i++)
 		{
-			log_DEBUG(logName.str(), getWallTime() << " finished agent: " << agent);
+			AgentPtr agent = agentsToExecute.at(i);
+			log_DEBUG(logName.str(), getWallTime() << " agent: " << agent << " being executed at index: " << sectionIndex << " of task: "<< _id << " in step: " << _world->getCurrentStep() );
+			agent->executeActions();
+			agent->updateState();
+			agentExecuted(agent, agentsToSend);
 		}
-		_executedAgentsHash.insert(make_pair(agent->getId(), agent));
-		numExecutedAgents++;
-		log_DEBUG(logName.str(), getWallTime()  << " num executed agents: " << numExecutedAgents );
 	}
-	log_DEBUG(logName.str(), getWallTime()  << " sending agents in section: " << sectionIndex << " and step: " << _world->getCurrentStep());
-	sendAgents(agentsToSend);
-	log_DEBUG(logName.str(), getWallTime() << " has finished section: " << sectionIndex << " and step: " << _world->getCurrentStep());
-	
+	int numExecutedAgents = agentsToExecute.size();
 	log_DEBUG(logName.str(), getWallTime() << " executed step: " << _world->getCurrentStep() << " section: " << sectionIndex << " in zone: " << _sections[sectionIndex] << " with num executed agents: " << numExecutedAgents << " total agents: " << std::distance(_world->beginAgents(), _world->endAgents()) << " and overlap agents: " << _overlapAgents.size());
 }
 
-void SpacePartition::sendAgents( AgentsList & agentsToSend )
+void SpacePartition::agentExecuted( AgentPtr agent, AgentsList & agentsToSend )
 {
-	if(_neighbors.size()==0)
-	{
-		return;
-	}
 	std::stringstream logName;
-	logName << "MPI_agents_world_" << _id;
-	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sendAgent: " << agentsToSend.size() << " agents");
+	logName << "simulation_" << _id;
+	_spatialIndex.updateAgent(agent.get());
+	log_DEBUG(logName.str(), getWallTime() << " agent: " << agent << " has been executed in step: " << _world->getCurrentStep() );
 
-	// for each neighbor, we send the number of agents to send
-	for(MpiFactory::TypesMap::iterator itType=MpiFactory::instance()->beginTypes(); itType!=MpiFactory::instance()->endTypes(); itType++)
+	if(!_ownedArea.contains(agent->getPosition()) && !willBeRemoved(agent->getId()))
 	{
-		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sendAgent - checking mpi type: " << itType->first );
-		// add each agent to the list of the neighbour where it will be sent
-		std::vector< AgentsList > agentsToNeighbors;
-		agentsToNeighbors.resize(_neighbors.size());
-
-
-		for(AgentsList::iterator it=agentsToSend.begin(); it!=agentsToSend.end(); it++)
-		{
-			AgentPtr agent = *it;
-			if(agent->isType(itType->first))
-			{
-				int newID = getIdFromPosition(agent->getPosition());
-				agentsToNeighbors[getNeighborIndex(newID)].push_back(agent);
-			}
-		}
+		log_DEBUG(logName.str(), getWallTime() << " migrating agent: " << agent << " of task: "<< _id );
+		agentsToSend.push_back(agent);
 
-		MPI_Datatype * agentType = itType->second;
-		for(size_t i=0; i<_neighbors.size(); i++)
-		{	
-			int numAgents = agentsToNeighbors[i].size();
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sendAgent - sending num agents: " << numAgents << " to: " << _neighbors[i]);
-			int error = MPI_Send(&numAgents, 1, MPI_INTEGER, _neighbors[i], eNumAgents, MPI_COMM_WORLD);
-			if(error != MPI_SUCCESS)
-			{
-				std::stringstream oss;
-				oss << "SpacePartition::sendAgents - " << _id << " error in MPI_Send : " << error;
-				throw Exception(oss.str());
-			}
-			AgentsList::iterator it= agentsToNeighbors[i].begin();
-			while(it!=agentsToNeighbors[i].end())
-			{
-				Agent * agent = it->get();
-				void * package = agent->fillPackage();
-				log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sendAgent - sending agent: " << *it << " to: " << _neighbors[i] );
-				error = MPI_Send(package, 1, *agentType, _neighbors[i], eAgent, MPI_COMM_WORLD);
-				delete package;
-				if(error != MPI_SUCCESS)
-				{
-					std::stringstream oss;
-					oss << "SpacePartition::sendAgents - " << _id << " error in MPI_Send : " << error;
-					throw Exception(oss.str());
-				}
-				agent->sendVectorAttributes(_neighbors[i]);
-				// it is not deleted, as it is sent to overlap list
-				it = agentsToNeighbors[i].erase(it);
-			}
-		}
+		// the agent is no longer property of this world
+		AgentsList::iterator itErase  = getOwnedAgent(agent->getId());
+		// it will be deleted
+		eraseOwnedAgent(itErase);
+		addGhostAgent(agent);
+		log_DEBUG(logName.str(), getWallTime() <<  "putting agent: " << agent << " to overlap");
 	}
-	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sendAgent -  end checking agents to send: " << agentsToSend.size());
+	else
+	{
+		log_DEBUG(logName.str(), getWallTime() << " finished agent: " << agent);
+	}
+	_executedAgentsHash.insert(make_pair(agent->getId(), agent));
 }
 
-void SpacePartition::sendOverlapZones( const int & sectionIndex, const bool & entireOverlap )
+void SpacePartition::packAgents( MpiBuffer & buffer, const AgentsList & agents, MPI_Datatype * agentType )
 {
-	std::stringstream logName;
-	logName << "MPI_raster_world_" << _id;
-	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " sendOverlapZones");
-	std::vector<int> neighborsToUpdate;
-	
-	for(size_t i=0; i<_neighbors.size(); i++)
+	buffer.pack((int)agents.size());
+	for(AgentsList::const_iterator it=agents.begin(); it!=agents.end(); it++)
 	{
-		if(needsToBeUpdated(_neighbors[i], sectionIndex))
-		{
-			neighborsToUpdate.push_back(_neighbors[i]);
-		}
+		Agent * agent = it->get();
+		void * package = agent->fillPackage();
+		buffer.pack(package, 1, *agentType);
+		delete package;
+		agent->packVectorAttributes(buffer);
 	}
+}
 
-	for(size_t d=0; d<_world->getNumberOfRasters(); d++)
-	{	
-		if(!_world->rasterExists(d) || !_world->isRasterDynamic(d))
-		{
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " index: " << d << " not sending");
-			continue;
-		}
-		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " sending raster: " << d);
-		for(size_t i=0; i<neighborsToUpdate.size(); i++)
-		{
-			MpiOverlap * send = new MpiOverlap;
-			if(entireOverlap)
-			{
-				send->_overlap= getOverlap(neighborsToUpdate[i], sectionIndex);
-				log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " send entire overlap: " << send->_overlap << " to: " << neighborsToUpdate[i]);
-			}
-			else
-			{
-				send->_overlap = getInternalOverlap(neighborsToUpdate[i]);
-				log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " send partial overlap: " << send->_overlap << " to: " << neighborsToUpdate[i]);
-			}
-			const Rectangle<int> & overlapZone = send->_overlap;
-			send->_data.resize(overlapZone._size._width * overlapZone._size._height);
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " will send overlap to: " << neighborsToUpdate[i] << " with size: " << send->_data.size() << " and zone: " << overlapZone);
-			for(size_t n=0; n<send->_data.size(); n++)
-			{
-				Point2D<int> index(overlapZone._origin._x+n%overlapZone._size._width, overlapZone._origin._y+n/overlapZone._size._width);
-				send->_data.at(n) = _world->getDynamicRaster(d).getValue(index);
-				log_EDEBUG(logName.str(), "\t" << getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " send index: " << index << " in global pos: " << index+_boundaries._origin << " value: " << send->_data.at(n));
-			}
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " raster: " << d << " will be sent");
-			MPI_Isend(&send->_data[0], send->_data.size(), MPI_INTEGER, neighborsToUpdate[i], eRasterData, MPI_COMM_WORLD, &send->_request);
-			_sendRequests.push_back(send);
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " raster: " << d << " data sent to: " << _neighbors[i]);
-		}
-		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " raster: " << d << " sent");
-	}
-	log_DEBUG(logName.str(), getWallTime() << " step: "  << "/" << sectionIndex << _world->getCurrentStep() << " sendOverlapZones ended");
+Agent * SpacePartition::unpackAgent( MpiBuffer & buffer, const int & typeId, MPI_Datatype * agentType )
+{
+	void * package = MpiFactory::instance()->createDefaultPackage(typeId);
+	buffer.unpack(package, 1, *agentType);
+	Agent * agent = MpiFactory::instance()->createAndFillAgent(typeId, package);
+	delete package;
+	agent->unpackVectorAttributes(buffer);
+	return agent;
 }
 
-void SpacePartition::sendMaxOverlapZones()
+void SpacePartition::sendAgents( AgentsList & agentsToSend )
 {
+	if(_neighbors.size()==0)
+	{
+		return;
+	}
 	std::stringstream logName;
-	logName << "MPI_raster_world_" << _id;
-	log_DEBUG(logName.str(), getWallTime() << " step: "  << _world->getCurrentStep() << " sendMaxOverlapZones");
-	for(size_t d=0; d<_world->getNumberOfRasters(); d++)
-	{	
-		if(!_world->rasterExists(d) || !_world->isRasterDynamic(d))
-		{
-			continue;
-		}
+	logName << "MPI_agents_world_" << _id;
+	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sendAgent: " << agentsToSend.size() << " agents");
 
-		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sending max raster: " << d);
-		for(size_t i=0; i<_neighbors.size(); i++)
+	// buffers are reused, so messages sent in the previous section must be completed
+	MPI_Waitall(_migrationRequests.size(), &_migrationRequests[0], MPI_STATUSES_IGNORE);
+
+	// add each agent to the list of the neighbour where it will be sent
+	std::vector< AgentsList > agentsToNeighbors;
+	agentsToNeighbors.resize(_neighbors.size());
+	for(AgentsList::iterator it=agentsToSend.begin(); it!=agentsToSend.end(); it++)
+	{
+		AgentPtr agent = *it;
+		int newID = getIdFromPosition(agent->getPosition());
+		agentsToNeighbors[getNeighborIndex(newID)].push_back(agent);
+	}
+
+	// a single message is sent to each neighbor, with the agents of every type in the order of MpiFactory
+	for(size_t i=0; i<_neighbors.size(); i++)
+	{
+		MpiBuffer & buffer = _migrationBuffers[i];
+		buffer.clear();
+		for(MpiFactory::TypesMap::iterator itType=MpiFactory::instance()->beginTypes(); itType!=MpiFactory::instance()->endTypes(); itType++)
 		{
-			MpiOverlap * send = new MpiOverlap;
-			send->_overlap = getInternalOverlap(_neighbors[i]);
-			send->_data.resize(send->_overlap._size._width * send->_overlap._size._height);
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " will send max overlap of: " << d << " to: " << _neighbors[i] << " with size: " << send->_data.size() << " and zone: " << send->_overlap << " to " << _neighbors[i]);
-			const Rectangle<int> & overlapZone = send->_overlap;
-			for(size_t n=0; n<send->_data.size(); n++)
+			int typeId = GeneralState::agentTypes().getId(itType->first);
+			AgentsList agentsOfType;
+			for(AgentsList::iterator it=agentsToNeighbors[i].begin(); it!=agentsToNeighbors[i].end(); it++)
 			{
-				Point2D<int> index(overlapZone._origin._x+n%overlapZone._size._width, overlapZone._origin._y+n/overlapZone._size._width);
-				send->_data.at(n) = _world->getDynamicRaster(d).getMaxValue(index);
-				log_EDEBUG(logName.str(), "\t" << getWallTime() << " step: " << _world->getCurrentStep() << " send index: " << index << " in global pos: " << index+_boundaries._origin << " max value: " << send->_data.at(n));
+				if((*it)->isType(typeId))
+				{
+					log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sendAgent - sending agent: " << *it << " to: " << _neighbors[i] );
+					agentsOfType.push_back(*it);
+				}
 			}
-			MPI_Isend(&send->_data[0], send->_data.size(), MPI_INTEGER, _neighbors[i], eRasterMaxData, MPI_COMM_WORLD, &send->_request);
-			_sendRequests.push_back(send);
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " raster: " << d << " max data sent to: " << _neighbors[i]);
+			packAgents(buffer, agentsOfType, itType->second);
 		}
-		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " raster: " << d << " max data sent");
+		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sendAgent - sending num agents: " << agentsToNeighbors[i].size() << " to: " << _neighbors[i] << " in bytes: " << buffer.getSize());
+		buffer.send(_neighbors[i], eAgent, &_migrationRequests[i]);
 	}
-	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sendMaxOverlapZones ended");
+	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sendAgent -  end checking agents to send: " << agentsToSend.size());
 }
 
 void SpacePartition::sendGhostAgents( const int & sectionIndex )
@@ -377,82 +331,60 @@ void SpacePartition::sendGhostAgents( const int & sectionIndex )
 	std::stringstream logName;
 	logName << "MPI_agents_world_" << _id;
 	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " send ghost agents for section index: " << sectionIndex );
+	if(_neighbors.size()==0)
+	{
+		return;
+	}
+
+	// buffers are reused, so messages sent in the previous section must be completed
+	MPI_Waitall(_ghostRequests.size(), &_ghostRequests[0], MPI_STATUSES_IGNORE);
 
-	std::vector<int> neighborsToUpdate;
 	for(size_t i=0; i<_neighbors.size(); i++)
 	{
-		if(needsToBeUpdated(_neighbors[i], sectionIndex))
+		if(!needsToBeUpdated(_neighbors[i], sectionIndex))
 		{
-			neighborsToUpdate.push_back(_neighbors[i]);
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " section index: " << sectionIndex << " will send overlap to: " << _neighbors[i]);
+			continue;
 		}
-	}
+		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " section index: " << sectionIndex << " will send overlap to: " << _neighbors[i]);
+		Rectangle<int> overlapZone = getOverlap(_neighbors[i], sectionIndex);
+		MpiBuffer & buffer = _ghostBuffers[i];
+		buffer.clear();
 
-	// for each type of agent we will send the collection of agents of the particular type to neighbors
-	for(MpiFactory::TypesMap::iterator itType=MpiFactory::instance()->beginTypes(); itType!=MpiFactory::instance()->endTypes(); itType++)
-	{
-		log_DEBUG(logName.str(),  getWallTime() << " step: " << _world->getCurrentStep() << " section index: " << sectionIndex << " checking type: " << itType->first );
-		MPI_Datatype * agentType = itType->second;
-
-		std::vector< AgentsList > agentsToNeighbors;
-		agentsToNeighbors.resize(neighborsToUpdate.size());
-
-		for(size_t i=0; i<neighborsToUpdate.size(); i++)
+		// for each type of agent we will pack the collection of agents of the particular type
+		for(MpiFactory::TypesMap::iterator itType=MpiFactory::instance()->beginTypes(); itType!=MpiFactory::instance()->endTypes(); itType++)
 		{
-			Rectangle<int> overlapZone = getOverlap(neighborsToUpdate[i], sectionIndex);
+			int typeId = GeneralState::agentTypes().getId(itType->first);
+			log_DEBUG(logName.str(),  getWallTime() << " step: " << _world->getCurrentStep() << " section index: " << sectionIndex << " checking type: " << itType->first );
+
+			AgentsList agentsToNeighbor;
 			for(AgentsList::iterator it=_world->beginAgents(); it!=_world->endAgents(); it++)
 			{
 				AgentPtr agent = *it;
-				// we check the type. TODO register the type in another string
-				// TODO refactor!!!
-				log_DEBUG(logName.str(),  getWallTime() << " step: " << _world->getCurrentStep() << " agent: " << agent << " of type: " << itType->first << " test will be removed: " << willBeRemoved(agent->getId()) << " checking overlap zone: " << overlapZone << " overlap boundaries: " << _boundaries << " - test is inside zone: " << overlapZone.contains(agent->getPosition()-_boundaries._origin));
-				if(agent->isType(itType->first))
+				if(agent->isType(typeId))
 				{
 					if((!willBeRemoved(agent->getId())) && (overlapZone.contains(agent->getPosition()-_boundaries._origin)))
 					{
-						agentsToNeighbors[i].push_back(agent);
-						log_DEBUG(logName.str(),  getWallTime() << " step: " << _world->getCurrentStep() << " sending ghost agent: " << agent << " to: " << neighborsToUpdate[i] << " in section index: " << sectionIndex);
+						agentsToNeighbor.push_back(agent);
+						log_DEBUG(logName.str(),  getWallTime() << " step: " << _world->getCurrentStep() << " sending ghost agent: " << agent << " to: " << _neighbors[i] << " in section index: " << sectionIndex);
 					}
 				}
 			}
 			for(AgentsList::iterator it=_overlapAgents.begin(); it!=_overlapAgents.end(); it++)
 			{
 				AgentPtr agent = *it;	
-				if(agent->isType(itType->first))
+				if(agent->isType(typeId))
 				{
 					if((!willBeRemoved(agent->getId())) && (overlapZone.contains(agent->getPosition()-_boundaries._origin)))
 					{
-						agentsToNeighbors[i].push_back(agent);
-						log_DEBUG(logName.str(),  getWallTime() << " step: " << _world->getCurrentStep() << " will send modified ghost agent: " << agent << " to: " << neighborsToUpdate[i] << " in section index: " << sectionIndex << " and step: " << _world->getCurrentStep());
+						agentsToNeighbor.push_back(agent);
+						log_DEBUG(logName.str(),  getWallTime() << " step: " << _world->getCurrentStep() << " will send modified ghost agent: " << agent << " to: " << _neighbors[i] << " in section index: " << sectionIndex << " and step: " << _world->getCurrentStep());
 					}
 				}
 			}
-
-			int numAgents = agentsToNeighbors[i].size();
-			log_DEBUG(logName.str(),  getWallTime() << " step: " << _world->getCurrentStep() << " sending num ghost agents: " << numAgents << " to : " << neighborsToUpdate[i] << " in step: " << _world->getCurrentStep() << " and section index: " << sectionIndex );
-			int error = MPI_Send(&numAgents, 1, MPI_INTEGER, neighborsToUpdate[i], eNumGhostAgents, MPI_COMM_WORLD);
-			if(error != MPI_SUCCESS)
-			{
-				std::stringstream oss;
-				oss << "SpacePartition::sendGhostAgents - " << _id << " error in MPI_Send : " << error;
-				throw Exception(oss.str());
-			}
-			for(AgentsList::iterator it=agentsToNeighbors[i].begin(); it!=agentsToNeighbors[i].end(); it++)
-			{
-				Agent * agent = it->get();
-				void * package = agent->fillPackage();
-				log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " sending ghost agent: " << *it << " from: " << _id << " to: " << neighborsToUpdate[i]);
-				error = MPI_Send(package, 1, *agentType, neighborsToUpdate[i], eGhostAgent, MPI_COMM_WORLD);
-				delete package;
-				if(error != MPI_SUCCESS)
-				{
-					std::stringstream oss;
-					oss << "SpacePartition::sendGhostAgents - " << _id << " error in MPI_Send : " << error;
-					throw Exception(oss.str());
-				}
-				agent->sendVectorAttributes(neighborsToUpdate[i]);
-			}
+			log_DEBUG(logName.str(),  getWallTime() << " step: " << _world->getCurrentStep() << " sending num ghost agents: " << agentsToNeighbor.size() << " to : " << _neighbors[i] << " in step: " << _world->getCurrentStep() << " and section index: " << sectionIndex );
+			packAgents(buffer, agentsToNeighbor, itType->second);
 		}
+		buffer.send(_neighbors[i], eGhostAgent, &_ghostRequests[i]);
 	}
 	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " send ghost agents for section index: " << sectionIndex << " finished");
 }
@@ -463,51 +395,28 @@ void SpacePartition::receiveGhostAgents( const int & sectionIndex )
 	logName << "MPI_agents_world_" << _id;
 	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " receive ghost agents for section index: " << sectionIndex );
 
-
-	// we need to calculate how many neighbors will send data to this id
-	std::vector<int> neighborsToUpdate;
 	for(size_t i=0; i<_neighbors.size(); i++)
 	{
-		if(needsToReceiveData(_neighbors[i], sectionIndex))
+		// we need to calculate which neighbors will send data to this id
+		if(!needsToReceiveData(_neighbors[i], sectionIndex))
 		{
-			neighborsToUpdate.push_back(_neighbors[i]);
+			continue;
 		}
-	}
-
-	// for each type of agent we will send the collection of agents of the particular type to neighbors	
-	for(MpiFactory::TypesMap::iterator itType=MpiFactory::instance()->beginTypes(); itType!=MpiFactory::instance()->endTypes(); itType++)
-	{
-		MPI_Datatype * agentType = itType->second;
+		_receiveBuffer.receive(_neighbors[i], eGhostAgent);
+		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " has received message from " << _neighbors[i] << " in bytes: " << _receiveBuffer.getSize());
+		Rectangle<int> overlapZone = getOverlap(_neighbors[i], sectionIndex);
 
-		for(size_t i=0; i<neighborsToUpdate.size(); i++)
+		for(MpiFactory::TypesMap::iterator itType=MpiFactory::instance()->beginTypes(); itType!=MpiFactory::instance()->endTypes(); itType++)
 		{
-            log_DEBUG(logName.str(), getWallTime() << " AA neigh to update: " << neighborsToUpdate[i] << " type: " << itType->first);
+			int typeId = GeneralState::agentTypes().getId(itType->first);
 			AgentsList newGhostAgents;
-			int numAgentsToReceive;
-			MPI_Status status;
-
-			int error = MPI_Recv(&numAgentsToReceive, 1, MPI_INTEGER, neighborsToUpdate[i], eNumGhostAgents, MPI_COMM_WORLD, &status);			
-			if(error!=MPI_SUCCESS)
-			{
-				std::stringstream oss;
-				oss << "SpacePartition::receiveGhostAgents - " << _id << " error in MPI_Recv: " << error;
-				throw Exception(oss.str());
-			}
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " has received message from " << neighborsToUpdate[i] << ", num ghost agents: " << numAgentsToReceive );
+			int numAgentsToReceive = 0;
+			_receiveBuffer.unpack(numAgentsToReceive);
+			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " num ghost agents of type: " << itType->first << " from: " << _neighbors[i] << ": " << numAgentsToReceive );
 			for(int j=0; j<numAgentsToReceive; j++)
 			{
-				void * package = MpiFactory::instance()->createDefaultPackage(itType->first);
-				error = MPI_Recv(package, 1, *agentType, neighborsToUpdate[i], eGhostAgent, MPI_COMM_WORLD, &status);					
-				if(error!=MPI_SUCCESS)
-				{
-					std::stringstream oss;
-					oss << "SpacePartition::receiveGhostAgents - " << _id << " error in MPI_Recv: " << error;
-					throw Exception(oss.str());
-				}
-				Agent * agent = MpiFactory::instance()->createAndFillAgent(itType->first, package);
-				log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " has received ghost agent: " << agent << " number: " << j << " from: " << neighborsToUpdate[i] << " in section index: " << sectionIndex << " and step: " << _world->getCurrentStep() );
-				delete package;
-				agent->receiveVectorAttributes(neighborsToUpdate[i]);
+				Agent * agent = unpackAgent(_receiveBuffer, typeId, itType->second);
+				log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " has received ghost agent: " << agent << " number: " << j << " from: " << _neighbors[i] << " in section index: " << sectionIndex << " and step: " << _world->getCurrentStep() );
 
 				// we must check if it is an update of an agent, or a ghost agent
 				bool worldOwnsAgent = false;
@@ -515,7 +424,7 @@ void SpacePartition::receiveGhostAgents( const int & sectionIndex )
 				if(it!=_world->endAgents())
 				{
 					log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " has received update of own agent: " << *it << " in step: " << _world->getCurrentStep() );
-					_world->eraseAgent(it);
+					eraseOwnedAgent(it);
 					_world->addAgent(agent, false);
 					worldOwnsAgent = true;
 				}
@@ -524,20 +433,18 @@ void SpacePartition::receiveGhostAgents( const int & sectionIndex )
 					newGhostAgents.push_back(std::shared_ptr<Agent>(agent));
 				}
 			}
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " num ghost agents sent for neighbor: " << neighborsToUpdate[i] << " in section index: " << sectionIndex << ": " << newGhostAgents.size());
 			// if the agent is in the zone to be updated, remove it
-			Rectangle<int> overlapZone = getOverlap(neighborsToUpdate[i], sectionIndex);
 			AgentsList::iterator it=_overlapAgents.begin();
 			while(it!=_overlapAgents.end())
 			{
 				Agent * agent = it->get();
-				if(agent->isType(itType->first))
+				if(agent->isType(typeId))
 				{
 					// si l'agent no està en zona que s'ha d'actualitzar, continuar
 					if(overlapZone.contains((*it)->getPosition()-_boundaries._origin))
 					{
 						log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " in section index: " << sectionIndex << " with overlap zone: " << overlapZone << " erasing agent: " << *it);
-						it = _overlapAgents.erase(it);
+						it = eraseGhostAgent(it);
 					}
 					else
 					{
@@ -555,7 +462,7 @@ void SpacePartition::receiveGhostAgents( const int & sectionIndex )
 			{
                 AgentPtr agent = *it;
 				log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " in section index: " << sectionIndex << " adding ghost agent: " << agent);
-				_overlapAgents.push_back(agent);
+				addGhostAgent(agent);
 			}
 		}
 	}
@@ -568,38 +475,18 @@ void SpacePartition::receiveAgents( const int & sectionIndex )
 	std::stringstream logName;
 	logName << "MPI_agents_world_" << _id;
 	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " receiving agents for section index: " << sectionIndex);
-	for(MpiFactory::TypesMap::iterator itType=MpiFactory::instance()->beginTypes(); itType!=MpiFactory::instance()->endTypes(); itType++)
+	for(size_t i=0; i<_neighbors.size(); i++)
 	{
-		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " receiveAgent - checking mpi type: " << itType->first);
-		MPI_Datatype * agentType = itType->second;
-
-		for(size_t i=0; i<_neighbors.size(); i++)
+		_receiveBuffer.receive(_neighbors[i], eAgent);
+		log_DEBUG(logName.str(), getWallTime() <<  " receiveAgents - received message from " << _neighbors[i] << " in bytes: " << _receiveBuffer.getSize());
+		for(MpiFactory::TypesMap::iterator itType=MpiFactory::instance()->beginTypes(); itType!=MpiFactory::instance()->endTypes(); itType++)
 		{
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " receiveAgent - checking mpi type: " << itType->first << " for neighbor: " << _neighbors[i] );
-
-			int numAgentsToReceive;
-			MPI_Status status;
-			int error = MPI_Recv(&numAgentsToReceive, 1, MPI_INTEGER, _neighbors[i], eNumAgents, MPI_COMM_WORLD, &status);			
-			if(error!=MPI_SUCCESS)
-			{
-				std::stringstream oss;
-				oss << "SpacePartition::receiveAgents - " << _id << " error in MPI_Recv: " << error;
-				throw Exception(oss.str());
-			}
-			log_DEBUG(logName.str(), getWallTime() <<  " receiveAgents - received message from " << _neighbors[i] << ", num agents: " << numAgentsToReceive);
+			int typeId = GeneralState::agentTypes().getId(itType->first);
+			int numAgentsToReceive = 0;
+			_receiveBuffer.unpack(numAgentsToReceive);
 			for(int j=0; j<numAgentsToReceive; j++)
 			{
-				void * package = MpiFactory::instance()->createDefaultPackage(itType->first);
-				error = MPI_Recv(package, 1, *agentType, _neighbors[i], eAgent, MPI_COMM_WORLD, &status);					
-				if(error!=MPI_SUCCESS)
-				{
-					std::stringstream oss;
-					oss << "SpacePartition::receiveAgents - " << _id << " error in MPI_Recv: " << error;
-					throw Exception(oss.str());
-				}
-				Agent * agent = MpiFactory::instance()->createAndFillAgent(itType->first, package);
-				delete package;
-				agent->receiveVectorAttributes(_neighbors[i]);
+				Agent * agent = unpackAgent(_receiveBuffer, typeId, itType->second);
 				_world->addAgent(agent, true);
 				log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " receiveAgents - received agent: " << agent << " number: " << j << " from: " << _neighbors[i]);
 			}
@@ -607,248 +494,414 @@ void SpacePartition::receiveAgents( const int & sectionIndex )
 	}
 }
 
-void SpacePartition::receiveOverlapData( const int & sectionIndex, const bool & entireOverlap )
+int SpacePartition::getIdFromPosition( const Point2D<int> & position )
 {
-	std::stringstream logName;
-	logName << "MPI_raster_world_" << _id;
-	log_DEBUG(logName.str(), getWallTime() << " step: "  << "/" << sectionIndex << _world->getCurrentStep() << " receiveOverlapData");
+	return _decomposition.getPartitionId(position);
+}
 
-	// we need to calculate how many neighbors will send data to this id
-	std::vector<int> neighborsToUpdate;
+Point2D<int> SpacePartition::getPositionFromId( const int & id ) const
+{
+	return _decomposition.getPartitionPosition(id);
+}
+
+int SpacePartition::getNeighborIndex( const int & id )
+{
 	for(size_t i=0; i<_neighbors.size(); i++)
 	{
-		if(needsToReceiveData(_neighbors[i], sectionIndex))
+		if(_neighbors[i] == id)
 		{
-			neighborsToUpdate.push_back(_neighbors[i]);
+			return i;
 		}
 	}
+	std::stringstream oss;
+	oss << "SpacePartition::getNeighborIndex- " << _id << " looking for neighbor with id: " << id << " not found";
+	throw Exception(oss.str());
+}
+
+void SpacePartition::executeAgents()
+{
+	// the time since the end of the previous step is spent updating rasters and serializing
+	if(_lastStepEnd>=0.0f)
+	{
+		_environmentTime += getWallTime()-_lastStepEnd;
+	}
+	if(_rebalancePeriod>0 && _world->getCurrentStep()>0 && _world->getCurrentStep()%_rebalancePeriod==0)
+	{
+		if(rebalance(true))
+		{
+			initOverlappingData();
+		}
+	}
+
+	// cells owned by neighbours are received once, before any section is executed
+	_sectionExchanges[0].startReceives();
+	_overlapExchange.exchange();
+	
+	std::stringstream logName;
+	logName << "simulation_" << getId();
+
+	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " has executed update overlap");
+	_executedAgentsHash.clear();
+
+	std::stringstream logNameMpi;
+	logNameMpi << "simulation_" << _id;
+
+	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " executing sections");
+	// there is no global synchronization between sections; every message is matched by neighbour and tag
+	for(int sectionIndex=0; sectionIndex<4; sectionIndex++)
+	{
+		// receives of the next section are posted while this one is executed
+		if(sectionIndex<3)
+		{
+			_sectionExchanges[sectionIndex+1].startReceives();
+		}
+		double sectionStart = getWallTime();
+		// messages of previous sections advance while agents are executed
+		AgentsList agentsToSend;
+		_progressThread.resume();
+		stepSection(sectionIndex, agentsToSend);
+		_progressThread.pause();
+		// migration requests are waited and reused, so they are only touched while the progress thread is paused
+		log_DEBUG(logNameMpi.str(), getWallTime()  << " sending agents in section: " << sectionIndex << " and step: " << _world->getCurrentStep());
+		sendAgents(agentsToSend);
+		_agentsTime += getWallTime()-sectionStart;
+		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " has been executed");
+		receiveAgents(sectionIndex);
+		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " has received agents");
+
+		sendGhostAgents(sectionIndex);
+		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " sent ghosts");
+		// raster overlap is exchanged while ghost messages are in flight
+		_sectionExchanges[sectionIndex].exchange();
+		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " exchanged overlap" );
+		receiveGhostAgents(sectionIndex);
+		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " received ghosts");
+	}
+	_lastStepEnd = getWallTime();
+}
 
-	// for each raster, we receive data from all the active neighbors
+bool SpacePartition::rebalance( const bool & measured )
+{
+	std::stringstream logName;
+	logName << "simulation_" << _id;
+	const Size<int> & size = _world->getConfig().getSize();
+
+	// each owned agent adds its cost to its column and row, and each owned cell adds the cost of updating the environment
+	double agentCost = 1.0f;
+	double cellCost = 0.0f;
+	if(measured)
+	{
+		int numAgents = std::distance(_world->beginAgents(), _world->endAgents());
+		agentCost = numAgents>0 ? _agentsTime/numAgents : 0.0f;
+		cellCost = _environmentTime/(double(_ownedArea._size._width)*_ownedArea._size._height);
+	}
+	_agentsTime = 0.0f;
+	_environmentTime = 0.0f;
+
+	std::vector<double> costs(size._width+size._height, 0.0f);
+	for(AgentsList::iterator it=_world->beginAgents(); it!=_world->endAgents(); it++)
+	{
+		const Point2D<int> & position = (*it)->getPosition();
+		if(_ownedArea.contains(position))
+		{
+			costs[position._x] += agentCost;
+			costs[size._width+position._y] += agentCost;
+		}
+	}
+	for(int x=_ownedArea._origin._x; x<_ownedArea._origin._x+_ownedArea._size._width; x++)
+	{
+		costs[x] += cellCost*_ownedArea._size._height;
+	}
+	for(int y=_ownedArea._origin._y; y<_ownedArea._origin._y+_ownedArea._size._height; y++)
+	{
+		costs[size._width+y] += cellCost*_ownedArea._size._width;
+	}
+	// costs are reduced by a single task and broadcasted, so every task computes exactly the same boundaries
+	std::vector<double> totalCosts(costs.size(), 0.0f);
+	MPI_Reduce(&costs[0], &totalCosts[0], costs.size(), MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+	MPI_Bcast(&totalCosts[0], totalCosts.size(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+	DomainDecomposition previous = _decomposition;
+	std::vector<double> columnCosts(totalCosts.begin(), totalCosts.begin()+size._width);
+	std::vector<double> rowCosts(totalCosts.begin()+size._width, totalCosts.end());
+	if(!_decomposition.balance(columnCosts, rowCosts))
+	{
+		return false;
+	}
+
+	// messages of previous boundaries must be completed before zones and buffers change
+	completeSends();
+	updateBoundaries();
+	migrateRasters(previous);
+	migrateAgents();
+	log_INFO(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " rebalanced with agent cost: " << agentCost << " and cell cost: " << cellCost << " new boundaries: " << _boundaries << " and owned area: " << _ownedArea);
+	return true;
+}
+
+void SpacePartition::migrateRasters( const DomainDecomposition & previous )
+{
+	Rectangle<int> previousOwnedArea = previous.getArea(_id);
+	Rectangle<int> previousBoundaries = previous.getBoundaries(_id, _overlap);
+
+	// dynamic rasters send current and max values
+	int valuesPerCell = 0;
 	for(size_t d=0; d<_world->getNumberOfRasters(); d++)
-	{	
-		if(!_world->rasterExists(d) || !_world->isRasterDynamic(d))
+	{
+		if(_world->rasterExists(d))
+		{
+			valuesPerCell += _world->isRasterDynamic(d) ? 2 : 1;
+		}
+	}
+	if(valuesPerCell==0)
+	{
+		return;
+	}
+
+	// each task sends the part of its previous owned area inside the new boundaries of every task
+	std::vector<Rectangle<int> > sendZones(_numTasks);
+	std::vector<Rectangle<int> > receiveZones(_numTasks);
+	std::vector<int> sendCounts(_numTasks, 0);
+	std::vector<int> receiveCounts(_numTasks, 0);
+	std::vector<int> sendOffsets(_numTasks+1, 0);
+	std::vector<int> receiveOffsets(_numTasks+1, 0);
+	for(int i=0; i<_numTasks; i++)
+	{
+		if(previousOwnedArea.intersection(_decomposition.getBoundaries(i, _overlap), sendZones[i]))
+		{
+			sendCounts[i] = valuesPerCell*sendZones[i]._size._width*sendZones[i]._size._height;
+		}
+		Rectangle<int> ownedArea = previous.getArea(i);
+		if(ownedArea.intersection(_boundaries, receiveZones[i]))
+		{
+			receiveCounts[i] = valuesPerCell*receiveZones[i]._size._width*receiveZones[i]._size._height;
+		}
+		sendOffsets[i+1] = sendOffsets[i]+sendCounts[i];
+		receiveOffsets[i+1] = receiveOffsets[i]+receiveCounts[i];
+	}
+
+	std::vector<int> sendBuffer(std::max(1, sendOffsets[_numTasks]));
+	for(int i=0; i<_numTasks; i++)
+	{
+		if(sendCounts[i]==0)
 		{
 			continue;
 		}
-		
-		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " receiving raster: " << d);
-		for(size_t i=0; i<neighborsToUpdate.size(); i++)
+		int * data = &sendBuffer[sendOffsets[i]];
+		Rectangle<int> zone = sendZones[i];
+		zone._origin = zone._origin-previousBoundaries._origin;
+		for(size_t d=0; d<_world->getNumberOfRasters(); d++)
 		{
-			MpiOverlap* receive = new MpiOverlap;
-			// TODO move to index
-			receive->_rasterName = _world->getRasterName(d);
-			if(entireOverlap)
+			if(!_world->rasterExists(d))
 			{
-				receive->_overlap = getOverlap(neighborsToUpdate[i], sectionIndex);
-				log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " receive entire overlap: " << receive->_overlap << " from " << neighborsToUpdate[i]);
+				continue;
 			}
-			else
+			for(int y=zone._origin._y; y<zone._origin._y+zone._size._height; y++)
 			{
-				receive->_overlap = getExternalOverlap(neighborsToUpdate[i]);
-				log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " receive external overlap: " << receive->_overlap << " from " << neighborsToUpdate[i]);
+				_world->getStaticRaster(d).copyRow(y, zone._origin._x, zone._size._width, data);
+				data += zone._size._width;
+			}
+			if(!_world->isRasterDynamic(d))
+			{
+				continue;
+			}
+			for(int y=zone._origin._y; y<zone._origin._y+zone._size._height; y++)
+			{
+				_world->getDynamicRaster(d).copyMaxRow(y, zone._origin._x, zone._size._width, data);
+				data += zone._size._width;
 			}
-			receive->_data.resize(receive->_overlap._size._width*receive->_overlap._size._height);
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " will receive overlap from: " << neighborsToUpdate[i] << " with size: " << receive->_data.size() << " and zone: " << receive->_overlap );
-			MPI_Irecv(&receive->_data[0], receive->_data.size(), MPI_INTEGER, neighborsToUpdate[i], eRasterData, MPI_COMM_WORLD, &receive->_request);
-			_receiveRequests.push_back(receive);
 		}
-		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " raster: " << d << " received");
 	}
-	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << "/" << sectionIndex << " receiveOverlapData ended");
-}
+	std::vector<int> receiveBuffer(std::max(1, receiveOffsets[_numTasks]));
+	MPI_Alltoallv(&sendBuffer[0], &sendCounts[0], &sendOffsets[0], MPI_INT, &receiveBuffer[0], &receiveCounts[0], &receiveOffsets[0], MPI_INT, MPI_COMM_WORLD);
 
-void SpacePartition::receiveMaxOverlapData()
-{
-	std::stringstream logName;
-	logName << "MPI_raster_world_" << _id;
-	log_DEBUG(logName.str(), getWallTime() << " step: "  << _world->getCurrentStep() << " receiveMaxOverlapData");
-	// for each raster, we receive data from all the active neighbors
+	// rasters are rebuilt one by one, reading the part of each task in the same order it was packed
+	std::vector<int *> data(_numTasks);
+	for(int i=0; i<_numTasks; i++)
+	{
+		data[i] = &receiveBuffer[receiveOffsets[i]];
+	}
+	const Size<int> & newSize = _boundaries._size;
+	std::vector<int> values(newSize._width*newSize._height);
+	std::vector<int> maxValues;
 	for(size_t d=0; d<_world->getNumberOfRasters(); d++)
 	{
-		if(!_world->rasterExists(d) || !_world->isRasterDynamic(d))
+		if(!_world->rasterExists(d))
 		{
 			continue;
 		}
-		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " receiving max raster: " << d);
-		for(size_t i=0; i<_neighbors.size(); i++)			
+		bool dynamic = _world->isRasterDynamic(d);
+		maxValues.resize(dynamic ? values.size() : 0);
+		for(int i=0; i<_numTasks; i++)
 		{
-			MpiOverlap* receive = new MpiOverlap;
-			receive->_rasterName = _world->getRasterName(d);
-			receive->_overlap = getExternalOverlap(_neighbors[i]);
-			receive->_data.resize(receive->_overlap._size._width*receive->_overlap._size._height);
-
-			log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " will receive max overlap to: " << _neighbors[i] << " with size: " << receive->_data.size() << " and zone: " << receive->_overlap << " from " << _neighbors[i]);
-			MPI_Irecv(&receive->_data[0], receive->_data.size(), MPI_INTEGER, _neighbors[i], eRasterMaxData, MPI_COMM_WORLD, &receive->_request);
-			_receiveRequests.push_back(receive);
+			if(receiveCounts[i]==0)
+			{
+				continue;
+			}
+			Rectangle<int> zone = receiveZones[i];
+			zone._origin = zone._origin-_boundaries._origin;
+			for(int y=zone._origin._y; y<zone._origin._y+zone._size._height; y++)
+			{
+				std::copy(data[i], data[i]+zone._size._width, &values[y*newSize._width+zone._origin._x]);
+				data[i] += zone._size._width;
+			}
+			if(!dynamic)
+			{
+				continue;
+			}
+			for(int y=zone._origin._y; y<zone._origin._y+zone._size._height; y++)
+			{
+				std::copy(data[i], data[i]+zone._size._width, &maxValues[y*newSize._width+zone._origin._x]);
+				data[i] += zone._size._width;
+			}
+		}
+		if(!dynamic)
+		{
+			StaticRaster & raster = _world->getStaticRaster(d);
+			raster.resize(newSize);
+			raster.setLoadedValues(values);
+			continue;
+		}
+		DynamicRaster & raster = _world->getDynamicRaster(d);
+		raster.resize(newSize);
+		// max values are set first, as setLoadedValues assigns them to current values too
+		raster.setLoadedValues(maxValues);
+		for(int y=0; y<newSize._height; y++)
+		{
+			raster.setRow(y, 0, newSize._width, &values[y*newSize._width]);
 		}
-		log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep()  << " raster: " << d << " max data received");
 	}
-	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " receiveMaxOverlapData ended");
 }
 
-void SpacePartition::clearRequests( bool updateMaxValues )
-{	
-	std::stringstream logName;
-	logName << "MPI_raster_world_" << _id;
-	int finished = 0;
-
-	// MPI_Isend
-	while(_sendRequests.size()!=0)
+void SpacePartition::migrateAgents()
+{
+	// owned agents outside the new owned area are sent to their new task
+	std::vector<AgentsList> agentsToTasks(_numTasks);
+	AgentsList::iterator it=_world->beginAgents();
+	while(it!=_world->endAgents())
 	{
-		std::list<MpiOverlap*>::iterator it=_sendRequests.begin();
-		while(it!=_sendRequests.end())
+		AgentPtr agent = *it;
+		if(_ownedArea.contains(agent->getPosition()))
 		{
-			MpiOverlap* send = *it;
-			MPI_Status status;
-			MPI_Test(&send->_request, &finished, &status);
-			if(finished)
-			{
-				it = _sendRequests.erase(it);
-				log_DEBUG(logName.str(), getWallTime() << " request finished, lacking: " << _sendRequests.size() << " requests");
-				delete send;
-			}
+			it++;
+			continue;
 		}
+		agentsToTasks[getIdFromPosition(agent->getPosition())].push_back(agent);
+		AgentsList::iterator itErase = it;
+		it++;
+		eraseOwnedAgent(itErase);
+	}
+	// ghost agents will be sent again for the new overlap zones
+	it = _overlapAgents.begin();
+	while(it!=_overlapAgents.end())
+	{
+		it = eraseGhostAgent(it);
+	}
+
+	_spatialIndex.resize(_boundaries);
+	for(it=_world->beginAgents(); it!=_world->endAgents(); it++)
+	{
+		_spatialIndex.addAgent(*it);
+	}
+	if(_parallelActions)
+	{
+		_executor.resize(_boundaries, _overlap, _spatialIndex.getCellSize());
 	}
 
-	// MPI_Irecv
-	while(_receiveRequests.size()!=0)
+	// the part of each task contains the number of agents of every type, even if none is sent
+	MpiBuffer buffer;
+	std::vector<int> offsets(_numTasks+1, 0);
+	for(int i=0; i<_numTasks; i++)
 	{
-		std::list<MpiOverlap*>::iterator it=_receiveRequests.begin();
-		while(it!=_receiveRequests.end())
+		for(MpiFactory::TypesMap::iterator itType=MpiFactory::instance()->beginTypes(); itType!=MpiFactory::instance()->endTypes(); itType++)
 		{
-			MpiOverlap* receive = *it;
-			MPI_Status status;
-			MPI_Test(&receive->_request, &finished, &status);
-			if(finished)
+			int typeId = GeneralState::agentTypes().getId(itType->first);
+			AgentsList agentsOfType;
+			for(AgentsList::iterator itAgent=agentsToTasks[i].begin(); itAgent!=agentsToTasks[i].end(); itAgent++)
 			{
-				it = _receiveRequests.erase(it);
-				log_DEBUG(logName.str(), getWallTime() << " receive request finished, lacking: " << _receiveRequests.size() << " requests");
-
-				const Rectangle<int> & overlapZone = receive->_overlap;
-				log_DEBUG(logName.str(), getWallTime() << " processing request for overlap: " << overlapZone << " raster: " << receive->_rasterName << " for max values");
-				for(size_t i=0; i<receive->_data.size(); i++)
-				{
-					Point2D<int> index(overlapZone._origin._x+i%overlapZone._size._width, overlapZone._origin._y+i/overlapZone._size._width);
-					if(updateMaxValues)
-					{
-						log_EDEBUG(logName.str(), "\t" << getWallTime() << " step: " << _world->getCurrentStep() << " receive index: " << index << " max value: " << receive->_data.at(i));
-						_world->getDynamicRaster(receive->_rasterName).setMaxValue(index, receive->_data.at(i));
-					}
-					else
-					{
-						log_EDEBUG(logName.str(), "\t" << getWallTime() << " step: " << _world->getCurrentStep() << " receive index: " << index << " current value: " << receive->_data.at(i));
-						_world->getDynamicRaster(receive->_rasterName).setValue(index, receive->_data.at(i));
-					}
-				}
-
-				if(updateMaxValues)
+				if((*itAgent)->isType(typeId))
 				{
-					log_DEBUG(logName.str(), getWallTime() << " receive request finished for max values of raster: " <<  receive->_rasterName);
+					agentsOfType.push_back(*itAgent);
 				}
-				else
-				{
-					log_DEBUG(logName.str(), getWallTime() << " receive request finished for current values of raster: " <<  receive->_rasterName);
-				}
-				delete receive;
 			}
+			packAgents(buffer, agentsOfType, itType->second);
 		}
+		offsets[i+1] = buffer.getSize();
 	}
-	
-}
+	buffer.allToAll(offsets, _receiveBuffer);
 
-int SpacePartition::getIdFromPosition( const Point2D<int> & position )
-{
-	Point2D<int> nodePosition(position._x/_ownedArea._size._width, position._y/_ownedArea._size._height);
-	return nodePosition._y*sqrt(_numTasks)+nodePosition._x;
-}
-
-Point2D<int> SpacePartition::getPositionFromId( const int & id ) const
-{
-	int worldsPerRow = sqrt(_numTasks);
-	Point2D<int> worldPos(id%worldsPerRow, id/worldsPerRow);
-	return worldPos;
-}
-
-int SpacePartition::getNeighborIndex( const int & id )
-{
-	for(size_t i=0; i<_neighbors.size(); i++)
+	for(int i=0; i<_numTasks; i++)
 	{
-		if(_neighbors[i] == id)
+		for(MpiFactory::TypesMap::iterator itType=MpiFactory::instance()->beginTypes(); itType!=MpiFactory::instance()->endTypes(); itType++)
 		{
-			return i;
+			int typeId = GeneralState::agentTypes().getId(itType->first);
+			int numAgentsToReceive = 0;
+			_receiveBuffer.unpack(numAgentsToReceive);
+			for(int j=0; j<numAgentsToReceive; j++)
+			{
+				_world->addAgent(unpackAgent(_receiveBuffer, typeId, itType->second), false);
+			}
 		}
 	}
-	std::stringstream oss;
-	oss << "SpacePartition::getNeighborIndex- " << _id << " looking for neighbor with id: " << id << " not found";
-	throw Exception(oss.str());
 }
 
-void SpacePartition::executeAgents()
+void SpacePartition::completeSends()
 {
-	for(int sectionIndex=0; sectionIndex<4; sectionIndex++)
+	if(!_migrationRequests.empty())
 	{
-		// section index doesn't matter if is the entire overlap
-		// TODO refactor? we are sending 4 times all the info
-		sendOverlapZones(sectionIndex, false);
-		receiveOverlapData(sectionIndex, false);
+		MPI_Waitall(_migrationRequests.size(), &_migrationRequests[0], MPI_STATUSES_IGNORE);
 	}
-	
-	std::stringstream logName;
-	logName << "simulation_" << getId();
-
-	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " has executed update overlap");
-	_executedAgentsHash.clear();
-
-	std::stringstream logNameMpi;
-	logNameMpi << "simulation_" << _id;
-
-	log_DEBUG(logName.str(), getWallTime() << " step: " << _world->getCurrentStep() << " executing sections");
+	if(!_ghostRequests.empty())
+	{
+		MPI_Waitall(_ghostRequests.size(), &_ghostRequests[0], MPI_STATUSES_IGNORE);
+	}
+	_overlapExchange.clear();
 	for(int sectionIndex=0; sectionIndex<4; sectionIndex++)
 	{
-		stepSection(sectionIndex);
-		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " has been executed");
-		receiveAgents(sectionIndex);
-		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " has received agents");
-
-		sendGhostAgents(sectionIndex);
-		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " sent ghosts");
-		receiveGhostAgents(sectionIndex);
-		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " received ghosts");
-
-		sendOverlapZones(sectionIndex);
-		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " sent overlap");
-		receiveOverlapData(sectionIndex);
-		log_DEBUG(logNameMpi.str(), getWallTime() << " executing step: " << _world->getCurrentStep() << " and section: " << sectionIndex << " received overlap" );
-		MPI_Barrier(MPI_COMM_WORLD);
+		_sectionExchanges[sectionIndex].clear();
 	}
 }
 
 void SpacePartition::initOverlappingData()
 {
-	// we need to send the agents and data in overlap zone to adjacent computer nodes	
-	sendMaxOverlapZones();
-	receiveMaxOverlapData();
+	_migrationBuffers.resize(_neighbors.size());
+	_ghostBuffers.resize(_neighbors.size());
+	_migrationRequests.resize(_neighbors.size(), MPI_REQUEST_NULL);
+	_ghostRequests.resize(_neighbors.size(), MPI_REQUEST_NULL);
 
-	clearRequests(true);
-	// all nodes must finish receiving max values before receiving current values
-	MPI_Barrier(MPI_COMM_WORLD);
+	// at the beginning of each step every neighbour sends the cells it owns inside our overlap
+	for(size_t i=0; i<_neighbors.size(); i++)
+	{
+		_overlapExchange.addSend(_neighbors[i], getInternalOverlap(_neighbors[i]));
+		_overlapExchange.addReceive(_neighbors[i], getExternalOverlap(_neighbors[i]));
+	}
+	_overlapExchange.init(*_world, eRasterData);
 
+	// after executing a section its entire overlap is sent to the neighbours sharing it
 	for(int sectionIndex=0; sectionIndex<4; sectionIndex++)
 	{
+		for(size_t i=0; i<_neighbors.size(); i++)
+		{
+			if(needsToBeUpdated(_neighbors[i], sectionIndex))
+			{
+				_sectionExchanges[sectionIndex].addSend(_neighbors[i], getOverlap(_neighbors[i], sectionIndex));
+			}
+			if(needsToReceiveData(_neighbors[i], sectionIndex))
+			{
+				_sectionExchanges[sectionIndex].addReceive(_neighbors[i], getOverlap(_neighbors[i], sectionIndex));
+			}
+		}
+		_sectionExchanges[sectionIndex].init(*_world, eRasterSectionData+sectionIndex);
+	}
 
-		// section index doesn't matter if is the entire overlap
-		// TODO refactor? we are sending 4 times all the info
-		sendOverlapZones(sectionIndex, false);
-		receiveOverlapData(sectionIndex, false);
-		clearRequests(false);
-		
-		// all nodes must finish receiving max values before receiving current values
-		MPI_Barrier(MPI_COMM_WORLD);
+	// max values must be received before current values
+	_overlapExchange.exchange(true);
+	_overlapExchange.exchange();
 
+	for(int sectionIndex=0; sectionIndex<4; sectionIndex++)
+	{
 		sendGhostAgents(sectionIndex);
 		receiveGhostAgents(sectionIndex);
 	}
-
 }
 
 void SpacePartition::finish()
@@ -858,6 +911,9 @@ void SpacePartition::finish()
 
 	_serializer.finish();
 
+	completeSends();
+	_progressThread.stop();
+
 	log_INFO(logName.str(), getWallTime() << " simulation finished");
 	if(_finalize)
 	{
@@ -1409,29 +1465,101 @@ bool SpacePartition::hasBeenExecuted( const std::string & id ) const
 
 void SpacePartition::agentAdded( AgentPtr agent, bool executedAgent )
 {
+	// World::addAgent pushes new agents at the end of the list
+	AgentsList::iterator itOwned = _world->endAgents();
+	itOwned--;
+	_ownedAgentsById[agent->getId()] = itOwned;
+	_spatialIndex.addAgent(agent);
+	if(!executedAgent)
+	{
+		return;
+	}
+
 	_executedAgentsHash.insert(make_pair(agent->getId(), agent));
 	AgentsList::iterator it = getGhostAgent(agent->getId());
 	if(it!=_overlapAgents.end())
 	{
-		_overlapAgents.erase(it);
+		eraseGhostAgent(it);
 	}
+}
 
-	if(!executedAgent)
+void SpacePartition::agentMoved( Agent * agent )
+{
+	_spatialIndex.updateAgent(agent);
+}
+
+void SpacePartition::agentIdChanged( const std::string & oldId, Agent * agent )
+{
+	const std::string & newId = agent->getId();
+	std::unordered_map<std::string, AgentsList::iterator>::iterator itOwned = _ownedAgentsById.find(oldId);
+	if(itOwned!=_ownedAgentsById.end())
 	{
-		return;
+		AgentsList::iterator it = itOwned->second;
+		_ownedAgentsById.erase(itOwned);
+		_ownedAgentsById[newId] = it;
+	}
+	std::unordered_map<std::string, AgentsList::iterator>::iterator itGhost = _ghostAgentsById.find(oldId);
+	if(itGhost!=_ghostAgentsById.end())
+	{
+		AgentsList::iterator it = itGhost->second;
+		_ghostAgentsById.erase(itGhost);
+		_ghostAgentsById[newId] = it;
+	}
+	std::unordered_map<std::string, std::weak_ptr<Agent> >::iterator itExecuted = _executedAgentsHash.find(oldId);
+	if(itExecuted!=_executedAgentsHash.end())
+	{
+		std::weak_ptr<Agent> executed = itExecuted->second;
+		_executedAgentsHash.erase(itExecuted);
+		_executedAgentsHash[newId] = executed;
+	}
+	if(_removedAgentsIds.erase(oldId))
+	{
+		_removedAgentsIds.insert(newId);
+	}
+}
+
+void SpacePartition::addGhostAgent( AgentPtr agent )
+{
+	_overlapAgents.push_back(agent);
+	AgentsList::iterator it = _overlapAgents.end();
+	it--;
+	_ghostAgentsById[agent->getId()] = it;
+	_spatialIndex.addAgent(agent);
+}
+
+AgentsList::iterator SpacePartition::eraseGhostAgent( AgentsList::iterator it )
+{
+	Agent * agent = it->get();
+	std::unordered_map<std::string, AgentsList::iterator>::iterator itId = _ghostAgentsById.find(agent->getId());
+	// the entry could belong to a newer copy of the agent
+	if(itId!=_ghostAgentsById.end() && itId->second==it)
+	{
+		_ghostAgentsById.erase(itId);
 	}
+	_spatialIndex.removeAgent(agent);
+	return _overlapAgents.erase(it);
+}
+
+void SpacePartition::eraseOwnedAgent( AgentsList::iterator it )
+{
+	Agent * agent = it->get();
+	std::unordered_map<std::string, AgentsList::iterator>::iterator itId = _ownedAgentsById.find(agent->getId());
+	if(itId!=_ownedAgentsById.end() && itId->second==it)
+	{
+		_ownedAgentsById.erase(itId);
+	}
+	_spatialIndex.removeAgent(agent);
+	_world->eraseAgent(it);
 }
 
 AgentsList::iterator SpacePartition::getGhostAgent( const std::string & id )
 {
-	for(AgentsList::iterator it=_overlapAgents.begin(); it!=_overlapAgents.end(); it++)		
+	std::unordered_map<std::string, AgentsList::iterator>::iterator it = _ghostAgentsById.find(id);
+	if(it==_ghostAgentsById.end())
 	{
-		if((*it)->getId().compare(id)==0)
-		{
-			return it;
-		}
-	}	
-	return _overlapAgents.end();
+		return _overlapAgents.end();
+	}
+	return it->second;
 }
 
 Agent * SpacePartition::getAgent( const std::string & id )
@@ -1469,6 +1597,7 @@ void SpacePartition::removeAgent( Agent * agent )
 	// TODO it is not needed if it has modified position, as it is already done after the executed of a given agent step
 	//sendDeleteOverlapAgent(it, agent->getPosition());
 	_removedAgents.push_back(*it);
+	_removedAgentsIds.insert(agent->getId());
 }
 
 void SpacePartition::removeAgents()
@@ -1485,35 +1614,38 @@ void SpacePartition::removeAgents()
 			throw Exception(oss.str());
 			return;
 		}
-		_world->eraseAgent(itAg);
+		eraseOwnedAgent(itAg);
 		it = _removedAgents.erase(it);
 	}
 	_removedAgents.clear();
+	_removedAgentsIds.clear();
 }
 
 AgentsVector SpacePartition::getAgent( const Point2D<int> & position, const std::string & type )
 {
-	AgentsVector result;
-	for(AgentsList::iterator it=_world->beginAgents(); it!=_world->endAgents(); it++)
+	// the index contains both owned and ghost agents
+	AgentsVector candidates;
+	// position could be in a region executed concurrently
+	if(_parallelActions)
 	{
-        AgentPtr agent = *it;
-		if(agent->getPosition().isEqual(position))
-		{
-			if(type.compare("all")==0 || agent->isType(type))
-			{
-				result.push_back(agent);
-			}
-		}
+		#pragma omp critical(agentsIndex)
+		candidates = _spatialIndex.getAgents(position);
+	}
+	else
+	{
+		candidates = _spatialIndex.getAgents(position);
 	}
-	for(AgentsList::iterator it=_overlapAgents.begin(); it!=_overlapAgents.end(); it++)		
+	if(type.compare("all")==0)
 	{
-        AgentPtr agent = *it;
-		if(agent->getPosition().isEqual(position))
-		{	
-			if(type.compare("all")==0 || agent->isType(type))
-			{
-				result.push_back(agent);
-			}
+		return candidates;
+	}
+	int typeId = GeneralState::agentTypes().getId(type);
+	AgentsVector result;
+	for(size_t i=0; i<candidates.size(); i++)
+	{
+		if(candidates[i]->isType(typeId))
+		{
+			result.push_back(candidates[i]);
 		}
 	}
 	return result;
@@ -1521,32 +1653,28 @@ AgentsVector SpacePartition::getAgent( const Point2D<int> & position, const std:
 
 AgentsList::iterator SpacePartition::getOwnedAgent( const std::string & id )
 {
-	for(AgentsList::iterator it=_world->beginAgents(); it!=_world->endAgents(); it++)
+	std::unordered_map<std::string, AgentsList::iterator>::iterator it = _ownedAgentsById.find(id);
+	if(it==_ownedAgentsById.end())
 	{
-		if((*it)->getId().compare(id)==0)
-		{
-			return it;
-		}
+		return _world->endAgents();
 	}
-	return _world->endAgents();
+	return it->second;
 }
 
 bool SpacePartition::willBeRemoved( const std::string & id )
 {
-	for(AgentsList::iterator it=_removedAgents.begin(); it!=_removedAgents.end(); it++)
-	{	
-		if((*it)->getId().compare(id)==0)
-		{
-			return true;
-		}
-	}
-	return false;
+	return _removedAgentsIds.find(id)!=_removedAgentsIds.end();
 }
 
 const Rectangle<int> & SpacePartition::getOwnedArea() const
 {
 	return _ownedArea;
 }
+
+const Size<int> & SpacePartition::getNumPartitions() const
+{
+	return _decomposition.getNumPartitions();
+}
 	
 Point2D<int> SpacePartition::getRealPosition( const Point2D<int> & globalPosition ) const
 {
@@ -1592,17 +1720,32 @@ void SpacePartition::serializeRasters( const int & step )
 
 int SpacePartition::countNeighbours( Agent * target, const double & radius, const std::string & type )
 {
-	int numAgents = for_each(_world->beginAgents(), _world->endAgents(), aggregatorCount<std::shared_ptr<Agent> >(radius,*target, type))._count;
-	int numOverlapAgents = for_each(_overlapAgents.begin(), _overlapAgents.end(), aggregatorCount<std::shared_ptr<Agent> >(radius,*target, type))._count;
-	return numAgents+numOverlapAgents;
+	// the index contains both owned and ghost agents
+	// queries beyond the overlap could read cells modified by regions executed concurrently
+	if(_parallelActions && radius>_overlap)
+	{
+		int count = 0;
+		#pragma omp critical(agentsIndex)
+		count = _spatialIndex.forEachInRadius(target->getPosition(), radius, aggregatorCount<std::shared_ptr<Agent> >(radius,*target, type))._count;
+		return count;
+	}
+	return _spatialIndex.forEachInRadius(target->getPosition(), radius, aggregatorCount<std::shared_ptr<Agent> >(radius,*target, type))._count;
 }
 
 AgentsVector SpacePartition::getNeighbours( Agent * target, const double & radius, const std::string & type )
 {
-	AgentsVector agentsVector = for_each(_world->beginAgents(), _world->endAgents(), aggregatorGet<std::shared_ptr<Agent> >(radius,*target, type))._neighbors;
-	AgentsVector overlapAgentsVector =  for_each(_overlapAgents.begin(), _overlapAgents.end(), aggregatorGet<std::shared_ptr<Agent> >(radius,*target, type))._neighbors;
-	std::copy(overlapAgentsVector.begin(), overlapAgentsVector.end(), std::back_inserter(agentsVector));
-	std::random_shuffle(agentsVector.begin(), agentsVector.end());
+	// the index contains both owned and ghost agents
+	AgentsVector agentsVector;
+	if(_parallelActions && radius>_overlap)
+	{
+		#pragma omp critical(agentsIndex)
+		agentsVector = _spatialIndex.forEachInRadius(target->getPosition(), radius, aggregatorGet<std::shared_ptr<Agent> >(radius,*target, type))._neighbors;
+	}
+	else
+	{
+		agentsVector = _spatialIndex.forEachInRadius(target->getPosition(), radius, aggregatorGet<std::shared_ptr<Agent> >(radius,*target, type))._neighbors;
+	}
+	GeneralState::statistics().shuffle(agentsVector.begin(), agentsVector.end());
 	return agentsVector;
 }
 	
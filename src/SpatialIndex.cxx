@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <SpatialIndex.hxx>
+#include <Agent.hxx>
+#include <Exception.hxx>
+
+#include <sstream>
+#include <algorithm>
+
+namespace Engine
+{
+
+SpatialIndex::SpatialIndex( const int & cellSize ) : _cellSize(cellSize), _numCells(0,0)
+{
+	if(_cellSize<1)
+	{
+		std::stringstream oss;
+		oss << "SpatialIndex::SpatialIndex - cell size: " << _cellSize << " must be greater than 0";
+		throw Exception(oss.str());
+	}
+}
+
+SpatialIndex::~SpatialIndex()
+{
+}
+
+void SpatialIndex::resize( const Rectangle<int> & boundaries )
+{
+	_boundaries = boundaries;
+	_numCells._width = std::max(1, 1+(_boundaries._size._width-1)/_cellSize);
+	_numCells._height = std::max(1, 1+(_boundaries._size._height-1)/_cellSize);
+	_cells.clear();
+	_cells.resize(_numCells._width*_numCells._height);
+	_agentCells.clear();
+}
+
+void SpatialIndex::clear()
+{
+	for(size_t i=0; i<_cells.size(); i++)
+	{
+		_cells[i].clear();
+	}
+	_agentCells.clear();
+}
+
+int SpatialIndex::getCellIndex( const Point2D<int> & position ) const
+{
+	int x = clampCell(double(position._x-_boundaries._origin._x)/_cellSize, _numCells._width);
+	int y = clampCell(double(position._y-_boundaries._origin._y)/_cellSize, _numCells._height);
+	return y*_numCells._width+x;
+}
+
+AgentPtr SpatialIndex::eraseFromCell( Agent * agent, const int & cellIndex )
+{
+	AgentsVector & cell = _cells[cellIndex];
+	for(size_t i=0; i<cell.size(); i++)
+	{
+		if(cell[i].get()==agent)
+		{
+			AgentPtr agentPtr = cell[i];
+			cell[i] = cell.back();
+			cell.pop_back();
+			return agentPtr;
+		}
+	}
+	std::stringstream oss;
+	oss << "SpatialIndex::eraseFromCell - agent: " << agent << " not found in cell: " << cellIndex;
+	throw Exception(oss.str());
+}
+
+void SpatialIndex::addAgent( AgentPtr agent )
+{
+	if(_cells.empty())
+	{
+		return;
+	}
+	std::unordered_map<Agent *, int>::iterator it = _agentCells.find(agent.get());
+	if(it!=_agentCells.end())
+	{
+		updateAgent(agent.get());
+		return;
+	}
+	int cellIndex = getCellIndex(agent->getPosition());
+	_cells[cellIndex].push_back(agent);
+	_agentCells.insert(std::make_pair(agent.get(), cellIndex));
+}
+
+void SpatialIndex::removeAgent( Agent * agent )
+{
+	std::unordered_map<Agent *, int>::iterator it = _agentCells.find(agent);
+	if(it==_agentCells.end())
+	{
+		return;
+	}
+	eraseFromCell(agent, it->second);
+	_agentCells.erase(it);
+}
+
+void SpatialIndex::updateAgent( Agent * agent )
+{
+	std::unordered_map<Agent *, int>::iterator it = _agentCells.find(agent);
+	if(it==_agentCells.end())
+	{
+		return;
+	}
+	int cellIndex = getCellIndex(agent->getPosition());
+	if(cellIndex==it->second)
+	{
+		return;
+	}
+	_cells[cellIndex].push_back(eraseFromCell(agent, it->second));
+	it->second = cellIndex;
+}
+
+AgentsVector SpatialIndex::getAgents( const Point2D<int> & position ) const
+{
+	AgentsVector result;
+	if(_cells.empty())
+	{
+		return result;
+	}
+	const AgentsVector & cell = _cells[getCellIndex(position)];
+	for(size_t i=0; i<cell.size(); i++)
+	{
+		const Point2D<int> & agentPosition = cell[i]->getPosition();
+		if(agentPosition._x==position._x && agentPosition._y==position._y)
+		{
+			result.push_back(cell[i]);
+		}
+	}
+	return result;
+}
+
+void SpatialIndex::updateAll()
+{
+	for(size_t i=0; i<_cells.size(); i++)
+	{
+		AgentsVector & cell = _cells[i];
+		size_t j = 0;
+		while(j<cell.size())
+		{
+			int cellIndex = getCellIndex(cell[j]->getPosition());
+			if(cellIndex==(int)i)
+			{
+				j++;
+				continue;
+			}
+			// the agent is moved to a different cell; the last one of this cell takes its place
+			_agentCells[cell[j].get()] = cellIndex;
+			_cells[cellIndex].push_back(cell[j]);
+			cell[j] = cell.back();
+			cell.pop_back();
+		}
+	}
+}
+
+} // namespace Engine
+
@@ -21,10 +21,12 @@
  */
 
 #include <StaticRaster.hxx>
+#include <RasterKernels.hxx>
 #include <Exception.hxx>
 #include <World.hxx>
 #include <limits>
 #include <iostream>
+#include <algorithm>
 
 namespace Engine
 {
@@ -38,7 +40,8 @@ StaticRaster::~StaticRaster()
 }
 
 bool StaticRaster::operator==(const StaticRaster& other) const {
-	return _minValue == other._minValue &&
+	return _size == other._size &&
+	       _minValue == other._minValue &&
 	       _maxValue == other._maxValue &&
 	       _values == other._values &&
 	       _hasColorTable == other._hasColorTable &&
@@ -51,37 +54,49 @@ bool StaticRaster::operator!=(const StaticRaster& other) const {
 
 void StaticRaster::resize( const Size<int> & size )
 {
-	_values.resize(size._width);
-	for(int i=0; i<size._width; i++)
-	{
-		_values[i].resize(size._height);
-	}
+	_size = size;
+	_values.resize(size_t(size._width)*size._height);
 }
 
-const int & StaticRaster::getValue( const Point2D<int>& position ) const
+void StaticRaster::checkBounds( const Point2D<int> & position, const std::string & method ) const
 {
-	if(position._x<0 || position._x>=_values.size())
-	{
-		std::stringstream oss;
-		oss << "StaticRaster::getValue - " << position << " x out of bounds: " << _values.size();
-		throw Exception(oss.str());
-	}
-	if(position._y<0 || position._y>=_values[position._x].size())
+	if(position._x<0 || position._x>=_size._width || position._y<0 || position._y>=_size._height)
 	{
 		std::stringstream oss;
-		oss << "StaticRaster::getValue - " << position << " y out of bounds: " << _values.size() << "/" << _values[position._x].size();
+		oss << method << " - " << position << " out of bounds: " << _size;
 		throw Exception(oss.str());
 	}
-	return _values[position._x][position._y];
+}
+
+void StaticRaster::throwNotDense( const char * method ) const
+{
+	std::stringstream oss;
+	oss << method << " - raster of type: " << getValueType() << " and size: " << _size << " does not store its cells in a dense int buffer";
+	throw Exception(oss.str());
+}
+
+int StaticRaster::getValue( const Point2D<int>& position ) const
+{
+#ifdef PANDORADEBUG
+	checkBounds(position, "StaticRaster::getValue");
+#endif
+	return _values[getIndex(position)];
+}
+
+void StaticRaster::copyRow( const int & y, const int & x, const int & width, int * values ) const
+{
+	const int * row = getRow(y)+x;
+	std::copy(row, row+width, values);
+}
+
+void StaticRaster::setLoadedValues( const std::vector<int> & values )
+{
+	std::copy(values.begin(), values.begin()+_values.size(), _values.begin());
 }
 
 Size<int> StaticRaster::getSize() const
 {
-	if(_values.size()==0)
-	{
-		return Size<int>(0,0);
-	}
-	return Size<int>(_values.size(), _values[0].size());
+	return _size;
 }
 
 const int & StaticRaster::getMinValue() const
@@ -94,38 +109,59 @@ const int & StaticRaster::getMaxValue() const
 	return _maxValue;
 }
 
-float StaticRaster::getAvgValue() const
+RasterValueType StaticRaster::getValueType() const
 {
-	if(_values.size()==0) 
-	{
-		return 0.0f;
-	}
-	float norm = 0.0f;
-	float avg = 0.0f;
+	return eRasterInt;
+}
+
+int StaticRaster::getNumBlocks() const
+{
+	return (_values.size()+RasterKernels::_blockSize-1)/RasterKernels::_blockSize;
+}
 
-	for(size_t i=0; i<_values.size(); i++)
+void StaticRaster::getStats( int & minValue, int & maxValue, long long & sum ) const
+{
+	minValue = std::numeric_limits<int>::max();
+	maxValue = std::numeric_limits<int>::min();
+	sum = 0;
+	int numBlocks = getNumBlocks();
+	#pragma omp parallel if(_values.size()>=RasterKernels::_parallelThreshold)
 	{
-		for(size_t j=0; j<_values[i].size(); j++)
-		{		
-			norm += 1.0;
-			avg += _values[i][j];
+		int localMin = std::numeric_limits<int>::max();
+		int localMax = std::numeric_limits<int>::min();
+		long long localSum = 0;
+		#pragma omp for schedule(static)
+		for(int i=0; i<numBlocks; i++)
+		{
+			size_t begin = i*RasterKernels::_blockSize;
+			size_t size = std::min(RasterKernels::_blockSize, _values.size()-begin);
+			RasterKernels::accumulate(&_values[begin], size, localMin, localMax, localSum);
+		}
+		#pragma omp critical(rasterStats)
+		{
+			minValue = std::min(minValue, localMin);
+			maxValue = std::max(maxValue, localMax);
+			sum += localSum;
 		}
 	}
-	return avg / norm;
 }
 
-void StaticRaster::updateMinMaxValues()
+float StaticRaster::getAvgValue() const
 {
-	_minValue = std::numeric_limits<int>::max();
-	_maxValue = std::numeric_limits<int>::min();
-	for(size_t i=0; i<_values.size(); i++)
+	if(_size._width*_size._height==0) 
 	{
-		for(size_t j=0; j<_values[i].size(); j++)
-		{
-			_minValue = std::min(_minValue, _values[i][j]);
-			_maxValue = std::max(_maxValue, _values[i][j]);
-		}
+		return 0.0f;
 	}
+	int minValue, maxValue;
+	long long sum;
+	getStats(minValue, maxValue, sum);
+	return float(double(sum)/(double(_size._width)*double(_size._height)));
+}
+
+void StaticRaster::updateMinMaxValues()
+{
+	long long sum;
+	getStats(_minValue, _maxValue, sum);
 }
 
 void StaticRaster::setColorTable( bool hasColorTable, int size )
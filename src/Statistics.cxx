@@ -31,12 +31,74 @@
 namespace Engine
 {
 
-Statistics::Statistics() :  _randomGenerator(getNewSeed()), _randomNumbers(0, _distributionSize-1), _nextRandomNumber(_randomGenerator,_randomNumbers), _next01Number(_randomGenerator)
+Statistics::Statistics() : _seed(0), _rank(0), _randomNumbers(0, _distributionSize-1)
 {
+	seedStreams(getNewSeed(), 0);
+}
+
+void Statistics::setSeed( uint64_t seed, int rank )
+{
+	seedStreams(seed, rank);
+}
+
+void Statistics::seedStreams( uint64_t seed, int rank )
+{
+	_seed = seed;
+	_rank = rank;
+	// enough engines for any thread that could be created
+	_streams.resize(std::max(omp_get_max_threads(), omp_get_num_procs()));
+	for(size_t i=0; i<_streams.size(); i++)
+	{
+		_streams[i]._engine.seed(getStreamSeed(seed, rank, i+1));
+	}
+	// distribution tables are the same for every task
+	_randomGenerator.seed(getStreamSeed(seed, 0, 0));
 	generateExponentialDistribution();
 	generateNormalDistribution();
 }
 
+// splitmix64 finalizer, so close seeds give unrelated streams
+static uint64_t mixSeed( uint64_t value )
+{
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+	return value ^ (value >> 31);
+}
+
+uint32_t Statistics::getStreamSeed( uint64_t seed, uint64_t rank, uint64_t thread )
+{
+	uint64_t value = mixSeed(seed + 0x9e3779b97f4a7c15ULL*(rank+1));
+	value = mixSeed(value + 0x9e3779b97f4a7c15ULL*(thread+1));
+	return uint32_t(value ^ (value >> 32));
+}
+
+void Statistics::seedTaskEngine( RandomEngine & engine, uint64_t step, uint64_t index ) const
+{
+	// the extra level keeps task substreams apart from thread substreams
+	uint64_t value = mixSeed(getStreamSeed(_seed, _rank, 0) + 0x9e3779b97f4a7c15ULL*(step+1));
+	value = mixSeed(value + 0x9e3779b97f4a7c15ULL*(index+1));
+	engine.seed(uint32_t(value ^ (value >> 32)));
+}
+
+Statistics::RandomEngine * Statistics::bindEngine( RandomEngine * engine ) const
+{
+	size_t thread = omp_get_thread_num();
+	if(thread>=_streams.size())
+	{
+		throwUnknownThread(thread);
+	}
+	RandomEngine * previous = _streams[thread]._bound;
+	_streams[thread]._bound = engine;
+	return previous;
+}
+
+void Statistics::throwUnknownThread( size_t thread ) const
+{
+	std::stringstream oss;
+	oss << "Statistics::getEngine - thread: " << thread << " does not have a random engine, number of engines: " << _streams.size();
+	throw Exception(oss.str());
+}
+
 void Statistics::generateExponentialDistribution()
 {
 	boost::exponential_distribution<> distribution; 
@@ -107,7 +169,7 @@ float Statistics::getExponentialDistValue( float min, float max ) const
 		oss << " Statistics::getExponentialDistValue - getting value with min: " << min << " and max: " << max << " before initializing distribution";		
 		throw Exception(oss.str());
 	}
-	int index = _nextRandomNumber();
+	int index = _randomNumbers(getEngine());
 	float value = _exponentialDistribution[index];
 	float diff = max - min;
 	value *= diff;
@@ -123,7 +185,7 @@ float Statistics::getNormalDistValueMinMax( float min, float max ) const
 		oss << " Statistics::getNormalDistValue - getting value with min: " << min << " and max: " << max << " before initializing distribution";		
 		throw Exception(oss.str());
 	}
-	int index = _nextRandomNumber();
+	int index = _randomNumbers(getEngine());
 	float value = _normalDistribution[index];
 	float diff = max - min;
 	value *= diff;
@@ -133,27 +195,24 @@ float Statistics::getNormalDistValueMinMax( float min, float max ) const
 
 float Statistics::getNormalDistValue( float mean, float sd )
 {
-    RandomEngine rng(getNewSeed());
     boost::normal_distribution<> nd(mean, sd);
-    boost::variate_generator<RandomEngine, boost::normal_distribution<> > var_nor(rng, nd);
-    return var_nor();
+    return nd(getEngine());
 }
 
 int Statistics::getUniformDistValue( int min, int max ) const
 {	
-	float rand = float(_nextRandomNumber())/float(_distributionSize);
-	float fMin=min;
-	float fMax=max;
-
-	int value = ((1.0f+fMax-fMin)*rand);
-	value     = value + fMin;
-
-	return value;
+	if(max<=min)
+	{
+		return min;
+	}
+	boost::uniform_int<> distribution(min, max);
+	return distribution(getEngine());
 }
 
 float Statistics::getUniformDistValue()
 {
-    return _next01Number();
+    boost::uniform_01<float> distribution;
+    return distribution(getEngine());
 }
 
 uint64_t Statistics::getNewSeed()
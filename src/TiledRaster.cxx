@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2014
+ * COMPUTER APPLICATIONS IN SCIENCE & ENGINEERING
+ * BARCELONA SUPERCOMPUTING CENTRE - CENTRO NACIONAL DE SUPERCOMPUTACIÓN
+ * http://www.bsc.es
+
+ * This file is part of Pandora Library. This library is free software; 
+ * you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation;
+ * either version 3.0 of the License, or (at your option) any later version.
+ * 
+ * Pandora is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public 
+ * License along with this library.  If not, see <http://www.gnu.org/licenses/>.
+ * 
+ */
+
+#include <TiledRaster.hxx>
+#include <Exception.hxx>
+
+#include <sstream>
+#include <limits>
+#include <algorithm>
+
+namespace Engine
+{
+
+const int TiledRaster::_tileSize;
+
+static const int cellsPerTile = TiledRaster::_tileSize*TiledRaster::_tileSize;
+
+TiledRaster::TiledRaster() : _increments(0)
+{
+}
+
+TiledRaster::~TiledRaster()
+{
+}
+
+void TiledRaster::resize( const Size<int> & size )
+{
+	// cells are stored in tiles instead of the dense buffers of DynamicRaster
+	_size = size;
+	_values.clear();
+	_maxValues.clear();
+	_numTiles._width = (size._width+_tileSize-1)/_tileSize;
+	_numTiles._height = (size._height+_tileSize-1)/_tileSize;
+	Tile tile;
+	tile._increments = _increments;
+	_tiles.assign(_numTiles._width*_numTiles._height, tile);
+}
+
+TiledRaster::Tile & TiledRaster::getTile( const Point2D<int> & position, int & cell )
+{
+#ifdef PANDORADEBUG
+	checkBounds(position, "TiledRaster::getTile");
+#endif
+	cell = (position._y%_tileSize)*_tileSize+position._x%_tileSize;
+	return _tiles[(position._y/_tileSize)*_numTiles._width+position._x/_tileSize];
+}
+
+const TiledRaster::Tile & TiledRaster::getTile( const Point2D<int> & position, int & cell ) const
+{
+#ifdef PANDORADEBUG
+	checkBounds(position, "TiledRaster::getTile");
+#endif
+	cell = (position._y%_tileSize)*_tileSize+position._x%_tileSize;
+	return _tiles[(position._y/_tileSize)*_numTiles._width+position._x/_tileSize];
+}
+
+int TiledRaster::getCellValue( const Tile & tile, const int & cell ) const
+{
+	int maxValue = getCellMaxValue(tile, cell);
+	if(tile._atMax)
+	{
+		return maxValue;
+	}
+	int value = tile._values.empty() ? tile._value : tile._values[cell];
+	if(value>=maxValue)
+	{
+		return value;
+	}
+	// regrowth of the increments not yet applied to the tile
+	long long grown = (long long)value+(_increments-tile._increments);
+	return grown<maxValue ? int(grown) : maxValue;
+}
+
+void TiledRaster::expandValues( Tile & tile ) const
+{
+	if(!tile._values.empty() && !tile._atMax && tile._increments==_increments)
+	{
+		return;
+	}
+	std::vector<int> values(cellsPerTile);
+	for(int i=0; i<cellsPerTile; i++)
+	{
+		values[i] = getCellValue(tile, i);
+	}
+	tile._values.swap(values);
+	tile._atMax = false;
+	tile._deficit = std::max(0, tile._deficit-(_increments-tile._increments));
+	tile._increments = _increments;
+}
+
+void TiledRaster::expandMaxValues( Tile & tile ) const
+{
+	if(tile._maxValues.empty())
+	{
+		tile._maxValues.assign(cellsPerTile, tile._maxValue);
+	}
+}
+
+void TiledRaster::compress( Tile & tile ) const
+{
+	tile._modified = false;
+	if(!tile._maxValues.empty() && std::count(tile._maxValues.begin(), tile._maxValues.end(), tile._maxValues[0])==cellsPerTile)
+	{
+		tile._maxValue = tile._maxValues[0];
+		std::vector<int>().swap(tile._maxValues);
+	}
+	if(tile._atMax)
+	{
+		return;
+	}
+	expandValues(tile);
+	bool uniform = true;
+	int deficit = 0;
+	for(int i=0; i<cellsPerTile; i++)
+	{
+		int value = tile._values[i];
+		int maxValue = getCellMaxValue(tile, i);
+		uniform = uniform && value==tile._values[0];
+		if(value>maxValue)
+		{
+			// regrowth does not lower values, so this tile will never be at max
+			deficit = std::numeric_limits<int>::max();
+		}
+		else if(deficit!=std::numeric_limits<int>::max())
+		{
+			deficit = std::max(deficit, maxValue-value);
+		}
+	}
+	tile._deficit = deficit;
+	if(deficit==0)
+	{
+		tile._atMax = true;
+		std::vector<int>().swap(tile._values);
+	}
+	else if(uniform)
+	{
+		tile._value = tile._values[0];
+		std::vector<int>().swap(tile._values);
+	}
+}
+
+int TiledRaster::getValue( const Point2D<int>& position ) const
+{
+	int cell = 0;
+	const Tile & tile = getTile(position, cell);
+	return getCellValue(tile, cell);
+}
+
+void TiledRaster::copyRow( const int & y, const int & x, const int & width, int * values ) const
+{
+	for(int i=0; i<width; i++)
+	{
+		values[i] = getValue(Point2D<int>(x+i, y));
+	}
+}
+
+int TiledRaster::getMaxValue( const Point2D<int>& position ) const
+{
+	int cell = 0;
+	const Tile & tile = getTile(position, cell);
+	return getCellMaxValue(tile, cell);
+}
+
+void TiledRaster::setValue( const Point2D<int>& position, int value )
+{
+	if(value>_maxValue)
+	{
+		std::stringstream oss;
+		oss << "TiledRaster::setValue - value: " << value << " bigger than max value: " << _maxValue << " at position: " << position;
+		throw Exception(oss.str());
+	}
+	int cell = 0;
+	Tile & tile = getTile(position, cell);
+	if(value>getCellMaxValue(tile, cell))
+	{
+		std::stringstream oss;
+		oss << "TiledRaster::setValue - value: " << value << " bigger than max value: " << getCellMaxValue(tile, cell) << " at position: " << position;
+		throw Exception(oss.str());
+	}
+	if(getCellValue(tile, cell)==value)
+	{
+		return;
+	}
+	expandValues(tile);
+	tile._values[cell] = value;
+	tile._modified = true;
+}
+
+void TiledRaster::setMaxValue( const Point2D<int>& position, int value )
+{
+	if(value>_maxValue)
+	{
+		std::stringstream oss;
+		oss << "TiledRaster::setMaxValue - value: " << value << " bigger than max value: " << _maxValue << " at pos: " << position;
+		throw Exception(oss.str());
+	}
+	int cell = 0;
+	Tile & tile = getTile(position, cell);
+	if(getCellMaxValue(tile, cell)==value)
+	{
+		return;
+	}
+	// values must be computed with the old max values
+	expandValues(tile);
+	expandMaxValues(tile);
+	tile._maxValues[cell] = value;
+	tile._modified = true;
+}
+
+void TiledRaster::copyMaxRow( const int & y, const int & x, const int & width, int * values ) const
+{
+	for(int i=0; i<width; i++)
+	{
+		values[i] = getMaxValue(Point2D<int>(x+i, y));
+	}
+}
+
+void TiledRaster::setRow( const int & y, const int & x, const int & width, const int * values )
+{
+	for(int i=0; i<width; i++)
+	{
+		int cell = 0;
+		Tile & tile = getTile(Point2D<int>(x+i, y), cell);
+		if(getCellValue(tile, cell)!=values[i])
+		{
+			expandValues(tile);
+			tile._values[cell] = values[i];
+			tile._modified = true;
+		}
+	}
+}
+
+void TiledRaster::setMaxRow( const int & y, const int & x, const int & width, const int * values )
+{
+	for(int i=0; i<width; i++)
+	{
+		int cell = 0;
+		Tile & tile = getTile(Point2D<int>(x+i, y), cell);
+		if(getCellMaxValue(tile, cell)!=values[i])
+		{
+			expandValues(tile);
+			expandMaxValues(tile);
+			tile._maxValues[cell] = values[i];
+			tile._modified = true;
+		}
+	}
+}
+
+void TiledRaster::setInitValues( int minValue, int maxValue, int defaultValue )
+{
+	if(defaultValue>maxValue)
+	{
+		std::stringstream oss;
+		oss << "TiledRaster::setInitValues - default value: " << defaultValue << " bigger than max value: " << maxValue;
+		throw Exception(oss.str());
+	}
+	_minValue = _currentMinValue = minValue;
+	_maxValue = _currentMaxValue = maxValue;
+	Tile tile;
+	tile._increments = _increments;
+	tile._value = defaultValue;
+	tile._maxValue = maxValue;
+	tile._deficit = maxValue-defaultValue;
+	tile._atMax = tile._deficit==0;
+	_tiles.assign(_tiles.size(), tile);
+}
+
+void TiledRaster::setLoadedValues( const std::vector<int> & values )
+{
+	for(int tileY=0; tileY<_numTiles._height; tileY++)
+	{
+		for(int tileX=0; tileX<_numTiles._width; tileX++)
+		{
+			Tile & tile = _tiles[tileY*_numTiles._width+tileX];
+			Point2D<int> origin(tileX*_tileSize, tileY*_tileSize);
+			// cells outside the raster copy the first cell of the tile, so they don't prevent compression
+			int first = values[origin._y*_size._width+origin._x];
+			tile._values.assign(cellsPerTile, first);
+			for(int y=0; y<_tileSize && origin._y+y<_size._height; y++)
+			{
+				for(int x=0; x<_tileSize && origin._x+x<_size._width; x++)
+				{
+					tile._values[y*_tileSize+x] = values[(origin._y+y)*_size._width+origin._x+x];
+				}
+			}
+			tile._maxValues = tile._values;
+			tile._atMax = false;
+			tile._increments = _increments;
+			compress(tile);
+		}
+	}
+}
+
+void TiledRaster::updateRasterIncrement()
+{
+	_increments++;
+	int numTiles = _tiles.size();
+	#pragma omp parallel for schedule(static) if(numTiles*cellsPerTile>=int(RasterKernels::_parallelThreshold))
+	for(int i=0; i<numTiles; i++)
+	{
+		Tile & tile = _tiles[i];
+		if(tile._modified)
+		{
+			compress(tile);
+		}
+		else if(!tile._atMax && _increments-tile._increments>=tile._deficit)
+		{
+			tile._atMax = true;
+			std::vector<int>().swap(tile._values);
+		}
+	}
+}
+
+void TiledRaster::updateRasterToMaxValues()
+{
+	for(size_t i=0; i<_tiles.size(); i++)
+	{
+		Tile & tile = _tiles[i];
+		tile._atMax = true;
+		std::vector<int>().swap(tile._values);
+		tile._increments = _increments;
+		tile._deficit = 0;
+		tile._modified = false;
+	}
+}
+
+void TiledRaster::getStats( int & minValue, int & maxValue, long long & sum ) const
+{
+	minValue = std::numeric_limits<int>::max();
+	maxValue = std::numeric_limits<int>::min();
+	sum = 0;
+	for(int tileY=0; tileY<_numTiles._height; tileY++)
+	{
+		for(int tileX=0; tileX<_numTiles._width; tileX++)
+		{
+			const Tile & tile = _tiles[tileY*_numTiles._width+tileX];
+			int width = std::min(_tileSize, _size._width-tileX*_tileSize);
+			int height = std::min(_tileSize, _size._height-tileY*_tileSize);
+			// every cell has the same value
+			if(tile._maxValues.empty() && (tile._atMax || tile._values.empty()))
+			{
+				int value = getCellValue(tile, 0);
+				minValue = std::min(minValue, value);
+				maxValue = std::max(maxValue, value);
+				sum += (long long)value*width*height;
+				continue;
+			}
+			for(int y=0; y<height; y++)
+			{
+				for(int x=0; x<width; x++)
+				{
+					int value = getCellValue(tile, y*_tileSize+x);
+					minValue = std::min(minValue, value);
+					maxValue = std::max(maxValue, value);
+					sum += value;
+				}
+			}
+		}
+	}
+}
+
+int TiledRaster::getNumExpandedTiles() const
+{
+	int numExpanded = 0;
+	for(size_t i=0; i<_tiles.size(); i++)
+	{
+		if(!_tiles[i]._values.empty() || !_tiles[i]._maxValues.empty())
+		{
+			numExpanded++;
+		}
+	}
+	return numExpanded;
+}
+
+} // namespace Engine
+
@@ -30,6 +30,8 @@
 
 #include <Logger.hxx>
 #include <Statistics.hxx>
+#include <TiledRaster.hxx>
+#include <NarrowRaster.hxx>
 
 #include <cstdlib>
 #include <iostream>
@@ -72,6 +74,10 @@ World::~World()
 void World::initialize(int argc, char *argv[])
 {
 	_scheduler->init(argc,argv);
+	if(_config->getRandomSeed()!=0)
+	{
+		GeneralState::statistics().setSeed(_config->getRandomSeed(), getId());
+	}
 
 	createRasters();
 	createAgents();		
@@ -95,9 +101,10 @@ void World::addAgent( Agent * agent, bool executedAgent )
 {
 	agent->setWorld(this);
     AgentPtr agentPtr(agent);
-	_agents.push_back(agentPtr);
-	if(executedAgent)
+	// agents can be created by other threads while executing actions in parallel
+	#pragma omp critical(agentsIndex)
 	{
+		_agents.push_back(agentPtr);
 		_scheduler->agentAdded(agentPtr, executedAgent);
 	}
 	
@@ -107,6 +114,17 @@ void World::addAgent( Agent * agent, bool executedAgent )
 }
 
 
+void World::agentMoved( Agent * agent )
+{
+	#pragma omp critical(agentsIndex)
+	_scheduler->agentMoved(agent);
+}
+
+void World::agentIdChanged( const std::string & oldId, Agent * agent )
+{
+	#pragma omp critical(agentsIndex)
+	_scheduler->agentIdChanged(oldId, agent);
+}
 
 void World::step()
 {
@@ -173,8 +191,14 @@ void World::stepRaster( const int & index  )
 	((DynamicRaster*)_rasters.at(index))->updateRasterIncrement();
 }
 
-void World::registerDynamicRaster( const std::string & key, const bool & serialize, int index )
+void World::registerDynamicRaster( const std::string & key, const bool & serialize, int index, const bool & tiled, const RasterValueType & valueType )
 {
+	if(tiled && valueType!=eRasterInt)
+	{
+		std::stringstream oss;
+		oss << "World::registerDynamicRaster - tiled raster: " << key << " can't use value type: " << valueType;
+		throw Exception(oss.str());
+	}
 	// if no index is provided, add one at the end
 	if(index==-1)
 	{
@@ -198,12 +222,27 @@ void World::registerDynamicRaster( const std::string & key, const bool & seriali
 	{
 		delete _rasters.at(index);
 	}
-	_rasters.at(index) = new DynamicRaster();
+	if(tiled)
+	{
+		_rasters.at(index) = new TiledRaster();
+	}
+	else if(valueType==eRasterShort)
+	{
+		_rasters.at(index) = new NarrowDynamicRaster<short>();
+	}
+	else if(valueType==eRasterByte)
+	{
+		_rasters.at(index) = new NarrowDynamicRaster<unsigned char>();
+	}
+	else
+	{
+		_rasters.at(index) = new DynamicRaster();
+	}
 	_rasters.at(index)->resize(_scheduler->getBoundaries()._size);
 	_serializeRasters.at(index) = serialize;
 }
 
-void World::registerStaticRaster( const std::string & key, const bool & serialize, int index )
+void World::registerStaticRaster( const std::string & key, const bool & serialize, int index, const RasterValueType & valueType )
 {
 	// if no index is provided, add one at the end
 	if(index==-1)
@@ -227,7 +266,18 @@ void World::registerStaticRaster( const std::string & key, const bool & serializ
 	{
 		delete _rasters.at(index);
 	}
-	_rasters.at(index) = new StaticRaster();
+	if(valueType==eRasterShort)
+	{
+		_rasters.at(index) = new NarrowStaticRaster<short>();
+	}
+	else if(valueType==eRasterByte)
+	{
+		_rasters.at(index) = new NarrowStaticRaster<unsigned char>();
+	}
+	else
+	{
+		_rasters.at(index) = new StaticRaster();
+	}
 	_rasters.at(index)->resize(_scheduler->getBoundaries()._size);
 	
 	_dynamicRasters.at(index) = false;
@@ -410,14 +460,14 @@ const std::string & World::getRasterName( const int & index) const
 }
 
 
-Scheduler * World::useSpacePartition(int overlap, bool finalize )
+Scheduler * World::useSpacePartition(int overlap, bool finalize, bool parallelActions, int rebalancePeriod )
 {
-	return new SpacePartition(overlap, finalize);
+	return new SpacePartition(overlap, finalize, parallelActions, rebalancePeriod);
 }
 
-Scheduler * World::useOpenMPSingleNode()
+Scheduler * World::useOpenMPSingleNode( int interactionRange )
 {
-	return new OpenMPSingleNode();
+	return new OpenMPSingleNode(interactionRange);
 }
 
 
@@ -426,12 +476,23 @@ const int & World::getNumTasks() const { return _scheduler->getNumTasks(); }
 const Rectangle<int> & World::getBoundaries() const{ return _scheduler->getBoundaries(); }
 void World::removeAgent( std::shared_ptr<Agent> agentPtr )
 {
-    Agent * agent = agentPtr.get();
-    _scheduler->removeAgent(agent);
+    removeAgent(agentPtr.get());
+}
+
+void World::removeAgent( Agent * agent )
+{
+	#pragma omp critical(agentsIndex)
+	_scheduler->removeAgent(agent);
+}
+
+Agent * World::getAgent( const std::string & id )
+{
+	Agent * agent = 0;
+	#pragma omp critical(agentsIndex)
+	agent = _scheduler->getAgent(id);
+	return agent;
 }
 
-void World::removeAgent( Agent * agent ) { _scheduler->removeAgent(agent); }
-Agent * World::getAgent( const std::string & id ) { return _scheduler->getAgent(id); }
 AgentsVector World::getAgent( const Point2D<int> & position, const std::string & type) { return _scheduler->getAgent(position, type); }
 void World::addStringAttribute( const std::string & type, const std::string & key, const std::string & value ) { _scheduler->addStringAttribute(type, key, value);}
 void World::addIntAttribute( const std::string & type, const std::string & key, int value ) { _scheduler->addIntAttribute(type, key, value); }
@@ -60,5 +60,15 @@ void AgentMean::postProcess()
 	}
 }
 
+void AgentMean::merge( const Analysis & partial )
+{
+	Analysis::merge(partial);
+	const AgentMean & mean = static_cast<const AgentMean &>(partial);
+	for(unsigned i=0; i<_numAgents.size(); i++)
+	{
+		_numAgents[i] += mean._numAgents.at(i);
+	}
+}
+
 } // namespace PostProcess
 
@@ -89,5 +89,15 @@ void AgentStdDev::postProcess()
 	}
 }
 
+void AgentStdDev::merge( const Analysis & partial )
+{
+	const AgentStdDev & stdDev = static_cast<const AgentStdDev &>(partial);
+	for(unsigned i=0; i<_numAgents.size(); i++)
+	{
+		_numAgents[i] += stdDev._numAgents.at(i);
+		_values[i].insert(_values[i].end(), stdDev._values.at(i).begin(), stdDev._values.at(i).end());
+	}
+}
+
 } // namespace PostProcess
 
@@ -56,6 +56,14 @@ long double Analysis::getResult( int timeStep ) const
 {
 	return _results.at(timeStep);
 }
+
+void Analysis::merge( const Analysis & partial )
+{
+	for(unsigned i=0; i<_results.size(); i++)
+	{
+		_results[i] += partial._results.at(i);
+	}
+}
 	
 } // namespace PostProcess
 
@@ -21,7 +21,10 @@
 
 #include <analysis/GlobalAgentStats.hxx>
 #include <analysis/Analysis.hxx>
+#include <AgentRecord.hxx>
+#include <Exception.hxx>
 #include <mpi.h>
+#include <omp.h>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
@@ -77,30 +80,40 @@ void GlobalAgentStats::apply( const Engine::SimulationRecord & simRecord, const
 		(*itL)->setNumTimeSteps(1+(simRecord.getNumSteps()/simRecord.getFinalResolution()));	
 		(*itL)->preProcess();
 		std::cout << "done" << std::endl;
-		std::cout << "Computing analysis: " << (*itL)->getName() << "...";
-		// all agents
-		if(type.compare("all")==0)
-		{	
-			for(Engine::SimulationRecord::AgentTypesMap::const_iterator it=simRecord.beginTypes(); it!=simRecord.endTypes(); it++)
+	}
+
+	// a single pass over the records of each type computes every analysis
+	std::cout << "Computing analyses...";
+	std::vector<const Engine::AgentRecord *> records;
+	// all agents
+	if(type.compare("all")==0)
+	{	
+		for(Engine::SimulationRecord::AgentTypesMap::const_iterator it=simRecord.beginTypes(); it!=simRecord.endTypes(); it++)
+		{
+			records.clear();
+			// the records of each type are loaded the first time they are iterated
+			for(Engine::SimulationRecord::AgentRecordsMap::const_iterator itA=simRecord.beginAgents(it); itA!=simRecord.endAgents(it); itA++)
 			{
-				const Engine::SimulationRecord::AgentRecordsMap & agentRecords = it->second;
-				for(Engine::SimulationRecord::AgentRecordsMap::const_iterator itA=agentRecords.begin(); itA!=agentRecords.end(); itA++)
-				{
-					(*itL)->computeAgent(*(itA->second));
-				}
+				records.push_back(itA->second);
 			}
+			computeAgents(records);
 		}
-		else
-		{	
-			if(simRecord.hasAgentType(type))
+	}
+	else
+	{	
+		if(simRecord.hasAgentType(type))
+		{
+			for(Engine::SimulationRecord::AgentRecordsMap::const_iterator it=simRecord.beginAgents(type); it!=simRecord.endAgents(type); it++)
 			{
-				for(Engine::SimulationRecord::AgentRecordsMap::const_iterator it=simRecord.beginAgents(type); it!=simRecord.endAgents(type); it++)
-				{
-					(*itL)->computeAgent(*(it->second));
-				}
+				records.push_back(it->second);
 			}
+			computeAgents(records);
 		}
-		std::cout << "done" << std::endl;
+	}
+	std::cout << "done" << std::endl;
+
+	for(AgentAnalysisList::const_iterator itL=_analysisList.begin(); itL!=_analysisList.end(); itL++)
+	{
 		std::cout << "Postprocessing analysis: " << (*itL)->getName() << "...";
 		(*itL)->postProcess();
 		std::cout << "done" << std::endl;
@@ -164,6 +177,97 @@ void GlobalAgentStats::apply( const Engine::SimulationRecord & simRecord, const
 	}
 }
 
+void GlobalAgentStats::computeAgents( const std::vector<const Engine::AgentRecord *> & records )
+{
+	std::vector<AgentAnalysis *> mergeable;
+	std::vector<AgentAnalysis *> serial;
+	for(AgentAnalysisList::const_iterator itL=_analysisList.begin(); itL!=_analysisList.end(); itL++)
+	{
+		if((*itL)->isMergeable())
+		{
+			mergeable.push_back(itL->get());
+		}
+		else
+		{
+			serial.push_back(itL->get());
+		}
+	}
+
+	int numThreads = omp_get_max_threads();
+	if(numThreads==1 || mergeable.empty() || records.size()<(size_t)numThreads)
+	{
+		for(size_t i=0; i<records.size(); i++)
+		{
+			for(AgentAnalysisList::const_iterator itL=_analysisList.begin(); itL!=_analysisList.end(); itL++)
+			{
+				(*itL)->computeAgent(*records[i]);
+			}
+		}
+		return;
+	}
+
+	// each thread fills copies of the mergeable analyses with a contiguous block of records
+	std::vector< std::vector<AgentAnalysis *> > partials(numThreads);
+	std::string error;
+	#pragma omp parallel num_threads(numThreads)
+	{
+		std::vector<AgentAnalysis *> & threadPartials = partials.at(omp_get_thread_num());
+		for(size_t j=0; j<mergeable.size(); j++)
+		{
+			AgentAnalysis * partial = mergeable[j]->clone();
+			partial->preProcess();
+			threadPartials.push_back(partial);
+		}
+		#pragma omp for schedule(static)
+		for(int i=0; i<(int)records.size(); i++)
+		{
+			try
+			{
+				for(size_t j=0; j<threadPartials.size(); j++)
+				{
+					threadPartials[j]->computeAgent(*records[i]);
+				}
+			}
+			catch(std::exception & exception)
+			{
+				#pragma omp critical(analysisError)
+				{
+					if(error.empty())
+					{
+						error = exception.what();
+					}
+				}
+			}
+		}
+	}
+
+	// merged in thread order, so results do not depend on scheduling
+	for(size_t t=0; t<partials.size(); t++)
+	{
+		for(size_t j=0; j<partials[t].size(); j++)
+		{
+			if(error.empty())
+			{
+				mergeable[j]->merge(*partials[t][j]);
+			}
+			delete partials[t][j];
+		}
+	}
+	if(!error.empty())
+	{
+		throw Engine::Exception(error);
+	}
+
+	// analyses that are not mergeable (i.e. python ones) are not thread-safe
+	for(size_t i=0; i<records.size(); i++)
+	{
+		for(size_t j=0; j<serial.size(); j++)
+		{
+			serial[j]->computeAgent(*records[i]);
+		}
+	}
+}
+
 void GlobalAgentStats::writeParams( std::stringstream & line, const std::string & fileName )
 {
 	std::cout << "line prev: " << line.str() << " file name: " << fileName << " input dir: " << _inputDir << std::endl;
@@ -21,6 +21,8 @@
 
 #include <analysis/GlobalRasterStats.hxx>
 #include <analysis/Analysis.hxx>
+#include <SimulationRecord.hxx>
+#include <DynamicRaster.hxx>
 #include <mpi.h>
 #include <iostream>
 #include <fstream>
@@ -71,28 +73,33 @@ void GlobalRasterStats::apply( const Engine::SimulationRecord & simRecord, const
 	}
 	file << header.str() << std::endl;;
 
+	int numTimeSteps = 1+(simRecord.getNumSteps()/simRecord.getFinalResolution());
 	for(RasterAnalysisList::const_iterator itL=_analysisList.begin(); itL!=_analysisList.end(); itL++)
 	{
 		std::cout << "Preprocessing analysis: " << (*itL)->getName() << "...";
-		(*itL)->setNumTimeSteps(1+(simRecord.getNumSteps()/simRecord.getFinalResolution()));	
+		(*itL)->setNumTimeSteps(numTimeSteps);	
 		(*itL)->preProcess();
 		std::cout << "done" << std::endl;
-		std::cout << "Computing analysis: " << (*itL)->getName() << "...";
-		// all agents
-		if(type.compare("all")==0)
-		{	
-			for(Engine::SimulationRecord::RasterMap::const_iterator it=simRecord.beginRasters(); it!=simRecord.endRasters(); it++)
-			{
-				const Engine::SimulationRecord::RasterHistory & rasterHistory = it->second;
-				(*itL)->computeRaster(rasterHistory);
-			}
-		}
-		else
+	}
+
+	// a single pass over the steps of each raster computes every analysis
+	std::cout << "Computing analyses...";
+	// all rasters
+	if(type.compare("all")==0)
+	{	
+		for(Engine::SimulationRecord::RasterMap::const_iterator it=simRecord.beginRasters(); it!=simRecord.endRasters(); it++)
 		{
-			const Engine::SimulationRecord::RasterHistory & rasterHistory = simRecord.getRasterHistory(type);
-			(*itL)->computeRaster(rasterHistory);
+			computeRaster(it->second, numTimeSteps);
 		}
-		std::cout << "done" << std::endl;
+	}
+	else
+	{
+		computeRaster(simRecord.getRasterHistory(type), numTimeSteps);
+	}
+	std::cout << "done" << std::endl;
+
+	for(RasterAnalysisList::const_iterator itL=_analysisList.begin(); itL!=_analysisList.end(); itL++)
+	{
 		std::cout << "Postprocessing analysis: " << (*itL)->getName() << "...";
 		(*itL)->postProcess();
 		std::cout << "done" << std::endl;
@@ -157,6 +164,39 @@ void GlobalRasterStats::apply( const Engine::SimulationRecord & simRecord, const
 	}
 }
 
+void GlobalRasterStats::computeRaster( const Engine::RasterHistory & rasterHistory, int numTimeSteps )
+{
+	std::vector<RasterAnalysis *> stepwise;
+	for(RasterAnalysisList::const_iterator itL=_analysisList.begin(); itL!=_analysisList.end(); itL++)
+	{
+		if((*itL)->isStepwise())
+		{
+			stepwise.push_back(itL->get());
+		}
+	}
+
+	if(!stepwise.empty())
+	{
+		for(int r=0; r<numTimeSteps; r++)
+		{
+			const Engine::DynamicRaster & raster = rasterHistory.at(r);
+			for(size_t j=0; j<stepwise.size(); j++)
+			{
+				stepwise[j]->computeRasterStep(raster, r);
+			}
+		}
+	}
+
+	// the rest of analyses receive the whole history
+	for(RasterAnalysisList::const_iterator itL=_analysisList.begin(); itL!=_analysisList.end(); itL++)
+	{
+		if(!(*itL)->isStepwise())
+		{
+			(*itL)->computeRaster(rasterHistory);
+		}
+	}
+}
+
 void GlobalRasterStats::writeParams( std::stringstream & line, const std::string & fileName )
 {
 		std::stringstream configFile;
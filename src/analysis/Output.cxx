@@ -62,8 +62,8 @@ void Output::apply( const Engine::SimulationRecord & simRecord, const std::strin
 	{
 		for(Engine::SimulationRecord::AgentTypesMap::const_iterator it=simRecord.beginTypes(); it!=simRecord.endTypes(); it++)
 		{		
-			const Engine::SimulationRecord::AgentRecordsMap & agentRecords = it->second;
-			for(Engine::SimulationRecord::AgentRecordsMap::const_iterator itA=agentRecords.begin(); itA!=agentRecords.end(); itA++)
+			// the records of each type are loaded the first time they are iterated
+			for(Engine::SimulationRecord::AgentRecordsMap::const_iterator itA=simRecord.beginAgents(it); itA!=simRecord.endAgents(it); itA++)
 			{
 				computeAgent(*(itA->second));
 			}
@@ -17,25 +17,24 @@ RasterMean::~RasterMean()
 
 void RasterMean::computeRaster( const Engine::SimulationRecord::RasterHistory & rasterHistory )
 {
+	for(unsigned r=0; r<_results.size(); r++)
+	{
+		computeRasterStep(rasterHistory.at(r), r);
+	}
+}
+
+void RasterMean::computeRasterStep( const Engine::DynamicRaster & raster, int timeStep )
+{
+	// the number of cells is taken from the first computed raster
 	if(_numCells==0)
 	{
-		if(rasterHistory.size()==0)
-		{
-			return;
-		}
-		const Engine::DynamicRaster & raster = rasterHistory.at(0);
 		_numCells = raster.getSize()._width * raster.getSize()._height;
 	}
-
-	for(unsigned r=0; r<_results.size(); r++)
+	for(int i=0; i<raster.getSize()._width; i++)
 	{
-		const Engine::DynamicRaster & raster = rasterHistory.at(r);
-		for(int i=0; i<raster.getSize()._width; i++)
+		for(int j=0; j<raster.getSize()._height; j++)
 		{
-			for(int j=0; j<raster.getSize()._height; j++)
-			{
-				_results.at(r) += raster.getValue(Engine::Point2D<int>(i,j));
-			}
+			_results.at(timeStep) += raster.getValue(Engine::Point2D<int>(i,j));
 		}
 	}
 }
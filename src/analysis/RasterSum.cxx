@@ -17,13 +17,17 @@ void RasterSum::computeRaster( const Engine::SimulationRecord::RasterHistory & r
 {
 	for(unsigned r=0; r<_results.size(); r++)
 	{
-		const Engine::DynamicRaster & raster = rasterHistory.at(r);
-		for(int i=0; i<raster.getSize()._width; i++)
+		computeRasterStep(rasterHistory.at(r), r);
+	}
+}
+
+void RasterSum::computeRasterStep( const Engine::DynamicRaster & raster, int timeStep )
+{
+	for(int i=0; i<raster.getSize()._width; i++)
+	{
+		for(int j=0; j<raster.getSize()._height; j++)
 		{
-			for(int j=0; j<raster.getSize()._height; j++)
-			{
-				_results.at(r) += raster.getValue(Engine::Point2D<int>(i,j));
-			}
+			_results.at(timeStep) += raster.getValue(Engine::Point2D<int>(i,j));
 		}
 	}
 }
@@ -221,17 +221,33 @@ public:
 	{
 		Engine::World::registerDynamicRaster(key, serialize, -1);			
 	}
+
+	void registerDynamicRasterTiled( const std::string & key, const bool & serialize, const bool & tiled )
+	{
+		Engine::World::registerDynamicRaster(key, serialize, -1, tiled);
+	}
+
+	void registerDynamicRasterTyped( const std::string & key, const bool & serialize, const bool & tiled, const Engine::RasterValueType & valueType )
+	{
+		Engine::World::registerDynamicRaster(key, serialize, -1, tiled, valueType);
+	}
 	
 	// needed to avoid expliciting default params
 	void registerStaticRasterSimple( const std::string & key, const bool & serialize )
 	{
 		Engine::World::registerStaticRaster(key, serialize, -1);			
 	}
+
+	void registerStaticRasterTyped( const std::string & key, const bool & serialize, const Engine::RasterValueType & valueType )
+	{
+		Engine::World::registerStaticRaster(key, serialize, -1, valueType);
+	}
 	
 	void addAgentSimple( std::shared_ptr<AgentWrap> agent)
 	{
         agent->setWorld(this);
     	_agents.push_back(agent);
+		_scheduler->agentAdded(agent, true);
 	}
 
     void configureSharedPtr( std::shared_ptr<ConfigWrap> config )
@@ -368,6 +384,8 @@ void (Engine::World::*setMaxValue)(const std::string&, const Engine::Point2D<int
 Engine::Agent * (Engine::World::*getAgent)(const std::string &) = &Engine::World::getAgent;
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(fillGDALRasterOverloads, fillGDALRaster, 2, 3)
+BOOST_PYTHON_FUNCTION_OVERLOADS(useSpacePartitionOverloads, Engine::World::useSpacePartition, 0, 4)
+BOOST_PYTHON_FUNCTION_OVERLOADS(useOpenMPSingleNodeOverloads, Engine::World::useOpenMPSingleNode, 0, 1)
 
 BOOST_PYTHON_MODULE(libpyPandora)
 {
@@ -404,10 +422,16 @@ BOOST_PYTHON_MODULE(libpyPandora)
 		.def("clone", &RectangleInt::clone)
 		;
 
+	boost::python::enum_< Engine::RasterValueType >("RasterValueType")
+		.value("eRasterInt", Engine::eRasterInt)
+		.value("eRasterShort", Engine::eRasterShort)
+		.value("eRasterByte", Engine::eRasterByte)
+		.export_values();
+
     boost::python::class_< Engine::StaticRaster, std::shared_ptr< Engine::StaticRaster> >("StaticRasterStub")
 		.def("resize", &Engine::StaticRaster::resize)
 		.def("getSize", &Engine::StaticRaster::getSize)
-		.def("getValue", boost::python::make_function(&Engine::StaticRaster::getValue, boost::python::return_value_policy<boost::python::copy_const_reference>()))
+		.def("getValue", &Engine::StaticRaster::getValue)
 
 	;
     
@@ -416,7 +440,7 @@ BOOST_PYTHON_MODULE(libpyPandora)
 		.def("setValue", &Engine::DynamicRaster::setValue)	
 		.def("resize", &Engine::DynamicRaster::resize)
 		.def("getSize", &Engine::DynamicRaster::getSize)
-		.def("getValue", boost::python::make_function(&Engine::DynamicRaster::getValue, boost::python::return_value_policy<boost::python::copy_const_reference>()))
+		.def("getValue", &Engine::DynamicRaster::getValue)
 	;
 
 
@@ -470,12 +494,13 @@ BOOST_PYTHON_MODULE(libpyPandora)
 		.def("setRandomPosition", &Engine::Agent::setRandomPosition)
 		.add_property("id", boost::python::make_function(&Engine::Agent::getId, boost::python::return_value_policy<boost::python::copy_const_reference>()))
 		.add_property("exists", &Engine::Agent::exists)
-		.add_property("_type", &Engine::Agent::getType)
+		.add_property("_type", boost::python::make_function(&Engine::Agent::getType, boost::python::return_value_policy<boost::python::copy_const_reference>()))
 		.add_property("position", boost::python::make_function(&Engine::Agent::getPosition, boost::python::return_value_policy<boost::python::reference_existing_object>()), &Engine::Agent::setPosition )
 	;
 	
 	boost::python::class_< std::vector<std::string> >("StringVector").def(boost::python::vector_indexing_suite< std::vector<std::string> >());
 	boost::python::class_< std::vector<int> >("IntVector").def(boost::python::vector_indexing_suite< std::vector<int> >());
+	boost::python::class_< std::vector<size_t> >("SizeVector").def(boost::python::vector_indexing_suite< std::vector<size_t> >());
 	
 	boost::python::class_< WorldWrap, boost::noncopyable >("WorldStub", boost::python::init< std::shared_ptr<ConfigWrap>, Engine::Scheduler *, const bool & >()[boost::python::with_custodian_and_ward<1,2>(),boost::python::with_custodian_and_ward<1,3>()])
 		.def("createRasters", &Engine::World::createRasters, &WorldWrap::default_createRasters)
@@ -484,13 +509,16 @@ BOOST_PYTHON_MODULE(libpyPandora)
 		.def("initialize", &WorldWrap::initializeNoArguments)
 		.def("checkPosition", &Engine::World::checkPosition)
 		.def("registerDynamicRaster", &WorldWrap::registerDynamicRasterSimple)	
+		.def("registerDynamicRaster", &WorldWrap::registerDynamicRasterTiled)
+		.def("registerDynamicRaster", &WorldWrap::registerDynamicRasterTyped)
 		.def("registerStaticRaster", &WorldWrap::registerStaticRasterSimple)	
+		.def("registerStaticRaster", &WorldWrap::registerStaticRasterTyped)
 		.def("getDynamicRaster", getDynamicRaster, boost::python::return_value_policy<boost::python::reference_existing_object>())
 		.def("getStaticRaster", getStaticRaster, boost::python::return_value_policy<boost::python::reference_existing_object>())
 		.def("run", &Engine::World::run)
-		.def("useSpacePartition", &Engine::World::useSpacePartition, boost::python::return_value_policy<boost::python::reference_existing_object>())
+		.def("useSpacePartition", &Engine::World::useSpacePartition, useSpacePartitionOverloads()[boost::python::return_value_policy<boost::python::reference_existing_object>()])
 		.staticmethod("useSpacePartition")
-		.def("useOpenMPSingleNode", &Engine::World::useOpenMPSingleNode, boost::python::return_value_policy<boost::python::reference_existing_object>())
+		.def("useOpenMPSingleNode", &Engine::World::useOpenMPSingleNode, useOpenMPSingleNodeOverloads()[boost::python::return_value_policy<boost::python::reference_existing_object>()])
 		.staticmethod("useOpenMPSingleNode")
 		.def("addAgent", &WorldWrap::addAgentSimple,boost::python::with_custodian_and_ward<1,2>())
 		.def("setValue", setValue)
@@ -506,19 +534,32 @@ BOOST_PYTHON_MODULE(libpyPandora)
 		.add_property("config", boost::python::make_function(&Engine::World::getConfig, boost::python::return_value_policy<boost::python::reference_existing_object>()))
 	;	
 	
-	boost::python::class_< Engine::SpacePartition, std::shared_ptr<Engine::SpacePartition> >("SpacePartitionStub", boost::python::init< const int &, bool >())
+	boost::python::class_< Engine::SpacePartition, std::shared_ptr<Engine::SpacePartition>, boost::noncopyable >("SpacePartitionStub", boost::python::init< const int &, bool >())
 	;
 	
 	boost::python::implicitly_convertible< std::shared_ptr< Engine::SpacePartition >, std::shared_ptr< Engine::Scheduler > >();	
 
-	boost::python::class_< Engine::OpenMPSingleNode, std::shared_ptr<Engine::OpenMPSingleNode> >("OpenMPSingleNodeStub", boost::python::init<>())
+	boost::python::class_< Engine::OpenMPSingleNode, std::shared_ptr<Engine::OpenMPSingleNode>, boost::noncopyable >("OpenMPSingleNodeStub", boost::python::init<>())
 	;
 	
 	boost::python::implicitly_convertible< std::shared_ptr< Engine::OpenMPSingleNode >, std::shared_ptr< Engine::Scheduler > >();	
 
 
-	boost::python::class_< Engine::SimulationRecord>("SimulationRecordStub", boost::python::init< int, bool >())
+	boost::python::class_< Engine::AttributeStats >("AttributeStats")
+		.def_readonly("_count", &Engine::AttributeStats::_count) 
+		.def_readonly("_sum", &Engine::AttributeStats::_sum) 
+		.def_readonly("_min", &Engine::AttributeStats::_min) 
+		.def_readonly("_max", &Engine::AttributeStats::_max) 
+		.add_property("mean", &Engine::AttributeStats::getMean)
+	;
+
+	boost::python::class_< Engine::SimulationRecord, boost::noncopyable>("SimulationRecordStub", boost::python::init< int, bool >())
 		.def("loadHDF5", &Engine::SimulationRecord::loadHDF5)
+		.def("getMean", &Engine::SimulationRecord::getMean)
+		.def("getSum", &Engine::SimulationRecord::getSum)
+		.def("getStats", &Engine::SimulationRecord::getStats)
+		.def("getCount", &Engine::SimulationRecord::getCount)
+		.def("getHistogram", &Engine::SimulationRecord::getHistogram)
 	;
 
 	boost::python::class_< PostProcess::GlobalAgentStats>("GlobalAgentsStatsStub", boost::python::init< const std::string & > ())
@@ -10,7 +10,20 @@
 #include <Size.hxx>
 #include <ShpLoader.hxx>
 #include <GeneralState.hxx>
+#include <Statistics.hxx>
 #include <Exception.hxx>
+#include <TiledRaster.hxx>
+#include <NarrowRaster.hxx>
+#include <DomainDecomposition.hxx>
+#include <SerializationThread.hxx>
+#include <Compression.hxx>
+#include <AgentColumns.hxx>
+#include <RasterHistory.hxx>
+#include <AgentTable.hxx>
+#include <SimulationRecord.hxx>
+#include <analysis/AgentMean.hxx>
+#include <analysis/AgentSum.hxx>
+#include <analysis/AgentStdDev.hxx>
 
 #include <boost/test/unit_test.hpp>
 
@@ -91,7 +104,197 @@ BOOST_AUTO_TEST_CASE( testAgentRemovedIsNotInInsideNeighbours )
 
 }
 
-BOOST_AUTO_TEST_CASE( testRectangleEquals ) 
+BOOST_AUTO_TEST_CASE( testNeighboursFollowAgentMovement ) 
+{
+	TestWorld myWorld(new Engine::Config(Engine::Size<int>(32,32), 1), TestWorld::useOpenMPSingleNode());
+	myWorld.initialize(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+
+	TestAgent * myAgent0 = new TestAgent("agent_0");
+	TestAgent * myAgent1 = new TestAgent("agent_1");
+	TestAgent * myAgent2 = new TestAgent("agent_2");
+	myWorld.addAgent(myAgent0);
+	myWorld.addAgent(myAgent1);
+	myWorld.addAgent(myAgent2);
+	myAgent0->setPosition(Engine::Point2D<int>(2,2));
+	myAgent1->setPosition(Engine::Point2D<int>(5,6));
+	myAgent2->setPosition(Engine::Point2D<int>(30,30));
+
+	BOOST_CHECK_EQUAL(myWorld.countNeighbours(myAgent0, 5), 1);
+	BOOST_CHECK_EQUAL(myWorld.countNeighbours(myAgent0, 4.9), 0);
+	BOOST_CHECK_EQUAL(myWorld.getNeighbours(myAgent0, 50).size(), 2);
+
+	// moving agents across cells of the spatial index
+	myAgent2->setPosition(Engine::Point2D<int>(3,3));
+	myAgent1->setPosition(Engine::Point2D<int>(20,2));
+	Engine::AgentsVector neighbours = myWorld.getNeighbours(myAgent0, 5);
+	BOOST_CHECK_EQUAL(neighbours.size(), 1);
+	BOOST_CHECK_EQUAL(neighbours.at(0)->getId(), "agent_2");
+	BOOST_CHECK_EQUAL(myWorld.countNeighbours(myAgent1, 17.5), 1);
+	myWorld.run();
+}
+
+BOOST_AUTO_TEST_CASE( testParallelActionsKeepIndexes ) 
+{
+	TestWorld myWorld(new Engine::Config(Engine::Size<int>(64,64), 2), TestWorld::useOpenMPSingleNode(2));
+	myWorld.initialize(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+
+	for(int i=0; i<100; i++)
+	{
+		std::stringstream oss;
+		oss << "agent_" << i;
+		TestAgent * agent = new TestAgent(oss.str());
+		myWorld.addAgent(agent);
+		agent->setRandomPosition();
+	}
+	myWorld.run();
+
+	Engine::Agent * agent = myWorld.getAgent("agent_0");
+	BOOST_CHECK(agent);
+	BOOST_CHECK_EQUAL(myWorld.countNeighbours(agent, 100), 99);
+	BOOST_CHECK(!myWorld.getAgent(agent->getPosition()).empty());
+}
+
+BOOST_AUTO_TEST_CASE( testGetAgentByIdAndPosition ) 
+{
+	TestWorld myWorld(new Engine::Config(Engine::Size<int>(10,10), 1), TestWorld::useSpacePartition(1, false));
+	myWorld.initialize(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+
+	TestAgent * myAgent0 = new TestAgent("agent_0");
+	TestAgent * myAgent1 = new TestAgent("agent_1");
+	myWorld.addAgent(myAgent0);
+	myWorld.addAgent(myAgent1);
+	myAgent0->setPosition(Engine::Point2D<int>(1,1));
+	myAgent1->setPosition(Engine::Point2D<int>(1,1));
+
+	BOOST_CHECK_EQUAL(myWorld.getAgent("agent_1"), myAgent1);
+	BOOST_CHECK_EQUAL(myWorld.getAgent(Engine::Point2D<int>(1,1)).size(), 2);
+	BOOST_CHECK_EQUAL(myWorld.getAgent(Engine::Point2D<int>(1,1), "foo").size(), 0);
+
+	myAgent1->setPosition(Engine::Point2D<int>(8,3));
+	BOOST_CHECK_EQUAL(myWorld.getAgent(Engine::Point2D<int>(1,1)).size(), 1);
+	BOOST_CHECK_EQUAL(myWorld.getAgent(Engine::Point2D<int>(8,3), "agent").size(), 1);
+
+	myAgent0->remove();
+	BOOST_CHECK(myWorld.getAgent("agent_0")==0);
+	myWorld.run();
+	BOOST_CHECK_EQUAL(myWorld.getNumberOfAgents(), 1);
+	BOOST_CHECK_EQUAL(myWorld.getAgent("agent_1"), myAgent1);
+}
+
+BOOST_AUTO_TEST_CASE( testChangeTypeKeepsIdIndexes ) 
+{
+	Engine::Scheduler * schedulers[] = {TestWorld::useOpenMPSingleNode(), TestWorld::useSpacePartition(1, false)};
+	for(int i=0; i<2; i++)
+	{
+		TestWorld myWorld(new Engine::Config(Engine::Size<int>(10,10), 1), schedulers[i]);
+		myWorld.initialize(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+
+		TestAgent * myAgent0 = new TestAgent("agent_0");
+		TestAgent * myAgent1 = new TestAgent("agent_1");
+		myWorld.addAgent(myAgent0);
+		myWorld.addAgent(myAgent1);
+		myAgent0->setPosition(Engine::Point2D<int>(2,2));
+		myAgent1->setPosition(Engine::Point2D<int>(3,3));
+
+		myAgent0->changeType("zombie");
+		BOOST_CHECK(myWorld.getAgent("agent_0")==0);
+		BOOST_CHECK_EQUAL(myWorld.getAgent("zombie_0"), myAgent0);
+		BOOST_CHECK_NO_THROW(myAgent0->remove());
+		myWorld.run();
+		BOOST_CHECK_EQUAL(myWorld.getNumberOfAgents(), 1);
+		BOOST_CHECK(myWorld.getAgent("zombie_0")==0);
+		BOOST_CHECK_EQUAL(myWorld.getAgent("agent_1"), myAgent1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE( testChangeTypeUpdatesTypeFilters ) 
+{
+	TestWorld myWorld(new Engine::Config(Engine::Size<int>(10,10), 1), TestWorld::useOpenMPSingleNode());
+	myWorld.initialize(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+
+	TestAgent * myAgent0 = new TestAgent("agent_0");
+	TestAgent * myAgent1 = new TestAgent("agent_1");
+	myWorld.addAgent(myAgent0);
+	myWorld.addAgent(myAgent1);
+	myAgent0->setPosition(Engine::Point2D<int>(2,2));
+	myAgent1->setPosition(Engine::Point2D<int>(3,3));
+
+	BOOST_CHECK_EQUAL(myAgent1->getType(), "agent");
+	BOOST_CHECK(myAgent1->isType("agent"));
+	BOOST_CHECK_EQUAL(myAgent1->getTypeId(), Engine::GeneralState::agentTypes().getId("agent"));
+	BOOST_CHECK_EQUAL(myWorld.countNeighbours(myAgent0, 5, "agent"), 1);
+	BOOST_CHECK_EQUAL(myWorld.countNeighbours(myAgent0, 5, "zombie"), 0);
+
+	myAgent1->changeType("zombie");
+	BOOST_CHECK_EQUAL(myAgent1->getId(), "zombie_1");
+	BOOST_CHECK_EQUAL(myAgent1->getType(), "zombie");
+	BOOST_CHECK(myAgent1->isType("zombie"));
+	BOOST_CHECK(!myAgent1->isType(myAgent0->getTypeId()));
+	BOOST_CHECK_EQUAL(myWorld.countNeighbours(myAgent0, 5, "agent"), 0);
+	BOOST_CHECK_EQUAL(myWorld.countNeighbours(myAgent0, 5, "zombie"), 1);
+	BOOST_CHECK_EQUAL(myWorld.getAgent(Engine::Point2D<int>(3,3), "zombie").size(), 1);
+
+	// lookups by id and removal follow the new id
+	BOOST_CHECK(myWorld.getAgent("agent_1")==0);
+	BOOST_CHECK_EQUAL(myWorld.getAgent("zombie_1"), myAgent1);
+	BOOST_CHECK_NO_THROW(myAgent1->remove());
+	myWorld.run();
+	BOOST_CHECK_EQUAL(myWorld.getNumberOfAgents(), 1);
+	BOOST_CHECK(myWorld.getAgent("zombie_1")==0);
+	BOOST_CHECK_EQUAL(myWorld.getAgent("agent_0"), myAgent0);
+}
+
+BOOST_AUTO_TEST_CASE( testRandomSeedIsReproducible ) 
+{
+	Engine::Statistics & statistics = Engine::GeneralState::statistics();
+	std::vector<int> values;
+	statistics.setSeed(42);
+	for(int i=0; i<10; i++)
+	{
+		values.push_back(statistics.getUniformDistValue(0, 1000));
+	}
+	statistics.setSeed(42);
+	for(int i=0; i<10; i++)
+	{
+		BOOST_CHECK_EQUAL(values.at(i), statistics.getUniformDistValue(0, 1000));
+	}
+	statistics.setSeed(statistics.getNewSeed());
+}
+
+BOOST_AUTO_TEST_CASE( testTaskEnginesDontDependOnThread )
+{
+	Engine::Statistics & statistics = Engine::GeneralState::statistics();
+	statistics.setSeed(42);
+	std::vector<int> expected(16);
+	for(int i=0; i<16; i++)
+	{
+		Engine::Statistics::RandomEngine engine;
+		statistics.seedTaskEngine(engine, 3, i);
+		Engine::Statistics::RandomEngine * previous = statistics.bindEngine(&engine);
+		expected.at(i) = statistics.getUniformDistValue(0, 1000000);
+		statistics.bindEngine(previous);
+	}
+	BOOST_CHECK(expected.at(0)!=expected.at(1));
+
+	// the same tasks drawn from any thread and in any order give the same values
+	std::vector<int> values(16);
+	#pragma omp parallel for schedule(dynamic)
+	for(int i=15; i>=0; i--)
+	{
+		Engine::Statistics::RandomEngine engine;
+		statistics.seedTaskEngine(engine, 3, i);
+		Engine::Statistics::RandomEngine * previous = statistics.bindEngine(&engine);
+		values.at(i) = statistics.getUniformDistValue(0, 1000000);
+		statistics.bindEngine(previous);
+	}
+	for(int i=0; i<16; i++)
+	{
+		BOOST_CHECK_EQUAL(values.at(i), expected.at(i));
+	}
+	statistics.setSeed(statistics.getNewSeed());
+}
+
+BOOST_AUTO_TEST_CASE( testRectangleEquals )
 {
 	Engine::Rectangle<int> aRectangle(5,10,20,30);
 	Engine::Rectangle<int> bRectangle(Engine::Size<int>(1,1), Engine::Point2D<int>(3,7));
@@ -216,6 +419,569 @@ BOOST_AUTO_TEST_CASE( testLoadDynamicRaster )
     BOOST_CHECK_EQUAL(139, aRaster.getValue(Engine::Point2D<int>(39,39)));
 }
 
+BOOST_AUTO_TEST_CASE( testRasterRowMajorLayout ) 
+{
+	Engine::DynamicRaster aRaster;
+	aRaster.resize(Engine::Size<int>(3,2));
+	aRaster.setInitValues(0, 10, 1);
+	aRaster.setValue(Engine::Point2D<int>(2,1), 5);
+	aRaster.setMaxValue(Engine::Point2D<int>(0,1), 7);
+
+	BOOST_CHECK_EQUAL(Engine::Size<int>(3,2), aRaster.getSize());
+	BOOST_CHECK_EQUAL(5, aRaster.getValueUnchecked(Engine::Point2D<int>(2,1)));
+	const Engine::DynamicRaster & constRaster = aRaster;
+	BOOST_CHECK_EQUAL(1, constRaster.getRow(0)[2]);
+	BOOST_CHECK_EQUAL(5, constRaster.getRow(1)[2]);
+	BOOST_CHECK_EQUAL(7, aRaster.getMaxValuesRow(1)[0]);
+
+	aRaster.getRow(0)[1] = 3;
+	BOOST_CHECK_EQUAL(3, aRaster.getValue(Engine::Point2D<int>(1,0)));
+	BOOST_CHECK_THROW(aRaster.setValue(Engine::Point2D<int>(0,1), 8), Engine::Exception);
+}
+
+struct AddThree
+{
+	int operator()( int value, int maxValue ) const { return value+3; }
+};
+
+BOOST_AUTO_TEST_CASE( testRasterUpdates ) 
+{
+	Engine::DynamicRaster aRaster;
+	aRaster.resize(Engine::Size<int>(300,300));
+	aRaster.setInitValues(0, 10, 0);
+	aRaster.setMaxValue(Engine::Point2D<int>(7,5), 1);
+	aRaster.setValue(Engine::Point2D<int>(3,3), 9);
+
+	aRaster.updateRasterIncrement();
+	BOOST_CHECK_EQUAL(1, aRaster.getValue(Engine::Point2D<int>(299,299)));
+	BOOST_CHECK_EQUAL(10, aRaster.getValue(Engine::Point2D<int>(3,3)));
+	aRaster.updateRasterIncrement();
+	BOOST_CHECK_EQUAL(1, aRaster.getValue(Engine::Point2D<int>(7,5)));
+	BOOST_CHECK_EQUAL(10, aRaster.getValue(Engine::Point2D<int>(3,3)));
+
+	aRaster.updateCurrentMinMaxValues();
+	BOOST_CHECK_EQUAL(1, aRaster.getCurrentMinValue());
+	BOOST_CHECK_EQUAL(10, aRaster.getCurrentMaxValue());
+
+	aRaster.transform(AddThree());
+	BOOST_CHECK_EQUAL(5, aRaster.getValue(Engine::Point2D<int>(0,0)));
+	BOOST_CHECK_EQUAL(1, aRaster.getValue(Engine::Point2D<int>(7,5)));
+	BOOST_CHECK_EQUAL(10, aRaster.getValue(Engine::Point2D<int>(3,3)));
+}
+
+BOOST_AUTO_TEST_CASE( testTiledRasterLazyRegrowth ) 
+{
+	Engine::TiledRaster aRaster;
+	aRaster.resize(Engine::Size<int>(100,100));
+	aRaster.setInitValues(0, 10, 10);
+	BOOST_CHECK_EQUAL(0, aRaster.getNumExpandedTiles());
+
+	aRaster.setValue(Engine::Point2D<int>(3,3), 2);
+	aRaster.setMaxValue(Engine::Point2D<int>(99,99), 5);
+	aRaster.updateRasterIncrement();
+	BOOST_CHECK_EQUAL(3, aRaster.getValue(Engine::Point2D<int>(3,3)));
+	BOOST_CHECK_EQUAL(10, aRaster.getValue(Engine::Point2D<int>(4,3)));
+	BOOST_CHECK_EQUAL(5, aRaster.getMaxValue(Engine::Point2D<int>(99,99)));
+	BOOST_CHECK_EQUAL(2, aRaster.getNumExpandedTiles());
+	BOOST_CHECK_THROW(aRaster.setValue(Engine::Point2D<int>(99,99), 6), Engine::Exception);
+
+	for(int i=0; i<7; i++)
+	{
+		aRaster.updateRasterIncrement();
+	}
+	BOOST_CHECK_EQUAL(10, aRaster.getValue(Engine::Point2D<int>(3,3)));
+	// the tile of (3,3) has regrown to its max value, so it is compressed again
+	BOOST_CHECK_EQUAL(1, aRaster.getNumExpandedTiles());
+
+	aRaster.setValue(Engine::Point2D<int>(50,50), 0);
+	std::vector<int> row(4);
+	aRaster.copyRow(50, 48, 4, &row[0]);
+	BOOST_CHECK_EQUAL(10, row[0]);
+	BOOST_CHECK_EQUAL(0, row[2]);
+
+	aRaster.updateRasterToMaxValues();
+	BOOST_CHECK_EQUAL(10, aRaster.getValue(Engine::Point2D<int>(50,50)));
+	aRaster.updateCurrentMinMaxValues();
+	BOOST_CHECK_EQUAL(5, aRaster.getCurrentMinValue());
+	BOOST_CHECK_EQUAL(10, aRaster.getCurrentMaxValue());
+}
+
+BOOST_AUTO_TEST_CASE( testNarrowRaster ) 
+{
+	Engine::NarrowDynamicRaster<unsigned char> aRaster;
+	aRaster.resize(Engine::Size<int>(50,50));
+	BOOST_CHECK_EQUAL(Engine::eRasterByte, aRaster.getValueType());
+	BOOST_CHECK_THROW(aRaster.setInitValues(0, 300, 0), Engine::Exception);
+
+	aRaster.setInitValues(0, 255, 250);
+	aRaster.setMaxValue(Engine::Point2D<int>(1,2), 251);
+	aRaster.setValue(Engine::Point2D<int>(3,4), 0);
+	BOOST_CHECK_THROW(aRaster.setValue(Engine::Point2D<int>(3,4), -1), Engine::Exception);
+
+	for(int i=0; i<10; i++)
+	{
+		aRaster.updateRasterIncrement();
+	}
+	BOOST_CHECK_EQUAL(255, aRaster.getValue(Engine::Point2D<int>(0,0)));
+	BOOST_CHECK_EQUAL(251, aRaster.getValue(Engine::Point2D<int>(1,2)));
+	BOOST_CHECK_EQUAL(10, aRaster.getValue(Engine::Point2D<int>(3,4)));
+
+	std::vector<int> row(5);
+	aRaster.copyRow(4, 0, 5, &row[0]);
+	BOOST_CHECK_EQUAL(10, row[3]);
+	BOOST_CHECK_EQUAL(255, row[4]);
+
+	aRaster.updateCurrentMinMaxValues();
+	BOOST_CHECK_EQUAL(10, aRaster.getCurrentMinValue());
+	BOOST_CHECK_EQUAL(255, aRaster.getCurrentMaxValue());
+}
+
+BOOST_AUTO_TEST_CASE( testRastersWithoutDenseBuffers ) 
+{
+	Engine::TiledRaster tiledRaster;
+	tiledRaster.resize(Engine::Size<int>(20,20));
+	tiledRaster.setInitValues(0, 10, 2);
+	tiledRaster.setMaxValue(Engine::Point2D<int>(9,9), 4);
+	Engine::NarrowDynamicRaster<unsigned char> narrowRaster;
+	narrowRaster.resize(Engine::Size<int>(20,20));
+	narrowRaster.setInitValues(0, 10, 2);
+	narrowRaster.setMaxValue(Engine::Point2D<int>(9,9), 4);
+
+	Engine::DynamicRaster * rasters[] = {&tiledRaster, &narrowRaster};
+	for(int i=0; i<2; i++)
+	{
+		Engine::DynamicRaster & aRaster = *rasters[i];
+		const Engine::DynamicRaster & constRaster = aRaster;
+		BOOST_CHECK_THROW(constRaster.getRow(0), Engine::Exception);
+		BOOST_CHECK_THROW(aRaster.getRow(0), Engine::Exception);
+		BOOST_CHECK_THROW(aRaster.getValueUnchecked(Engine::Point2D<int>(1,1)), Engine::Exception);
+		BOOST_CHECK_THROW(aRaster.setValueUnchecked(Engine::Point2D<int>(1,1), 3), Engine::Exception);
+		BOOST_CHECK_THROW(aRaster.getMaxValueUnchecked(Engine::Point2D<int>(1,1)), Engine::Exception);
+		BOOST_CHECK_THROW(aRaster.getMaxValuesRow(0), Engine::Exception);
+
+		// transform falls back to the virtual accessors
+		aRaster.transform(AddThree());
+		BOOST_CHECK_EQUAL(5, aRaster.getValue(Engine::Point2D<int>(0,0)));
+		BOOST_CHECK_EQUAL(4, aRaster.getValue(Engine::Point2D<int>(9,9)));
+		BOOST_CHECK_EQUAL(5, aRaster.getValue(Engine::Point2D<int>(19,19)));
+	}
+}
+
+BOOST_AUTO_TEST_CASE( testDomainDecomposition ) 
+{
+	Engine::DomainDecomposition decomposition;
+	// 6 partitions on a wide space are arranged in 3 columns and 2 rows
+	decomposition.init(Engine::Size<int>(120,80), 6, 4);
+	BOOST_CHECK_EQUAL(Engine::Size<int>(3,2), decomposition.getNumPartitions());
+	BOOST_CHECK_EQUAL(Engine::Rectangle<int>(Engine::Size<int>(40,40), Engine::Point2D<int>(40,40)), decomposition.getArea(4));
+	BOOST_CHECK_EQUAL(Engine::Rectangle<int>(Engine::Size<int>(41,41), Engine::Point2D<int>(0,39)), decomposition.getBoundaries(3, 1));
+	BOOST_CHECK_EQUAL(5, decomposition.getPartitionId(Engine::Point2D<int>(80,40)));
+	BOOST_CHECK_THROW(decomposition.init(Engine::Size<int>(120,80), 7, 20), Engine::Exception);
+
+	// every agent is placed in the first 30 columns
+	std::vector<double> columnCosts(120, 0.0f);
+	std::fill(columnCosts.begin(), columnCosts.begin()+30, 1.0f);
+	std::vector<double> rowCosts(80, 1.0f);
+	BOOST_CHECK(decomposition.balance(columnCosts, rowCosts));
+	BOOST_CHECK(!decomposition.balance(columnCosts, rowCosts));
+	int width = 0;
+	for(int i=0; i<3; i++)
+	{
+		Engine::Rectangle<int> area = decomposition.getArea(i);
+		BOOST_CHECK_EQUAL(0, area._size._width%2);
+		BOOST_CHECK(area._size._width>=4);
+		BOOST_CHECK_EQUAL(i, decomposition.getPartitionId(area._origin));
+		width += area._size._width;
+	}
+	BOOST_CHECK_EQUAL(120, width);
+	BOOST_CHECK_EQUAL(10, decomposition.getArea(0)._size._width);
+	BOOST_CHECK_EQUAL(10, decomposition.getArea(1)._size._width);
+	BOOST_CHECK_EQUAL(40, decomposition.getArea(3)._size._height);
+}
+
+BOOST_AUTO_TEST_CASE( testSerializationThread ) 
+{
+	Engine::SerializationThread writer(2);
+	std::vector<int> written;
+	// not running, tasks are executed by the caller
+	writer.push([&written](){ written.push_back(0); });
+	BOOST_CHECK_EQUAL(1, written.size());
+
+	writer.start();
+	for(int i=1; i<10; i++)
+	{
+		writer.push([&written, i](){ written.push_back(i); });
+	}
+	writer.flush();
+	BOOST_CHECK_EQUAL(10, written.size());
+	for(int i=0; i<10; i++)
+	{
+		BOOST_CHECK_EQUAL(i, written.at(i));
+	}
+
+	writer.push([](){ throw Engine::Exception("write failed"); });
+	BOOST_CHECK_THROW(writer.flush(), Engine::Exception);
+	writer.push([&written](){ written.push_back(10); });
+	writer.stop();
+	BOOST_CHECK_EQUAL(11, written.size());
+}
+
+BOOST_AUTO_TEST_CASE( testDeltaEncoding ) 
+{
+	Engine::RasterSnapshot snapshot;
+	snapshot._step = 0;
+	snapshot._area = Engine::Rectangle<int>(Engine::Size<int>(2,2), Engine::Point2D<int>(0,0));
+	snapshot._data.push_back(std::numeric_limits<int>::max());
+	snapshot._data.push_back(-5);
+	snapshot._data.push_back(0);
+	snapshot._data.push_back(7);
+
+	Engine::DeltaReference reference;
+	std::vector<int> deltas;
+	// the first step is always complete
+	BOOST_CHECK(!Engine::Compression::encodeDelta(reference, snapshot, deltas));
+	std::vector<int> values(snapshot._data);
+
+	for(int i=1; i<=Engine::Compression::_maxDeltas; i++)
+	{
+		snapshot._step = i;
+		snapshot._data[0] = std::numeric_limits<int>::min()+i;
+		snapshot._data[3] += i;
+		BOOST_CHECK(Engine::Compression::encodeDelta(reference, snapshot, deltas));
+		BOOST_CHECK_EQUAL(0, deltas[2]);
+		BOOST_CHECK_EQUAL(i, deltas[3]);
+		Engine::Compression::decodeDelta(values, deltas);
+		BOOST_CHECK(values==snapshot._data);
+	}
+	// complete step after _maxDeltas, and when the area changes
+	snapshot._step++;
+	BOOST_CHECK(!Engine::Compression::encodeDelta(reference, snapshot, deltas));
+	snapshot._step++;
+	BOOST_CHECK(Engine::Compression::encodeDelta(reference, snapshot, deltas));
+	snapshot._area._origin._x = 1;
+	BOOST_CHECK(!Engine::Compression::encodeDelta(reference, snapshot, deltas));
+}
+
+BOOST_AUTO_TEST_CASE( testAgentColumns ) 
+{
+	Engine::AgentColumns columns("Bird");
+	int x = columns.addIntColumn("x");
+	BOOST_CHECK_EQUAL(x, columns.addIntColumn("x"));
+	int speed = columns.addFloatColumn("speed");
+	int id = columns.addStringColumn("id");
+	BOOST_CHECK_EQUAL(-1, columns.getIntHandle("speed"));
+	BOOST_CHECK_THROW(columns.addFloatColumn("x"), Engine::Exception);
+
+	for(int i=0; i<3; i++)
+	{
+		columns.beginAgent();
+		columns.addString("id", "bird");
+		columns.addInt("x", i);
+		columns.addFloat("speed", 0.5f*i);
+	}
+	// an agent serializing its attributes in a different order
+	columns.beginAgent();
+	columns.addFloat("speed", 2.0f);
+	columns.addInt("x", 3);
+	columns.addString("id", "bird");
+	BOOST_CHECK_THROW(columns.addInt("y", 0), Engine::Exception);
+
+	BOOST_CHECK_EQUAL(4, columns.getNumAgents());
+	BOOST_CHECK_EQUAL(3, columns.getIntColumn(x).at(3));
+	BOOST_CHECK_EQUAL(2.0f, columns.getFloatColumn(speed).at(3));
+
+	Engine::AgentColumns snapshot;
+	columns.moveValues(snapshot);
+	BOOST_CHECK_EQUAL("Bird", snapshot.getType());
+	BOOST_CHECK_EQUAL(4, snapshot.getNumAgents());
+	BOOST_CHECK_EQUAL(4, snapshot.getStringColumn(snapshot.getStringHandle("id")).size());
+	BOOST_CHECK_EQUAL(0, columns.getNumAgents());
+	BOOST_CHECK_EQUAL(0, columns.getIntColumn(x).size());
+	BOOST_CHECK_EQUAL(id, snapshot.getStringHandle("id"));
+}
+
+void writeTestRange( const hid_t & objectId, int minValue, int maxValue )
+{
+	hid_t attributeSpace = H5Screate(H5S_SCALAR);
+	hid_t attributeId = H5Acreate(objectId, "minValue", H5T_NATIVE_INT, attributeSpace, H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attributeId, H5T_NATIVE_INT, &minValue);
+	H5Aclose(attributeId);
+	attributeId = H5Acreate(objectId, "maxValue", H5T_NATIVE_INT, attributeSpace, H5P_DEFAULT, H5P_DEFAULT);
+	H5Awrite(attributeId, H5T_NATIVE_INT, &maxValue);
+	H5Aclose(attributeId);
+	H5Sclose(attributeSpace);
+}
+
+BOOST_AUTO_TEST_CASE( testRasterHistory ) 
+{
+	hid_t fileId = H5Fcreate("rasterHistory.h5", H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+	hid_t groupId = H5Gcreate(fileId, "/resources", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+	hsize_t dims[2] = {2, 2};
+	hid_t spaceId = H5Screate_simple(2, dims, NULL);
+	for(int i=0; i<3; i++)
+	{
+		std::ostringstream oss;
+		oss << "/resources/step" << i;
+		int values[4] = {i, i+1, i+2, i+3};
+		hid_t datasetId = H5Dcreate(fileId, oss.str().c_str(), H5T_NATIVE_INT, spaceId, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+		H5Dwrite(datasetId, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, values);
+		H5Dclose(datasetId);
+	}
+	H5Sclose(spaceId);
+	H5Gclose(groupId);
+
+	Engine::RasterCache cache(1);
+	Engine::RasterHistory history;
+	// the last step was never written
+	history.init("resources", fileId, 4, 1, Engine::Size<int>(2,2), &cache);
+	BOOST_CHECK_EQUAL(4, history.size());
+	BOOST_CHECK_EQUAL(3, history[1].getValue(Engine::Point2D<int>(0,1)));
+	BOOST_CHECK_EQUAL(5, static_cast<const Engine::StaticRaster &>(history[1]).getMaxValue());
+	BOOST_CHECK_EQUAL(0, history[1].getMinValue());
+	BOOST_CHECK_EQUAL(1, cache.getSize());
+	// loading another step releases the previous one
+	BOOST_CHECK_EQUAL(2, history[2].getValue(Engine::Point2D<int>(0,0)));
+	BOOST_CHECK_EQUAL(1, cache.getSize());
+	BOOST_CHECK_EQUAL(1, history[1].getValue(Engine::Point2D<int>(0,0)));
+	BOOST_CHECK_EQUAL(Engine::Size<int>(2,2), history[3].getSize());
+	BOOST_CHECK_THROW(history.at(4), Engine::Exception);
+
+	cache.setCapacity(0);
+	history[0];
+	history[1];
+	BOOST_CHECK_EQUAL(3, cache.getSize());
+
+	// ranges stored by the serializers are used instead of the values: first the range of each step
+	for(int i=0; i<3; i++)
+	{
+		std::ostringstream oss;
+		oss << "/resources/step" << i;
+		hid_t datasetId = H5Dopen(fileId, oss.str().c_str(), H5P_DEFAULT);
+		writeTestRange(datasetId, -i, 10+i);
+		H5Dclose(datasetId);
+	}
+	Engine::RasterHistory stepRanges;
+	stepRanges.init("resources", fileId, 4, 1, Engine::Size<int>(2,2), &cache);
+	BOOST_CHECK_EQUAL(-2, stepRanges[0].getMinValue());
+	BOOST_CHECK_EQUAL(12, static_cast<const Engine::StaticRaster &>(stepRanges[0]).getMaxValue());
+
+	// and the range of the whole raster if it exists
+	groupId = H5Gopen(fileId, "/resources", H5P_DEFAULT);
+	writeTestRange(groupId, -5, 50);
+	H5Gclose(groupId);
+	Engine::RasterHistory groupRange;
+	groupRange.init("resources", fileId, 4, 1, Engine::Size<int>(2,2), &cache);
+	BOOST_CHECK_EQUAL(-5, groupRange[2].getMinValue());
+	BOOST_CHECK_EQUAL(50, static_cast<const Engine::StaticRaster &>(groupRange[2]).getMaxValue());
+	H5Fclose(fileId);
+}
+
+BOOST_AUTO_TEST_CASE( testAgentTable ) 
+{
+	Engine::AgentTable table;
+	table.init("Bird", 2);
+	BOOST_CHECK_EQUAL(0, table.addAgent("b"));
+	BOOST_CHECK_EQUAL(1, table.addAgent("a"));
+	BOOST_CHECK_EQUAL(0, table.addAgent("b"));
+	BOOST_CHECK_EQUAL(-1, table.getAgentIndex("c"));
+
+	int x = table.addIntColumn("x");
+	int speed = table.addFloatColumn("speed");
+	int name = table.addStrColumn("name");
+	BOOST_CHECK_EQUAL(x, table.addIntColumn("x"));
+	BOOST_CHECK_EQUAL(-1, table.getFloatColumn("x"));
+	for(int step=0; step<2; step++)
+	{
+		std::vector<int> & exists = table.getIntStep(table.getExistsColumn(), step);
+		std::vector<int> & xs = table.getIntStep(x, step);
+		std::vector<float> & speeds = table.getFloatStep(speed, step);
+		for(size_t i=0; i<table.getNumAgents(); i++)
+		{
+			exists[i] = 1;
+			xs[i] = step+i;
+			speeds[i] = 0.5f*i;
+		}
+		table.getStrStep(name, step)[0] = table.encodeString("bird");
+		// agent added once the first step is filled
+		table.addAgent("c");
+	}
+
+	const Engine::AgentRecord & record = table.getRecord(table.getAgentIndex("a"));
+	BOOST_CHECK_EQUAL("a", record.getId());
+	BOOST_CHECK_EQUAL(2, record.getInt(1, "x"));
+	BOOST_CHECK_EQUAL(0.5f, record.getFloat(0, "speed"));
+	BOOST_CHECK_EQUAL("", record.getStr(0, "name"));
+	BOOST_CHECK_EQUAL("bird", table.getRecord(0).getStr(1, "name"));
+	BOOST_CHECK(record.isFloat("speed"));
+	BOOST_CHECK_THROW(record.getInt(0, "speed"), Engine::Exception);
+	// records are iterated by id
+	BOOST_CHECK_EQUAL("a", table.beginRecords()->first);
+	BOOST_CHECK_EQUAL(0, table.getRecord(table.getAgentIndex("c")).getInt(0, "x"));
+	BOOST_CHECK_EQUAL(1, table.getRecord(table.getAgentIndex("c")).getInt(1, "exists"));
+
+	Engine::AttributeStats stats;
+	table.aggregate("x", 1, 1, stats);
+	BOOST_CHECK_EQUAL(3, stats._count);
+	BOOST_CHECK_EQUAL(6.0, stats._sum);
+	BOOST_CHECK_EQUAL(1.0, stats._min);
+	BOOST_CHECK_EQUAL(3.0, stats._max);
+	table.aggregate("speed", 0, 1, stats);
+	BOOST_CHECK_EQUAL(8, stats._count);
+	BOOST_CHECK_THROW(table.aggregate("name", 0, 1, stats), Engine::Exception);
+	BOOST_CHECK_THROW(table.aggregate("x", 0, 2, stats), Engine::Exception);
+
+	// x is 0 and 1 in the first step, and 1, 2 and 3 in the second one
+	std::vector<size_t> bins;
+	table.histogram("x", 0, 1, 1.0, 2.0, bins);
+	BOOST_CHECK_EQUAL(2, bins.size());
+	BOOST_CHECK_EQUAL(3, bins[0]);
+	BOOST_CHECK_EQUAL(1, bins[1]);
+
+	// agents without y are not located
+	std::vector<int> indices;
+	table.getAgentsAt(1, Engine::Point2D<int>(2,0), indices);
+	BOOST_CHECK(indices.empty());
+	table.addIntColumn("y");
+	table.getAgentsAt(1, Engine::Point2D<int>(2,0), indices);
+	BOOST_CHECK_EQUAL(1, indices.size());
+	BOOST_CHECK_EQUAL("a", table.getRecord(indices[0]).getId());
+}
+
+void writeTestDataset( const hid_t & groupId, const std::string & name, const hid_t & type, hsize_t size, const void * values, bool dictionary )
+{
+	hid_t spaceId = H5Screate_simple(1, &size, NULL);
+	hid_t datasetId = H5Dcreate(groupId, name.c_str(), type, spaceId, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+	H5Dwrite(datasetId, type, H5S_ALL, H5S_ALL, H5P_DEFAULT, values);
+	if(dictionary)
+	{
+		hid_t attributeSpace = H5Screate(H5S_SCALAR);
+		hid_t attributeId = H5Acreate(datasetId, "dictionary", H5T_NATIVE_INT, attributeSpace, H5P_DEFAULT, H5P_DEFAULT);
+		int dictionaryDataset = 1;
+		H5Awrite(attributeId, H5T_NATIVE_INT, &dictionaryDataset);
+		H5Aclose(attributeId);
+		H5Sclose(attributeSpace);
+	}
+	H5Dclose(datasetId);
+	H5Sclose(spaceId);
+}
+
+BOOST_AUTO_TEST_CASE( testSimulationRecord ) 
+{
+	hid_t fileId = H5Fcreate("./recordTest.h5", H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+	hid_t attributeSpace = H5Screate(H5S_SCALAR);
+	hid_t globalSpace = H5Screate(H5S_SCALAR);
+	hid_t globalId = H5Dcreate(fileId, "global", H5T_NATIVE_INT, globalSpace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+	const char * names[5] = {"numSteps", "serializerResolution", "numTasks", "width", "height"};
+	int values[5] = {1, 1, 1, 10, 10};
+	for(int i=0; i<5; i++)
+	{
+		hid_t attributeId = H5Acreate(globalId, names[i], H5T_NATIVE_INT, attributeSpace, H5P_DEFAULT, H5P_DEFAULT);
+		H5Awrite(attributeId, H5T_NATIVE_INT, &values[i]);
+		H5Aclose(attributeId);
+	}
+	H5Dclose(globalId);
+	H5Sclose(globalSpace);
+	H5Sclose(attributeSpace);
+	H5Fclose(fileId);
+
+	// two agents in the first step, and one in the second
+	fileId = H5Fcreate("./agents.abm", H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+	const char dictionary[] = "b\0a\0bird";
+	writeTestDataset(fileId, "dictionary", H5T_NATIVE_CHAR, sizeof(dictionary), dictionary, false);
+	hid_t typeId = H5Gcreate(fileId, "Bird", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+	int ids[2][2] = {{0, 1}, {1, 0}};
+	int xs[2][2] = {{3, 4}, {7, 0}};
+	float speeds[2][2] = {{0.5f, 1.5f}, {2.0f, 0.0f}};
+	int birds[2] = {2, 2};
+	for(int i=0; i<2; i++)
+	{
+		std::ostringstream oss;
+		oss << "step" << i;
+		hid_t stepId = H5Gcreate(typeId, oss.str().c_str(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+		writeTestDataset(stepId, "id", H5T_NATIVE_INT, 2-i, ids[i], true);
+		writeTestDataset(stepId, "x", H5T_NATIVE_INT, 2-i, xs[i], false);
+		writeTestDataset(stepId, "y", H5T_NATIVE_INT, 2-i, xs[i], false);
+		writeTestDataset(stepId, "speed", H5T_NATIVE_FLOAT, 2-i, speeds[i], false);
+		writeTestDataset(stepId, "name", H5T_NATIVE_INT, 2-i, birds, true);
+		H5Gclose(stepId);
+	}
+	H5Gclose(typeId);
+	H5Fclose(fileId);
+
+	Engine::SimulationRecord record(1, false);
+	BOOST_CHECK(record.loadHDF5("./recordTest.h5", false, true));
+	BOOST_CHECK(record.hasAgentType("Bird"));
+	BOOST_CHECK_EQUAL(7.0, record.getSum("Bird", "x", 0));
+	BOOST_CHECK_EQUAL(1.0, record.getMean("Bird", "speed", 0));
+	BOOST_CHECK_EQUAL(7, record.getMaxInt("x"));
+	BOOST_CHECK_EQUAL(0.5f, record.getMinFloat("speed"));
+
+	Engine::SimulationRecord::AgentRecordsMap::const_iterator it = record.beginAgents("Bird");
+	BOOST_CHECK_EQUAL("a", it->first);
+	BOOST_CHECK_EQUAL(7, it->second->getInt(1, "x"));
+	BOOST_CHECK_EQUAL("bird", it->second->getStr(0, "name"));
+	it++;
+	BOOST_CHECK_EQUAL(0, it->second->getInt(1, "exists"));
+	BOOST_CHECK_EQUAL(1, record.getAgentsAtPosition(1, Engine::Point2D<int>(7,7)).size());
+	BOOST_CHECK_EQUAL(3, record.getCount("Bird", 0, 1));
+	BOOST_CHECK_EQUAL(2.0, record.getStats("Bird", "speed", 0, 1)._max);
+	BOOST_CHECK_EQUAL(2, record.getHistogram("Bird", "x", 0, 1, 0.0, 4.0).size());
+}
+
+BOOST_AUTO_TEST_CASE( testMergeAnalyses ) 
+{
+	Engine::AgentTable table;
+	table.init("Bird", 2);
+	for(int i=0; i<5; i++)
+	{
+		std::stringstream id;
+		id << "bird_" << i;
+		table.addAgent(id.str());
+	}
+	int x = table.addIntColumn("x");
+	for(int step=0; step<2; step++)
+	{
+		std::vector<int> & exists = table.getIntStep(table.getExistsColumn(), step);
+		std::vector<int> & xs = table.getIntStep(x, step);
+		for(size_t i=0; i<table.getNumAgents(); i++)
+		{
+			// the last agent only exists in the second step
+			exists[i] = (step==1 || i<4);
+			xs[i] = (step+1)*i;
+		}
+	}
+
+	PostProcess::AgentMean mean("x");
+	PostProcess::AgentSum sum("x");
+	PostProcess::AgentStdDev stdDev("x");
+	PostProcess::AgentAnalysis * analyses[] = {&mean, &sum, &stdDev};
+	for(int j=0; j<3; j++)
+	{
+		BOOST_CHECK(analyses[j]->isMergeable());
+		analyses[j]->setNumTimeSteps(2);
+		analyses[j]->preProcess();
+		// records split between two partial copies
+		PostProcess::AgentAnalysis * first = analyses[j]->clone();
+		PostProcess::AgentAnalysis * second = analyses[j]->clone();
+		first->preProcess();
+		second->preProcess();
+		for(size_t i=0; i<table.getNumAgents(); i++)
+		{
+			(i<2 ? first : second)->computeAgent(table.getRecord(i));
+		}
+		analyses[j]->merge(*first);
+		analyses[j]->merge(*second);
+		analyses[j]->postProcess();
+		delete first;
+		delete second;
+	}
+	BOOST_CHECK_CLOSE(1.5, (double)mean.getResult(0), 0.001);
+	BOOST_CHECK_CLOSE(4.0, (double)mean.getResult(1), 0.001);
+	BOOST_CHECK_CLOSE(10.0, (double)sum.getResult(0), 0.001);
+	BOOST_CHECK_CLOSE(20.0, (double)sum.getResult(1), 0.001);
+	BOOST_CHECK_CLOSE(sqrt(8.0), (double)stdDev.getResult(1), 0.001);
+}
+
 BOOST_AUTO_TEST_CASE( testAddAgent) 
 {
 	TestWorld myWorld(new Engine::Config(Engine::Size<int>(10,10), 1), TestWorld::useSpacePartition(1, false));
@@ -54,14 +54,4 @@ void MpiFactory::registerTypes()
 {
 }
 
-Engine::Agent * MpiFactory::createAndFillAgent( const std::string & type, void * package )
-{
-	return 0;
-}
-
-void * MpiFactory::createDefaultPackage( const std::string & type )
-{
-	return 0;
-}
-
 } // namespace Engine